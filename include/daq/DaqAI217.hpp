@@ -12,6 +12,10 @@ namespace Daq
     class DaqAI217 : public UeiDaqDevice
     {
     public:
+        // 設定 Batch 大小
+        // 100Hz 取樣下，設定 10 代表每 0.1秒送一次 UDP 封包
+        static const int BATCH_SIZE = 10;
+
         DaqAI217(const Utils::TaskConfig &config);
         virtual ~DaqAI217();
 
@@ -23,7 +27,10 @@ namespace Daq
 
     private:
         // 解析 Gain 設定值轉為 SDK 參數
-        int GetGainCode(int gainVal);
+        static int GetGainCode(int gainVal);
+
+        // 設定取樣時脈，回傳依實際頻率計算的迴圈週期
+        bool SetClock(int device, double sampleRate, long &periodUs);
     };
 
 } // namespace Daq
\ No newline at end of file
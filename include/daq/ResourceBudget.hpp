@@ -0,0 +1,52 @@
+//=============================================================================
+// NAME:    include/daq/ResourceBudget.hpp
+// DESC:    設定可行性 / 資源預算估算：啟動 (或熱重新載入) 前檢查 Controller 與鏈路能否負荷
+//=============================================================================
+#pragma once
+
+#include "utils/UeiStructs.h"
+#include <string>
+#include <vector>
+
+namespace Daq
+{
+
+    // 單一 Task 的估算結果
+    struct TaskBudget
+    {
+        int deviceId = 0;
+        std::string taskName;
+        int numChannels = 0;
+        double sampleRate = 0.0;
+        double samplesPerSec = 0.0;      // 所有通道合計
+        double payloadBytesPerSec = 0.0; // 編碼後 Payload
+        double wireBitsPerSec = 0.0;     // 單一目標的鏈路位元率 (含 Header / 分段 / FEC / UDP+IP)
+        double datagramsPerSec = 0.0;    // 單一目標
+        double memoryBytes = 0.0;        // 裝置佇列 + 處理緩衝區
+        double cpuPercent = 0.0;         // 擷取 + 處理 + 編碼 + FEC + 發送
+    };
+
+    // 全系統估算結果與超出預算的項目
+    struct BudgetReport
+    {
+        std::vector<TaskBudget> tasks;
+        double samplesPerSec = 0.0;
+        double linkBitsPerSec = 0.0; // 所有目標 (Unicast / Multicast / TCP Client) 合計
+        double linkLimitBitsPerSec = 0.0;
+        double memoryBytes = 0.0; // Task + 共用佇列 / Ring / 重送歷史
+        double cpuPercent = 0.0;
+        std::vector<std::string> violations;
+
+        bool Exceeded() const { return !violations.empty(); }
+    };
+
+    /**
+     * @brief 依設定與 resource_budget 的各階段成本估算吞吐量、頻寬、記憶體與 CPU
+     * 所有 Task 以 AI-217 擷取迴圈估算 (每個 Frame 一次讀取，Batch 為 DaqAI217::BATCH_SIZE)；
+     * TCP Client 以 max_clients 計算 (最壞情況)，NACK 重送流量依遺失率而定，不列入。
+     */
+    BudgetReport EstimateBudget(const Utils::SystemConfig &config);
+
+    void PrintBudget(const BudgetReport &report);
+
+} // namespace Daq
@@ -5,12 +5,15 @@
 #pragma once
 
 #include "utils/UeiStructs.h"
+#include "utils/StageMonitor.hpp"
 #include <vector>
 #include <string>
 #include <thread>
 #include <atomic>
 #include <queue>
 #include <mutex>
+#include <utility>
+#include <memory>
 #include <cstdint> // for uint32_t
 #include <sys/time.h>
 
@@ -21,15 +24,30 @@ namespace Daq
     struct RawDataPacket
     {
         double timestamp;              // 第一筆資料的時間戳記
+        uint64_t timestampNs;          // 同上 (Unix Epoch 奈秒，供 v2 Header)
+        uint64_t firstSampleIndex;     // 第一筆資料在本裝置的累計樣本序號
         std::vector<uint32_t> rawData; // [變更] 原始 ADC Code (uint32)
         int numSamples;                // [新增] 這個 Batch 包含多少個取樣點
+        Utils::TaskConfigPtr config;   // 擷取此 Batch 時使用的設定 (通道 / 取樣率 / 編碼)
+    };
+
+    // 擷取健康統計 (Status 封包用)
+    struct DeviceHealth
+    {
+        uint64_t samples = 0;      // 累計取樣數
+        uint64_t readErrors = 0;   // 讀取失敗次數
+        double jitterAvgUs = 0.0;  // 讀取迴圈實際週期與設定週期的平均偏差
+        int64_t jitterMaxUs = 0;   // 最大偏差
     };
 
     class UeiDaqDevice
     {
     public:
+        // 裝置佇列最多保留的 Batch 數 (超過時捨棄最舊者)
+        static const size_t MAX_QUEUE_BATCHES = 100;
+
         UeiDaqDevice(const Utils::TaskConfig &config)
-            : m_config(config), m_running(false), m_handle(0) {}
+            : m_config(std::make_shared<Utils::TaskConfig>(config)), m_configGen(0), m_running(false), m_handle(0) {}
 
         virtual ~UeiDaqDevice() { Stop(); }
 
@@ -59,12 +77,36 @@ namespace Daq
             std::unique_lock<std::mutex> lock(m_queueMutex);
             if (m_dataQueue.empty())
                 return false;
-            packet = m_dataQueue.front();
+            packet = std::move(m_dataQueue.front());
             m_dataQueue.pop();
+            m_monitor.RecordDepth(m_dataQueue.size());
             return true;
         }
 
-        const Utils::TaskConfig &GetConfig() const { return m_config; }
+        // 目前生效的設定快照
+        Utils::TaskConfigPtr GetConfig() const { return std::atomic_load(&m_config); }
+
+        /**
+         * @brief 執行中替換設定 (RCU：發布新快照，擷取迴圈於下一個 Batch 邊界改用)
+         * 擷取中的不完整 Batch 以舊設定送出，不會捨棄；IOM 不重新開啟。
+         */
+        void UpdateConfig(const Utils::TaskConfig &config)
+        {
+            std::atomic_store(&m_config, Utils::TaskConfigPtr(std::make_shared<Utils::TaskConfig>(config)));
+            m_configGen++;
+        }
+
+        // 擷取階段統計 (服務時間 = 一次讀取迴圈的處理時間)
+        Utils::StageStats GetStats() const { return m_monitor.Snapshot(); }
+
+        DeviceHealth GetHealth() const
+        {
+            std::lock_guard<std::mutex> lock(m_healthMutex);
+            DeviceHealth health = m_health;
+            if (m_jitterCount > 0)
+                health.jitterAvgUs = (double)m_jitterTotalUs / m_jitterCount;
+            return health;
+        }
 
     protected:
         // --- 內部使用 ---
@@ -75,22 +117,56 @@ namespace Daq
             std::lock_guard<std::mutex> lock(m_queueMutex);
             m_dataQueue.push(packet);
 
-            // 避免佇列無限膨脹 (例如保留最新 100 筆 Batch)
-            if (m_dataQueue.size() > 100)
+            // 避免佇列無限膨脹 (保留最新 MAX_QUEUE_BATCHES 筆 Batch)
+            if (m_dataQueue.size() > MAX_QUEUE_BATCHES)
             {
                 m_dataQueue.pop();
+                m_monitor.RecordDrop();
             }
+            m_monitor.RecordDepth(m_dataQueue.size());
+        }
+
+        void RecordSamples(int count)
+        {
+            std::lock_guard<std::mutex> lock(m_healthMutex);
+            m_health.samples += count;
+        }
+
+        // 回傳累計失敗次數 (供呼叫端決定是否印出錯誤，避免洗版)
+        uint64_t RecordReadError()
+        {
+            std::lock_guard<std::mutex> lock(m_healthMutex);
+            return ++m_health.readErrors;
+        }
+
+        void RecordJitter(int64_t jitterUs)
+        {
+            if (jitterUs < 0)
+                jitterUs = -jitterUs;
+            std::lock_guard<std::mutex> lock(m_healthMutex);
+            m_jitterTotalUs += jitterUs;
+            m_jitterCount++;
+            if (jitterUs > m_health.jitterMaxUs)
+                m_health.jitterMaxUs = jitterUs;
         }
 
         virtual void DaqLoop() = 0;
 
-        Utils::TaskConfig m_config;
+        // 擷取迴圈比較 m_configGen 得知有新快照，才以 atomic_load 取得 (平常只讀一個整數)
+        Utils::TaskConfigPtr m_config;
+        std::atomic<uint64_t> m_configGen;
         std::atomic<bool> m_running;
         int m_handle;
         std::thread m_workerThread;
 
         std::queue<RawDataPacket> m_dataQueue;
         std::mutex m_queueMutex;
+        Utils::StageMonitor m_monitor;
+
+        mutable std::mutex m_healthMutex;
+        DeviceHealth m_health;
+        int64_t m_jitterTotalUs = 0;
+        uint64_t m_jitterCount = 0;
     };
 
 } // namespace Daq
\ No newline at end of file
@@ -0,0 +1,156 @@
+/**
+ * @file ArchiveWriter.hpp
+ * @brief 接收端長時間保存：每個裝置 / 通道為獨立欄位 (Column) 的 mmap Segment 檔
+ *
+ * 每個裝置各自寫入一連串 Segment 檔，檔案建立時即以 fallocate 配置完整大小並 mmap，
+ * 寫入只有記憶體複製 (interleaved -> 各通道欄位)，不經 write() 系統呼叫。
+ *
+ * Segment 檔配置 (Writer Host Order，以 endianTag 判別)：
+ *   [0, 4096)                ArchiveSegmentHeader
+ *   [indexOffset, ...)       ArchiveIndexEntry[indexCapacity] (每個 Batch 一筆)
+ *   [columnOffset + c * columnStride, ...)   通道 c 的 uint32 Code，共 rowCapacity 筆
+ * 欄位起點皆對齊 Page，Reader mmap 後可直接以指標存取，不需解析。
+ *
+ * Segment 於下列情況結束並換新檔：欄位或 Index 已滿、資料時間跨度超過 maxSegmentSec、
+ * 裝置的通道數 / 取樣率改變。寫入中的檔案副檔名為 .part，結束後 state = Complete 並改名為 .uarc。
+ * 序號缺口不補零：Index 的 firstSampleIndex 記錄每個 Batch 在裝置上的樣本序號，Reader 可由此判斷缺口。
+ */
+#pragma once
+
+#include "net/UdpReceiver.hpp"
+#include <string>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    static const char ARCHIVE_MAGIC[8] = {'U', 'E', 'I', 'A', 'R', 'C', '0', '1'};
+    static const uint32_t ARCHIVE_ENDIAN_TAG = 0x01020304;
+    static const uint32_t ARCHIVE_VERSION = 1;
+    static const size_t ARCHIVE_HEADER_SIZE = 4096;
+
+    enum class ArchiveState : uint32_t
+    {
+        Open = 0,    // 寫入中 (rowCount / indexCount 隨時增加)
+        Complete = 1 // 已結束，內容不再改變
+    };
+
+    // Segment 檔頭 (固定於檔案開頭，其餘空間保留為 0)
+    struct ArchiveSegmentHeader
+    {
+        char magic[8];
+        uint32_t endianTag;
+        uint32_t version;
+        uint32_t headerBytes;
+        uint32_t state; // ArchiveState
+        uint16_t deviceId;
+        uint16_t numChannels;
+        uint32_t channelMask;
+        double sampleRate;
+        uint64_t segmentSeq; // 同一裝置的第幾個 Segment
+        uint64_t createdNs;  // 建立時間 (CLOCK_REALTIME)
+
+        uint64_t indexOffset;
+        uint32_t indexCapacity;
+        uint32_t indexCount;
+
+        uint64_t columnOffset;
+        uint64_t columnStride; // 每個通道欄位的 Byte 數 (Page 對齊)
+        uint64_t rowCapacity;
+        uint64_t rowCount;
+
+        uint64_t firstSeq;
+        uint64_t lastSeq;
+        uint64_t firstTimestampNs;
+        uint64_t lastTimestampNs; // 最後一個 Batch 的時間戳
+        uint64_t flagsOr;         // 所有 Batch 的 flags OR (例如 WIRE_FLAG_TIME_CORRECTED)
+    };
+
+    // 每個 Batch (或跨 Segment 時的一部分) 一筆
+    struct ArchiveIndexEntry
+    {
+        uint64_t seqId;
+        uint64_t firstSampleIndex; // 本段第一筆在裝置上的累計樣本序號
+        uint64_t timestampNs;      // 本段第一筆的時間
+        uint64_t row;              // 本段在欄位中的起始列
+        uint32_t numSamples;
+        uint32_t flags;
+    };
+
+    struct ArchiveOptions
+    {
+        std::string directory = ".";
+        size_t segmentBytes = 256 * 1024 * 1024; // 每個 Segment 檔大小 (預先配置)
+        long maxSegmentSec = 3600;               // 資料時間跨度上限 (0 = 不限)
+        long syncIntervalMs = 1000;              // msync(MS_ASYNC) 間隔 (0 = 只在結束時)
+    };
+
+    class ArchiveWriter
+    {
+    public:
+        ArchiveWriter();
+        ~ArchiveWriter();
+
+        bool Open(const ArchiveOptions &options);
+
+        /**
+         * @brief 寫入一個解碼後的 Batch (Batch 超過 Segment 剩餘空間時分拆至下一個 Segment)
+         * @return false 無法建立 Segment 檔 (磁碟空間不足等)
+         */
+        bool Append(const DecodedBatch &batch);
+
+        // 結束所有寫入中的 Segment (改名為 .uarc)
+        void Close();
+
+        uint64_t GetSegmentsCompleted() const { return m_segmentsCompleted; }
+        uint64_t GetSamplesWritten() const { return m_samplesWritten; }
+        uint64_t GetBytesWritten() const { return m_bytesWritten; }
+
+    private:
+        struct Segment
+        {
+            int fd = -1;
+            uint8_t *base = NULL;
+            size_t mappedBytes = 0;
+            std::string path;
+            uint64_t nextSegmentSeq = 0;
+            int64_t lastSyncUs = 0;
+            ArchiveSegmentHeader *header = NULL;
+        };
+
+        bool CreateSegment(Segment &seg, const PacketHeader &h);
+        void FinishSegment(Segment &seg);
+        bool NeedsRollover(const Segment &seg, const PacketHeader &h) const;
+
+        ArchiveOptions m_options;
+        bool m_open;
+        std::map<uint16_t, Segment> m_segments;
+
+        uint64_t m_segmentsCompleted;
+        uint64_t m_samplesWritten;
+        uint64_t m_bytesWritten;
+    };
+
+    /**
+     * @brief 唯讀 mmap 一個 Segment 檔 (.uarc 或寫入中的 .part)
+     */
+    class ArchiveSegmentReader
+    {
+    public:
+        ArchiveSegmentReader();
+        ~ArchiveSegmentReader();
+
+        bool Open(const std::string &path);
+        void Close();
+
+        const ArchiveSegmentHeader &Header() const { return *m_header; }
+        const ArchiveIndexEntry *Index() const;
+        const uint32_t *Column(int channel) const;
+
+    private:
+        uint8_t *m_base;
+        size_t m_size;
+        const ArchiveSegmentHeader *m_header;
+    };
+}
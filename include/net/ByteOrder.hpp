@@ -0,0 +1,70 @@
+/**
+ * @file ByteOrder.hpp
+ * @brief Big Endian (Network Order) 讀寫工具，供封包序列化 / 解析使用
+ *
+ * 以逐 Byte 方式存取，不受對齊與主機 Endian 影響 (PPC 與 x86 皆可用)。
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Net
+{
+    // 主機是否為 Big Endian (即線路順序；Controller 的 PPC 為 true)
+    inline bool HostIsBigEndian()
+    {
+        const uint16_t probe = 1;
+        return *reinterpret_cast<const uint8_t *>(&probe) == 0;
+    }
+
+    inline void WriteBe16(uint8_t *p, uint16_t v)
+    {
+        p[0] = (uint8_t)(v >> 8);
+        p[1] = (uint8_t)v;
+    }
+
+    inline void WriteBe32(uint8_t *p, uint32_t v)
+    {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+
+    inline void WriteBe64(uint8_t *p, uint64_t v)
+    {
+        WriteBe32(p, (uint32_t)(v >> 32));
+        WriteBe32(p + 4, (uint32_t)v);
+    }
+
+    inline void WriteBeDouble(uint8_t *p, double v)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        WriteBe64(p, bits);
+    }
+
+    inline uint16_t ReadBe16(const uint8_t *p)
+    {
+        return (uint16_t)((p[0] << 8) | p[1]);
+    }
+
+    inline uint32_t ReadBe32(const uint8_t *p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    }
+
+    inline uint64_t ReadBe64(const uint8_t *p)
+    {
+        return ((uint64_t)ReadBe32(p) << 32) | ReadBe32(p + 4);
+    }
+
+    inline double ReadBeDouble(const uint8_t *p)
+    {
+        uint64_t bits = ReadBe64(p);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+}
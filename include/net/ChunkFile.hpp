@@ -0,0 +1,229 @@
+/**
+ * @file ChunkFile.hpp
+ * @brief 可依時間隨機存取的分塊錄製檔 (.uchk)：查詢 "通道 3、10:02:05 ~ 10:02:07" 只讀取涵蓋的 Chunk 欄位
+ *
+ * 一個檔案對應一個裝置串流，Controller 或接收端皆可寫入 / 讀取。
+ * 檔案配置 (Writer Host Order，以 endianTag 判別，Reader 自動轉換)：
+ *   ChunkFileHeader + Layout (JSON 文字：TaskConfig 與各欄位對應的實體通道，補 0 至 8 Byte 對齊)
+ *   Chunk ...     ChunkHeader + min[numChannels] + max[numChannels] + 各通道欄位 (column c 連續 numSamples 筆 Code)
+ *   Footer        所有 Chunk 的 ChunkHeader + min / max 副本 (稀疏 Index：每個 Chunk 一筆，不含樣本)
+ *   ChunkFileTrailer (檔尾固定 24 Byte，指向 Footer)
+ *
+ * 同一 Chunk 內的樣本序號連續 (遇到缺口即結束 Chunk)，第 r 列的時間以
+ * firstTimestampNs + (endTimestampNs - firstTimestampNs) * r / numSamples 內插。
+ * 寫入中的檔案副檔名為 .part，Close() 寫出 Footer 後改名；沒有 Footer (異常結束) 的檔案由 Reader 逐一掃描
+ * Chunk Header 重建 Index，最多遺失最後一個尚未寫出的 Chunk。
+ */
+#pragma once
+
+#include "net/WireProtocol.hpp"
+#include "utils/UeiStructs.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    static const char CHUNK_FILE_MAGIC[8] = {'U', 'E', 'I', 'C', 'H', 'K', '0', '1'};
+    static const char CHUNK_TRAILER_MAGIC[8] = {'U', 'E', 'I', 'C', 'H', 'K', 'I', 'X'};
+    static const uint32_t CHUNK_ENDIAN_TAG = 0x01020304;
+    static const uint32_t CHUNK_VERSION = 1;
+    static const uint32_t CHUNK_MAGIC = 0x4348554B; // "CHUK"
+
+    // 檔頭 (後接 layoutBytes 的 Layout JSON)
+    struct ChunkFileHeader
+    {
+        char magic[8];
+        uint32_t endianTag;
+        uint32_t version;
+        uint32_t headerBytes; // 檔頭 + Layout (8 Byte 對齊)，即第一個 Chunk 的位置
+        uint32_t layoutBytes;
+        uint16_t deviceId;
+        uint16_t numChannels;
+        uint32_t channelMask;
+        double sampleRate;
+        uint64_t createdNs;
+        uint32_t chunkSamples; // Chunk 列數上限
+        uint32_t reserved;
+    };
+
+    // Chunk 檔頭 (Footer 中的 Index 為相同內容)，後接 min[numChannels]、max[numChannels]
+    struct ChunkHeader
+    {
+        uint32_t magic; // CHUNK_MAGIC
+        uint16_t numChannels;
+        uint16_t reserved;
+        uint32_t numSamples; // 列數
+        uint32_t flags;      // 本 Chunk 內所有 Batch 的 flags OR
+        uint64_t offset;     // 本 Chunk 在檔案中的位置
+        uint64_t firstSampleIndex;
+        uint64_t firstSeq;
+        uint64_t lastSeq;
+        uint64_t firstTimestampNs; // 第一列的時間
+        uint64_t endTimestampNs;   // 最後一列的下一列時間 (最後一個 Batch 時間 + 其樣本數 / 取樣率)
+    };
+
+    struct ChunkFileTrailer
+    {
+        char magic[8];
+        uint64_t footerOffset;
+        uint64_t chunkCount;
+    };
+
+    // 檔案描述的裝置與通道配置
+    struct ChunkLayout
+    {
+        uint16_t deviceId = 0;
+        uint16_t numChannels = 0;
+        uint32_t channelMask = 0;
+        double sampleRate = 0.0;
+        std::string taskName;
+        std::vector<std::string> channelNames; // 欄位 c 對應的實體通道 (例如 "ai3")
+        std::string taskJson;                  // TaskConfig (JSON，未知時為空字串)
+    };
+
+    /**
+     * @brief 由 Batch Header 及 (若已知) 對應的 TaskConfig 建立 Layout
+     * 欄位 c 對應 channelMask 中第 c 個設定的 bit；Mask 不足時以 "ch<c>" 命名。
+     */
+    ChunkLayout MakeChunkLayout(const PacketHeader &desc, const Utils::TaskConfig *task);
+
+    struct ChunkOptions
+    {
+        size_t chunkSamples = 16384; // 每個 Chunk 的列數上限
+        long maxChunkMs = 1000;      // Chunk 資料時間跨度上限 (異常結束時最多遺失的資料量)
+        long syncIntervalMs = 1000;  // 寫出 Chunk 後 fdatasync 的最短間隔 (0 = 只在 Close 時)
+    };
+
+    class ChunkFileWriter
+    {
+    public:
+        ChunkFileWriter();
+        ~ChunkFileWriter();
+
+        /**
+         * @brief 建立 path + ".part" 並寫入檔頭與 Layout
+         */
+        bool Open(const std::string &path, const ChunkLayout &layout, const ChunkOptions &options);
+
+        /**
+         * @brief 加入一個 Batch (interleaved，Host Order)
+         * 早於已寫入資料的 Batch (晚到 / 重複) 會被略過並計數。
+         * @return false 通道數或取樣率與 Layout 不符 (呼叫端應改開新檔)，或寫入失敗
+         */
+        bool Append(const PacketHeader &desc, const uint32_t *samples, size_t count);
+
+        // 寫出最後一個 Chunk 與 Footer，改名為 path
+        void Close();
+
+        bool IsOpen() const { return m_fd >= 0; }
+        const ChunkLayout &Layout() const { return m_layout; }
+        uint64_t GetFirstTimestampNs() const { return m_firstTimestampNs; }
+
+        uint64_t GetChunksWritten() const { return m_index.size(); }
+        uint64_t GetSamplesWritten() const { return m_samplesWritten; }
+        uint64_t GetBytesWritten() const { return m_bytesWritten; }
+        uint64_t GetLateDropped() const { return m_lateDropped; }
+
+    private:
+        bool FlushChunk();
+        bool WriteAll(const void *data, size_t length);
+        static int64_t NowUs();
+
+        ChunkLayout m_layout;
+        ChunkOptions m_options;
+        std::string m_path;
+        int m_fd;
+        uint64_t m_offset;
+        int64_t m_lastSyncUs;
+
+        // 組裝中的 Chunk：各通道欄位 (channel * chunkSamples + row)
+        ChunkHeader m_chunk;
+        std::vector<uint32_t> m_columns;
+        std::vector<uint32_t> m_minMax; // min[numChannels] + max[numChannels]
+        uint64_t m_nextSampleIndex;     // 目前 Chunk 下一列應有的樣本序號
+        bool m_haveData;                // 已寫入過任何樣本 (m_nextSampleIndex 有效)
+
+        // Footer 內容 (每個 Chunk 的 Header + min / max)
+        std::vector<ChunkHeader> m_index;
+        std::vector<uint32_t> m_indexMinMax;
+        std::vector<uint8_t> m_buffer;
+
+        uint64_t m_firstTimestampNs;
+        uint64_t m_samplesWritten;
+        uint64_t m_bytesWritten;
+        uint64_t m_lateDropped;
+    };
+
+    /**
+     * @brief 讀取 .uchk (或寫入中 / 異常結束的 .part) 並依時間查詢
+     * 只讀取 Footer 與查詢範圍內 Chunk 的單一通道欄位。
+     */
+    class ChunkFileReader
+    {
+    public:
+        ChunkFileReader();
+        ~ChunkFileReader();
+
+        bool Open(const std::string &path);
+        void Close();
+
+        const ChunkFileHeader &Header() const { return m_header; }
+        const ChunkLayout &Layout() const { return m_layout; }
+        const std::string &LayoutText() const { return m_layoutText; }
+        bool HasFooter() const { return m_hasFooter; } // false = Index 由掃描重建
+
+        size_t ChunkCount() const { return m_index.size(); }
+        const ChunkHeader &Chunk(size_t chunk) const { return m_index[chunk]; }
+        uint32_t ChunkMin(size_t chunk, int channel) const { return m_minMax[chunk * 2 * m_header.numChannels + channel]; }
+        uint32_t ChunkMax(size_t chunk, int channel) const
+        {
+            return m_minMax[chunk * 2 * m_header.numChannels + m_header.numChannels + channel];
+        }
+
+        /**
+         * @brief 第一個含有 timestampNs 之後資料的 Chunk (Index 二分搜尋)
+         * @return Chunk 索引，全部早於 timestampNs 時回傳 ChunkCount()
+         */
+        size_t FindChunk(uint64_t timestampNs) const;
+
+        /**
+         * @brief 讀取單一通道在 [fromNs, toNs) 內的樣本
+         * @param samples 輸出 (會先清空)
+         * @param timestampsNs 若非 NULL，輸出每個樣本的內插時間
+         */
+        bool ReadChannel(int channel, uint64_t fromNs, uint64_t toNs, std::vector<uint32_t> &samples,
+                         std::vector<uint64_t> *timestampsNs = NULL);
+
+        /**
+         * @brief 單一通道在 [fromNs, toNs) 內的最小 / 最大 Code
+         * 完全落在範圍內的 Chunk 直接使用 Index 中的 min / max，只讀取頭尾兩個 Chunk 的部分欄位。
+         * @return false 範圍內沒有資料或讀取失敗
+         */
+        bool ChannelExtent(int channel, uint64_t fromNs, uint64_t toNs, uint32_t &minCode, uint32_t &maxCode);
+
+        // 查詢統計 (Open 後累計)
+        uint64_t GetChunksRead() const { return m_chunksRead; }
+        uint64_t GetBytesRead() const { return m_bytesRead; }
+
+    private:
+        bool LoadFooter(uint64_t fileBytes);
+        void ScanChunks(uint64_t fileBytes);
+        void RowRange(size_t chunk, uint64_t fromNs, uint64_t toNs, uint32_t &firstRow, uint32_t &endRow) const;
+        bool ReadColumn(size_t chunk, int channel, uint32_t firstRow, uint32_t endRow, uint32_t *out);
+        bool ReadAt(void *data, size_t length, uint64_t offset);
+
+        int m_fd;
+        bool m_swapped;
+        bool m_hasFooter;
+        ChunkFileHeader m_header;
+        ChunkLayout m_layout;
+        std::string m_layoutText;
+        std::vector<ChunkHeader> m_index;
+        std::vector<uint32_t> m_minMax; // 每個 Chunk：min[numChannels] + max[numChannels]
+
+        uint64_t m_chunksRead;
+        uint64_t m_bytesRead;
+    };
+}
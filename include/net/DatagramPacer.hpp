@@ -0,0 +1,33 @@
+/**
+ * @file DatagramPacer.hpp
+ * @brief UdpSender 前的發送節奏階段 (流量整形等)：每個送出的 Datagram 呼叫一次 Admit()
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    class DatagramPacer
+    {
+    public:
+        virtual ~DatagramPacer() {}
+
+        // 目標數量變更時呼叫 (AddTarget / SetPacer)
+        virtual void SetTargetCount(size_t count) = 0;
+
+        /**
+         * @brief 允許送出一個 Datagram
+         * @param target 目標索引 (< 0 表示不屬於特定目標，例如 NACK 重送)
+         * @param bytes Datagram 長度 (不含 UDP/IP Header)
+         * @param readyUs Datagram 交給 UdpSender 的時間 (CLOCK_MONOTONIC 微秒)
+         * @param mayWait true = 必要時在此等待後允許；false = 需要等待時回傳 false (批次模式在此切開 sendmmsg)
+         * @return true 可以送出 (已計入用量)
+         */
+        virtual bool Admit(int target, size_t bytes, int64_t readyUs, bool mayWait) = 0;
+
+        // Admit() 已計入但最後沒有送出 (發送失敗) 的 Datagram 歸還用量
+        virtual void Refund(int target, size_t bytes) = 0;
+    };
+}
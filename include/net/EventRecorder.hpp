@@ -0,0 +1,160 @@
+/**
+ * @file EventRecorder.hpp
+ * @brief 黑盒子事件錄製：RAM Ring 保留最近數秒的完整資料，事件發生時輸出前後時間窗
+ *
+ * 擷取端 Push() 把每個 Batch 複製進預先配置的 Ring Slot (唯一的一次複製)；
+ * 事件 (準位觸發、UDP 指令、Signal 或 Trigger()) 發生時，輸出執行緒把觸發點前 preMs 的 Slot 釘住，
+ * 等待觸發點後 postMs 的 Batch 寫入後，直接由 Slot 寫檔 (writev) 及 / 或經 UdpSender 送出，不另外複製快照。
+ * 已輸出的 Slot 立即釋放；擷取端永不等待：輸出落後到 Ring 繞回尚未輸出的 Slot 時，
+ * 該 Batch 不寫入 Ring (計入 skipped)，已釘住的資料不會被覆寫。
+ *
+ * 一個 EventRecorder 對應一個裝置串流 (Ring 大小依第一個 Batch 的取樣率與 Batch 樣本數決定)。
+ * 輸出期間再次觸發的事件只計數不重複輸出。
+ *
+ * 事件檔 (evt_dev<id>_<UTC>_<n>.evt，Writer Host Order，以 endianTag 判別)：
+ *   EventFileHeader，接著 recordCount 筆 Record (v2 Header + Raw Big Endian Payload，與 LocalRecorder 相同)
+ */
+#pragma once
+
+#include "net/UdpSender.hpp"
+#include "net/LocalRecorder.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    static const char EVENT_MAGIC[8] = {'U', 'E', 'I', 'E', 'V', 'T', '0', '1'};
+    static const uint32_t EVENT_ENDIAN_TAG = 0x01020304;
+    static const uint32_t EVENT_VERSION = 1;
+
+    enum class EventReason : uint32_t
+    {
+        Command = 0, // Trigger() 或 UDP 指令
+        Level = 1,   // 通道準位觸發
+        Signal = 2   // SIGUSR1
+    };
+
+    enum class TriggerEdge
+    {
+        Rising,
+        Falling,
+        Both
+    };
+
+    // 事件檔頭
+    struct EventFileHeader
+    {
+        char magic[8];
+        uint32_t endianTag;
+        uint32_t version;
+        uint32_t reason; // EventReason
+        uint16_t deviceId;
+        uint16_t reserved;
+        uint64_t triggerSeq;         // 觸發時最後一個 Batch 的序號
+        uint64_t triggerTimestampNs; // 該 Batch 的時間
+        uint64_t createdNs;
+        uint32_t preBatches; // 實際輸出的觸發前 / 後 Batch 數
+        uint32_t postBatches;
+        uint64_t recordCount;
+        uint64_t skipped; // 輸出期間因 Ring 追上而未能保留的 Batch 數
+    };
+
+    struct EventOptions
+    {
+        long preMs = 5000;     // 觸發前保留時間
+        long postMs = 2000;    // 觸發後錄製時間
+        std::string directory; // 事件檔目錄 (空字串 = 不寫檔)
+        std::string targetIp;  // 事件資料送往的 UDP 目標 (空字串 = 不送出)
+        int targetPort = 5009;
+        int mtu = 1500;
+        int commandPort = 0; // 收到 "TRIGGER" 即觸發的 UDP Port (0 = 不開啟)
+
+        // 準位觸發 (channel < 0 = 不使用)：Batch 內第 channel 個通道的 Code 越過 level
+        int triggerChannel = -1;
+        uint32_t triggerLevel = 0x800000;
+        TriggerEdge triggerEdge = TriggerEdge::Rising;
+    };
+
+    class EventRecorder
+    {
+    public:
+        EventRecorder();
+        ~EventRecorder();
+
+        // 啟動輸出執行緒 (Ring 於第一個 Batch 時配置)
+        bool Start(const EventOptions &options);
+
+        // 停止；輸出中的事件以現有資料結束
+        void Stop();
+
+        /**
+         * @brief 放入一個 Batch 並檢查準位觸發 (擷取 / 分派迴圈呼叫，不阻塞)
+         * @return false 輸出落後，本 Batch 未能放入 Ring
+         */
+        bool Push(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
+
+        /**
+         * @brief 觸發事件 (任何執行緒皆可呼叫)
+         * @return false 前一個事件仍在輸出中 (本次只計數)
+         */
+        bool Trigger(EventReason reason);
+
+        uint64_t GetEvents() const { return m_events; }         // 已完成輸出的事件數
+        uint64_t GetSuppressed() const { return m_suppressed; } // 輸出中又觸發而略過的次數
+        uint64_t GetSkipped() const { return m_skipped; }       // 因輸出落後未放入 Ring 的 Batch 數
+        size_t GetRingBatches() const { return m_ringBatches; }
+
+        /**
+         * @brief 讀取事件檔 (取回後於 PC 上解析)
+         * @param records 輸出 (樣本為 Host Order)
+         */
+        static bool ReadFile(const std::string &path, EventFileHeader &header, std::vector<RecordedBatch> &records);
+
+    private:
+        struct Slot
+        {
+            PacketHeader desc;
+            std::vector<uint32_t> samples;
+        };
+
+        void Run();
+        void PollCommand(int timeoutMs);
+        void Capture(EventReason reason, uint64_t triggerIndex);
+        int OpenEventFile(const EventFileHeader &header, std::string &path);
+        bool WriteRecords(int fd, uint64_t first, uint64_t count);
+        void CheckLevel(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
+        static int64_t NowUs();
+
+        EventOptions m_options;
+        std::vector<Slot> m_slots;
+        size_t m_ringBatches;
+        uint64_t m_preBatches;
+        uint64_t m_postBatches;
+
+        // 單一生產者 (Push) / 單一消費者 (輸出執行緒)
+        std::atomic<uint64_t> m_writeIndex; // 下一個寫入的 Batch 編號 (寫完 Slot 後才遞增)
+        std::atomic<uint64_t> m_pinIndex;   // 輸出中最舊、尚未輸出的 Batch 編號 (UINT64_MAX = 未輸出)
+        std::atomic<uint64_t> m_trigger;    // 待處理 / 輸出中的事件：原因 << 56 | 觸發當下的 m_writeIndex (UINT64_MAX = 無)
+
+        // 準位觸發狀態 (Push 執行緒專用)
+        bool m_haveLast;
+        uint32_t m_lastLevel;
+
+        UdpSender m_sender;
+        bool m_sending;
+        int m_commandFd;
+        std::vector<uint8_t> m_recordHeaders; // writev 用的 Record Header
+        std::vector<uint32_t> m_swapBuffer;   // Little Endian 主機寫檔時的轉換 Buffer
+
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+        uint64_t m_fileCounter;
+        std::atomic<uint64_t> m_events;
+        std::atomic<uint64_t> m_suppressed;
+        std::atomic<uint64_t> m_skipped;
+    };
+}
@@ -0,0 +1,168 @@
+/**
+ * @file Fec.hpp
+ * @brief Datagram 群組前向錯誤更正 (XOR Parity / Reed-Solomon Erasure Code)
+ *
+ * 每 K 個 Data Datagram 為一組，額外送出 M 個 Parity Datagram：
+ *   - XOR：M = 1，可補回組內任意 1 個遺失的 Datagram
+ *   - RS ：GF(256) Cauchy 矩陣，可補回組內任意 <= M 個遺失的 Datagram
+ * Parity 以「完整 Datagram (含 Header)」為單位計算，補回的 Datagram 可直接交給
+ * FragmentReassembler；因此只支援 v2 Header (以 deviceId / seqId / fragIndex 識別成員)。
+ *
+ * Parity Datagram 格式 (Big Endian)：
+ *    0    2    magic = 0x5545
+ *    2    1    version = 2
+ *    3    1    packetType = Parity
+ *    4    2    headerBytes (= FEC_HEADER_SIZE + memberCount * FEC_MEMBER_SIZE)
+ *    6    1    scheme (FecScheme)
+ *    7    1    memberCount (本組實際 Data 數，可能因逾時少於 K)
+ *    8    2    deviceId
+ *   10    1    parityIndex
+ *   11    1    parityCount (M)
+ *   12    4    groupId
+ *   16    2    paritySize (Parity Payload 長度 = 組內最長 Datagram)
+ *   18    6    保留
+ *   24   12*K  成員 { seqId(u64), fragIndex(u16), length(u16) }
+ *   ...        Parity Payload
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sys/uio.h>
+
+namespace Net
+{
+    enum class FecScheme : uint8_t
+    {
+        Xor = 0,
+        ReedSolomon = 1
+    };
+
+    static const size_t FEC_HEADER_SIZE = 24;
+    static const size_t FEC_MEMBER_SIZE = 12;
+    static const int FEC_MAX_GROUP = 64;
+    static const int FEC_MAX_PARITY = 8;
+
+    // 發送端：逐筆累積 Parity，不保留 Data 副本
+    class FecEncoder
+    {
+    public:
+        FecEncoder();
+
+        /**
+         * @param scheme XOR 或 RS (XOR 時 parityCount 固定為 1)
+         * @param groupSize 每組 Data 數 K (2..FEC_MAX_GROUP)
+         * @param parityCount 每組 Parity 數 M (1..FEC_MAX_PARITY)
+         * @param maxDatagram Data Datagram 上限 (Parity Payload 最大長度)
+         * @return true 成功, false 參數不合法
+         */
+        bool Init(FecScheme scheme, int groupSize, int parityCount, size_t maxDatagram);
+
+        bool Enabled() const { return m_groupSize > 0; }
+
+        /**
+         * @brief 每個 Data Datagram 需保留給 Parity Header 的空間 (Parity 才能放進同一個 MTU)
+         */
+        static size_t Overhead(int groupSize) { return FEC_HEADER_SIZE + (size_t)groupSize * FEC_MEMBER_SIZE; }
+
+        /**
+         * @brief 加入一個已送出的 Data Datagram
+         * @return true 本組已滿，應呼叫 Finish() 送出 Parity
+         */
+        bool Add(uint16_t deviceId, uint64_t seqId, uint16_t fragIndex, const struct iovec *iov, int iovCount);
+
+        // 目前是否有未送出 Parity 的成員，以及第一個成員的加入時間
+        bool HasPending() const { return m_memberCount > 0; }
+        int64_t PendingSinceUs() const { return m_firstUs; }
+
+        /**
+         * @brief 完成本組：產生 Parity Datagram 並重置
+         * @return Parity 數量 (以 ParityData / ParityLength 取得)
+         */
+        int Finish();
+
+        const uint8_t *ParityData(int index) const { return m_parity[index].data(); }
+        size_t ParityLength(int index) const { return m_parityLength[index]; }
+
+    private:
+        FecScheme m_scheme;
+        int m_groupSize;
+        int m_parityCount;
+        size_t m_maxDatagram;
+
+        uint16_t m_deviceId;
+        uint32_t m_groupId;
+        int m_memberCount;
+        int64_t m_firstUs;
+        size_t m_maxLength;
+        std::vector<std::vector<uint8_t>> m_parity; // [Header + 成員表 | Parity Payload]
+        std::vector<size_t> m_parityLength;
+        uint8_t m_coefTable[256];
+    };
+
+    // 接收端：保留最近的 Data Datagram，收到 Parity 時嘗試補回遺失的成員
+    class FecDecoder
+    {
+    public:
+        /**
+         * @param historyDepth 保留最近幾個 Data Datagram
+         * @param maxGroups 同時追蹤的 Parity 群組數
+         */
+        explicit FecDecoder(size_t historyDepth = 512, size_t maxGroups = 32);
+
+        /**
+         * @brief 輸入任一收到的 Datagram
+         * @param recovered 補回的完整 Data Datagram (呼叫端應交給 FragmentReassembler)
+         * @return true 為 Parity Datagram (不需交給 Reassembler)
+         */
+        bool Push(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>> &recovered);
+
+        uint64_t GetRecovered() const { return m_recovered; }
+        uint64_t GetUnrecoverable() const { return m_unrecoverable; }
+
+    private:
+        struct StoredDatagram
+        {
+            bool used;
+            uint16_t deviceId;
+            uint64_t seqId;
+            uint16_t fragIndex;
+            std::vector<uint8_t> data;
+        };
+
+        struct Member
+        {
+            uint64_t seqId;
+            uint16_t fragIndex;
+            uint16_t length;
+        };
+
+        struct Group
+        {
+            bool used;
+            bool done;
+            uint16_t deviceId;
+            uint32_t groupId;
+            FecScheme scheme;
+            int parityCount;
+            size_t paritySize;
+            std::vector<Member> members;
+            std::vector<int> parityIndex;                // 已收到的 Parity 索引
+            std::vector<std::vector<uint8_t>> parityData; // 對應的 Parity Payload
+        };
+
+        void StoreData(uint16_t deviceId, uint64_t seqId, uint16_t fragIndex, const uint8_t *data, size_t length);
+        const StoredDatagram *FindData(uint16_t deviceId, uint64_t seqId, uint16_t fragIndex) const;
+        void TryRecover(Group &group, std::vector<std::vector<uint8_t>> &recovered);
+        int CountMissing(const Group &group) const;
+
+        std::vector<StoredDatagram> m_store;
+        size_t m_storeNext;
+        std::vector<Group> m_groups;
+        size_t m_groupNext;
+
+        uint64_t m_recovered;
+        uint64_t m_unrecoverable;
+    };
+}
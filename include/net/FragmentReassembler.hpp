@@ -0,0 +1,81 @@
+/**
+ * @file FragmentReassembler.hpp
+ * @brief 接收端分段重組 (對應 UdpSender 依 MTU 切出的分段 Datagram)
+ *
+ * - 分段可任意順序到達，以 fragOffset 直接寫入對應位置
+ * - 同時最多追蹤 maxPending 個未完成的 Batch，超過時捨棄最舊者
+ * - 未完成的 Batch 超過 timeoutUs 未補齊即視為遺失
+ * - v1 / v2 皆可處理，未完成的 Batch 以 (deviceId, seqId) 區分
+ * - payloadBytes 來自封包：超過 maxPayloadBytes 或 fragCount 個 Datagram 可容納的大小即視為格式錯誤，不配置
+ */
+#pragma once
+
+#include "net/WireProtocol.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace Net
+{
+    // 重組完成的 Batch
+    struct ReassembledBatch
+    {
+        PacketHeader header;          // 第一個收到的分段 Header (frag* 欄位無意義)
+        std::vector<uint8_t> payload; // 完整 Payload (尚未解碼)
+    };
+
+    class FragmentReassembler
+    {
+    public:
+        /**
+         * @param maxPending 同時追蹤的未完成 Batch 數
+         * @param timeoutUs 未完成 Batch 的最長等待時間 (微秒)
+         * @param maxPayloadBytes 單一 Batch 的 Payload 上限
+         * @param maxDatagram 單一 Datagram 的大小上限 (接收 Slot 大小)
+         */
+        explicit FragmentReassembler(size_t maxPending = 8, int64_t timeoutUs = 500000,
+                                     size_t maxPayloadBytes = 1024 * 1024, size_t maxDatagram = 65536);
+
+        /**
+         * @brief 輸入一個收到的 Datagram
+         * @param data Datagram 內容 (含 UdpHeader)
+         * @param length Datagram 長度
+         * @param out 若回傳 true，填入完整的 Batch
+         * @return true 有完整 Batch 可用 (未分段的 Datagram 會直接回傳)
+         */
+        bool Push(const uint8_t *data, size_t length, ReassembledBatch &out);
+
+        /**
+         * @brief 捨棄超時的未完成 Batch (Push 內也會自動呼叫)
+         */
+        void Expire();
+
+        uint64_t GetCompleted() const { return m_completed; }
+        uint64_t GetIncompleteDropped() const { return m_incompleteDropped; }
+        uint64_t GetDuplicates() const { return m_duplicates; }
+        uint64_t GetMalformed() const { return m_malformed; }
+
+    private:
+        struct Pending
+        {
+            bool used;
+            int64_t firstUs;
+            PacketHeader header;
+            uint16_t received;
+            std::vector<uint8_t> payload;
+            std::vector<bool> have;
+        };
+
+        Pending *FindOrAllocate(uint16_t deviceId, uint64_t seqId);
+        static int64_t NowUs();
+
+        std::vector<Pending> m_pending;
+        int64_t m_timeoutUs;
+        size_t m_maxPayloadBytes;
+        size_t m_maxDatagram;
+
+        uint64_t m_completed;
+        uint64_t m_incompleteDropped;
+        uint64_t m_duplicates;
+        uint64_t m_malformed;
+    };
+}
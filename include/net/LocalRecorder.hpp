@@ -0,0 +1,219 @@
+/**
+ * @file LocalRecorder.hpp
+ * @brief Controller 本機環狀錄製：網路中斷期間的資料寫入 Flash / RAM Disk，事後再取回
+ *
+ * 固定數量、預先配置大小的檔案 (rec_000.rec ...) 依序循環使用，寫滿最後一個後覆寫最舊的一個，
+ * 因此磁碟用量固定，永遠保留最近 fileCount * fileBytes 的資料。
+ * 寫入由獨立執行緒負責：分派迴圈的 Submit() 只複製 Batch 到預先配置的佇列 Slot，
+ * Flash 寫入延遲 (Erase / GC) 只會讓本佇列變深，不影響裝置佇列與網路發送。
+ *
+ * 檔案配置 (皆以 blockBytes 對齊；Header / Index 為 Writer Host Order，Reader 依 endianTag 自動轉換，
+ * PPC 上錄下的檔案可直接在 PC 上讀取)：
+ *   [0, blockBytes)           RecordFileHeader
+ *   [dataOffset, ...)         dataBlocks 個 Data Block，只以整個 Block 依序附加寫入
+ *   [indexOffset, ...)        RecordIndexEntry[dataBlocks] (每個 Data Block 一筆)
+ * Record = 完整的 v2 Header (64 Byte) + Raw Big Endian Payload，與線路上未分段的 Datagram 相同。
+ * Record 不跨 Block (比 Block 大的 Record 由 Block 起點開始佔用數個 Block，後面補 0)，
+ * 因此 recordCount > 0 的 Block 起點必為一筆 Record，可直接由 Index 定位。
+ *
+ * 檔案重新使用時先寫入新的 Header (fileSeq 遞增)，舊內容的 Index 因 fileSeq 不符而失效；
+ * 異常結束時最後一個檔案停在 Open 狀態，Reader 以 Header 的 blocksWritten 與 Index 的 fileSeq 判斷有效範圍
+ * (最多遺失最後一個 syncIntervalMs 內尚未寫出的部分 Block)。
+ */
+#pragma once
+
+#include "net/WireProtocol.hpp"
+#include "utils/StageMonitor.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    static const char RECORD_MAGIC[8] = {'U', 'E', 'I', 'R', 'E', 'C', '0', '1'};
+    static const uint32_t RECORD_ENDIAN_TAG = 0x01020304;
+    static const uint32_t RECORD_VERSION = 1;
+
+    enum class RecordFileState : uint32_t
+    {
+        Open = 0,    // 寫入中 (或寫入中途異常結束)
+        Complete = 1 // 已結束寫入 (寫滿換檔或正常關閉)
+    };
+
+    // 檔頭 (檔案第一個 Block，其餘空間為 0)
+    struct RecordFileHeader
+    {
+        char magic[8];
+        uint32_t endianTag;
+        uint32_t version;
+        uint32_t blockBytes;
+        uint32_t state;   // RecordFileState
+        uint64_t fileSeq; // 全部檔案中遞增的序號，最大者為最新
+        uint64_t createdNs;
+
+        uint64_t dataOffset;
+        uint64_t dataBlocks; // Data Block 容量
+        uint64_t indexOffset;
+
+        uint64_t blocksWritten; // 已寫入的 Data Block 數 (每個 sync 週期更新)
+        uint64_t recordCount;
+        uint64_t firstTimestampNs;
+        uint64_t lastTimestampNs;
+    };
+
+    // 每個 Data Block 一筆：以此 Block 起始的 Record
+    struct RecordIndexEntry
+    {
+        uint64_t timestampNs;      // 第一筆 Record 的 Batch 時間
+        uint64_t seqId;            // 第一筆 Record 的序號
+        uint64_t firstSampleIndex; // 第一筆 Record 在裝置上的累計樣本序號
+        uint16_t deviceId;
+        uint16_t recordCount; // 以此 Block 起始的 Record 數 (0 = 前一筆大 Record 的延續)
+        uint32_t fileSeq;     // 所屬檔案 fileSeq 的低 32 bit (用以排除前一輪的舊 Index)
+    };
+
+    // Reader 讀出的一筆 Record
+    struct RecordedBatch
+    {
+        PacketHeader header;
+        std::vector<uint32_t> samples; // Host Order，interleaved
+    };
+
+    struct RecorderOptions
+    {
+        std::string directory = ".";
+        int fileCount = 8;                  // 循環使用的檔案數
+        size_t fileBytes = 8 * 1024 * 1024; // 每個檔案大小 (預先配置)
+        size_t blockBytes = 4096;           // 寫入單位 (Flash Page 的倍數為佳，至少 512)
+        long syncIntervalMs = 1000;         // 部分填滿的 Block 補 0 寫出並 fdatasync 的間隔 (0 = 只在換檔時)
+        size_t queueDepth = 1024;           // 寫入佇列 (Batch 數，滿時捨棄最舊者)
+    };
+
+    class LocalRecorder
+    {
+    public:
+        LocalRecorder();
+        ~LocalRecorder();
+
+        /**
+         * @brief 預先配置所有檔案並啟動寫入執行緒
+         * 目錄中已有的錄製檔會保留，由最新檔案的下一個開始覆寫 (重開機後不會先蓋掉最新的資料)。
+         */
+        bool Open(const RecorderOptions &options);
+
+        /**
+         * @brief 寫完佇列中剩餘的 Batch，寫出部分 Block / Index / Header 後停止
+         */
+        void Close();
+
+        /**
+         * @brief 排入一個 Raw Batch (複製到佇列 Slot，不阻塞)
+         * @return true 排入, false 佇列已滿 (仍會排入，但捨棄了最舊的一筆)
+         */
+        bool Submit(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
+
+        // 寫入階段統計 (服務時間 = 一個 Batch 的組裝與寫入時間)
+        Utils::StageStats GetStats() const { return m_monitor.Snapshot(); }
+
+        uint64_t GetRecordsWritten() const { return m_recordsWritten; }
+        uint64_t GetBlocksWritten() const { return m_blocksWritten; }
+        uint64_t GetFilesCompleted() const { return m_filesCompleted; }
+        uint64_t GetWriteErrors() const { return m_writeErrors; }
+
+        // 第 slot 個檔案的路徑
+        static std::string FilePath(const std::string &directory, int slot);
+
+    private:
+        struct Job
+        {
+            PacketHeader desc;
+            std::vector<uint32_t> rawData;
+        };
+
+        void Run();
+        bool Prepare(int slot);
+        bool BeginFile();
+        void FinishFile();
+        bool Append(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
+        bool FlushBlocks();
+        void FlushIndex();
+        bool WriteHeader();
+        bool WriteAt(const uint8_t *data, size_t length, uint64_t offset);
+        static int64_t NowUs();
+
+        RecorderOptions m_options;
+        std::vector<int> m_fds;
+        int m_slot; // 寫入中的檔案
+        uint64_t m_fileSeq;
+        RecordFileHeader m_header;
+
+        // 組裝中的 Block (大 Record 時暫時擴充為數個 Block)
+        std::vector<uint8_t> m_block;
+        size_t m_blockUsed;
+        RecordIndexEntry m_blockEntry;
+        std::vector<uint8_t> m_headerBlock;
+        // 目前檔案的 Index (容量為整數個 Block，未用部分為 0，可直接整塊寫出)
+        std::vector<RecordIndexEntry> m_index;
+        size_t m_indexFlushed; // 已寫出且不再改變的 Index 筆數 (整個 Block)
+        int64_t m_lastSyncUs;
+
+        // 佇列
+        std::vector<Job> m_jobs; // 環狀佇列
+        size_t m_head;
+        size_t m_count;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+        Utils::StageMonitor m_monitor;
+
+        std::atomic<uint64_t> m_recordsWritten;
+        std::atomic<uint64_t> m_blocksWritten;
+        std::atomic<uint64_t> m_filesCompleted;
+        std::atomic<uint64_t> m_writeErrors;
+    };
+
+    /**
+     * @brief 讀取錄製檔 (取回後於 PC 上解析；Open 狀態的檔案亦可讀到最後寫出的 Block)
+     */
+    class RecordFileReader
+    {
+    public:
+        RecordFileReader();
+        ~RecordFileReader();
+
+        bool Open(const std::string &path);
+        void Close();
+
+        const RecordFileHeader &Header() const { return m_header; }
+
+        // 有效的 Data Block 數 (其 Index 皆屬於本檔案)
+        uint64_t ValidBlocks() const { return m_validBlocks; }
+        const RecordIndexEntry &Index(uint64_t block) const { return m_index[block]; }
+
+        /**
+         * @brief 找出第一個含有 timestampNs 之後資料的 Block (Index 二分搜尋)
+         * @return Block 索引，全部早於 timestampNs 時回傳 ValidBlocks()
+         */
+        uint64_t FindBlock(uint64_t timestampNs) const;
+
+        /**
+         * @brief 讀取以 block 起始的 Record
+         * @param records 輸出 (會先清空)
+         * @return 該 Block 佔用的 Block 數 (下一個 Block = block + 回傳值)，0 表示讀取失敗
+         */
+        uint64_t ReadBlock(uint64_t block, std::vector<RecordedBatch> &records);
+
+    private:
+        int m_fd;
+        RecordFileHeader m_header;
+        std::vector<RecordIndexEntry> m_index;
+        uint64_t m_validBlocks;
+        std::vector<uint8_t> m_buffer;
+    };
+}
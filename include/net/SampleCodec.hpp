@@ -0,0 +1,81 @@
+/**
+ * @file SampleCodec.hpp
+ * @brief Batch Payload 無損壓縮 (Per-Channel Delta/Predictor + Rice / FOR Bit-Packing)
+ *
+ * 編碼格式 (Big Endian Bit Stream, MSB First)：
+ *   對每個通道 (Channel-Major)：
+ *     [32 bit] 第一筆 Sample 原始值
+ *     之後每 CODEC_BLOCK_SAMPLES 筆殘差為一個 Block：
+ *       [8 bit]  Block Mode: bit7 = Predictor (0: Delta, 1: 2nd-Order)
+ *                            bit6 = Packing   (0: Rice,  1: Frame-of-Reference)
+ *                            bit0-5 = Rice k 或 FOR Bit 寬度 (0..32)
+ *       [N bit]  ZigZag 後的殘差
+ *   整個 Payload 最後補 0 至 Byte 邊界。
+ *
+ * 殘差以 uint32 模數運算計算，因此對完整 32 bit Code 皆為無損 (不假設只有 24 bit)。
+ */
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    // Payload 編碼方式 (會寫入 UDP Header，接收端依此解碼)
+    enum class SampleEncoding : uint8_t
+    {
+        Raw = 0,       // 原始 uint32 interleaved (相容舊版接收端)
+        DeltaPack = 1  // Delta/Predictor + 自適應 Rice / FOR Bit-Packing
+    };
+
+    // 每個 Block 的殘差數量 (每個 Block 獨立選擇 Predictor 與 Packing 參數)
+    static const int CODEC_BLOCK_SAMPLES = 128;
+
+    class SampleCodec
+    {
+    public:
+        /**
+         * @brief 編碼後最多需要的 Byte 數 (供呼叫端預先配置 Buffer)
+         */
+        static size_t MaxEncodedSize(int numSamples, int numChannels);
+
+        /**
+         * @brief 將 interleaved Raw Data 壓縮
+         * @param rawData interleaved 原始資料 (ch0, ch1, ..., ch0, ch1, ...)
+         * @param numSamples 樣本數 (Frames)
+         * @param numChannels 通道數
+         * @param out 輸出 Buffer
+         * @param outCapacity 輸出 Buffer 大小 (需 >= MaxEncodedSize)
+         * @return 實際寫入的 Byte 數，失敗回傳 0
+         */
+        static size_t Encode(const uint32_t *rawData,
+                             int numSamples,
+                             int numChannels,
+                             uint8_t *out,
+                             size_t outCapacity);
+
+        /**
+         * @brief 解壓縮為 interleaved Raw Data
+         * @param data 壓縮後資料
+         * @param length 壓縮後資料長度
+         * @param numSamples 樣本數 (由 Header 取得)
+         * @param numChannels 通道數 (由 Header 取得)
+         * @param rawOut 輸出 (需可容納 numSamples * numChannels 個 uint32)
+         * @return true 成功, false 資料損毀或長度不符
+         */
+        static bool Decode(const uint8_t *data,
+                           size_t length,
+                           int numSamples,
+                           int numChannels,
+                           uint32_t *rawOut);
+
+        /**
+         * @brief 設定檔字串 ("raw", "delta") 轉換為編碼列舉
+         * @return true 成功, false 未知的名稱
+         */
+        static bool ParseEncoding(const std::string &name, SampleEncoding &encoding);
+
+        static const char *EncodingName(SampleEncoding encoding);
+    };
+}
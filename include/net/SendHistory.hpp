@@ -0,0 +1,68 @@
+/**
+ * @file SendHistory.hpp
+ * @brief 已發送 Datagram 的固定大小歷史環 (供 NACK 重送使用)
+ *
+ * 每個 Slot 預先配置 maxDatagram Byte，記錄時只做一次 memcpy，不做配置。
+ * 查詢為 O(1)：以 (deviceId, seqId) 雜湊到 Bucket (記錄最新的 Slot)，同一 Batch 的分段以 prev 串接；
+ * Bucket 數為深度的 4 倍以上，不同裝置的序號碰撞時較舊的 Batch 查不到 (視為已不在歷史環中)。
+ * NACK 來自網路上任何主機，查詢成本不可與歷史深度成正比。
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sys/uio.h>
+
+namespace Net
+{
+    class SendHistory
+    {
+    public:
+        struct Entry
+        {
+            bool used;
+            uint16_t deviceId;
+            uint64_t seqId;
+            size_t length;
+            size_t prev;     // 同一 (deviceId, seqId) 前一個分段的 Slot (NO_SLOT = 沒有)
+            uint64_t serial; // 記錄順序 (串接時驗證 prev 未被覆蓋成較新的資料)
+            std::vector<uint8_t> data;
+        };
+
+        SendHistory() : m_next(0), m_maxDatagram(0), m_serial(0) {}
+
+        /**
+         * @brief 配置歷史環
+         * @param depth 保留的 Datagram 數量 (0 表示停用)
+         * @param maxDatagram 單一 Datagram 上限
+         */
+        void Init(size_t depth, size_t maxDatagram);
+
+        bool Enabled() const { return !m_entries.empty(); }
+
+        /**
+         * @brief 記錄一個 Datagram (覆蓋最舊的 Slot)
+         * @return 寫入的 Entry (供呼叫端調整旗標)，超過 maxDatagram 時回傳 NULL
+         */
+        Entry *Record(uint16_t deviceId, uint64_t seqId, const struct iovec *iov, int iovCount);
+
+        /**
+         * @brief 找出屬於 (deviceId, seqId) 的所有 Datagram (含所有分段，依發送順序)
+         * @return 找到的數量
+         */
+        size_t Find(uint16_t deviceId, uint64_t seqId, std::vector<const Entry *> &out) const;
+
+    private:
+        static const size_t NO_SLOT = (size_t)-1;
+
+        size_t Bucket(uint16_t deviceId, uint64_t seqId) const;
+        bool Matches(size_t slot, uint16_t deviceId, uint64_t seqId) const;
+
+        std::vector<Entry> m_entries;
+        std::vector<size_t> m_buckets; // (deviceId, seqId) 雜湊 -> 最新的 Slot
+        size_t m_next;
+        size_t m_maxDatagram;
+        uint64_t m_serial;
+    };
+}
@@ -0,0 +1,97 @@
+/**
+ * @file SendPipeline.hpp
+ * @brief 獨立的網路發送執行緒 (與擷取 / 分派迴圈解耦)
+ *
+ * 分派端 Submit() 只做 Buffer 交換並喚醒發送執行緒，不觸碰 Socket；
+ * sendto 阻塞 (Socket Buffer 滿、ARP 解析) 只會讓本佇列變深，不會延誤裝置佇列的清空。
+ * 啟動後 UdpSender / TcpSink 只能由發送執行緒使用 (NACK、批次期限、TCP 連線皆在此處理)。
+ */
+#pragma once
+
+#include "net/UdpSender.hpp"
+#include "net/TcpSink.hpp"
+#include "utils/StageMonitor.hpp"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace Net
+{
+    // 由發送執行緒呼叫，填入 report.devices (各裝置的擷取統計)
+    typedef std::function<void(StatusReport &)> StatusCollector;
+
+    class SendPipeline
+    {
+    public:
+        /**
+         * @param udp 已初始化的 UdpSender
+         * @param tcp 可選的 TcpSink (NULL 表示不使用)
+         */
+        SendPipeline(UdpSender &udp, TcpSink *tcp);
+        ~SendPipeline();
+
+        /**
+         * @brief 預先配置佇列並啟動發送執行緒
+         * @param capacity 佇列可容納的 Batch 數 (滿時捨棄最舊者)
+         */
+        bool Start(size_t capacity);
+
+        /**
+         * @brief 送出佇列中剩餘的 Batch 後停止執行緒
+         */
+        void Stop();
+
+        /**
+         * @brief 排入一個 Batch (不阻塞)
+         * rawData 與佇列 Slot 內的 Buffer 交換：呼叫端取回的是已送出 Batch 的舊 Buffer，
+         * 穩定狀態下不需配置也不需複製。
+         * @return true 排入, false 佇列已滿 (仍會排入，但捨棄了最舊的一筆)
+         */
+        bool Submit(const PacketHeader &desc, std::vector<uint32_t> &rawData);
+
+        /**
+         * @brief 啟用週期性 Status 封包 (需在 Start 之前呼叫)
+         * 發送端統計 (佇列、發送失敗) 由 Pipeline 填入，裝置統計由 collector 提供。
+         * @param intervalMs 發送間隔 (毫秒)
+         * @param collector 裝置統計來源 (於發送執行緒呼叫，需為執行緒安全)
+         */
+        void EnableStatus(long intervalMs, StatusCollector collector);
+
+        // 發送階段統計 (服務時間 = 一個 Batch 的 UDP + TCP 發送時間)
+        Utils::StageStats GetStats() const { return m_monitor.Snapshot(); }
+
+    private:
+        struct Job
+        {
+            PacketHeader desc;
+            std::vector<uint32_t> rawData;
+        };
+
+        void Run();
+        void SendStatus(int64_t nowUs);
+        static int64_t NowUs();
+
+        UdpSender &m_udp;
+        TcpSink *m_tcp;
+
+        std::vector<Job> m_jobs; // 環狀佇列
+        size_t m_head;
+        size_t m_count;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cond;
+
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+        Utils::StageMonitor m_monitor;
+
+        // Status 封包
+        long m_statusIntervalMs;
+        StatusCollector m_statusCollector;
+        StatusReport m_statusReport;
+        int64_t m_startUs;
+        int64_t m_lastStatusUs;
+    };
+}
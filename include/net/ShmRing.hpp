@@ -0,0 +1,151 @@
+/**
+ * @file ShmRing.hpp
+ * @brief POSIX Shared Memory 單寫多讀環狀傳輸 (同一台 Controller 上的 Consumer 使用)
+ *
+ * 本機 Logger / 告警程式不需經過 UDP Loopback：Writer 將每個 Batch (v2 Header + Raw Payload)
+ * 寫入 Shared Memory，Reader 以名稱 Attach 後直接讀取 (零複製)。
+ *
+ * 記憶體配置: [控制區 64B][資料區 capacity Byte (2 的次方)]
+ *   - 位置以 32 bit 絕對值遞增 (PPC32 上 64 bit atomic 不是 lock-free，無法跨行程使用)
+ *   - head: 已寫入資料的結尾；tail: 仍完整保留的最舊紀錄
+ *   - 每筆紀錄 8 Byte 對齊，前置 16 Byte 紀錄 Header；放不下時以 Pad 紀錄補滿並繞回開頭
+ *   - Writer 覆寫前先推進 tail；Reader 讀完再檢查 tail，被覆寫即判定為 overrun (seqlock 方式)
+ * Writer 不等待 Reader：慢的 Reader 只會自己 overrun，不影響擷取。
+ */
+#pragma once
+
+#include "net/WireProtocol.hpp"
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    static const uint32_t SHM_RING_MAGIC = 0x55455352; // "UESR"
+    static const uint32_t SHM_RING_VERSION = 1;
+    static const size_t SHM_RING_RECORD_HEADER = 16;
+
+    // 控制區 (位於 Shared Memory 開頭，Writer / Reader 共用)
+    struct ShmRingControl
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;   // 資料區大小 (2 的次方)
+        uint32_t generation; // Writer 每次建立時改變，Reader 可偵測 Writer 重啟
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+        std::atomic<uint32_t> records; // 已發布的紀錄數 (下一筆的序號)
+        uint32_t reserved[9];
+    };
+
+    // Reader 取得的一筆紀錄 (指標指向 Shared Memory，Release() 前有效)
+    struct ShmRecord
+    {
+        uint32_t seq;          // 紀錄序號 (Writer 端遞增，可用於計算遺失筆數)
+        PacketHeader header;   // 已解析的 v2 Header
+        const uint8_t *data;   // 整筆資料 (Header + Payload)
+        size_t length;
+        const uint8_t *payload;
+        size_t payloadBytes;
+    };
+
+    enum class ShmReadStatus
+    {
+        Empty,  // 沒有新資料
+        Ok,     // 取得一筆 (處理完需呼叫 Release)
+        Overrun // Reader 太慢，已被覆寫；游標跳到最舊的完整紀錄
+    };
+
+    class ShmRingWriter
+    {
+    public:
+        ShmRingWriter();
+        ~ShmRingWriter();
+
+        /**
+         * @brief 建立 (或重建) Shared Memory 並對應
+         * @param name POSIX shm 名稱 (例如 "/uei_daq")
+         * @param capacityBytes 資料區大小，向上取到 2 的次方
+         */
+        bool Create(const std::string &name, size_t capacityBytes);
+
+        /**
+         * @brief 發布一個 Batch (v2 Header + Raw Payload，一次 memcpy 寫入 Ring)
+         * @return false 未建立或 Batch 大於 Ring 的一半
+         */
+        bool Publish(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
+
+        // 關閉並 shm_unlink (已 Attach 的 Reader 仍可讀完現有資料)
+        void Close();
+
+        uint64_t GetPublished() const { return m_published; }
+        uint64_t GetRejected() const { return m_rejected; }
+
+    private:
+        void Reserve(uint32_t end);
+
+        std::string m_name;
+        int m_fd;
+        void *m_base;
+        size_t m_mapBytes;
+        ShmRingControl *m_control;
+        uint8_t *m_data;
+        uint32_t m_mask;
+        uint8_t m_headerSlot[WIRE_V2_HEADER_SIZE];
+        uint64_t m_published;
+        uint64_t m_rejected;
+    };
+
+    class ShmRingReader
+    {
+    public:
+        ShmRingReader();
+        ~ShmRingReader();
+
+        /**
+         * @brief 以名稱 Attach (唯讀)，游標從目前的 head 開始 (只讀新資料)
+         * @param fromOldest true 時改從最舊的完整紀錄開始
+         */
+        bool Attach(const std::string &name, bool fromOldest = false);
+
+        /**
+         * @brief 取得下一筆 (不阻塞)
+         */
+        ShmReadStatus Poll(ShmRecord &record);
+
+        /**
+         * @brief 處理完 Poll 取得的紀錄後呼叫，推進游標
+         * @return false 處理期間已被 Writer 覆寫 (資料可能不完整，應丟棄)
+         */
+        bool Release();
+
+        void Detach();
+
+        // Writer 是否已重建 Ring (generation 改變)
+        bool WriterRestarted() const;
+
+        uint64_t GetRead() const { return m_read; }
+        uint64_t GetOverruns() const { return m_overruns; } // overrun 次數
+        uint64_t GetLost() const { return m_lost; }         // 因 overrun 跳過的紀錄數
+
+    private:
+        bool Overwritten(uint32_t position) const;
+        void Resync();
+
+        int m_fd;
+        void *m_base;
+        size_t m_mapBytes;
+        const ShmRingControl *m_control;
+        const uint8_t *m_data;
+        uint32_t m_mask;
+        uint32_t m_generation;
+        uint32_t m_cursor;
+        uint32_t m_pendingSize; // Poll 取得但尚未 Release 的紀錄大小 (0 = 無)
+        uint32_t m_expectedSeq;
+        bool m_haveSeq;
+        uint64_t m_read;
+        uint64_t m_overruns;
+        uint64_t m_lost;
+    };
+}
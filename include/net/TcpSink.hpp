@@ -0,0 +1,97 @@
+/**
+ * @file TcpSink.hpp
+ * @brief TCP 串流輸出 (供需要完整資料的 Archive Client 連線)
+ *
+ * - 與 UDP 相同的 v2 Header 做為 Frame：先讀 64 Byte Header，再依 payloadBytes 讀 Payload
+ *   (TCP 不需分段，fragCount 固定為 1；v1 Header 缺少長度欄位，因此一律使用 v2)
+ * - 每個 Batch 以 Header + Payload 兩段 iovec 一次送出，不做合併複製
+ * - Client 跟不上時，未送出的部分放入 Pool 中預先配置的 Chunk；
+ *   積壓超過 maxBacklogBytes 即中斷該 Client，不阻塞擷取迴圈
+ */
+#pragma once
+
+#include "net/WireProtocol.hpp"
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+namespace Net
+{
+    class TcpSink
+    {
+    public:
+        TcpSink();
+        ~TcpSink();
+
+        /**
+         * @brief 開始監聽 (非阻塞，連線於 Service() 中接受)
+         * @param port 監聽 Port
+         * @param maxClients 同時連線上限
+         * @param maxBacklogBytes 每個 Client 的積壓上限 (Byte)
+         * @param sendBufferBytes SO_SNDBUF (0 = 系統預設)
+         * @return true 成功, false 失敗
+         */
+        bool Init(int port, int maxClients, size_t maxBacklogBytes, int sendBufferBytes);
+
+        /**
+         * @brief 發送一個 Batch 給所有 Client (desc 的意義與 UdpSender::SendBatch 相同)
+         * @return true 至少有一個 Client 正常 (送出或排入積壓), false 沒有 Client 或全部失敗
+         */
+        bool SendBatch(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
+
+        /**
+         * @brief 接受新連線、送出積壓資料、清除已關閉的 Client (於主迴圈中週期性呼叫)
+         */
+        void Service();
+
+        size_t GetClientCount() const { return m_clients.size(); }
+        uint64_t GetBytesSent() const { return m_bytesSent; }
+        uint64_t GetSlowDisconnects() const { return m_slowDisconnects; } // 積壓超過上限而中斷
+        size_t GetBacklogHighWater() const { return m_backlogHighWater; }
+
+        void Close();
+
+    private:
+        // Pool 中的一塊積壓 Buffer，[begin, end) 為尚未送出的資料
+        struct Chunk
+        {
+            std::vector<uint8_t> data;
+            size_t begin;
+            size_t end;
+        };
+
+        struct Client
+        {
+            int fd;
+            struct sockaddr_in addr;
+            std::deque<int> backlog; // Chunk 索引 (先進先出)
+            size_t backlogBytes;
+        };
+
+        void AcceptClients();
+        bool SendToClient(Client &client, const struct iovec *iov, int iovCount, size_t total, bool &slow);
+        bool Enqueue(Client &client, const struct iovec *iov, int iovCount, size_t skip);
+        bool FlushBacklog(Client &client);
+        void Disconnect(size_t index, const char *reason);
+        int AllocateChunk();
+        void ReleaseChunk(int index);
+
+        int m_listenFd;
+        int m_maxClients;
+        size_t m_maxBacklogBytes;
+        int m_sendBufferBytes;
+        std::vector<Client> m_clients;
+
+        std::vector<Chunk> m_chunks; // Init 時一次配置 (maxClients * 每 Client 所需 Chunk 數)
+        std::vector<int> m_freeChunks;
+
+        std::vector<uint8_t> m_encodeBuffer;
+        uint8_t m_headerSlot[WIRE_V2_HEADER_SIZE];
+
+        uint64_t m_bytesSent;
+        uint64_t m_slowDisconnects;
+        size_t m_backlogHighWater;
+    };
+}
@@ -0,0 +1,184 @@
+/**
+ * @file TimeSync.hpp
+ * @brief 接收端發起的時鐘偏差估計 (NTP 式四個時間戳，獨立 Port)
+ *
+ * Controller 的時間戳來自 gettimeofday，與擷取 PC 的時鐘會逐漸偏移，
+ * 多台裝置的時間軸因此對不齊。接收端 (ClockSync) 週期性發出 Request，
+ * Controller (TimeSyncServer) 回覆收到 / 送出時間：
+ *   t1 = 接收端送出, t2 = Controller 收到 (Kernel 時間戳), t3 = Controller 送出, t4 = 接收端收到
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2   (Controller 時鐘 - 接收端時鐘)
+ *   delay  = (t4 - t1) - (t3 - t2)
+ * 接收端只採用延遲最小的一半樣本，對時間做線性回歸得到 offset 與 drift。
+ * 接收端可將估計值回送 (Correction)，Controller 之後送出的 Batch 改以接收端時間標示
+ * 並設定 WIRE_FLAG_TIME_CORRECTED。Correction 只接受來自指定接收端 IP 的封包
+ * (未指定時為最近一次送出 Request 的位址與 Port)，其餘捨棄並計數。
+ *
+ * 封包格式 (32 Byte，Big Endian)：
+ *    0    2    magic = 0x5545
+ *    2    1    version = 2
+ *    3    1    packetType = TimeSync
+ *    4    1    kind (TimeSyncKind)
+ *    5    3    保留
+ *    Request / Response:  8 t1(u64)  16 t2(u64)  24 t3(u64)   (Unix Epoch 奈秒)
+ *    Correction:          8 refNs(u64, Controller 時間)  16 offsetNs(i64)  24 driftPpb(i64)
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <netinet/in.h>
+
+namespace Net
+{
+    static const size_t TIME_SYNC_PACKET_SIZE = 32;
+
+    enum class TimeSyncKind : uint8_t
+    {
+        Request = 0,
+        Response = 1,
+        Correction = 2
+    };
+
+    // 時鐘修正參數：receiverNs = controllerNs - (offsetNs + driftPpb * (controllerNs - refNs) / 1e9)
+    struct ClockCorrection
+    {
+        uint64_t refNs = 0;
+        int64_t offsetNs = 0;
+        int64_t driftPpb = 0;
+    };
+
+    /**
+     * @brief Controller 端：回應時間 Request 並接收接收端回送的修正值 (獨立執行緒)
+     */
+    class TimeSyncServer
+    {
+    public:
+        TimeSyncServer();
+        ~TimeSyncServer();
+
+        /**
+         * @param port 本機 Port
+         * @param clientIp 允許送出 Correction 的接收端 IP (空字串 = 最近一次送出 Request 的位址與 Port)
+         */
+        bool Start(int port, const std::string &clientIp = "");
+        void Stop();
+
+        /**
+         * @brief 以最近一次收到的修正值換算時間
+         * @return false 沒有修正值或已超過 maxAgeMs 未更新 (correctedNs = controllerNs)
+         */
+        bool Correct(uint64_t controllerNs, uint64_t &correctedNs, long maxAgeMs) const;
+
+        // 測試用：模擬 Controller 時鐘偏差 (Loopback 測試時兩端共用同一個時鐘)
+        void SetClockSkew(int64_t offsetNs, int64_t driftPpb);
+        uint64_t ApplySkew(uint64_t realNs) const;
+
+        uint64_t GetRequests() const { return m_requests; }
+        uint64_t GetCorrections() const { return m_corrections; }
+        uint64_t GetRejectedCorrections() const { return m_rejectedCorrections; } // 來源不符而捨棄
+
+    private:
+        void Run();
+        bool CorrectionAllowed(const struct sockaddr_in &from) const;
+
+        int m_sockfd;
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+
+        // Correction 來源限制 (只在接收執行緒中使用)
+        bool m_haveClientIp;
+        struct in_addr m_clientIp;
+        bool m_haveProbe;
+        struct sockaddr_in m_lastProbe; // 最近一次 Request 的來源
+
+        mutable std::mutex m_mutex;
+        ClockCorrection m_correction;
+        bool m_haveCorrection;
+        int64_t m_correctionUs; // 收到修正值的時間 (CLOCK_MONOTONIC)
+
+        int64_t m_skewOffsetNs;
+        int64_t m_skewDriftPpb;
+        uint64_t m_skewRefNs;
+
+        std::atomic<uint64_t> m_requests;
+        std::atomic<uint64_t> m_corrections;
+        std::atomic<uint64_t> m_rejectedCorrections;
+    };
+
+    /**
+     * @brief 接收端：週期性量測並估計 Controller 的時鐘偏差與漂移 (非阻塞，於接收迴圈中呼叫 Poll)
+     */
+    class ClockSync
+    {
+    public:
+        /**
+         * @param windowSize 保留的樣本數 (估計只用延遲最小的一半)
+         */
+        explicit ClockSync(size_t windowSize = 64);
+        ~ClockSync();
+
+        /**
+         * @param controllerIp Controller IP
+         * @param port Controller 的 TimeSync Port
+         * @param intervalMs Request 間隔
+         * @param sendCorrections 是否回送修正值 (讓 Controller 以接收端時間標示 Batch)
+         */
+        bool Init(const std::string &controllerIp, int port, long intervalMs, bool sendCorrections);
+
+        /**
+         * @brief 到期時送出 Request，並處理所有已收到的 Response
+         * @return 本次新增的樣本數
+         */
+        int Poll();
+
+        // 目前是否已有可用的估計值
+        bool Synced() const { return m_synced; }
+
+        // 換算 Controller 時間戳為接收端時間 (未同步時原樣回傳)
+        uint64_t ToLocalNs(uint64_t controllerNs) const;
+
+        const ClockCorrection &GetCorrection() const { return m_estimate; }
+        int64_t GetLastDelayNs() const { return m_lastDelayNs; }
+        int64_t GetMinDelayNs() const { return m_minDelayNs; }
+        uint64_t GetSamples() const { return m_sampleCount; }
+
+        void Close();
+
+    private:
+        struct Sample
+        {
+            uint64_t localNs; // (t1 + t4) / 2
+            int64_t offsetNs;
+            int64_t delayNs;
+        };
+
+        void AddSample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+        void Estimate();
+        void SendCorrection();
+
+        size_t m_windowSize;
+        std::vector<Sample> m_samples; // 環狀保存
+        size_t m_next;
+        std::vector<Sample> m_selected; // 估計用暫存
+
+        int m_sockfd;
+        struct sockaddr_in m_server;
+        long m_intervalMs;
+        bool m_sendCorrections;
+        int64_t m_lastRequestUs;
+
+        bool m_synced;
+        ClockCorrection m_estimate;
+        int64_t m_lastDelayNs;
+        int64_t m_minDelayNs;
+        uint64_t m_sampleCount;
+    };
+
+    // CLOCK_REALTIME 奈秒 (與 Batch timestampNs 同一時間基準)
+    uint64_t RealtimeNs();
+}
@@ -0,0 +1,94 @@
+/**
+ * @file TrafficShaper.hpp
+ * @brief 發送端流量整形 (全域 + 每個目標各一個 Token Bucket)
+ *
+ * 多個 Task 同時 Flush 時會在瞬間送出大量 Datagram (microburst)，100 Mbit 鏈路上的
+ * Switch Buffer 容易溢出。Shaper 依 Token 不足的量延後送出，將 Datagram 平均分散：
+ *   - 以 IP 層長度 (Datagram + 28 Byte) 計算
+ *   - 每個 Datagram 的額外延遲 (自交給 UdpSender 起算) 不超過 maxDelayUs；
+ *     需要更久才能送出時直接送出並計入 overrun (延遲上限優先於速率)
+ *   - Token 不足時的欠額上限為一個 burst，避免持續超載後長期停擺
+ */
+#pragma once
+
+#include "net/DatagramPacer.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+    class TrafficShaper : public DatagramPacer
+    {
+    public:
+        TrafficShaper();
+
+        /**
+         * @param globalBitsPerSec 所有目標合計的速率上限 (0 = 不限制)
+         * @param targetBitsPerSec 每個目標的速率上限 (0 = 不限制)
+         * @param burstBytes Bucket 容量 (允許的瞬間 Burst)
+         * @param maxDelayUs 每個 Datagram 最多額外延遲
+         */
+        void Configure(double globalBitsPerSec, double targetBitsPerSec, size_t burstBytes, int64_t maxDelayUs);
+
+        bool Enabled() const { return m_enabled; }
+
+        // 目標數量變更時呼叫 (新目標的 Bucket 為滿)
+        void SetTargetCount(size_t count) override;
+
+        // DatagramPacer：可等待時 Pace()，否則 Token 足夠才 Consume()
+        bool Admit(int target, size_t bytes, int64_t readyUs, bool mayWait) override;
+        void Refund(int target, size_t bytes) override;
+
+        /**
+         * @brief 計算 target 送出 bytes 前需等待的時間 (不消耗 Token)
+         * @param target 目標索引 (< 0 表示只受全域 Bucket 限制，例如 NACK 重送)
+         */
+        int64_t Delay(int target, size_t bytes);
+
+        /**
+         * @brief 必要時等待 (不超過延遲上限)，並消耗 Token
+         * @param readyUs Datagram 交給 UdpSender 的時間 (CLOCK_MONOTONIC 微秒)
+         * @return 實際等待的微秒數
+         */
+        int64_t Pace(int target, size_t bytes, int64_t readyUs);
+
+        /**
+         * @brief 直接消耗 Token (Delay() 為 0 時使用)
+         */
+        void Consume(int target, size_t bytes);
+
+        // 統計
+        uint64_t GetShapedDatagrams() const { return m_shapedDatagrams; } // 曾被延後的 Datagram 數
+        uint64_t GetShapedDelayUs() const { return m_shapedDelayUs; }     // 累計延後時間
+        int64_t GetMaxShapedDelayUs() const { return m_maxShapedDelayUs; }
+        uint64_t GetOverruns() const { return m_overruns; } // 超過延遲上限而直接送出
+
+        static int64_t NowUs();
+
+    private:
+        struct Bucket
+        {
+            double bytesPerUs; // 0 = 不限制
+            double tokens;
+            int64_t lastUs;
+        };
+
+        void Refill(Bucket &bucket, int64_t nowUs) const;
+        int64_t BucketDelay(Bucket &bucket, size_t bytes, int64_t nowUs) const;
+        void BucketConsume(Bucket &bucket, size_t bytes) const;
+        void BucketRefund(Bucket &bucket, size_t bytes) const;
+
+        bool m_enabled;
+        double m_burstBytes;
+        int64_t m_maxDelayUs;
+        double m_targetBytesPerUs;
+        Bucket m_global;
+        std::vector<Bucket> m_targets;
+
+        uint64_t m_shapedDatagrams;
+        uint64_t m_shapedDelayUs;
+        int64_t m_maxShapedDelayUs;
+        uint64_t m_overruns;
+    };
+}
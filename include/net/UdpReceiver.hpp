@@ -0,0 +1,173 @@
+/**
+ * @file UdpReceiver.hpp
+ * @brief 接收端函式庫：recvmmsg 批次接收、FEC 補回、分段重組、解碼與各裝置序號追蹤
+ *
+ * - Datagram 以 recvmmsg 一次取回多個，寫入預先配置的固定 Slot (不做逐封包配置)
+ * - Parity 交給 FecDecoder，補回的 Datagram 與一般 Datagram 一同送入 FragmentReassembler
+ * - 完整 Batch 解碼為 Host Order 的 interleaved uint32 (Raw 為 Big Endian，DeltaPack 經 SampleCodec)
+ * - 每個 deviceId 以滑動視窗追蹤序號：缺口、亂序、重複、重送補回
+ * - Status 封包解析後交給 StatusCallback
+ *
+ * 輸出方式二選一：
+ *   1. Callback：呼叫端自行呼叫 Poll()，每個 Batch 於 Poll 內以 BatchCallback 交出
+ *   2. Ring：Start() 啟動接收執行緒，呼叫端以 Pop() 取出 (交換 Buffer，不複製；滿時捨棄最舊者)
+ */
+#pragma once
+
+#include "net/FragmentReassembler.hpp"
+#include "net/Fec.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <sys/socket.h>
+
+namespace Net
+{
+    struct ReceiverOptions
+    {
+        std::string bindIp;               // 空字串 = INADDR_ANY
+        int recvBufferBytes = 4 * 1024 * 1024; // SO_RCVBUF (0 = 系統預設)
+        size_t batchSize = 32;            // 每次 recvmmsg 最多取回的 Datagram 數
+        size_t maxDatagram = 65536;       // 每個 Slot 的大小
+        bool fec = true;                  // 處理 Parity Datagram
+        size_t maxPending = 16;           // 同時重組中的 Batch 數
+        size_t maxBatchBytes = 1024 * 1024; // 單一 Batch 的上限 (重組的 Payload 與解碼後的樣本)，超過視為格式 / 解碼錯誤
+        int64_t reassemblyTimeoutUs = 500000;
+    };
+
+    // 解碼完成的 Batch
+    struct DecodedBatch
+    {
+        PacketHeader header;            // frag* 欄位無意義
+        std::vector<uint32_t> samples;  // interleaved (numSamples * numChannels)，Host Order
+        uint64_t arrivalNs = 0;         // 最後一個分段的 Kernel 接收時間 (CLOCK_REALTIME)
+    };
+
+    // 單一裝置的序號統計
+    struct StreamStats
+    {
+        uint16_t deviceId = 0;
+        uint64_t batches = 0;      // 交出的 Batch 數 (不含重複)
+        uint64_t samples = 0;
+        uint64_t lastSeq = 0;      // 目前收到的最大序號
+        uint64_t missing = 0;      // 目前仍缺少的序號數 (晚到或重送補回後會扣除)
+        uint64_t reordered = 0;    // 晚於更大序號到達的 Batch
+        uint64_t recovered = 0;    // 由重送 (RETRANSMIT) 補回的 Batch
+        uint64_t duplicates = 0;
+        uint64_t tooLate = 0;      // 落在追蹤視窗之外才到達 (無法判斷是否重複)
+        uint64_t decodeErrors = 0;
+        uint64_t restarts = 0;     // 序號大幅往回跳 (裝置重新啟動)，之後重新追蹤
+        uint64_t lastArrivalNs = 0;
+    };
+
+    typedef std::function<void(const DecodedBatch &)> BatchCallback;
+    typedef std::function<void(const StatusReport &)> StatusCallback;
+
+    class UdpReceiver
+    {
+    public:
+        UdpReceiver();
+        ~UdpReceiver();
+
+        bool Init(int port, const ReceiverOptions &options = ReceiverOptions());
+
+        // 需在 Poll / Start 之前設定
+        void SetBatchCallback(BatchCallback callback) { m_batchCallback = callback; }
+        void SetStatusCallback(StatusCallback callback) { m_statusCallback = callback; }
+
+        /**
+         * @brief 等待最多 timeoutMs，接收並處理目前所有可讀的 Datagram
+         * @return 本次交出的 Batch 數，Socket 錯誤回傳 -1
+         */
+        int Poll(int timeoutMs);
+
+        /**
+         * @brief 啟動接收執行緒，Batch 改放入 Ring 供 Pop() 取出 (BatchCallback 不再呼叫)
+         * @param capacity Ring 可容納的 Batch 數
+         */
+        bool Start(size_t capacity);
+        void Stop();
+
+        /**
+         * @brief 取出最舊的 Batch (與 out 交換 Buffer)
+         * @return false 等待 timeoutMs 後仍無資料
+         */
+        bool Pop(DecodedBatch &out, int timeoutMs);
+
+        // 各裝置統計快照 (依 deviceId 排序，可由任意執行緒呼叫)
+        std::vector<StreamStats> GetStreamStats() const;
+
+        uint64_t GetDatagrams() const { return m_datagrams; }
+        uint64_t GetBytes() const { return m_bytes; }
+        uint64_t GetRecvCalls() const { return m_recvCalls; }
+        uint64_t GetMalformed() const { return m_malformed + m_reassembler.GetMalformed(); }
+        uint64_t GetFecRecovered() const { return m_fecRecovered; }
+        uint64_t GetIncompleteDropped() const { return m_incompleteDropped; }
+        uint64_t GetRingDropped() const { return m_ringDropped; }
+
+        void Close();
+
+    private:
+        // 序號追蹤視窗 (低於 lastSeq 的 64 個序號以 Bitmap 記錄是否已收到)
+        struct StreamState
+        {
+            bool started = false;
+            uint64_t seen = 0; // bit i = lastSeq - i 已收到
+            StreamStats stats;
+        };
+
+        void HandleDatagram(const uint8_t *data, size_t length, uint64_t arrivalNs, int &delivered);
+        void HandleData(const uint8_t *data, size_t length, uint64_t arrivalNs, int &delivered);
+        void PushFec(const uint8_t *data, size_t length, uint64_t arrivalNs, int &delivered);
+        bool TrackSequence(const PacketHeader &header, uint64_t arrivalNs, bool decoded);
+        bool Decode(const ReassembledBatch &batch, std::vector<uint32_t> &samples);
+        void Deliver();
+        void Run();
+
+        int m_sockfd;
+        ReceiverOptions m_options;
+
+        // recvmmsg Slot (預先配置)
+        std::vector<uint8_t> m_buffers;
+        std::vector<struct mmsghdr> m_msgs;
+        std::vector<struct iovec> m_iovs;
+        std::vector<uint8_t> m_controls;
+
+        FragmentReassembler m_reassembler;
+        FecDecoder m_fec;
+        ReassembledBatch m_batch;
+        std::vector<std::vector<uint8_t>> m_recoveredDatagrams;
+        DecodedBatch m_decoded;
+        StatusReport m_status;
+
+        mutable std::mutex m_statsMutex;
+        std::map<uint16_t, StreamState> m_streams;
+
+        BatchCallback m_batchCallback;
+        StatusCallback m_statusCallback;
+
+        // Ring 模式
+        std::vector<DecodedBatch> m_ring;
+        size_t m_head;
+        size_t m_count;
+        bool m_ringMode;
+        std::mutex m_ringMutex;
+        std::condition_variable m_ringCond;
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+
+        std::atomic<uint64_t> m_datagrams;
+        std::atomic<uint64_t> m_bytes;
+        std::atomic<uint64_t> m_recvCalls;
+        std::atomic<uint64_t> m_malformed;
+        std::atomic<uint64_t> m_fecRecovered;
+        std::atomic<uint64_t> m_incompleteDropped;
+        std::atomic<uint64_t> m_ringDropped;
+    };
+}
@@ -8,20 +8,34 @@
 #include <vector>
 #include <cstdint>
 #include <netinet/in.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include "net/SampleCodec.hpp"
+#include "net/WireProtocol.hpp"
+#include "net/SendHistory.hpp"
+#include "net/Fec.hpp"
+#include "net/DatagramPacer.hpp"
 
 namespace Net
 {
-// 定義二進位封包結構 (Header + Payload)
-// 讓 Python 端可以用 struct.unpack 解析
-#pragma pack(push, 1) // 取消記憶體對齊，確保封包大小緊湊
-    struct UdpHeader
+    // 批次模式 (sendmmsg) 中單一 Datagram 的發送結果
+    struct SendResult
     {
-        uint32_t seqId;       // 封包序號
-        double timestamp;     // 第一筆資料的時間戳
-        uint16_t numSamples;  // 這個封包包含多少個 Sample
-        uint16_t numChannels; // 通道數
+        uint64_t seqId; // 對應的封包序號
+        int target;     // 目標索引 (AddTarget 的順序，0 為 Init 的目標)
+        int error;      // 0 = 成功, 否則為 errno
+    };
+
+    // Socket 調整參數 (Init 時套用)；Init 後可由 GetSocketOptions() 取得實際生效值
+    struct SocketOptions
+    {
+        int sendBufferBytes = 0;  // SO_SNDBUF (0 = 系統預設；Linux 實際值為要求的兩倍)
+        int dscp = -1;            // IP_TOS 的 DSCP 欄位 0-63 (-1 = 不設定，46 = EF)
+        int priority = -1;        // SO_PRIORITY 0-6 (-1 = 不設定)，決定網卡佇列的優先權
+        std::string bindDevice;   // SO_BINDTODEVICE 網卡名稱 (空字串 = 不綁定，需 root)
+        std::string sourceIp;     // 綁定的來源 IP (空字串 = 依路由表)
+        bool nonBlocking = false; // 非阻塞：Socket Buffer 滿時直接計入發送失敗而非等待
     };
-#pragma pack(pop)
 
     class UdpSender
     {
@@ -33,29 +47,258 @@ namespace Net
          * @brief 初始化 UDP Socket
          * @param targetIp 目標 IP
          * @param port 目標 Port
+         * @param options Socket 調整參數 (任一項設定失敗時只記錄錯誤，不中止初始化)
          * @return true 成功, false 失敗
          */
-        bool Init(const std::string &targetIp, int port);
+        bool Init(const std::string &targetIp, int port, const SocketOptions &options = SocketOptions());
+
+        // Init 後實際生效的 Socket 參數 (由 getsockopt 讀回)
+        const SocketOptions &GetSocketOptions() const { return m_socketOptions; }
+
+        /**
+         * @brief 新增發送目標 (Unicast 或 IPv4 Multicast Group)
+         * 每個 Datagram 只編碼一次，再依序送往所有目標。
+         * @return true 成功, false IP 格式錯誤或尚未 Init
+         */
+        bool AddTarget(const std::string &targetIp, int port);
+
+        /**
+         * @brief 設定 Multicast 發送參數 (需在 Init 之後呼叫)
+         * @param ttl Multicast TTL (1 = 不跨 Router)
+         * @param interfaceIp 送出的網卡 IP (空字串表示依路由表)
+         * @param loopback 是否讓本機也收到
+         */
+        bool SetMulticast(int ttl, const std::string &interfaceIp, bool loopback);
+
+        /**
+         * @brief 發送一個 Batch (依 SetProtocolVersion 選擇 v1 / v2 Header)
+         * 零複製：Header 放在 Sender 內預先配置的 Slot，Payload 直接指向 rawData。
+         * @param desc Batch 描述 (裝置、通道、序號、樣本索引、時間、取樣率、要求的編碼)
+         * @param rawData 原始數據起點 (interleaved)
+         * @param rawCount rawData 的 uint32 數量
+         * @return true 成功送出 (批次模式下為成功排入), false 失敗
+         */
+        bool SendBatch(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount);
 
         /**
-         * @brief 發送原始 ADC 數值 (Binary Batch)
+         * @brief 發送原始 ADC 數值 (Binary Batch，未提供裝置資訊的簡易介面)
          * @param seqId 序號
          * @param timestamp 時間戳
          * @param rawData 所有通道的原始數據 (interleaved: ch0, ch1, ch0, ch1...)
          * @param numSamples 樣本數 (Frames)
          * @param numChannels 通道數
+         * @param encoding Payload 編碼方式 (預設 Raw)
+         * 超過 MTU 的 Batch 會自動切成多個分段 Datagram (共用同一個 seqId)。
          */
         void SendRawBatch(uint32_t seqId,
                           double timestamp,
                           const std::vector<uint32_t> &rawData,
-                          uint16_t numSamples,
-                          uint16_t numChannels);
+                          uint32_t numSamples,
+                          uint16_t numChannels,
+                          SampleEncoding encoding = SampleEncoding::Raw);
+
+        /**
+         * @brief 零複製發送 (sendmsg + iovec)
+         * Payload 直接指向呼叫端 Buffer，不做配置也不做 memcpy；
+         * 適用任何連續 Buffer (例如 Pool 取得的 Batch Buffer)。
+         * @param rawData 原始數據起點 (interleaved)
+         * @param rawCount rawData 的 uint32 數量
+         * @return true 成功送出, false 失敗
+         */
+        bool SendRawBatch(uint32_t seqId,
+                          double timestamp,
+                          const uint32_t *rawData,
+                          size_t rawCount,
+                          uint32_t numSamples,
+                          uint16_t numChannels,
+                          SampleEncoding encoding = SampleEncoding::Raw);
+
+        /**
+         * @brief 設定鏈路 MTU，Datagram (含 Header) 不會超過 MTU - 28
+         * @param mtu 鏈路 MTU (Byte)，預設 1500
+         */
+        void SetMtu(int mtu);
+
+        /**
+         * @brief 設定封包格式版本 (1: 相容模式, 2: 自我描述格式，預設)
+         */
+        void SetProtocolVersion(int version);
+
+        /**
+         * @brief 啟用批次發送模式：累積 Datagram 後以單一 sendmmsg 送出
+         * 達到 maxMessages 筆或最早一筆等待超過 maxDelayUs 即 Flush。
+         * 批次模式下 Payload 會複製到預先配置的 Slot (呼叫端 Buffer 可立即重用)。
+         * @param maxMessages 每次 sendmmsg 的最大筆數 (<= 1 表示關閉批次模式)
+         * @param maxDelayUs 最大累積延遲 (微秒)
+         */
+        void SetBatching(int maxMessages, long maxDelayUs);
+
+        /**
+         * @brief Raw Payload 送出前轉為 Big Endian (線路順序)
+         * Controller (PPC) 的主機順序即線路順序，預設不轉換，Raw 維持零複製。
+         * 在 Little Endian 主機送出 Raw 的工具 (重播 / 負載產生) 需啟用：Payload 先轉換到內部 Buffer 再送出 (多一次複製)。
+         */
+        void SetRawByteSwap(bool swap) { m_rawByteSwap = swap; }
+
+        /**
+         * @brief 截止時間檢查：若最早一筆已等待超過 maxDelayUs 則立即 Flush
+         * 呼叫端需以不大於 maxDelayUs 的間隔呼叫 (例如主迴圈閒置時)，以保證延遲上限。
+         */
+        void Poll();
+
+        /**
+         * @brief 立即送出所有累積中的 Datagram
+         * @return 成功送出的筆數
+         */
+        int Flush();
+
+        /**
+         * @brief 啟用 NACK 選擇性重送 (需在 Init / SetMtu 之後呼叫)
+         * 保留最近 historyDepth 個 Datagram；接收端將 NACK 送到 nackPort，
+         * Sender 只重送遺失的序號給提出要求的位址 (NACK 的來源位址)。
+         * @param historyDepth 歷史環深度 (Datagram 數)
+         * @param nackPort 接收 NACK 的本機 Port
+         * @param maxPerSec 每秒最多重送的 Datagram 數 (Token Bucket)
+         */
+        bool EnableRetransmit(size_t historyDepth, int nackPort, int maxPerSec);
+
+        /**
+         * @brief 處理所有待處理的 NACK (非阻塞，於主迴圈中週期性呼叫)
+         * 每個 NACK 最多處理 historyDepth 個序號，重送額度用完後其餘序號只計入 Throttled。
+         * @return 本次重送的 Datagram 數
+         */
+        int ServiceNacks();
+
+        /**
+         * @brief 對指定裝置的串流啟用 FEC (需在 SetProtocolVersion / SetMtu 之後呼叫，僅支援 v2)
+         * 每 groupSize 個 Data Datagram 送出 parityCount 個 Parity Datagram (額外頻寬約 M / K)；
+         * 該裝置的 Data Datagram 會預留 Parity Header 空間，使 Parity 也不超過 MTU。
+         * @param deviceId 串流的裝置 ID (PacketHeader.deviceId)
+         * @param scheme XOR (M 固定為 1) 或 RS
+         * @param groupSize 每組 Data 數 K
+         * @param parityCount 每組 Parity 數 M
+         * @param maxDelayUs 群組未滿時最長等待時間，逾時由 Poll() 以現有成員送出 Parity
+         */
+        bool EnableFec(uint16_t deviceId, FecScheme scheme, int groupSize, int parityCount, long maxDelayUs);
+
+        /**
+         * @brief 在發送前加入節奏階段 (例如 TrafficShaper 流量整形)
+         * 每個送出的 Datagram (資料 / Parity / 重送，每個目標各一次) 呼叫一次 Admit()；
+         * 重送以 target = -1 呼叫 (TrafficShaper 只套用全域 Bucket)。批次模式下 sendmmsg 會在需要等待的位置切開；
+         * 部分送出時其餘已計入的筆數沿用到下一次呼叫，發送失敗的 Datagram 以 Refund() 歸還。
+         * @param pacer NULL = 不整形；呼叫端須保證在 UdpSender 使用期間有效
+         */
+        void SetPacer(DatagramPacer *pacer);
+
+        /**
+         * @brief 送出 Status 封包到所有目標 (不經批次 / 歷史環 / FEC；v1 模式下不送)
+         * @return true 成功, false v1 模式或發送失敗
+         */
+        bool SendStatus(const StatusReport &report);
+
+        // 已產生的 Parity Datagram 數 (多目標時每個目標各送一份，不重複計算)
+        uint64_t GetParitySent() const { return m_paritySent; }
+
+        // NACK / 重送統計
+        uint64_t GetNacksReceived() const { return m_nacksReceived; }
+        uint64_t GetRetransmitted() const { return m_retransmitted; }
+        uint64_t GetRetransmitMisses() const { return m_retransmitMisses; }       // 已不在歷史環中
+        uint64_t GetRetransmitThrottled() const { return m_retransmitThrottled; } // 超過速率上限而略過
+
+        // 最近一次 Flush 每筆 Datagram (每個目標各一筆) 的結果
+        const std::vector<SendResult> &GetLastFlushResults() const { return m_flushResults; }
+
+        // 累計發送失敗次數
+        uint64_t GetSendErrors() const { return m_sendErrors; }
+
+        // 累計成功交給 Kernel 的 Datagram 數 (含 Parity / Status / 重送，多目標時每個目標各計一次)
+        uint64_t GetSentDatagrams() const { return m_sentDatagrams; }
 
         void Close();
 
     private:
+        // 批次模式的預配置 Slot (Header + Payload 連續存放)
+        struct BatchSlot
+        {
+            uint64_t seqId;
+            std::vector<uint8_t> data;
+            struct iovec iov;
+        };
+
+        // 單一裝置串流的 FEC 狀態
+        struct FecStream
+        {
+            uint16_t deviceId;
+            FecScheme scheme;
+            int groupSize;
+            int parityCount;
+            long maxDelayUs;
+            FecEncoder encoder;
+        };
+
+        void ApplySocketOptions(const SocketOptions &options);
+        bool SendDatagram(uint64_t seqId);
+        bool TransmitDatagram(uint64_t seqId);
+        FecStream *FindFec(uint16_t deviceId);
+        bool SendParity(FecStream &stream);
+        void Retransmit(uint16_t deviceId, uint64_t seqId, const struct sockaddr_in &requester);
+        void RebuildBatchMsgs();
+        bool Admit(int target, size_t bytes, int64_t readyUs, bool mayWait)
+        {
+            return !m_pacer || m_pacer->Admit(target, bytes, readyUs, mayWait);
+        }
+        void Refund(int target, size_t bytes)
+        {
+            if (m_pacer)
+                m_pacer->Refund(target, bytes);
+        }
+        static int64_t NowUs();
+
+        // 批次模式
+        int m_batchMax;
+        long m_batchDelayUs;
+        int m_batchCount;
+        int64_t m_batchFirstUs;
+        std::vector<BatchSlot> m_batchSlots;
+        std::vector<struct mmsghdr> m_batchMsgs;
+        std::vector<SendResult> m_flushResults;
+        bool m_useSendmmsg;
+        uint64_t m_sendErrors;
+        uint64_t m_sentDatagrams;
+
+        // NACK 重送
+        SendHistory m_history;
+        size_t m_historyDepth;
+        int m_nackSockfd;
+        int m_retxMaxPerSec;
+        double m_retxTokens;
+        int64_t m_retxLastUs;
+        std::vector<const SendHistory::Entry *> m_retxFound;
+        uint64_t m_nacksReceived;
+        uint64_t m_retransmitted;
+        uint64_t m_retransmitMisses;
+        uint64_t m_retransmitThrottled;
+
+        // FEC (依裝置)
+        std::vector<FecStream> m_fecStreams;
+        uint64_t m_paritySent;
+
+        // 流量整形
+        DatagramPacer *m_pacer; // NULL = 不整形
+        int64_t m_readyUs; // 目前 Batch / Parity 交給 Sender 的時間 (整形延遲的起點)
+
+        std::vector<uint8_t> m_statusBuffer;               // Status 序列化用 (預先配置)
+        std::vector<uint8_t> m_encodeBuffer;               // 壓縮用暫存區 (重複使用，避免每次配置)
+        PacketHeader m_txHeader;                           // 目前發送中的 Header 內容
+        uint8_t m_headerSlot[WIRE_V2_HEADER_SIZE];         // 預先配置的 Header Slot (序列化後)
+        struct iovec m_iov[2];                             // [0] Header, [1] Payload
+        struct msghdr m_msg;                               // Init 時填好目的地與 iovec
+        size_t m_maxDatagram;                              // 單一 Datagram 上限 (MTU - IP/UDP Header)
+        uint8_t m_protocolVersion;
+        bool m_rawByteSwap;                        // Raw Payload 需轉為 Big Endian (Little Endian 主機)
         int m_sockfd;
-        struct sockaddr_in m_servaddr;
+        SocketOptions m_socketOptions;             // 實際生效值
+        std::vector<struct sockaddr_in> m_targets; // 所有目標 ([0] 為 Init 指定)
         bool m_initialized;
     };
 }
\ No newline at end of file
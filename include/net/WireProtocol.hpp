@@ -0,0 +1,238 @@
+/**
+ * @file WireProtocol.hpp
+ * @brief UDP 封包格式定義 (v1 相容格式與 v2 自我描述格式)
+ *
+ * 所有欄位皆為 Big Endian (與 PPC 主機順序相同，舊版 Python 端以 '>' 解析)。
+ *
+ * v1 (相容模式, 16 Byte)：
+ *   seqId(u32) timestamp(f64 秒) numSamples(u16) numChannels(u16)
+ *   numChannels: bit0-7 通道數, bit8-14 編碼, bit15 分段旗標 (後接 UdpFragmentHeader)
+ *
+ * v2 (64 Byte)：
+ *   off  size  欄位
+ *    0    2    magic = 0x5545 ("UE")
+ *    2    1    version = 2
+ *    3    1    packetType (PacketType)
+ *    4    2    headerBytes (含 Header 本身，供日後擴充)
+ *    6    1    encoding (SampleEncoding)
+ *    7    1    flags (WIRE_FLAG_*)
+ *    8    2    deviceId
+ *   10    2    numChannels
+ *   12    4    channelMask
+ *   16    8    seqId
+ *   24    8    firstSampleIndex (此 Batch 第一筆在該裝置的累計樣本序號)
+ *   32    8    timestampNs (Unix Epoch 奈秒)
+ *   40    8    sampleRate (f64 Hz)
+ *   48    4    numSamples (整個 Batch)
+ *   52    2    fragIndex
+ *   54    2    fragCount (未分段為 1)
+ *   56    4    fragOffset (本段在完整 Payload 中的 Byte 位移)
+ *   60    4    payloadBytes (完整 Payload 長度)
+ *
+ * 判別方式：前 2 Byte 為 magic 且第 3 Byte 為 2 即視為 v2
+ * (v1 的 seqId 需達 0x554502xx 才會誤判，實務上不會發生)。
+ *
+ * NACK (接收端 -> 發送端，要求重送)：
+ *    0    2    magic = 0x5545
+ *    2    1    version = 2
+ *    3    1    packetType = Nack
+ *    4    2    deviceId (v1 串流填 0)
+ *    6    2    rangeCount (<= NACK_MAX_RANGES)
+ *    8   10*N  { firstSeq(u64), count(u16) } 遺失的序號區間
+ *
+ * Parity (FEC)：前 4 Byte 與 v2 相同 (packetType = Parity)，其餘格式見 net/Fec.hpp。
+ *
+ * Status (發送端 -> 接收端，低頻率的健康狀態)：
+ *    0    2    magic = 0x5545
+ *    2    1    version = 2
+ *    3    1    packetType = Status
+ *    4    2    headerBytes = 64 (固定區大小，與 v2 Header 等長，舊接收端依 packetType 略過)
+ *    6    1    deviceCount (<= STATUS_MAX_DEVICES)
+ *    7    1    保留
+ *    8    8    uptimeMs
+ *   16    4    statusSeq
+ *   20    4    sendErrors (累計 sendto / sendmmsg 失敗)
+ *   24    4    sendQueueDepth
+ *   28    4    sendQueueHighWater
+ *   32    4    sendDropped
+ *   36    4    sendAvgServiceUs
+ *   40    4    sendMaxServiceUs
+ *   44   20    保留 (0)
+ *   64  40*N   每個裝置：
+ *                0 deviceId(u16) 2 queueDepth(u16) 4 queueHighWater(u16) 6 保留(u16)
+ *                8 samples(u64) 16 readErrors(u32) 20 queueDropped(u32)
+ *               24 jitterAvgUs(u32) 28 jitterMaxUs(u32) 32 loopAvgUs(u32) 36 loopMaxUs(u32)
+ *   超過欄位寬度的數值以最大值表示。
+ */
+#pragma once
+
+#include "net/SampleCodec.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Net
+{
+// v1 封包結構 (Header + Payload)，讓 Python 端可以用 struct.unpack 解析
+#pragma pack(push, 1) // 取消記憶體對齊，確保封包大小緊湊
+    struct UdpHeader
+    {
+        uint32_t seqId;       // 封包序號
+        double timestamp;     // 第一筆資料的時間戳
+        uint16_t numSamples;  // 這個封包包含多少個 Sample
+        uint16_t numChannels; // bit0-7: 通道數, bit8-14: Payload 編碼 (SampleEncoding), bit15: 分段旗標
+    };
+
+    // v1 分段延伸 Header (僅在 numChannels 的分段旗標設立時緊接在 UdpHeader 之後)
+    struct UdpFragmentHeader
+    {
+        uint16_t fragIndex;    // 本段索引 (0 起算)
+        uint16_t fragCount;    // 總段數
+        uint32_t fragOffset;   // 本段在完整 Payload 中的 Byte 位移
+        uint32_t payloadBytes; // 完整 Payload 長度 (編碼後)
+        uint32_t numSamples;   // 完整 Batch 的樣本數 (不受 UdpHeader 16 bit 限制)
+    };
+#pragma pack(pop)
+
+    // v1 numChannels 欄位拆解 (未分段且編碼為 Raw 時高 8 bit 為 0，與舊版接收端相容)
+    static const uint16_t UDP_CHANNEL_COUNT_MASK = 0x00FF;
+    static const uint16_t UDP_ENCODING_MASK = 0x7F00;
+    static const int UDP_ENCODING_SHIFT = 8;
+    static const uint16_t UDP_FLAG_FRAGMENTED = 0x8000;
+
+    // IPv4 + UDP Header 長度 (由 MTU 換算 Datagram 上限)
+    static const int UDP_IP_OVERHEAD = 28;
+
+    // v2 常數
+    static const uint16_t WIRE_MAGIC = 0x5545;
+    static const uint8_t WIRE_VERSION_1 = 1;
+    static const uint8_t WIRE_VERSION_2 = 2;
+    static const size_t WIRE_V2_HEADER_SIZE = 64;
+    static const size_t WIRE_V2_FLAGS_OFFSET = 7; // flags 欄位位置 (重送 / FEC 直接修改已編碼的 Datagram)
+    static const uint8_t WIRE_FLAG_FRAGMENTED = 0x01;
+    static const uint8_t WIRE_FLAG_RETRANSMIT = 0x02; // 由 NACK 觸發的重送
+    static const uint8_t WIRE_FLAG_TIME_CORRECTED = 0x04; // timestampNs 已換算為接收端時間 (見 net/TimeSync.hpp)
+
+    // NACK 常數
+    static const size_t NACK_HEADER_SIZE = 8;
+    static const size_t NACK_RANGE_SIZE = 10;
+    static const size_t NACK_MAX_RANGES = 64;
+
+    // Status 封包
+    static const size_t STATUS_HEADER_SIZE = 64;
+    static const size_t STATUS_DEVICE_SIZE = 40;
+    static const size_t STATUS_MAX_DEVICES = 32;
+
+    // 封包種類 (v2)
+    enum class PacketType : uint8_t
+    {
+        Data = 0, // 取樣資料 Batch
+        Nack = 1, // 接收端要求重送
+        Parity = 2, // FEC Parity (格式見 net/Fec.hpp)
+        Status = 3,  // 健康狀態 / Heartbeat
+        TimeSync = 4 // 時鐘偏差量測 (獨立 Port，格式見 net/TimeSync.hpp)
+    };
+
+    // NACK 中的一段遺失序號 [firstSeq, firstSeq + count)
+    struct NackRange
+    {
+        uint64_t firstSeq;
+        uint16_t count;
+    };
+
+    // 解析後的封包 Header (v1 / v2 共用；v1 缺少的欄位為 0)
+    // 發送端亦以此描述一個 Batch (frag* / payloadBytes / version 由 UdpSender 填寫)
+    struct PacketHeader
+    {
+        uint8_t version = WIRE_VERSION_2;
+        PacketType type = PacketType::Data;
+        SampleEncoding encoding = SampleEncoding::Raw;
+        uint8_t flags = 0;
+        uint16_t deviceId = 0;
+        uint16_t numChannels = 0;
+        uint32_t channelMask = 0;
+        uint64_t seqId = 0;
+        uint64_t firstSampleIndex = 0;
+        uint64_t timestampNs = 0;
+        double sampleRate = 0.0;
+        uint32_t numSamples = 0;
+        uint16_t fragIndex = 0;
+        uint16_t fragCount = 1;
+        uint32_t fragOffset = 0;
+        uint32_t payloadBytes = 0;
+        size_t headerBytes = 0; // 解析時填入：Payload 起點
+    };
+
+    /**
+     * @brief 依 header.version 序列化 Header (v1 分段時含 UdpFragmentHeader)
+     * @param out 輸出 Buffer (至少 WIRE_V2_HEADER_SIZE)
+     * @return 寫入的 Byte 數
+     */
+    size_t WriteHeader(const PacketHeader &header, uint8_t *out);
+
+    /**
+     * @brief 解析 Datagram Header (自動判別 v1 / v2)
+     * @return true 成功, false 長度不足或格式錯誤
+     */
+    bool ParseHeader(const uint8_t *data, size_t length, PacketHeader &header);
+
+    /**
+     * @brief 序列化 NACK
+     * @return 寫入的 Byte 數 (rangeCount 超過上限時只寫入前 NACK_MAX_RANGES 段)
+     */
+    size_t WriteNack(uint16_t deviceId, const NackRange *ranges, size_t rangeCount, uint8_t *out, size_t capacity);
+
+    /**
+     * @brief 解析 NACK
+     * @param ranges 輸出陣列 (至少 NACK_MAX_RANGES 個)
+     * @return 解析出的區間數，格式錯誤回傳 0
+     */
+    size_t ParseNack(const uint8_t *data, size_t length, uint16_t &deviceId, NackRange *ranges);
+
+    // Status 封包中單一裝置的擷取統計
+    struct DeviceStatus
+    {
+        uint16_t deviceId = 0;
+        uint32_t queueDepth = 0;
+        uint32_t queueHighWater = 0;
+        uint32_t queueDropped = 0;
+        uint64_t samples = 0;     // 累計取樣數
+        uint32_t readErrors = 0;  // 讀取失敗次數
+        uint32_t jitterAvgUs = 0; // 讀取迴圈週期與設定週期的偏差
+        uint32_t jitterMaxUs = 0;
+        uint32_t loopAvgUs = 0; // 讀取迴圈處理時間
+        uint32_t loopMaxUs = 0;
+    };
+
+    // Status 封包內容
+    struct StatusReport
+    {
+        uint64_t uptimeMs = 0;
+        uint32_t statusSeq = 0;
+        uint32_t sendErrors = 0;
+        uint32_t sendQueueDepth = 0;
+        uint32_t sendQueueHighWater = 0;
+        uint32_t sendDropped = 0;
+        uint32_t sendAvgServiceUs = 0;
+        uint32_t sendMaxServiceUs = 0;
+        std::vector<DeviceStatus> devices;
+    };
+
+    /**
+     * @brief 序列化 Status (裝置數超過上限或 capacity 不足時只寫入前面的裝置)
+     * @return 寫入的 Byte 數，capacity 放不下固定區時回傳 0
+     */
+    size_t WriteStatus(const StatusReport &report, uint8_t *out, size_t capacity);
+
+    /**
+     * @brief 解析 Status
+     * @return true 成功, false 長度不足或格式錯誤
+     */
+    bool ParseStatus(const uint8_t *data, size_t length, StatusReport &report);
+
+    /**
+     * @brief 由 "ai0:7" / "ai3" 形式的通道範圍計算 Channel Mask
+     */
+    uint32_t ChannelMaskFromRange(const std::string &range);
+}
@@ -0,0 +1,58 @@
+//=============================================================================
+// NAME:    include/utils/ArgParse.hpp
+// DESC:    工具程式的命令列數值參數 (整個字串皆需為數字且在範圍內；失敗時由呼叫端印出用法)
+//=============================================================================
+#pragma once
+
+#include <string>
+#include <cstdlib>
+#include <cerrno>
+
+namespace Utils
+{
+
+    // 整數參數 (int / long / size_t / int64_t 等)
+    template <typename T>
+    inline bool ParseInt(const char *text, long long minValue, long long maxValue, T &value)
+    {
+        char *end;
+        errno = 0;
+        long long v = strtoll(text, &end, 10);
+        if (end == text || *end != '\0' || errno == ERANGE || v < minValue || v > maxValue)
+            return false;
+        value = (T)v;
+        return true;
+    }
+
+    // 浮點數參數
+    inline bool ParseDouble(const char *text, double minValue, double maxValue, double &value)
+    {
+        char *end;
+        errno = 0;
+        double v = strtod(text, &end);
+        if (end == text || *end != '\0' || errno == ERANGE || !(v >= minValue && v <= maxValue))
+            return false;
+        value = v;
+        return true;
+    }
+
+    // UDP / TCP Port (1-65535)
+    inline bool ParsePort(const char *text, int &port)
+    {
+        return ParseInt(text, 1, 65535, port);
+    }
+
+    // "ip:port" (未指定 Port 時保留 port 原值)
+    inline bool ParseEndpoint(const std::string &text, std::string &ip, int &port)
+    {
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos)
+        {
+            ip = text;
+            return !ip.empty();
+        }
+        ip = text.substr(0, colon);
+        return !ip.empty() && ParsePort(text.c_str() + colon + 1, port);
+    }
+
+} // namespace Utils
@@ -5,20 +5,67 @@
 
 #include "utils/UeiStructs.h"
 #include <string>
+#include <vector>
 
 namespace Utils
 {
 
+    // 單一 Task 的設定差異 (熱重新載入用，依 deviceId 對應)
+    struct TaskDiff
+    {
+        int deviceId = 0;
+        std::string taskName;
+        bool added = false;      // 只存在於新設定 (新增或由未啟用改為啟用)
+        bool removed = false;    // 只存在於執行中的設定
+        bool hardware = false;   // hardware_config (gain / excitation / coupling)
+        bool channels = false;   // 通道範圍 / 啟用狀態
+        bool sampleRate = false;
+        bool encoding = false;
+        bool fec = false;
+        bool processing = false; // moving_avg / fft / model_info
+
+        bool Any() const
+        {
+            return added || removed || hardware || channels || sampleRate || encoding || fec || processing;
+        }
+    };
+
+    struct ConfigDiff
+    {
+        std::vector<TaskDiff> tasks;              // 有變更的 Task
+        std::vector<std::string> restartSections; // 有變更的系統層級區塊 (JSON 名稱)
+
+        bool Empty() const { return tasks.empty() && restartSections.empty(); }
+    };
+
     class ConfigLoader
     {
     public:
         /**
          * @brief 載入並解析 JSON 設定檔
+         * 同目錄下的 <filePath>.cache 與 JSON 內容的 Hash 相符時直接載入 (不解析 JSON)；
+         * 否則解析 JSON 並重新寫出快取。
          * * @param filePath JSON 檔案路徑 (e.g., "config/DAQ_Settings.json")
          * @return SystemConfig 解析後的系統設定結構
          * @throws std::runtime_error 若檔案不存在或格式錯誤
          */
         static SystemConfig load(const std::string &filePath);
+
+        /**
+         * @brief load() 實際開啟的路徑 (filePath 不存在時改用上層目錄)
+         */
+        static std::string resolve(const std::string &filePath);
+
+        /**
+         * @brief 解析 JSON 文字 (不使用快取)
+         * @throws std::runtime_error 若格式錯誤
+         */
+        static SystemConfig parse(const std::string &jsonText);
+
+        /**
+         * @brief 比較執行中與新載入的設定
+         */
+        static ConfigDiff diff(const SystemConfig &running, const SystemConfig &next);
     };
 
 } // namespace Utils
\ No newline at end of file
@@ -0,0 +1,52 @@
+//=============================================================================
+// NAME:    include/utils/ConfigWatcher.hpp
+// DESC:    設定檔熱重新載入：inotify 監看 DAQ_Settings.json，變動後重新載入
+//=============================================================================
+#pragma once
+
+#include "utils/UeiStructs.h"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+namespace Utils
+{
+
+    class ConfigWatcher
+    {
+    public:
+        typedef std::function<void(const SystemConfig &)> ReloadCallback;
+
+        ConfigWatcher();
+        ~ConfigWatcher();
+
+        /**
+         * @brief 開始監看設定檔
+         * 監看的是所在目錄 (編輯器以暫存檔 rename 取代原檔也能偵測)，最後一次變動後 settleMs 才重新載入。
+         * callback 在監看執行緒中呼叫；JSON 格式錯誤時只印出錯誤並保留執行中的設定。
+         */
+        bool Start(const std::string &filePath, long settleMs, ReloadCallback callback);
+
+        void Stop();
+
+        uint64_t GetReloads() const { return m_reloads; }
+        uint64_t GetErrors() const { return m_errors; }
+
+    private:
+        void Run();
+        static int64_t NowUs();
+
+        std::string m_path;
+        std::string m_name; // 目錄中的檔名
+        long m_settleMs;
+        ReloadCallback m_callback;
+        int m_fd;
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+        std::atomic<uint64_t> m_reloads;
+        std::atomic<uint64_t> m_errors;
+    };
+
+} // namespace Utils
@@ -0,0 +1,67 @@
+//=============================================================================
+// NAME:    include/utils/StageMonitor.hpp
+// DESC:    Pipeline 各階段 (擷取 / 發送) 的佇列深度與服務時間統計
+//=============================================================================
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace Utils
+{
+
+    // 某一階段的統計快照
+    struct StageStats
+    {
+        size_t queueDepth = 0;     // 目前佇列深度
+        size_t queueHighWater = 0; // 佇列最高深度
+        uint64_t processed = 0;    // 已處理筆數
+        uint64_t dropped = 0;      // 佇列滿而捨棄的筆數
+        double avgServiceUs = 0.0; // 平均服務時間 (微秒)
+        int64_t maxServiceUs = 0;  // 最長服務時間 (微秒)
+    };
+
+    // 由生產者 / 消費者執行緒更新，其他執行緒以 Snapshot() 讀取
+    class StageMonitor
+    {
+    public:
+        void RecordDepth(size_t depth)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.queueDepth = depth;
+            if (depth > m_stats.queueHighWater)
+                m_stats.queueHighWater = depth;
+        }
+
+        void RecordDrop()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.dropped++;
+        }
+
+        void RecordService(int64_t serviceUs)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.processed++;
+            m_totalServiceUs += serviceUs;
+            if (serviceUs > m_stats.maxServiceUs)
+                m_stats.maxServiceUs = serviceUs;
+        }
+
+        StageStats Snapshot() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            StageStats stats = m_stats;
+            if (stats.processed > 0)
+                stats.avgServiceUs = (double)m_totalServiceUs / stats.processed;
+            return stats;
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        StageStats m_stats;
+        int64_t m_totalServiceUs = 0;
+    };
+
+} // namespace Utils
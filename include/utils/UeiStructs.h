@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 namespace Utils
 {
@@ -13,17 +14,17 @@ namespace Utils
     // FFT 設定結構
     struct FftConfig
     {
-        bool active;
+        bool active = false;
         std::string windowType; // e.g., "Hann", "Blackman"
-        int points;
-        double overlapPercent;
+        int points = 0;
+        double overlapPercent = 0.0;
     };
 
     // Moving Average 設定結構
     struct MovingAvgConfig
     {
-        bool active;
-        int windowSize;
+        bool active = false;
+        int windowSize = 0;
     };
 
     // 硬體特定參數 (整合所有卡的特殊需求)
@@ -47,28 +48,198 @@ namespace Utils
         std::string deviceName;   // 用於 UDP Header 識別
         std::string channelRange; // e.g., "ai0:3"
         std::string modelInfo;    // 描述資訊
-        bool active;
+        bool active = true;
 
         HardwareConfig hwConfig;   // 硬體參數
         MovingAvgConfig avgConfig; // 降頻/平滑參數
         FftConfig fftConfig;       // 頻譜分析參數
     };
 
+    // 前向錯誤更正 (FEC) 設定 (每個 Task 的串流獨立)
+    struct FecConfig
+    {
+        bool active = false;
+        std::string scheme = "xor"; // "xor" (每組 1 個 Parity) 或 "rs" (Reed-Solomon，每組 parityCount 個)
+        int groupSize = 8;          // 每組 Data Datagram 數 K
+        int parityCount = 1;        // 每組 Parity Datagram 數 M (額外頻寬約 M / K)
+        long maxDelayUs = 20000;    // 群組未滿時最長等待時間 (微秒)
+    };
+
     // 任務設定結構 (對應一個 I/O 卡/Slot)
     struct TaskConfig
     {
         std::string taskName;
-        bool active;
-        double sampleRate;
+        int deviceId = 0; // v2 Header 的裝置 ID (預設為 tasks 陣列中的位置)
+        bool active = false;
+        double sampleRate = 0.0;
+        std::string encoding = "raw"; // UDP Payload 編碼: "raw", "delta"
+        FecConfig fec;
         std::vector<ChannelConfig> channels;
     };
 
+    // 執行中 Task 參數的不可變快照 (熱重新載入時整份替換，讀取端持有的舊快照在釋放前仍有效)
+    typedef std::shared_ptr<const TaskConfig> TaskConfigPtr;
+
+    // 額外的 UDP 發送目標
+    struct UdpTargetConfig
+    {
+        std::string ip;
+        int port;
+    };
+
+    // IPv4 Multicast 發送設定
+    struct MulticastConfig
+    {
+        bool active = false;
+        std::string group = "239.192.0.10"; // Multicast Group 位址
+        int port = 5005;
+        int ttl = 1;                        // 1 = 不跨 Router
+        std::string interfaceIp;            // 送出的網卡 IP (空字串依路由表)
+        bool loopback = false;              // 本機是否也收到
+    };
+
+    // NACK 選擇性重送設定
+    struct RetransmitConfig
+    {
+        bool active = false;
+        int historyDepth = 2048; // 保留最近幾個 Datagram
+        int nackPort = 5006;     // 接收 NACK 的本機 Port
+        int maxPerSec = 500;     // 每秒最多重送的 Datagram 數
+    };
+
+    // TCP 串流輸出設定 (供需要完整資料的 Archive Client)
+    struct TcpSinkConfig
+    {
+        bool active = false;
+        int port = 5007;
+        int maxClients = 4;
+        long maxBacklogBytes = 4 * 1024 * 1024; // 每個 Client 的積壓上限，超過即中斷該 Client
+        int sendBufferBytes = 1024 * 1024;      // SO_SNDBUF (0 = 系統預設)
+    };
+
+    // 週期性 Status / Heartbeat 封包 (送往所有 UDP 目標，僅 v2)
+    struct StatusConfig
+    {
+        bool active = false;
+        long intervalMs = 1000; // 發送間隔 (毫秒)
+    };
+
+    // 時鐘偏差量測 (接收端發起，NTP 式四個時間戳)
+    struct TimeSyncConfig
+    {
+        bool active = false;
+        int port = 5008;                 // 接收 Request / Correction 的本機 Port
+        bool applyCorrections = true;    // 收到接收端回送的修正值後，Batch 時間改以接收端時間標示
+        long maxCorrectionAgeMs = 30000; // 修正值超過此時間未更新即停止套用
+        std::string clientIp;            // 只接受此 IP 的修正值 (空字串 = 最近一次送出 Request 的接收端)
+    };
+
+    // 本機 Shared Memory Ring 輸出 (同一台 Controller 上的 Logger / 告警程式使用)
+    struct ShmRingConfig
+    {
+        bool active = false;
+        std::string name = "/uei_daq";        // POSIX shm 名稱
+        long capacityBytes = 4 * 1024 * 1024; // 資料區大小 (向上取到 2 的次方)
+    };
+
+    // 本機環狀錄製 (網路中斷時保留最近的資料於 Flash / RAM Disk，事後取回)
+    struct LocalRecorderConfig
+    {
+        bool active = false;
+        std::string directory = "/mnt/rec";
+        int fileCount = 8;                // 循環使用的檔案數
+        long fileBytes = 8 * 1024 * 1024; // 每個檔案大小 (預先配置)
+        int blockBytes = 4096;            // 寫入單位 (至少 512)
+        long syncIntervalMs = 1000;       // 部分 Block 寫出並 fdatasync 的間隔
+        int queueDepth = 1024;            // 寫入佇列深度 (Batch 數)
+    };
+
+    // 黑盒子事件錄製 (RAM Ring 保留最近數秒，觸發時輸出前後時間窗)
+    struct EventRecorderConfig
+    {
+        bool active = false;
+        long preMs = 5000;                         // 觸發前保留時間
+        long postMs = 2000;                        // 觸發後錄製時間
+        std::string directory = "/mnt/rec/events"; // 事件檔目錄 (空字串 = 不寫檔)
+        std::string targetIp;                      // 事件資料送往的 UDP 目標 (空字串 = 不送出)
+        int targetPort = 5009;
+        int commandPort = 5010;             // 收到 "TRIGGER" 即觸發 (0 = 不開啟)；另可送 SIGUSR1
+        int triggerChannel = -1;            // 準位觸發通道 (Batch 內索引，-1 = 不使用)
+        long triggerLevel = 8388608;        // 觸發準位 (Code)
+        std::string triggerEdge = "rising"; // "rising", "falling", "both"
+    };
+
+    // 設定檔熱重新載入 (inotify 監看 DAQ_Settings.json)
+    struct HotReloadConfig
+    {
+        bool active = false;
+        long settleMs = 200; // 最後一次變動後等待的時間 (編輯器分次寫入時只載入一次)
+    };
+
+    // 資源預算檢查 (啟動前估算吞吐量 / 頻寬 / 記憶體 / CPU，超過上限時警告或拒絕啟動)
+    // 各階段成本預設為保守估計，請以 tools/codec_bench、tools/fec_bench 在 Controller 上量測後覆寫
+    struct ResourceBudgetConfig
+    {
+        bool active = true;
+        bool enforce = false;            // true = 超過預算時拒絕啟動 / 拒絕熱重新載入
+        double linkMbps = 100.0;         // 網路鏈路速率
+        double maxCpuPercent = 80.0;     // CPU 使用率上限 (單核)
+        double maxMemoryMb = 64.0;       // 佇列與緩衝區記憶體上限 (MB 皆為 10^6 bytes)
+        double readUsPerFrame = 20.0;    // 每個 Frame 一次 DqAdv217Read 的時間
+        double encodeMbPerSec = 20.0;    // delta 編碼速度 (Raw MB/s)
+        double compressionRatio = 0.6;   // delta 編碼後大小 / Raw 大小
+        double fecXorMbPerSec = 60.0;    // XOR FEC 編碼速度
+        double fecRsMbPerSec = 8.0;      // Reed-Solomon FEC 編碼速度
+        double sendUsPerDatagram = 15.0; // 每個 Datagram 的 sendmsg 成本 (每個目標)
+        double avgNsPerSample = 50.0;    // Moving Average 每筆樣本成本
+        double fftNsPerButterfly = 40.0; // FFT 每個 Butterfly 成本
+    };
+
+    // UDP Socket 調整 / QoS 設定 (Init 時套用)
+    struct UdpSocketConfig
+    {
+        int sendBufferBytes = 0;  // SO_SNDBUF (0 = 系統預設)
+        int dscp = -1;            // DSCP 0-63 (-1 = 不設定，46 = EF)
+        int priority = -1;        // SO_PRIORITY 0-6 (-1 = 不設定)
+        std::string bindDevice;   // SO_BINDTODEVICE 網卡名稱 (空字串 = 不綁定)
+        std::string sourceIp;     // 來源 IP (空字串 = 依路由表)
+        bool nonBlocking = false; // 非阻塞發送
+    };
+
+    // UDP 流量整形設定 (Token Bucket，平滑多 Task 同時 Flush 造成的 Burst)
+    struct ShapingConfig
+    {
+        bool active = false;
+        double globalMbps = 80.0; // 所有目標合計速率上限 (0 = 不限制)
+        double targetMbps = 0.0;  // 每個目標的速率上限 (0 = 不限制)
+        int burstBytes = 16384;   // Bucket 容量
+        long maxDelayUs = 5000;   // 每個 Datagram 最多額外延遲 (微秒)
+    };
+
     // 系統總設定
     struct SystemConfig
     {
         std::string systemName;
         std::string udpIp;
-        int udpPort;
+        int udpPort = 0;
+        std::vector<UdpTargetConfig> udpExtraTargets; // 同一份封包額外送往的 Unicast 目標
+        MulticastConfig multicast;
+        RetransmitConfig retransmit;
+        TcpSinkConfig tcpSink;
+        ShapingConfig shaping;
+        UdpSocketConfig udpSocket;
+        ShmRingConfig shmRing;
+        LocalRecorderConfig localRecorder;
+        EventRecorderConfig eventRecorder;
+        StatusConfig status;
+        TimeSyncConfig timeSync;
+        HotReloadConfig hotReload;
+        ResourceBudgetConfig resourceBudget;
+        int protocolVersion = 2;        // UDP 封包格式 (1: 相容模式, 2: 自我描述)
+        int udpMtu = 1500;              // 鏈路 MTU，超過的 Batch 自動分段
+        int udpBatchMaxMessages = 1;    // sendmmsg 每批最大筆數 (1 = 不批次)
+        long udpBatchMaxDelayUs = 2000; // 批次最大累積延遲 (微秒)
+        int sendQueueDepth = 256;       // 發送執行緒佇列深度 (Batch 數，滿時捨棄最舊者)
         std::vector<TaskConfig> taskConfigs;
     };
 
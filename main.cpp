@@ -6,20 +6,136 @@
 #include <unistd.h>
 #include <signal.h>
 #include "utils/ConfigLoader.hpp"
+#include "utils/ConfigWatcher.hpp"
 #include "daq/DaqAI217.hpp"
 #include "net/UdpSender.hpp"
+#include "net/TrafficShaper.hpp"
+#include "net/TcpSink.hpp"
+#include "net/SendPipeline.hpp"
+#include "net/ShmRing.hpp"
+#include "net/TimeSync.hpp"
+#include "net/LocalRecorder.hpp"
+#include "net/EventRecorder.hpp"
+#include "daq/ResourceBudget.hpp"
 
 volatile sig_atomic_t g_stop = 0;
 void signal_handler(int) { g_stop = 1; }
 
+// SIGUSR1：觸發黑盒子事件輸出
+volatile sig_atomic_t g_event = 0;
+void event_handler(int) { g_event = 1; }
+
 int main()
 {
     signal(SIGINT, signal_handler);
+    signal(SIGUSR1, event_handler);
 
     // ... Config Loading 代碼省略 ...
     auto sysConfig = Utils::ConfigLoader::load("DAQ_Settings.json");
+
+    // 資源預算：在開啟 Socket / 裝置之前估算，超過時警告 (enforce 時拒絕啟動)
+    if (sysConfig.resourceBudget.active)
+    {
+        Daq::BudgetReport budget = Daq::EstimateBudget(sysConfig);
+        Daq::PrintBudget(budget);
+        if (budget.Exceeded() && sysConfig.resourceBudget.enforce)
+        {
+            std::cerr << "[Main] Resource budget exceeded, refusing to start" << std::endl;
+            return 1;
+        }
+    }
+
+    Net::TrafficShaper shaper; // 發送前的整形階段 (需比 udpSender 存活更久)
     Net::UdpSender udpSender;
-    udpSender.Init(sysConfig.udpIp, sysConfig.udpPort);
+    Net::SocketOptions socketOptions;
+    socketOptions.sendBufferBytes = sysConfig.udpSocket.sendBufferBytes;
+    socketOptions.dscp = sysConfig.udpSocket.dscp;
+    socketOptions.priority = sysConfig.udpSocket.priority;
+    socketOptions.bindDevice = sysConfig.udpSocket.bindDevice;
+    socketOptions.sourceIp = sysConfig.udpSocket.sourceIp;
+    socketOptions.nonBlocking = sysConfig.udpSocket.nonBlocking;
+    udpSender.Init(sysConfig.udpIp, sysConfig.udpPort, socketOptions);
+    for (const auto &target : sysConfig.udpExtraTargets)
+        udpSender.AddTarget(target.ip, target.port);
+    if (sysConfig.multicast.active)
+    {
+        udpSender.SetMulticast(sysConfig.multicast.ttl, sysConfig.multicast.interfaceIp, sysConfig.multicast.loopback);
+        udpSender.AddTarget(sysConfig.multicast.group, sysConfig.multicast.port);
+    }
+    udpSender.SetProtocolVersion(sysConfig.protocolVersion);
+    udpSender.SetMtu(sysConfig.udpMtu);
+    udpSender.SetBatching(sysConfig.udpBatchMaxMessages, sysConfig.udpBatchMaxDelayUs);
+    if (sysConfig.retransmit.active)
+    {
+        udpSender.EnableRetransmit(sysConfig.retransmit.historyDepth,
+                                   sysConfig.retransmit.nackPort,
+                                   sysConfig.retransmit.maxPerSec);
+    }
+    if (sysConfig.shaping.active)
+    {
+        shaper.Configure(sysConfig.shaping.globalMbps * 1e6, sysConfig.shaping.targetMbps * 1e6,
+                         (size_t)sysConfig.shaping.burstBytes, sysConfig.shaping.maxDelayUs);
+        udpSender.SetPacer(&shaper);
+        std::cout << "[Main] Shaping: global " << sysConfig.shaping.globalMbps << " Mbps, per target "
+                  << sysConfig.shaping.targetMbps << " Mbps, burst " << sysConfig.shaping.burstBytes
+                  << " B, max delay " << sysConfig.shaping.maxDelayUs << " us" << std::endl;
+    }
+
+    // TCP 串流輸出 (Archive Client 需要完整資料時使用)
+    Net::TcpSink tcpSink;
+    if (sysConfig.tcpSink.active)
+    {
+        tcpSink.Init(sysConfig.tcpSink.port, sysConfig.tcpSink.maxClients,
+                     (size_t)sysConfig.tcpSink.maxBacklogBytes, sysConfig.tcpSink.sendBufferBytes);
+    }
+
+    // 時鐘偏差量測 (接收端發起；可回送修正值讓 Batch 以接收端時間標示)
+    Net::TimeSyncServer timeSync;
+    if (sysConfig.timeSync.active)
+        timeSync.Start(sysConfig.timeSync.port, sysConfig.timeSync.clientIp);
+
+    // 本機 Consumer (Logger / 告警程式) 經 Shared Memory 直接讀取
+    Net::ShmRingWriter shmRing;
+    if (sysConfig.shmRing.active)
+        shmRing.Create(sysConfig.shmRing.name, (size_t)sysConfig.shmRing.capacityBytes);
+
+    // 本機環狀錄製 (網路中斷期間的資料事後由 Flash / RAM Disk 取回)
+    Net::LocalRecorder recorder;
+    bool recording = false;
+    if (sysConfig.localRecorder.active)
+    {
+        Net::RecorderOptions recOptions;
+        recOptions.directory = sysConfig.localRecorder.directory;
+        recOptions.fileCount = sysConfig.localRecorder.fileCount;
+        recOptions.fileBytes = (size_t)sysConfig.localRecorder.fileBytes;
+        recOptions.blockBytes = (size_t)sysConfig.localRecorder.blockBytes;
+        recOptions.syncIntervalMs = sysConfig.localRecorder.syncIntervalMs;
+        recOptions.queueDepth = (size_t)sysConfig.localRecorder.queueDepth;
+        recording = recorder.Open(recOptions);
+    }
+
+    // 黑盒子：RAM Ring 保留最近數秒，事件觸發時輸出前後時間窗
+    Net::EventRecorder blackBox;
+    bool blackBoxActive = false;
+    if (sysConfig.eventRecorder.active)
+    {
+        const Utils::EventRecorderConfig &ev = sysConfig.eventRecorder;
+        Net::EventOptions evOptions;
+        evOptions.preMs = ev.preMs;
+        evOptions.postMs = ev.postMs;
+        evOptions.directory = ev.directory;
+        evOptions.targetIp = ev.targetIp;
+        evOptions.targetPort = ev.targetPort;
+        evOptions.mtu = sysConfig.udpMtu;
+        evOptions.commandPort = ev.commandPort;
+        evOptions.triggerChannel = ev.triggerChannel;
+        evOptions.triggerLevel = (uint32_t)ev.triggerLevel;
+        if (ev.triggerEdge == "falling")
+            evOptions.triggerEdge = Net::TriggerEdge::Falling;
+        else if (ev.triggerEdge == "both")
+            evOptions.triggerEdge = Net::TriggerEdge::Both;
+        blackBoxActive = blackBox.Start(evOptions);
+    }
 
     // ... Daq 初始化代碼省略 ...
     Utils::TaskConfig *ai217Config = &sysConfig.taskConfigs[0]; // 簡化範例
@@ -27,22 +143,190 @@ int main()
     ai217Device.Configure();
     ai217Device.Start();
 
+    // FEC (每個 Task 的串流可獨立設定)
+    if (ai217Config->fec.active)
+    {
+        Net::FecScheme scheme = (ai217Config->fec.scheme == "rs") ? Net::FecScheme::ReedSolomon : Net::FecScheme::Xor;
+        udpSender.EnableFec((uint16_t)ai217Config->deviceId, scheme,
+                            ai217Config->fec.groupSize, ai217Config->fec.parityCount, ai217Config->fec.maxDelayUs);
+    }
+
+    // Payload 編碼 (每個 Task 可獨立設定)
+    Net::SampleEncoding encoding = Net::SampleEncoding::Raw;
+    if (!Net::SampleCodec::ParseEncoding(ai217Config->encoding, encoding))
+    {
+        std::cerr << "[Main] Unknown encoding '" << ai217Config->encoding << "', fallback to raw" << std::endl;
+    }
+
     Daq::RawDataPacket packet;
-    long seqId = 0;
+    uint64_t seqId = 0;
     int numCh = 8; // 假設 8 通道
 
+    // Stream 描述 (v2 Header 中固定不變的欄位；熱重新載入後依 Batch 附帶的設定快照更新)
+    Net::PacketHeader desc;
+    desc.deviceId = (uint16_t)ai217Config->deviceId;
+    desc.numChannels = (uint16_t)numCh;
+    for (const auto &ch : ai217Config->channels)
+        desc.channelMask |= Net::ChannelMaskFromRange(ch.channelRange);
+    desc.sampleRate = ai217Config->sampleRate;
+    desc.encoding = encoding;
+    Utils::TaskConfigPtr lastConfig; // 保留參照，避免以重新配置的位址誤判
+
+    // 設定檔熱重新載入：通道 / Gain / 取樣率 / 編碼 / 處理參數由擷取迴圈在 Batch 邊界套用，
+    // Socket、輸出、錄製與 FEC 等需重新建立的設定只回報，保留執行中的值
+    Utils::ConfigWatcher configWatcher;
+    Utils::SystemConfig runningConfig = sysConfig; // 只在監看執行緒中存取
+    if (sysConfig.hotReload.active)
+    {
+        configWatcher.Start("DAQ_Settings.json", sysConfig.hotReload.settleMs,
+                            [&runningConfig, &ai217Device](const Utils::SystemConfig &next) {
+            runningConfig.resourceBudget = next.resourceBudget; // 只用於檢查，直接採用新值
+            Utils::ConfigDiff changes = Utils::ConfigLoader::diff(runningConfig, next);
+            if (changes.Empty())
+            {
+                std::cout << "[Config] Reloaded, no changes" << std::endl;
+                return;
+            }
+            for (const auto &section : changes.restartSections)
+                std::cout << "[Config] '" << section << "' changed, restart required to apply" << std::endl;
+
+            // 先組出套用後的設定，通過資源預算檢查後才替換
+            int runningId = ai217Device.GetConfig()->deviceId;
+            Utils::SystemConfig candidate = runningConfig;
+            std::vector<Utils::TaskConfig> updates;
+            std::vector<std::string> notes;
+            for (const auto &change : changes.tasks)
+            {
+                if (change.deviceId != runningId || change.added || change.removed)
+                {
+                    std::cout << "[Config] Task '" << change.taskName << "' (device " << change.deviceId << ") "
+                              << (change.removed ? "removed" : change.added ? "added" : "changed")
+                              << ", restart required to apply" << std::endl;
+                    continue;
+                }
+
+                Utils::TaskConfig applied;
+                for (const auto &task : next.taskConfigs)
+                    if (task.deviceId == change.deviceId)
+                        applied = task;
+                if (change.fec)
+                {
+                    // FEC 編碼器由發送執行緒使用，執行中不重建
+                    std::cout << "[Config] Task '" << change.taskName << "' FEC changed, restart required to apply"
+                              << std::endl;
+                    applied.fec = ai217Device.GetConfig()->fec;
+                }
+                if (change.hardware || change.channels || change.sampleRate || change.encoding || change.processing)
+                {
+                    updates.push_back(applied);
+                    notes.push_back(std::string(change.hardware ? " [hardware]" : "") +
+                                    (change.channels ? " [channels]" : "") + (change.sampleRate ? " [sample_rate]" : "") +
+                                    (change.encoding ? " [encoding]" : "") + (change.processing ? " [processing]" : ""));
+                }
+                for (auto &task : candidate.taskConfigs)
+                    if (task.deviceId == change.deviceId)
+                        task = applied;
+            }
+
+            if (!updates.empty() && runningConfig.resourceBudget.active)
+            {
+                Daq::BudgetReport budget = Daq::EstimateBudget(candidate);
+                Daq::PrintBudget(budget);
+                if (budget.Exceeded() && runningConfig.resourceBudget.enforce)
+                {
+                    std::cerr << "[Config] Resource budget exceeded, keeping running task parameters" << std::endl;
+                    return;
+                }
+            }
+            for (size_t i = 0; i < updates.size(); i++)
+            {
+                ai217Device.UpdateConfig(updates[i]);
+                std::cout << "[Config] Task '" << updates[i].taskName << "' updated" << notes[i] << std::endl;
+            }
+            runningConfig.taskConfigs = candidate.taskConfigs;
+        });
+    }
+
+    // 網路發送由獨立執行緒負責，分派迴圈只做 Buffer 交換 (sendto 阻塞不會延誤裝置佇列)
+    Net::SendPipeline pipeline(udpSender, sysConfig.tcpSink.active ? &tcpSink : NULL);
+    if (sysConfig.status.active)
+    {
+        // 裝置統計皆為 Mutex 保護的快照，可由發送執行緒讀取
+        pipeline.EnableStatus(sysConfig.status.intervalMs, [&ai217Device](Net::StatusReport &report) {
+            Utils::StageStats stats = ai217Device.GetStats();
+            Daq::DeviceHealth health = ai217Device.GetHealth();
+            Net::DeviceStatus dev;
+            dev.deviceId = (uint16_t)ai217Device.GetConfig()->deviceId;
+            dev.queueDepth = (uint32_t)stats.queueDepth;
+            dev.queueHighWater = (uint32_t)stats.queueHighWater;
+            dev.queueDropped = (uint32_t)stats.dropped;
+            dev.samples = health.samples;
+            dev.readErrors = (uint32_t)health.readErrors;
+            dev.jitterAvgUs = (uint32_t)health.jitterAvgUs;
+            dev.jitterMaxUs = (uint32_t)health.jitterMaxUs;
+            dev.loopAvgUs = (uint32_t)stats.avgServiceUs;
+            dev.loopMaxUs = (uint32_t)stats.maxServiceUs;
+            report.devices.push_back(dev);
+        });
+    }
+    pipeline.Start((size_t)sysConfig.sendQueueDepth);
+
     while (!g_stop)
     {
         // 從 Queue 取出一個 Batch (包含 10 個 Samples)
         if (ai217Device.PopData(packet))
         {
+            // 擷取迴圈換用新設定後的第一個 Batch：更新 Stream 描述
+            if (packet.config && packet.config != lastConfig)
+            {
+                const Utils::TaskConfig &task = *packet.config;
+                desc.channelMask = 0;
+                for (const auto &ch : task.channels)
+                    desc.channelMask |= Net::ChannelMaskFromRange(ch.channelRange);
+                if (packet.numSamples > 0)
+                    desc.numChannels = (uint16_t)(packet.rawData.size() / packet.numSamples);
+                desc.sampleRate = task.sampleRate;
+                if (!Net::SampleCodec::ParseEncoding(task.encoding, desc.encoding))
+                    desc.encoding = Net::SampleEncoding::Raw;
+                if (lastConfig)
+                    std::cout << "[Main] Stream parameters updated: " << desc.numChannels << " ch, mask 0x" << std::hex
+                              << desc.channelMask << std::dec << ", " << desc.sampleRate << " Hz" << std::endl;
+                lastConfig = packet.config;
+            }
+
             seqId++;
-            // 發送二進位封包
-            udpSender.SendRawBatch(seqId,
-                                   packet.timestamp,
-                                   packet.rawData,
-                                   packet.numSamples,
-                                   numCh);
+            desc.seqId = seqId;
+            desc.firstSampleIndex = packet.firstSampleIndex;
+            desc.timestampNs = packet.timestampNs;
+            desc.numSamples = (uint32_t)packet.numSamples;
+            desc.flags = 0;
+            if (sysConfig.timeSync.active && sysConfig.timeSync.applyCorrections)
+            {
+                uint64_t correctedNs;
+                if (timeSync.Correct(packet.timestampNs, correctedNs, sysConfig.timeSync.maxCorrectionAgeMs))
+                {
+                    desc.timestampNs = correctedNs;
+                    desc.flags = Net::WIRE_FLAG_TIME_CORRECTED;
+                }
+            }
+
+            // 本機 Consumer / 錄製先取得 (Submit 會交換走 rawData)
+            if (sysConfig.shmRing.active)
+                shmRing.Publish(desc, packet.rawData.data(), packet.rawData.size());
+            if (recording)
+                recorder.Submit(desc, packet.rawData.data(), packet.rawData.size());
+            if (blackBoxActive)
+            {
+                blackBox.Push(desc, packet.rawData.data(), packet.rawData.size());
+                if (g_event)
+                {
+                    g_event = 0;
+                    blackBox.Trigger(Net::EventReason::Signal);
+                }
+            }
+
+            // 交給發送執行緒 (rawData 與佇列 Buffer 交換，不複製)
+            pipeline.Submit(desc, packet.rawData);
         }
         else
         {
@@ -50,7 +334,53 @@ int main()
         }
     }
 
+    configWatcher.Stop();
     ai217Device.Stop();
+    pipeline.Stop(); // 送完佇列中剩餘的 Batch
+    recorder.Close(); // 寫完佇列中剩餘的 Batch 並結束目前的檔案
+    blackBox.Stop();  // 輸出中的事件以現有資料結束
+
+    // 各階段統計
+    Utils::StageStats daqStats = ai217Device.GetStats();
+    Utils::StageStats netStats = pipeline.GetStats();
+    std::cout << "[Main] DAQ queue: high-water " << daqStats.queueHighWater << ", dropped " << daqStats.dropped
+              << ", loop avg " << daqStats.avgServiceUs << " us / max " << daqStats.maxServiceUs << " us" << std::endl;
+    Daq::DeviceHealth daqHealth = ai217Device.GetHealth();
+    std::cout << "[Main] DAQ samples: " << daqHealth.samples << ", read errors " << daqHealth.readErrors
+              << ", jitter avg " << daqHealth.jitterAvgUs << " us / max " << daqHealth.jitterMaxUs << " us" << std::endl;
+    std::cout << "[Main] Send queue: high-water " << netStats.queueHighWater << ", dropped " << netStats.dropped
+              << ", send avg " << netStats.avgServiceUs << " us / max " << netStats.maxServiceUs << " us"
+              << ", send errors " << udpSender.GetSendErrors() << std::endl;
+    if (sysConfig.shaping.active)
+    {
+        std::cout << "[Main] Shaping: delayed " << shaper.GetShapedDatagrams() << " datagrams, total "
+                  << shaper.GetShapedDelayUs() << " us / max " << shaper.GetMaxShapedDelayUs()
+                  << " us, overruns " << shaper.GetOverruns() << std::endl;
+    }
+
+    if (recording)
+    {
+        Utils::StageStats recStats = recorder.GetStats();
+        std::cout << "[Main] Recorder: " << recorder.GetRecordsWritten() << " batches, " << recorder.GetFilesCompleted()
+                  << " files completed, queue high-water " << recStats.queueHighWater << ", dropped "
+                  << recStats.dropped << ", write errors " << recorder.GetWriteErrors() << std::endl;
+    }
+
+    if (blackBoxActive)
+    {
+        std::cout << "[Main] Black box: " << blackBox.GetEvents() << " events, suppressed " << blackBox.GetSuppressed()
+                  << ", ring " << blackBox.GetRingBatches() << " batches, skipped " << blackBox.GetSkipped() << std::endl;
+    }
+
+    if (sysConfig.timeSync.active)
+    {
+        std::cout << "[Main] Time sync: " << timeSync.GetRequests() << " requests, " << timeSync.GetCorrections()
+                  << " corrections, rejected " << timeSync.GetRejectedCorrections() << std::endl;
+    }
+
     udpSender.Close();
+    tcpSink.Close();
+    shmRing.Close();
+    timeSync.Stop();
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
  * @brief AI-217 實作 (修正：加入 Loop Pacing 防止重複讀取)
  */
 #include "daq/DaqAI217.hpp"
+#include "net/WireProtocol.hpp"
 #include <iostream>
 #include <vector>
 #include <cstring>
@@ -16,10 +17,6 @@ extern "C"
 
 namespace Daq
 {
-    // 設定 Batch 大小
-    // 100Hz 取樣下，設定 10 代表每 0.1秒送一次 UDP 封包
-    static const int BATCH_SIZE = 10;
-
     DaqAI217::DaqAI217(const Utils::TaskConfig &config) : UeiDaqDevice(config) {}
 
     DaqAI217::~DaqAI217()
@@ -57,22 +54,37 @@ namespace Daq
         }
         return true;
     }
-    void DaqAI217::DaqLoop()
+    // 依設定的通道範圍建立 Channel List (各通道使用所屬範圍的 Gain)；沒有有效範圍時沿用 ai0:7
+    static int BuildChannelList(const Utils::TaskConfig &config, uint32 *clList, int (*gainCode)(int))
     {
-        std::cout << "[AI217] Configuring Clock..." << std::endl;
+        int numCh = 0;
+        for (int ch = 0; ch < DQ_AI217_CHAN; ch++)
+        {
+            for (const auto &range : config.channels)
+            {
+                if (Net::ChannelMaskFromRange(range.channelRange) & (1u << ch))
+                {
+                    clList[numCh++] = ch | DQ_LNCL_GAIN(gainCode(range.hwConfig.gain)) | DQ_LNCL_DIFF;
+                    break;
+                }
+            }
+        }
+        if (numCh == 0)
+        {
+            int gain = config.channels.empty() ? 1 : config.channels[0].hwConfig.gain;
+            for (numCh = 0; numCh < 8; numCh++)
+                clList[numCh] = numCh | DQ_LNCL_GAIN(gainCode(gain)) | DQ_LNCL_DIFF;
+        }
+        return numCh;
+    }
 
-        int device = 0;
-        int numCh = 8;
-        // ... (Channel List 設定同前) ...
-        uint32 clList[DQ_AI217_CHAN];
-        int gainCode = GetGainCode(m_config.channels[0].hwConfig.gain);
-        for (int i = 0; i < numCh; i++)
-            clList[i] = i | DQ_LNCL_GAIN(gainCode) | DQ_LNCL_DIFF;
+    bool DaqAI217::SetClock(int device, double sampleRate, long &periodUs)
+    {
+        std::cout << "[AI217] Configuring Clock..." << std::endl;
 
-        // --- 設定 Clock ---
         DQSETCLK clkSet;
         float actualClkRate; // [關鍵] 用這個變數來儲存硬體給的真實頻率
-        float reqRate = (float)m_config.sampleRate;
+        float reqRate = (float)sampleRate;
         uint32 clkEntries = 1;
 
         clkSet.dev = device | DQ_LASTDEV;
@@ -83,7 +95,7 @@ namespace Daq
         if (DqCmdSetClock(m_handle, &clkSet, &actualClkRate, &clkEntries) < 0)
         {
             std::cerr << "[AI217] SetClock Failed" << std::endl;
-            return;
+            return false;
         }
 
         std::cout << "[AI217] Requested: " << reqRate << " Hz, Actual: " << actualClkRate << " Hz" << std::endl;
@@ -92,31 +104,107 @@ namespace Daq
         // 避免除以 0
         if (actualClkRate < 0.1)
             actualClkRate = 1.0;
-        long period_us = (long)(1000000.0 / actualClkRate);
+        periodUs = (long)(1000000.0 / actualClkRate);
+        return true;
+    }
+
+    void DaqAI217::DaqLoop()
+    {
+        int device = 0;
+        int numCh = 0;
+        uint32 clList[DQ_AI217_CHAN];
+        long period_us = 0;
+
+        // 目前套用的設定快照；m_configGen 改變時於 Batch 邊界換用新快照 (不重新開啟 IOM)
+        Utils::TaskConfigPtr config;
+        uint64_t appliedGen = 0;
 
         // 初始化
         uint32 rawDataOneSample[DQ_AI217_CHAN];
         double scaledDummy[DQ_AI217_CHAN];
         std::vector<uint32_t> batchBuffer;
-        batchBuffer.reserve(numCh * BATCH_SIZE);
+        batchBuffer.reserve(DQ_AI217_CHAN * BATCH_SIZE);
         double batchStartTime = 0.0;
+        uint64_t batchStartNs = 0;
+        uint64_t sampleIndex = 0; // 累計樣本序號 (跨 Batch 連續)
+        uint64_t batchStartIndex = 0;
         int samplesCollected = 0;
+        struct timeval prevStart;
+        bool havePrevStart = false;
 
-        std::cout << "[AI217] Loop Starting with Period: " << period_us << " us" << std::endl;
+        auto flushBatch = [&]()
+        {
+            if (samplesCollected == 0)
+                return;
+            RawDataPacket packet;
+            packet.timestamp = batchStartTime;
+            packet.timestampNs = batchStartNs;
+            packet.firstSampleIndex = batchStartIndex;
+            packet.numSamples = samplesCollected;
+            packet.rawData = batchBuffer;
+            packet.config = config;
+            PushData(packet);
+            batchBuffer.clear();
+            samplesCollected = 0;
+        };
 
         while (m_running)
         {
+            uint64_t gen = m_configGen.load();
+            if (!config || gen != appliedGen)
+            {
+                // 不完整的 Batch 以舊設定送出，之後的樣本使用新的通道 / Gain / 取樣率
+                flushBatch();
+                Utils::TaskConfigPtr next = GetConfig();
+                appliedGen = gen;
+                if (!config || next->sampleRate != config->sampleRate)
+                {
+                    if (!SetClock(device, next->sampleRate, period_us))
+                    {
+                        if (!config)
+                            return;
+                        // 新取樣率無法設定：其餘參數照常套用，取樣率維持原值
+                        Utils::TaskConfig adjusted = *next;
+                        adjusted.sampleRate = config->sampleRate;
+                        next = std::make_shared<Utils::TaskConfig>(adjusted);
+                    }
+                    havePrevStart = false;
+                }
+                bool initial = !config;
+                config = next;
+                numCh = BuildChannelList(*config, clList, &DaqAI217::GetGainCode);
+                if (initial)
+                    std::cout << "[AI217] Loop Starting with Period: " << period_us << " us, " << numCh << " ch" << std::endl;
+                else
+                    std::cout << "[AI217] Config updated: " << numCh << " ch, period " << period_us << " us" << std::endl;
+            }
+
             struct timeval t1, t2;
             gettimeofday(&t1, NULL); // Loop Start
 
+            // 週期抖動 = 實際週期與設定週期的偏差
+            if (havePrevStart)
+                RecordJitter((t1.tv_sec - prevStart.tv_sec) * 1000000L + (t1.tv_usec - prevStart.tv_usec) - period_us);
+            prevStart = t1;
+            havePrevStart = true;
+
             // 讀取數據
             int ret = DqAdv217Read(m_handle, device, numCh, clList, rawDataOneSample, scaledDummy);
 
-            if (ret >= 0)
+            if (ret < 0)
+            {
+                // 只印第一次與之後每 1000 次，完整次數由 Status 封包回報
+                uint64_t errors = RecordReadError();
+                if (errors == 1 || errors % 1000 == 0)
+                    std::cerr << "[AI217] DqAdv217Read Failed: " << ret << " (total " << errors << ")" << std::endl;
+            }
+            else
             {
                 if (samplesCollected == 0)
                 {
                     batchStartTime = t1.tv_sec + t1.tv_usec / 1000000.0;
+                    batchStartNs = (uint64_t)t1.tv_sec * 1000000000ULL + (uint64_t)t1.tv_usec * 1000ULL;
+                    batchStartIndex = sampleIndex;
                 }
 
                 for (int i = 0; i < numCh; i++)
@@ -124,22 +212,17 @@ namespace Daq
                     batchBuffer.push_back(rawDataOneSample[i]);
                 }
                 samplesCollected++;
+                sampleIndex++;
+                RecordSamples(1);
 
                 if (samplesCollected >= BATCH_SIZE)
-                {
-                    RawDataPacket packet;
-                    packet.timestamp = batchStartTime;
-                    packet.numSamples = samplesCollected;
-                    packet.rawData = batchBuffer;
-                    PushData(packet);
-                    batchBuffer.clear();
-                    samplesCollected = 0;
-                }
+                    flushBatch();
             }
 
             // [關鍵] 精確的軟體定時
             gettimeofday(&t2, NULL); // Loop End
             long elapsed_us = (t2.tv_sec - t1.tv_sec) * 1000000 + (t2.tv_usec - t1.tv_usec);
+            m_monitor.RecordService(elapsed_us);
 
             // 只有當處理時間小於週期時才休眠
             long sleep_us = period_us - elapsed_us;
@@ -151,5 +234,6 @@ namespace Daq
                 usleep(sleep_us);
             }
         }
+        flushBatch();
     }
-}
\ No newline at end of file
+}
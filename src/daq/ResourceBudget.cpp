@@ -0,0 +1,226 @@
+//=============================================================================
+// NAME:    src/daq/ResourceBudget.cpp
+//=============================================================================
+#include "daq/ResourceBudget.hpp"
+#include "daq/DaqAI217.hpp"
+#include "net/WireProtocol.hpp"
+#include "net/SampleCodec.hpp"
+#include "net/Fec.hpp"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+namespace Daq
+{
+    // 所有 MB 皆為 10^6 bytes (與 codec_bench / fec_bench 量測的 MB/s 相同)
+    static const double MB = 1e6;
+    static const double US_PER_SEC = 1e6;
+
+    static int CountBits(uint32_t mask)
+    {
+        int count = 0;
+        for (; mask; mask &= mask - 1)
+            count++;
+        return count;
+    }
+
+    static std::string Format(double value, int precision)
+    {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(precision) << value;
+        return text.str();
+    }
+
+    // ShmRing 資料區向上取到 2 的次方
+    static double RoundUpPow2(double bytes)
+    {
+        double size = 1.0;
+        while (size < bytes)
+            size *= 2.0;
+        return size;
+    }
+
+    BudgetReport EstimateBudget(const Utils::SystemConfig &config)
+    {
+        const Utils::ResourceBudgetConfig &cost = config.resourceBudget;
+        BudgetReport report;
+
+        // 同一份 UDP 封包送往的目標數 (皆經過同一條鏈路)
+        int destinations = 1 + (int)config.udpExtraTargets.size() + (config.multicast.active ? 1 : 0);
+        int tcpClients = config.tcpSink.active ? config.tcpSink.maxClients : 0;
+        bool v1 = (config.protocolVersion == Net::WIRE_VERSION_1);
+        double maxDatagram = (double)config.udpMtu - Net::UDP_IP_OVERHEAD;
+
+        double tcpBitsPerSec = 0.0;
+        double maxBatchBytes = 0.0;
+        for (const auto &task : config.taskConfigs)
+        {
+            TaskBudget budget;
+            budget.deviceId = task.deviceId;
+            budget.taskName = task.taskName;
+            budget.sampleRate = task.sampleRate;
+
+            // 通道數與 DaqAI217 建立的 Channel List 相同 (沒有有效範圍時為 ai0:7)
+            uint32_t mask = 0;
+            for (const auto &ch : task.channels)
+                mask |= Net::ChannelMaskFromRange(ch.channelRange);
+            budget.numChannels = mask ? CountBits(mask) : 8;
+            budget.samplesPerSec = task.sampleRate * budget.numChannels;
+
+            double batchesPerSec = task.sampleRate / DaqAI217::BATCH_SIZE;
+            double rawBatchBytes = (double)DaqAI217::BATCH_SIZE * budget.numChannels * sizeof(uint32_t);
+            maxBatchBytes = std::max(maxBatchBytes, rawBatchBytes);
+
+            Net::SampleEncoding encoding = Net::SampleEncoding::Raw;
+            Net::SampleCodec::ParseEncoding(task.encoding, encoding);
+            bool delta = (encoding == Net::SampleEncoding::DeltaPack);
+            double payloadBytes = delta ? rawBatchBytes * cost.compressionRatio : rawBatchBytes;
+            budget.payloadBytesPerSec = payloadBytes * batchesPerSec;
+
+            // 一個 Batch 的 Datagram 數與位元組 (與 UdpSender::SendBatch 的分段規則相同)
+            double taskMaxDatagram = maxDatagram;
+            if (task.fec.active)
+                taskMaxDatagram -= (double)Net::FecEncoder::Overhead(task.fec.groupSize);
+            double header = v1 ? sizeof(Net::UdpHeader) : Net::WIRE_V2_HEADER_SIZE;
+            double fragHeader = v1 ? sizeof(Net::UdpHeader) + sizeof(Net::UdpFragmentHeader) : Net::WIRE_V2_HEADER_SIZE;
+            double datagrams = 1.0;
+            double batchBytes = header + payloadBytes;
+            if (batchBytes > taskMaxDatagram)
+            {
+                double chunk = std::floor((taskMaxDatagram - fragHeader) / 4.0) * 4.0;
+                if (chunk <= 0.0)
+                {
+                    report.violations.push_back("Task '" + task.taskName + "': udp_mtu " + std::to_string(config.udpMtu) +
+                                                " leaves no room for payload");
+                    chunk = 4.0;
+                }
+                datagrams = std::max(2.0, std::ceil(payloadBytes / chunk));
+                batchBytes = payloadBytes + datagrams * fragHeader;
+            }
+            double wireBytesPerSec = (batchBytes + datagrams * Net::UDP_IP_OVERHEAD) * batchesPerSec;
+            budget.datagramsPerSec = datagrams * batchesPerSec;
+
+            // FEC：每 K 個 Data Datagram 加 M 個 Parity (大小約為平均 Datagram + Parity Header)
+            double fecUs = 0.0;
+            if (task.fec.active && task.fec.groupSize > 0)
+            {
+                bool rs = (task.fec.scheme == "rs");
+                double parityPerGroup = rs ? task.fec.parityCount : 1;
+                double parityPerSec = budget.datagramsPerSec * parityPerGroup / task.fec.groupSize;
+                double parityBytes = batchBytes / datagrams + Net::FecEncoder::Overhead(task.fec.groupSize) +
+                                     Net::UDP_IP_OVERHEAD;
+                fecUs = wireBytesPerSec / ((rs ? cost.fecRsMbPerSec : cost.fecXorMbPerSec) * MB) * US_PER_SEC;
+                wireBytesPerSec += parityPerSec * parityBytes;
+                budget.datagramsPerSec += parityPerSec;
+            }
+            budget.wireBitsPerSec = wireBytesPerSec * 8.0;
+            tcpBitsPerSec += tcpClients * (Net::WIRE_V2_HEADER_SIZE + payloadBytes) * batchesPerSec * 8.0;
+
+            // CPU (每秒微秒數)：擷取迴圈每個 Frame 一次讀取
+            double loopUs = task.sampleRate * cost.readUsPerFrame;
+            if (loopUs > US_PER_SEC)
+            {
+                report.violations.push_back("Task '" + task.taskName + "': " + Format(task.sampleRate, 0) +
+                                            " Hz needs " + Format(US_PER_SEC / task.sampleRate, 1) + " us per frame, read takes " +
+                                            Format(cost.readUsPerFrame, 1) + " us");
+            }
+            double encodeUs = delta ? rawBatchBytes * batchesPerSec / (cost.encodeMbPerSec * MB) * US_PER_SEC : 0.0;
+            double sendUs = budget.datagramsPerSec * destinations * cost.sendUsPerDatagram;
+
+            // Moving Average / FFT 處理與緩衝區 (每個通道範圍各自設定)
+            double processUs = 0.0;
+            budget.memoryBytes = UeiDaqDevice::MAX_QUEUE_BATCHES * rawBatchBytes;
+            for (const auto &ch : task.channels)
+            {
+                int rangeChannels = CountBits(Net::ChannelMaskFromRange(ch.channelRange));
+                if (ch.avgConfig.active)
+                {
+                    processUs += task.sampleRate * rangeChannels * cost.avgNsPerSample / 1000.0;
+                    budget.memoryBytes += (double)rangeChannels * ch.avgConfig.windowSize * sizeof(double);
+                }
+                if (ch.fftConfig.active && ch.fftConfig.points > 1)
+                {
+                    double points = ch.fftConfig.points;
+                    double hop = std::max(1.0, points * (1.0 - ch.fftConfig.overlapPercent / 100.0));
+                    double butterflies = points / 2.0 * std::log2(points);
+                    processUs += task.sampleRate / hop * rangeChannels * butterflies * cost.fftNsPerButterfly / 1000.0;
+                    // 輸入 Ring + 複數輸出 + Window 表
+                    budget.memoryBytes += rangeChannels * points * 3 * sizeof(double) + points * sizeof(double);
+                }
+            }
+            budget.cpuPercent = (loopUs + encodeUs + fecUs + sendUs + processUs) / US_PER_SEC * 100.0;
+
+            report.samplesPerSec += budget.samplesPerSec;
+            report.linkBitsPerSec += budget.wireBitsPerSec * destinations;
+            report.memoryBytes += budget.memoryBytes;
+            report.cpuPercent += budget.cpuPercent;
+            report.tasks.push_back(budget);
+        }
+        report.linkBitsPerSec += tcpBitsPerSec;
+
+        // 共用的佇列 / Ring / 歷史
+        report.memoryBytes += config.sendQueueDepth * maxBatchBytes;
+        if (config.shmRing.active)
+            report.memoryBytes += RoundUpPow2((double)config.shmRing.capacityBytes);
+        if (config.localRecorder.active)
+            report.memoryBytes += config.localRecorder.queueDepth * maxBatchBytes + config.localRecorder.blockBytes;
+        if (config.eventRecorder.active && !report.tasks.empty())
+        {
+            // 黑盒子只保留第一個 Task (Ring = 前後時間窗 + 25% + 16 個 Batch)
+            const TaskBudget &first = report.tasks[0];
+            double batchesPerSec = first.sampleRate / DaqAI217::BATCH_SIZE;
+            double batches = (config.eventRecorder.preMs + config.eventRecorder.postMs) * batchesPerSec / 1000.0;
+            report.memoryBytes += (batches * 1.25 + 16) * DaqAI217::BATCH_SIZE * first.numChannels * sizeof(uint32_t);
+        }
+        if (config.retransmit.active)
+            report.memoryBytes += config.retransmit.historyDepth * maxDatagram;
+        if (config.tcpSink.active)
+            report.memoryBytes += (double)tcpClients * config.tcpSink.maxBacklogBytes;
+
+        // 預算檢查 (有啟用整形時以 global_mbps 為上限，超過的流量只會在整形器中累積)
+        report.linkLimitBitsPerSec = cost.linkMbps * 1e6;
+        std::string linkName = "link_mbps";
+        if (config.shaping.active && config.shaping.globalMbps > 0 && config.shaping.globalMbps < cost.linkMbps)
+        {
+            report.linkLimitBitsPerSec = config.shaping.globalMbps * 1e6;
+            linkName = "traffic_shaping.global_mbps";
+        }
+        if (report.linkBitsPerSec > report.linkLimitBitsPerSec)
+        {
+            report.violations.push_back("Network " + Format(report.linkBitsPerSec / 1e6, 2) + " Mbit/s exceeds " +
+                                        linkName + " " + Format(report.linkLimitBitsPerSec / 1e6, 2));
+        }
+        if (report.cpuPercent > cost.maxCpuPercent)
+        {
+            report.violations.push_back("CPU " + Format(report.cpuPercent, 1) + "% exceeds max_cpu_percent " +
+                                        Format(cost.maxCpuPercent, 1));
+        }
+        if (report.memoryBytes > cost.maxMemoryMb * MB)
+        {
+            report.violations.push_back("Memory " + Format(report.memoryBytes / MB, 2) + " MB exceeds max_memory_mb " +
+                                        Format(cost.maxMemoryMb, 2));
+        }
+        return report;
+    }
+
+    void PrintBudget(const BudgetReport &report)
+    {
+        for (const auto &task : report.tasks)
+        {
+            std::cout << "[Budget] Task '" << task.taskName << "' (device " << task.deviceId << "): " << task.numChannels
+                      << " ch @ " << Format(task.sampleRate, 0) << " Hz, " << Format(task.samplesPerSec, 0)
+                      << " samples/s, " << Format(task.wireBitsPerSec / 1e6, 2) << " Mbit/s, "
+                      << Format(task.datagramsPerSec, 0) << " datagrams/s, " << Format(task.memoryBytes / MB, 2)
+                      << " MB, CPU " << Format(task.cpuPercent, 1) << "%" << std::endl;
+        }
+        std::cout << "[Budget] Total: " << Format(report.samplesPerSec, 0) << " samples/s, network "
+                  << Format(report.linkBitsPerSec / 1e6, 2) << " / " << Format(report.linkLimitBitsPerSec / 1e6, 2)
+                  << " Mbit/s, memory " << Format(report.memoryBytes / MB, 2) << " MB, CPU "
+                  << Format(report.cpuPercent, 1) << "%" << std::endl;
+        for (const auto &violation : report.violations)
+            std::cerr << "[Budget] Exceeded: " << violation << std::endl;
+    }
+
+} // namespace Daq
@@ -0,0 +1,326 @@
+/**
+ * @file ArchiveWriter.cpp
+ * @brief 欄位式 mmap Segment 檔寫入 / 讀取實作
+ */
+#include "net/ArchiveWriter.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Net
+{
+    static const size_t ARCHIVE_PAGE = 4096;
+    // Index 容量下限 (Batch 很小時 Index 可能先於欄位用完)
+    static const size_t ARCHIVE_MIN_INDEX = 1024;
+
+    static_assert(sizeof(ArchiveSegmentHeader) <= ARCHIVE_HEADER_SIZE, "archive header exceeds reserved page");
+
+    static size_t RoundUpPage(size_t bytes) { return (bytes + ARCHIVE_PAGE - 1) & ~(ARCHIVE_PAGE - 1); }
+
+    static int64_t NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    static uint64_t RealtimeNsNow()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    ArchiveWriter::ArchiveWriter()
+        : m_open(false), m_segmentsCompleted(0), m_samplesWritten(0), m_bytesWritten(0) {}
+
+    ArchiveWriter::~ArchiveWriter() { Close(); }
+
+    bool ArchiveWriter::Open(const ArchiveOptions &options)
+    {
+        Close();
+        m_options = options;
+
+        struct stat st;
+        if (stat(m_options.directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            std::cerr << "[Archive] Not a directory: " << m_options.directory << std::endl;
+            return false;
+        }
+
+        m_open = true;
+        std::cout << "[Archive] Writing to " << m_options.directory << " (segment "
+                  << m_options.segmentBytes / (1024 * 1024) << " MB, max " << m_options.maxSegmentSec << " s)" << std::endl;
+        return true;
+    }
+
+    bool ArchiveWriter::NeedsRollover(const Segment &seg, const PacketHeader &h) const
+    {
+        const ArchiveSegmentHeader *sh = seg.header;
+        if (sh->rowCount >= sh->rowCapacity || sh->indexCount >= sh->indexCapacity)
+            return true;
+        if (sh->numChannels != h.numChannels || sh->channelMask != h.channelMask || sh->sampleRate != h.sampleRate)
+            return true;
+        if (m_options.maxSegmentSec > 0 && h.timestampNs > sh->firstTimestampNs &&
+            h.timestampNs - sh->firstTimestampNs >= (uint64_t)m_options.maxSegmentSec * 1000000000ULL)
+            return true;
+        return false;
+    }
+
+    bool ArchiveWriter::CreateSegment(Segment &seg, const PacketHeader &h)
+    {
+        // 由 Segment 大小推算容量：Header + Index + numChannels 個等長欄位
+        size_t rowBytes = (size_t)h.numChannels * sizeof(uint32_t);
+        size_t available = (m_options.segmentBytes > ARCHIVE_HEADER_SIZE) ? m_options.segmentBytes - ARCHIVE_HEADER_SIZE : 0;
+        size_t rows = available / rowBytes;
+        size_t indexCapacity = rows / 8;
+        if (indexCapacity < ARCHIVE_MIN_INDEX)
+            indexCapacity = ARCHIVE_MIN_INDEX;
+        size_t indexBytes = RoundUpPage(indexCapacity * sizeof(ArchiveIndexEntry));
+        if (available <= indexBytes + ARCHIVE_PAGE * h.numChannels)
+        {
+            std::cerr << "[Archive] Segment size too small for " << h.numChannels << " channels" << std::endl;
+            return false;
+        }
+        size_t columnStride = ((available - indexBytes) / h.numChannels) & ~(ARCHIVE_PAGE - 1);
+        size_t totalBytes = ARCHIVE_HEADER_SIZE + indexBytes + columnStride * h.numChannels;
+
+        // 檔名：dev<id>_<資料時間 UTC>_<序號>.part
+        uint64_t startNs = h.timestampNs ? h.timestampNs : RealtimeNsNow();
+        time_t startSec = (time_t)(startNs / 1000000000ULL);
+        struct tm utc;
+        gmtime_r(&startSec, &utc);
+        char name[96];
+        strftime(name, sizeof(name), "%Y%m%dT%H%M%SZ", &utc);
+        char file[160];
+        snprintf(file, sizeof(file), "dev%u_%s_%06llu", (unsigned)h.deviceId, name,
+                 (unsigned long long)seg.nextSegmentSeq);
+        seg.path = m_options.directory + "/" + file;
+
+        std::string partPath = seg.path + ".part";
+        seg.fd = open(partPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (seg.fd < 0)
+        {
+            std::cerr << "[Archive] Cannot create " << partPath << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // 預先配置實際磁碟區塊 (稀疏檔在磁碟滿時會讓 mmap 寫入觸發 SIGBUS)
+        int err = posix_fallocate(seg.fd, 0, (off_t)totalBytes);
+        if (err != 0)
+        {
+            std::cerr << "[Archive] Cannot allocate " << totalBytes << " bytes: " << strerror(err) << std::endl;
+            close(seg.fd);
+            unlink(partPath.c_str());
+            seg.fd = -1;
+            return false;
+        }
+
+        void *addr = mmap(NULL, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, seg.fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            std::cerr << "[Archive] mmap failed: " << strerror(errno) << std::endl;
+            close(seg.fd);
+            unlink(partPath.c_str());
+            seg.fd = -1;
+            return false;
+        }
+        seg.base = (uint8_t *)addr;
+        seg.mappedBytes = totalBytes;
+        seg.lastSyncUs = NowUs();
+
+        ArchiveSegmentHeader *sh = (ArchiveSegmentHeader *)seg.base;
+        memset(sh, 0, ARCHIVE_HEADER_SIZE);
+        memcpy(sh->magic, ARCHIVE_MAGIC, sizeof(sh->magic));
+        sh->endianTag = ARCHIVE_ENDIAN_TAG;
+        sh->version = ARCHIVE_VERSION;
+        sh->headerBytes = (uint32_t)ARCHIVE_HEADER_SIZE;
+        sh->state = (uint32_t)ArchiveState::Open;
+        sh->deviceId = h.deviceId;
+        sh->numChannels = h.numChannels;
+        sh->channelMask = h.channelMask;
+        sh->sampleRate = h.sampleRate;
+        sh->segmentSeq = seg.nextSegmentSeq++;
+        sh->createdNs = RealtimeNsNow();
+        sh->indexOffset = ARCHIVE_HEADER_SIZE;
+        sh->indexCapacity = (uint32_t)indexCapacity;
+        sh->columnOffset = ARCHIVE_HEADER_SIZE + indexBytes;
+        sh->columnStride = columnStride;
+        sh->rowCapacity = columnStride / sizeof(uint32_t);
+        sh->firstSeq = h.seqId;
+        sh->firstTimestampNs = h.timestampNs;
+        seg.header = sh;
+        return true;
+    }
+
+    void ArchiveWriter::FinishSegment(Segment &seg)
+    {
+        if (!seg.base)
+            return;
+
+        seg.header->state = (uint32_t)ArchiveState::Complete;
+        msync(seg.base, seg.mappedBytes, MS_SYNC);
+        munmap(seg.base, seg.mappedBytes);
+        close(seg.fd);
+
+        std::string partPath = seg.path + ".part";
+        std::string finalPath = seg.path + ".uarc";
+        if (rename(partPath.c_str(), finalPath.c_str()) != 0)
+            std::cerr << "[Archive] Cannot rename " << partPath << ": " << strerror(errno) << std::endl;
+
+        seg.base = NULL;
+        seg.header = NULL;
+        seg.fd = -1;
+        m_segmentsCompleted++;
+    }
+
+    bool ArchiveWriter::Append(const DecodedBatch &batch)
+    {
+        const PacketHeader &h = batch.header;
+        if (!m_open || h.numChannels == 0 || batch.samples.size() < (size_t)h.numSamples * h.numChannels)
+            return false;
+
+        Segment &seg = m_segments[h.deviceId];
+        size_t nc = h.numChannels;
+        uint32_t offset = 0;
+        while (offset < h.numSamples)
+        {
+            PacketHeader part = h;
+            part.firstSampleIndex = h.firstSampleIndex + offset;
+            if (offset > 0 && h.sampleRate > 0)
+                part.timestampNs = h.timestampNs + (uint64_t)(offset * 1e9 / h.sampleRate);
+
+            if (seg.base && NeedsRollover(seg, part))
+                FinishSegment(seg);
+            if (!seg.base && !CreateSegment(seg, part))
+                return false;
+
+            ArchiveSegmentHeader *sh = seg.header;
+            uint64_t row = sh->rowCount;
+            uint32_t count = h.numSamples - offset;
+            if (count > sh->rowCapacity - row)
+                count = (uint32_t)(sh->rowCapacity - row);
+
+            // interleaved -> 各通道欄位 (依通道逐一寫入，每個欄位為連續記憶體)
+            const uint32_t *src = batch.samples.data() + (size_t)offset * nc;
+            for (size_t c = 0; c < nc; c++)
+            {
+                uint32_t *col = (uint32_t *)(seg.base + sh->columnOffset + c * sh->columnStride) + row;
+                for (uint32_t s = 0; s < count; s++)
+                    col[s] = src[(size_t)s * nc + c];
+            }
+
+            ArchiveIndexEntry &entry = ((ArchiveIndexEntry *)(seg.base + sh->indexOffset))[sh->indexCount];
+            entry.seqId = h.seqId;
+            entry.firstSampleIndex = part.firstSampleIndex;
+            entry.timestampNs = part.timestampNs;
+            entry.row = row;
+            entry.numSamples = count;
+            entry.flags = h.flags;
+
+            // 資料寫入後才更新計數，讀取寫入中 Segment 的 Reader 不會看到未完成的列
+            std::atomic_thread_fence(std::memory_order_release);
+            sh->lastSeq = h.seqId;
+            sh->lastTimestampNs = part.timestampNs;
+            sh->flagsOr |= h.flags;
+            sh->indexCount++;
+            sh->rowCount = row + count;
+
+            offset += count;
+            m_samplesWritten += count;
+            m_bytesWritten += (uint64_t)count * nc * sizeof(uint32_t);
+        }
+
+        if (m_options.syncIntervalMs > 0)
+        {
+            int64_t nowUs = NowUs();
+            if (nowUs - seg.lastSyncUs >= m_options.syncIntervalMs * 1000)
+            {
+                // 非同步回寫，避免程式異常結束時遺失大量資料 (不等待 I/O)
+                msync(seg.base, seg.mappedBytes, MS_ASYNC);
+                seg.lastSyncUs = nowUs;
+            }
+        }
+        return true;
+    }
+
+    void ArchiveWriter::Close()
+    {
+        for (std::map<uint16_t, Segment>::iterator it = m_segments.begin(); it != m_segments.end(); ++it)
+            FinishSegment(it->second);
+        m_segments.clear();
+        m_open = false;
+    }
+
+    //=========================================================================
+    // ArchiveSegmentReader
+    //=========================================================================
+
+    ArchiveSegmentReader::ArchiveSegmentReader() : m_base(NULL), m_size(0), m_header(NULL) {}
+
+    ArchiveSegmentReader::~ArchiveSegmentReader() { Close(); }
+
+    bool ArchiveSegmentReader::Open(const std::string &path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < ARCHIVE_HEADER_SIZE)
+        {
+            close(fd);
+            return false;
+        }
+        void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED)
+            return false;
+
+        m_base = (uint8_t *)addr;
+        m_size = (size_t)st.st_size;
+        m_header = (const ArchiveSegmentHeader *)m_base;
+
+        const ArchiveSegmentHeader &h = *m_header;
+        bool valid = memcmp(h.magic, ARCHIVE_MAGIC, sizeof(h.magic)) == 0 &&
+                     h.endianTag == ARCHIVE_ENDIAN_TAG && h.version == ARCHIVE_VERSION &&
+                     h.indexOffset + (uint64_t)h.indexCapacity * sizeof(ArchiveIndexEntry) <= m_size &&
+                     h.columnOffset + h.columnStride * h.numChannels <= m_size;
+        if (!valid)
+        {
+            std::cerr << "[Archive] Not a valid segment (or written on a host with different byte order): " << path << std::endl;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void ArchiveSegmentReader::Close()
+    {
+        if (m_base)
+            munmap(m_base, m_size);
+        m_base = NULL;
+        m_size = 0;
+        m_header = NULL;
+    }
+
+    const ArchiveIndexEntry *ArchiveSegmentReader::Index() const
+    {
+        return (const ArchiveIndexEntry *)(m_base + m_header->indexOffset);
+    }
+
+    const uint32_t *ArchiveSegmentReader::Column(int channel) const
+    {
+        if (channel < 0 || channel >= m_header->numChannels)
+            return NULL;
+        return (const uint32_t *)(m_base + m_header->columnOffset + (size_t)channel * m_header->columnStride);
+    }
+}
@@ -0,0 +1,709 @@
+/**
+ * @file ChunkFile.cpp
+ * @brief 分塊錄製檔寫入與依時間查詢實作
+ */
+#include "net/ChunkFile.hpp"
+#include "nlohmann/json.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+using json = nlohmann::json;
+
+namespace Net
+{
+    static_assert(sizeof(ChunkFileHeader) == 56, "chunk file header layout changed");
+    static_assert(sizeof(ChunkHeader) == 64, "chunk header layout changed");
+    static_assert(sizeof(ChunkFileTrailer) == 24, "chunk trailer layout changed");
+
+    static uint64_t RealtimeNsNow()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    // Chunk 佔用的 Byte 數 (Header + min / max + 欄位)
+    static uint64_t ChunkBytes(uint16_t numChannels, uint32_t numSamples)
+    {
+        return sizeof(ChunkHeader) + 2ULL * numChannels * sizeof(uint32_t) +
+               (uint64_t)numChannels * numSamples * sizeof(uint32_t);
+    }
+
+    static void SwapFileHeader(ChunkFileHeader &h)
+    {
+        h.endianTag = __builtin_bswap32(h.endianTag);
+        h.version = __builtin_bswap32(h.version);
+        h.headerBytes = __builtin_bswap32(h.headerBytes);
+        h.layoutBytes = __builtin_bswap32(h.layoutBytes);
+        h.deviceId = __builtin_bswap16(h.deviceId);
+        h.numChannels = __builtin_bswap16(h.numChannels);
+        h.channelMask = __builtin_bswap32(h.channelMask);
+        uint64_t bits;
+        memcpy(&bits, &h.sampleRate, sizeof(bits));
+        bits = __builtin_bswap64(bits);
+        memcpy(&h.sampleRate, &bits, sizeof(bits));
+        h.createdNs = __builtin_bswap64(h.createdNs);
+        h.chunkSamples = __builtin_bswap32(h.chunkSamples);
+    }
+
+    static void SwapChunkHeader(ChunkHeader &c)
+    {
+        c.magic = __builtin_bswap32(c.magic);
+        c.numChannels = __builtin_bswap16(c.numChannels);
+        c.numSamples = __builtin_bswap32(c.numSamples);
+        c.flags = __builtin_bswap32(c.flags);
+        c.offset = __builtin_bswap64(c.offset);
+        c.firstSampleIndex = __builtin_bswap64(c.firstSampleIndex);
+        c.firstSeq = __builtin_bswap64(c.firstSeq);
+        c.lastSeq = __builtin_bswap64(c.lastSeq);
+        c.firstTimestampNs = __builtin_bswap64(c.firstTimestampNs);
+        c.endTimestampNs = __builtin_bswap64(c.endTimestampNs);
+    }
+
+    static void SwapWords(uint32_t *data, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            data[i] = __builtin_bswap32(data[i]);
+    }
+
+    static json TaskToJson(const Utils::TaskConfig &task)
+    {
+        json channels = json::array();
+        for (const auto &ch : task.channels)
+        {
+            channels.push_back({{"device_name", ch.deviceName},
+                                {"channel_range", ch.channelRange},
+                                {"model_info", ch.modelInfo},
+                                {"active", ch.active},
+                                {"moving_avg", {{"active", ch.avgConfig.active}, {"window_size", ch.avgConfig.windowSize}}},
+                                {"fft",
+                                 {{"active", ch.fftConfig.active},
+                                  {"window_type", ch.fftConfig.windowType},
+                                  {"points", ch.fftConfig.points},
+                                  {"overlap_percent", ch.fftConfig.overlapPercent}}},
+                                {"hardware_config",
+                                 {{"gain", ch.hwConfig.gain},
+                                  {"ai208_excitation_a", ch.hwConfig.excitationA},
+                                  {"ai208_excitation_b", ch.hwConfig.excitationB},
+                                  {"ai211_coupling", ch.hwConfig.coupling},
+                                  {"ai211_iepe_current", ch.hwConfig.iepeCurrent}}}});
+        }
+        return {{"task_name", task.taskName},
+                {"device_id", task.deviceId},
+                {"active", task.active},
+                {"sample_rate", task.sampleRate},
+                {"encoding", task.encoding},
+                {"fec",
+                 {{"active", task.fec.active},
+                  {"scheme", task.fec.scheme},
+                  {"group_size", task.fec.groupSize},
+                  {"parity_count", task.fec.parityCount},
+                  {"max_delay_us", task.fec.maxDelayUs}}},
+                {"channels", channels}};
+    }
+
+    ChunkLayout MakeChunkLayout(const PacketHeader &desc, const Utils::TaskConfig *task)
+    {
+        ChunkLayout layout;
+        layout.deviceId = desc.deviceId;
+        layout.numChannels = desc.numChannels;
+        layout.channelMask = desc.channelMask;
+        layout.sampleRate = desc.sampleRate;
+
+        // 欄位 c = channelMask 中第 c 個設定的 bit
+        std::vector<int> physical;
+        for (int bit = 0; bit < 32; bit++)
+            if (desc.channelMask & (1u << bit))
+                physical.push_back(bit);
+        for (int c = 0; c < desc.numChannels; c++)
+        {
+            char name[16];
+            if (physical.size() >= desc.numChannels)
+                snprintf(name, sizeof(name), "ai%d", physical[c]);
+            else
+                snprintf(name, sizeof(name), "ch%d", c);
+            layout.channelNames.push_back(name);
+        }
+
+        if (task)
+        {
+            layout.taskName = task->taskName;
+            layout.taskJson = TaskToJson(*task).dump();
+        }
+        return layout;
+    }
+
+    // ============================================================
+    // ChunkFileWriter
+    // ============================================================
+    ChunkFileWriter::ChunkFileWriter()
+        : m_fd(-1), m_offset(0), m_lastSyncUs(0), m_nextSampleIndex(0), m_haveData(false), m_firstTimestampNs(0),
+          m_samplesWritten(0), m_bytesWritten(0), m_lateDropped(0)
+    {
+        memset(&m_chunk, 0, sizeof(m_chunk));
+    }
+
+    ChunkFileWriter::~ChunkFileWriter()
+    {
+        Close();
+    }
+
+    bool ChunkFileWriter::Open(const std::string &path, const ChunkLayout &layout, const ChunkOptions &options)
+    {
+        Close();
+        if (layout.numChannels == 0 || options.chunkSamples == 0 || options.chunkSamples > UINT32_MAX)
+        {
+            std::cerr << "[Chunk] Invalid layout / chunk size" << std::endl;
+            return false;
+        }
+
+        m_layout = layout;
+        m_options = options;
+        m_path = path;
+        std::string partPath = path + ".part";
+        m_fd = open(partPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0)
+        {
+            std::cerr << "[Chunk] Cannot create " << partPath << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        json layoutJson = {{"device_id", layout.deviceId},
+                           {"num_channels", layout.numChannels},
+                           {"channel_mask", layout.channelMask},
+                           {"sample_rate", layout.sampleRate},
+                           {"task_name", layout.taskName},
+                           {"columns", layout.channelNames}};
+        if (!layout.taskJson.empty())
+        {
+            json taskJson = json::parse(layout.taskJson, nullptr, false);
+            if (!taskJson.is_discarded())
+                layoutJson["task"] = taskJson;
+        }
+        std::string layoutText = layoutJson.dump();
+
+        ChunkFileHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, CHUNK_FILE_MAGIC, sizeof(h.magic));
+        h.endianTag = CHUNK_ENDIAN_TAG;
+        h.version = CHUNK_VERSION;
+        h.layoutBytes = (uint32_t)layoutText.size();
+        h.headerBytes = (uint32_t)((sizeof(h) + layoutText.size() + 7) & ~(size_t)7);
+        h.deviceId = layout.deviceId;
+        h.numChannels = layout.numChannels;
+        h.channelMask = layout.channelMask;
+        h.sampleRate = layout.sampleRate;
+        h.createdNs = RealtimeNsNow();
+        h.chunkSamples = (uint32_t)options.chunkSamples;
+
+        m_buffer.assign(h.headerBytes, 0);
+        memcpy(m_buffer.data(), &h, sizeof(h));
+        memcpy(m_buffer.data() + sizeof(h), layoutText.data(), layoutText.size());
+        m_offset = 0;
+        if (!WriteAll(m_buffer.data(), m_buffer.size()))
+        {
+            close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+
+        m_columns.assign((size_t)layout.numChannels * options.chunkSamples, 0);
+        m_minMax.assign(2 * layout.numChannels, 0);
+        memset(&m_chunk, 0, sizeof(m_chunk));
+        m_index.clear();
+        m_indexMinMax.clear();
+        m_nextSampleIndex = 0;
+        m_haveData = false;
+        m_firstTimestampNs = 0;
+        m_samplesWritten = 0;
+        m_bytesWritten = 0;
+        m_lateDropped = 0;
+        m_lastSyncUs = NowUs();
+        return true;
+    }
+
+    bool ChunkFileWriter::Append(const PacketHeader &desc, const uint32_t *samples, size_t count)
+    {
+        if (m_fd < 0)
+            return false;
+        if (desc.numChannels != m_layout.numChannels || desc.sampleRate != m_layout.sampleRate)
+            return false;
+
+        const uint16_t numChannels = m_layout.numChannels;
+        const size_t rows = count / numChannels;
+        if (rows == 0)
+            return true;
+
+        // 晚到 / 重複的 Batch：Chunk 依時間排列，不回頭插入
+        if (m_haveData && desc.firstSampleIndex < m_nextSampleIndex)
+        {
+            m_lateDropped++;
+            return true;
+        }
+
+        // 序號缺口或時間跨度已達上限：結束目前的 Chunk
+        if (m_chunk.numSamples > 0 &&
+            (desc.firstSampleIndex != m_nextSampleIndex ||
+             desc.timestampNs - m_chunk.firstTimestampNs >= (uint64_t)m_options.maxChunkMs * 1000000ULL))
+        {
+            if (!FlushChunk())
+                return false;
+        }
+
+        const double nsPerSample = (desc.sampleRate > 0) ? 1e9 / desc.sampleRate : 0.0;
+        const size_t capacity = m_options.chunkSamples;
+        uint32_t *mins = m_minMax.data();
+        uint32_t *maxs = m_minMax.data() + numChannels;
+        size_t row = 0;
+        while (row < rows)
+        {
+            if (m_chunk.numSamples == 0)
+            {
+                m_chunk.firstSampleIndex = desc.firstSampleIndex + row;
+                m_chunk.firstSeq = desc.seqId;
+                m_chunk.firstTimestampNs = desc.timestampNs + (uint64_t)(row * nsPerSample);
+                m_chunk.flags = 0;
+                for (int c = 0; c < numChannels; c++)
+                {
+                    mins[c] = UINT32_MAX;
+                    maxs[c] = 0;
+                }
+            }
+
+            size_t take = std::min(rows - row, capacity - m_chunk.numSamples);
+            for (int c = 0; c < numChannels; c++)
+            {
+                uint32_t *column = m_columns.data() + (size_t)c * capacity + m_chunk.numSamples;
+                const uint32_t *src = samples + row * numChannels + c;
+                uint32_t lo = mins[c], hi = maxs[c];
+                for (size_t k = 0; k < take; k++)
+                {
+                    uint32_t v = src[k * numChannels];
+                    column[k] = v;
+                    lo = std::min(lo, v);
+                    hi = std::max(hi, v);
+                }
+                mins[c] = lo;
+                maxs[c] = hi;
+            }
+
+            m_chunk.numSamples += (uint32_t)take;
+            m_chunk.lastSeq = desc.seqId;
+            m_chunk.flags |= desc.flags;
+            row += take;
+            m_chunk.endTimestampNs = desc.timestampNs + (uint64_t)(row * nsPerSample);
+            if (m_chunk.numSamples == capacity && !FlushChunk())
+                return false;
+        }
+
+        if (!m_haveData)
+            m_firstTimestampNs = desc.timestampNs;
+        m_haveData = true;
+        m_nextSampleIndex = desc.firstSampleIndex + rows;
+        m_samplesWritten += rows;
+        return true;
+    }
+
+    bool ChunkFileWriter::FlushChunk()
+    {
+        if (m_chunk.numSamples == 0)
+            return true;
+
+        const uint16_t numChannels = m_layout.numChannels;
+        m_chunk.magic = CHUNK_MAGIC;
+        m_chunk.numChannels = numChannels;
+        m_chunk.offset = m_offset;
+
+        // Header + min / max + 各通道欄位 (只取已填入的列)，一次寫出
+        size_t columnBytes = (size_t)m_chunk.numSamples * sizeof(uint32_t);
+        m_buffer.resize(ChunkBytes(numChannels, m_chunk.numSamples));
+        uint8_t *p = m_buffer.data();
+        memcpy(p, &m_chunk, sizeof(m_chunk));
+        p += sizeof(m_chunk);
+        memcpy(p, m_minMax.data(), m_minMax.size() * sizeof(uint32_t));
+        p += m_minMax.size() * sizeof(uint32_t);
+        for (int c = 0; c < numChannels; c++)
+        {
+            memcpy(p, m_columns.data() + (size_t)c * m_options.chunkSamples, columnBytes);
+            p += columnBytes;
+        }
+
+        bool ok = WriteAll(m_buffer.data(), m_buffer.size());
+        if (ok)
+        {
+            m_index.push_back(m_chunk);
+            m_indexMinMax.insert(m_indexMinMax.end(), m_minMax.begin(), m_minMax.end());
+
+            int64_t nowUs = NowUs();
+            if (m_options.syncIntervalMs > 0 && nowUs - m_lastSyncUs >= m_options.syncIntervalMs * 1000)
+            {
+                fdatasync(m_fd);
+                m_lastSyncUs = nowUs;
+            }
+        }
+        m_chunk.numSamples = 0;
+        return ok;
+    }
+
+    void ChunkFileWriter::Close()
+    {
+        if (m_fd < 0)
+            return;
+
+        FlushChunk();
+
+        // Footer：每個 Chunk 的 Header + min / max，最後是指向 Footer 的 Trailer
+        const uint16_t numChannels = m_layout.numChannels;
+        ChunkFileTrailer trailer;
+        memcpy(trailer.magic, CHUNK_TRAILER_MAGIC, sizeof(trailer.magic));
+        trailer.footerOffset = m_offset;
+        trailer.chunkCount = m_index.size();
+
+        size_t entryBytes = sizeof(ChunkHeader) + 2 * numChannels * sizeof(uint32_t);
+        m_buffer.resize(m_index.size() * entryBytes + sizeof(trailer));
+        uint8_t *p = m_buffer.data();
+        for (size_t i = 0; i < m_index.size(); i++)
+        {
+            memcpy(p, &m_index[i], sizeof(ChunkHeader));
+            memcpy(p + sizeof(ChunkHeader), m_indexMinMax.data() + i * 2 * numChannels,
+                   2 * numChannels * sizeof(uint32_t));
+            p += entryBytes;
+        }
+        memcpy(p, &trailer, sizeof(trailer));
+        bool ok = WriteAll(m_buffer.data(), m_buffer.size());
+
+        fdatasync(m_fd);
+        close(m_fd);
+        m_fd = -1;
+
+        std::string partPath = m_path + ".part";
+        if (ok && rename(partPath.c_str(), m_path.c_str()) != 0)
+            std::cerr << "[Chunk] Cannot rename " << partPath << ": " << strerror(errno) << std::endl;
+    }
+
+    bool ChunkFileWriter::WriteAll(const void *data, size_t length)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t n = write(m_fd, p + done, length - done);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "[Chunk] Write failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+            done += (size_t)n;
+        }
+        m_offset += length;
+        m_bytesWritten += length;
+        return true;
+    }
+
+    int64_t ChunkFileWriter::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    // ============================================================
+    // ChunkFileReader
+    // ============================================================
+    ChunkFileReader::ChunkFileReader()
+        : m_fd(-1), m_swapped(false), m_hasFooter(false), m_chunksRead(0), m_bytesRead(0)
+    {
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    ChunkFileReader::~ChunkFileReader()
+    {
+        Close();
+    }
+
+    bool ChunkFileReader::Open(const std::string &path)
+    {
+        Close();
+        m_fd = open(path.c_str(), O_RDONLY);
+        if (m_fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || !ReadAt(&m_header, sizeof(m_header), 0) ||
+            memcmp(m_header.magic, CHUNK_FILE_MAGIC, sizeof(m_header.magic)) != 0)
+        {
+            Close();
+            return false;
+        }
+        m_swapped = (m_header.endianTag != CHUNK_ENDIAN_TAG);
+        if (m_swapped)
+            SwapFileHeader(m_header); // 另一種 Byte Order 的主機寫出 (PPC 上錄下、PC 上讀取)
+        uint64_t fileBytes = (uint64_t)st.st_size;
+        if (m_header.endianTag != CHUNK_ENDIAN_TAG || m_header.version != CHUNK_VERSION ||
+            m_header.numChannels == 0 || sizeof(m_header) + m_header.layoutBytes > m_header.headerBytes ||
+            m_header.headerBytes > fileBytes)
+        {
+            Close();
+            return false;
+        }
+
+        m_layoutText.assign(m_header.layoutBytes, '\0');
+        if (m_header.layoutBytes > 0 && !ReadAt(&m_layoutText[0], m_header.layoutBytes, sizeof(m_header)))
+        {
+            Close();
+            return false;
+        }
+
+        m_layout = ChunkLayout();
+        m_layout.deviceId = m_header.deviceId;
+        m_layout.numChannels = m_header.numChannels;
+        m_layout.channelMask = m_header.channelMask;
+        m_layout.sampleRate = m_header.sampleRate;
+        json layoutJson = json::parse(m_layoutText, nullptr, false);
+        if (layoutJson.is_object())
+        {
+            m_layout.taskName = layoutJson.value("task_name", "");
+            if (layoutJson.contains("columns") && layoutJson["columns"].is_array())
+                for (const auto &name : layoutJson["columns"])
+                    if (name.is_string())
+                        m_layout.channelNames.push_back(name.get<std::string>());
+            if (layoutJson.contains("task"))
+                m_layout.taskJson = layoutJson["task"].dump();
+        }
+        for (int c = (int)m_layout.channelNames.size(); c < m_header.numChannels; c++)
+            m_layout.channelNames.push_back("ch" + std::to_string(c));
+
+        m_hasFooter = LoadFooter(fileBytes);
+        if (!m_hasFooter)
+            ScanChunks(fileBytes);
+        return true;
+    }
+
+    void ChunkFileReader::Close()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+        m_index.clear();
+        m_minMax.clear();
+        m_layoutText.clear();
+        m_hasFooter = false;
+        m_chunksRead = 0;
+        m_bytesRead = 0;
+    }
+
+    bool ChunkFileReader::LoadFooter(uint64_t fileBytes)
+    {
+        ChunkFileTrailer trailer;
+        if (fileBytes < m_header.headerBytes + sizeof(trailer) ||
+            !ReadAt(&trailer, sizeof(trailer), fileBytes - sizeof(trailer)) ||
+            memcmp(trailer.magic, CHUNK_TRAILER_MAGIC, sizeof(trailer.magic)) != 0)
+            return false;
+        if (m_swapped)
+        {
+            trailer.footerOffset = __builtin_bswap64(trailer.footerOffset);
+            trailer.chunkCount = __builtin_bswap64(trailer.chunkCount);
+        }
+
+        const uint16_t numChannels = m_header.numChannels;
+        const uint64_t entryBytes = sizeof(ChunkHeader) + 2ULL * numChannels * sizeof(uint32_t);
+        if (trailer.footerOffset < m_header.headerBytes ||
+            trailer.footerOffset + trailer.chunkCount * entryBytes + sizeof(trailer) != fileBytes)
+            return false;
+
+        std::vector<uint8_t> footer(trailer.chunkCount * entryBytes);
+        if (!footer.empty() && !ReadAt(footer.data(), footer.size(), trailer.footerOffset))
+            return false;
+
+        m_index.resize(trailer.chunkCount);
+        m_minMax.resize(trailer.chunkCount * 2 * numChannels);
+        for (uint64_t i = 0; i < trailer.chunkCount; i++)
+        {
+            ChunkHeader &c = m_index[i];
+            memcpy(&c, footer.data() + i * entryBytes, sizeof(c));
+            uint32_t *minMax = m_minMax.data() + i * 2 * numChannels;
+            memcpy(minMax, footer.data() + i * entryBytes + sizeof(c), 2 * numChannels * sizeof(uint32_t));
+            if (m_swapped)
+            {
+                SwapChunkHeader(c);
+                SwapWords(minMax, 2 * numChannels);
+            }
+            if (c.magic != CHUNK_MAGIC || c.numChannels != numChannels ||
+                c.offset + ChunkBytes(numChannels, c.numSamples) > trailer.footerOffset)
+            {
+                m_index.clear();
+                m_minMax.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ChunkFileReader::ScanChunks(uint64_t fileBytes)
+    {
+        // 沒有 Footer (寫入中或異常結束)：依序讀取 Chunk Header，遇到不完整的 Chunk 即停止
+        const uint16_t numChannels = m_header.numChannels;
+        std::vector<uint32_t> minMax(2 * numChannels);
+        uint64_t pos = m_header.headerBytes;
+        ChunkHeader c;
+        while (pos + sizeof(c) <= fileBytes && ReadAt(&c, sizeof(c), pos))
+        {
+            if (m_swapped)
+                SwapChunkHeader(c);
+            if (c.magic != CHUNK_MAGIC || c.numChannels != numChannels || c.offset != pos || c.numSamples == 0 ||
+                pos + ChunkBytes(numChannels, c.numSamples) > fileBytes ||
+                !ReadAt(minMax.data(), minMax.size() * sizeof(uint32_t), pos + sizeof(c)))
+                break;
+            if (m_swapped)
+                SwapWords(minMax.data(), minMax.size());
+            m_index.push_back(c);
+            m_minMax.insert(m_minMax.end(), minMax.begin(), minMax.end());
+            pos += ChunkBytes(numChannels, c.numSamples);
+        }
+    }
+
+    size_t ChunkFileReader::FindChunk(uint64_t timestampNs) const
+    {
+        size_t lo = 0, hi = m_index.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (m_index[mid].endTimestampNs <= timestampNs)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    void ChunkFileReader::RowRange(size_t chunk, uint64_t fromNs, uint64_t toNs, uint32_t &firstRow,
+                                   uint32_t &endRow) const
+    {
+        // 第 r 列時間 = first + span * r / n，取 [fromNs, toNs) 內的列
+        const ChunkHeader &c = m_index[chunk];
+        const uint32_t n = c.numSamples;
+        const double span = (c.endTimestampNs > c.firstTimestampNs) ? (double)(c.endTimestampNs - c.firstTimestampNs) : 0.0;
+        auto rowAt = [&](uint64_t t) -> uint32_t
+        {
+            if (t <= c.firstTimestampNs)
+                return 0;
+            if (t >= c.endTimestampNs || span <= 0.0)
+                return n;
+            double row = std::ceil((double)(t - c.firstTimestampNs) * n / span);
+            return (row >= n) ? n : (uint32_t)row;
+        };
+        firstRow = rowAt(fromNs);
+        endRow = std::max(firstRow, rowAt(toNs));
+    }
+
+    bool ChunkFileReader::ReadColumn(size_t chunk, int channel, uint32_t firstRow, uint32_t endRow, uint32_t *out)
+    {
+        const ChunkHeader &c = m_index[chunk];
+        uint64_t offset = c.offset + sizeof(ChunkHeader) + 2ULL * c.numChannels * sizeof(uint32_t) +
+                          ((uint64_t)channel * c.numSamples + firstRow) * sizeof(uint32_t);
+        size_t length = (size_t)(endRow - firstRow) * sizeof(uint32_t);
+        if (!ReadAt(out, length, offset))
+            return false;
+        if (m_swapped)
+            SwapWords(out, endRow - firstRow);
+        m_chunksRead++;
+        m_bytesRead += length;
+        return true;
+    }
+
+    bool ChunkFileReader::ReadChannel(int channel, uint64_t fromNs, uint64_t toNs, std::vector<uint32_t> &samples,
+                                      std::vector<uint64_t> *timestampsNs)
+    {
+        samples.clear();
+        if (timestampsNs)
+            timestampsNs->clear();
+        if (m_fd < 0 || channel < 0 || channel >= m_header.numChannels)
+            return false;
+
+        for (size_t i = FindChunk(fromNs); i < m_index.size() && m_index[i].firstTimestampNs < toNs; i++)
+        {
+            uint32_t firstRow, endRow;
+            RowRange(i, fromNs, toNs, firstRow, endRow);
+            if (endRow == firstRow)
+                continue;
+
+            size_t base = samples.size();
+            samples.resize(base + (endRow - firstRow));
+            if (!ReadColumn(i, channel, firstRow, endRow, samples.data() + base))
+                return false;
+
+            if (timestampsNs)
+            {
+                const ChunkHeader &c = m_index[i];
+                double nsPerRow = (double)(c.endTimestampNs - c.firstTimestampNs) / c.numSamples;
+                for (uint32_t r = firstRow; r < endRow; r++)
+                    timestampsNs->push_back(c.firstTimestampNs + (uint64_t)(r * nsPerRow));
+            }
+        }
+        return true;
+    }
+
+    bool ChunkFileReader::ChannelExtent(int channel, uint64_t fromNs, uint64_t toNs, uint32_t &minCode,
+                                        uint32_t &maxCode)
+    {
+        if (m_fd < 0 || channel < 0 || channel >= m_header.numChannels)
+            return false;
+
+        bool found = false;
+        minCode = UINT32_MAX;
+        maxCode = 0;
+        std::vector<uint32_t> partial;
+        for (size_t i = FindChunk(fromNs); i < m_index.size() && m_index[i].firstTimestampNs < toNs; i++)
+        {
+            uint32_t firstRow, endRow;
+            RowRange(i, fromNs, toNs, firstRow, endRow);
+            if (endRow == firstRow)
+                continue;
+            found = true;
+
+            if (firstRow == 0 && endRow == m_index[i].numSamples)
+            {
+                // 整個 Chunk 都在範圍內：直接使用 Index 的 min / max
+                minCode = std::min(minCode, ChunkMin(i, channel));
+                maxCode = std::max(maxCode, ChunkMax(i, channel));
+                continue;
+            }
+
+            partial.resize(endRow - firstRow);
+            if (!ReadColumn(i, channel, firstRow, endRow, partial.data()))
+                return false;
+            for (uint32_t v : partial)
+            {
+                minCode = std::min(minCode, v);
+                maxCode = std::max(maxCode, v);
+            }
+        }
+        return found;
+    }
+
+    bool ChunkFileReader::ReadAt(void *data, size_t length, uint64_t offset)
+    {
+        uint8_t *p = (uint8_t *)data;
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t n = pread(m_fd, p + done, length - done, (off_t)(offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            done += (size_t)n;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,453 @@
+/**
+ * @file EventRecorder.cpp
+ * @brief 黑盒子事件錄製實作
+ */
+#include "net/EventRecorder.hpp"
+#include "net/ByteOrder.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace Net
+{
+    static const uint64_t EVENT_NONE = UINT64_MAX;
+    static const int EVENT_REASON_SHIFT = 56;
+    static const uint64_t EVENT_INDEX_MASK = (1ULL << EVENT_REASON_SHIFT) - 1;
+    // 一次 writev 的 Record 數
+    static const uint64_t EVENT_WRITE_BURST = 64;
+    // 觸發後超過此時間沒有新 Batch (擷取已停止)，以現有資料結束輸出
+    static const int64_t EVENT_STALL_US = 2000000;
+    // 取樣率不明 (v1 Header) 時假設的 Batch 速率
+    static const double EVENT_DEFAULT_BATCH_RATE = 100.0;
+
+    static uint64_t RealtimeNsNow()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    EventRecorder::EventRecorder()
+        : m_ringBatches(0), m_preBatches(0), m_postBatches(0), m_writeIndex(0), m_pinIndex(EVENT_NONE),
+          m_trigger(EVENT_NONE), m_haveLast(false), m_lastLevel(0), m_sending(false), m_commandFd(-1),
+          m_running(false), m_fileCounter(0), m_events(0), m_suppressed(0), m_skipped(0) {}
+
+    EventRecorder::~EventRecorder() { Stop(); }
+
+    bool EventRecorder::Start(const EventOptions &options)
+    {
+        if (m_running)
+            return false;
+        m_options = options;
+
+        if (!m_options.targetIp.empty())
+        {
+            if (!m_sender.Init(m_options.targetIp, m_options.targetPort))
+                return false;
+            m_sender.SetMtu(m_options.mtu);
+            m_sending = true;
+        }
+
+        if (m_options.commandPort > 0)
+        {
+            m_commandFd = socket(AF_INET, SOCK_DGRAM, 0);
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons(m_options.commandPort);
+            if (m_commandFd < 0 || bind(m_commandFd, (const struct sockaddr *)&addr, sizeof(addr)) < 0)
+            {
+                std::cerr << "[Event] Cannot bind command port " << m_options.commandPort << ": " << strerror(errno)
+                          << std::endl;
+                if (m_commandFd >= 0)
+                    close(m_commandFd);
+                m_commandFd = -1;
+                return false;
+            }
+        }
+
+        m_recordHeaders.resize(EVENT_WRITE_BURST * WIRE_V2_HEADER_SIZE);
+        m_running = true;
+        m_thread = std::thread(&EventRecorder::Run, this);
+        std::cout << "[Event] Black box " << m_options.preMs << " ms pre / " << m_options.postMs << " ms post"
+                  << (m_options.directory.empty() ? "" : ", files in " + m_options.directory)
+                  << (m_sending ? ", sending to " + m_options.targetIp : "") << std::endl;
+        return true;
+    }
+
+    void EventRecorder::Stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+            m_thread.join();
+        if (m_commandFd >= 0)
+            close(m_commandFd);
+        m_commandFd = -1;
+        if (m_sending)
+            m_sender.Close();
+        m_sending = false;
+    }
+
+    bool EventRecorder::Push(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
+    {
+        if (m_slots.empty())
+        {
+            // 第一個 Batch：依 Batch 速率決定 Ring 大小 (前後時間窗 + 25% 讓輸出落後的餘裕)
+            double batchRate = (desc.sampleRate > 0 && desc.numSamples > 0) ? desc.sampleRate / desc.numSamples
+                                                                             : EVENT_DEFAULT_BATCH_RATE;
+            m_preBatches = (uint64_t)std::ceil(m_options.preMs * batchRate / 1000.0);
+            m_postBatches = (uint64_t)std::ceil(m_options.postMs * batchRate / 1000.0);
+            m_ringBatches = (size_t)(m_preBatches + m_postBatches + (m_preBatches + m_postBatches) / 4 + 16);
+            m_slots.resize(m_ringBatches);
+        }
+
+        uint64_t index = m_writeIndex.load(std::memory_order_relaxed);
+        uint64_t pin = m_pinIndex.load();
+        if (index >= m_ringBatches && pin != EVENT_NONE && index - m_ringBatches >= pin)
+        {
+            // 會覆寫尚未輸出的 Slot：本 Batch 不進 Ring，不等待
+            m_skipped++;
+            CheckLevel(desc, rawData, rawCount);
+            return false;
+        }
+
+        Slot &slot = m_slots[index % m_ringBatches];
+        slot.desc = desc;
+        slot.samples.assign(rawData, rawData + rawCount);
+        m_writeIndex.store(index + 1);
+
+        CheckLevel(desc, rawData, rawCount);
+        return true;
+    }
+
+    void EventRecorder::CheckLevel(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
+    {
+        int ch = m_options.triggerChannel;
+        if (ch < 0 || ch >= desc.numChannels)
+            return;
+
+        size_t nc = desc.numChannels;
+        uint32_t level = m_options.triggerLevel;
+        for (size_t i = (size_t)ch; i < rawCount; i += nc)
+        {
+            uint32_t v = rawData[i];
+            if (m_haveLast)
+            {
+                bool rising = m_lastLevel < level && v >= level;
+                bool falling = m_lastLevel >= level && v < level;
+                if ((rising && m_options.triggerEdge != TriggerEdge::Falling) ||
+                    (falling && m_options.triggerEdge != TriggerEdge::Rising))
+                {
+                    m_lastLevel = v;
+                    Trigger(EventReason::Level);
+                    break; // 每個 Batch 最多觸發一次
+                }
+            }
+            m_lastLevel = v;
+            m_haveLast = true;
+        }
+    }
+
+    bool EventRecorder::Trigger(EventReason reason)
+    {
+        uint64_t value = ((uint64_t)reason << EVENT_REASON_SHIFT) | (m_writeIndex.load() & EVENT_INDEX_MASK);
+        uint64_t expected = EVENT_NONE;
+        if (m_trigger.compare_exchange_strong(expected, value))
+            return true;
+        m_suppressed++;
+        return false;
+    }
+
+    void EventRecorder::PollCommand(int timeoutMs)
+    {
+        if (m_commandFd < 0)
+        {
+            usleep(timeoutMs * 1000);
+            return;
+        }
+        struct pollfd pfd = {m_commandFd, POLLIN, 0};
+        if (poll(&pfd, 1, timeoutMs) <= 0)
+            return;
+        char buf[64];
+        ssize_t n = recv(m_commandFd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n >= 7 && memcmp(buf, "TRIGGER", 7) == 0)
+            Trigger(EventReason::Command);
+    }
+
+    void EventRecorder::Run()
+    {
+        while (m_running)
+        {
+            uint64_t trigger = m_trigger.load();
+            if (trigger == EVENT_NONE)
+            {
+                PollCommand(20);
+                continue;
+            }
+            Capture((EventReason)(trigger >> EVENT_REASON_SHIFT), trigger & EVENT_INDEX_MASK);
+            m_trigger.store(EVENT_NONE);
+        }
+    }
+
+    void EventRecorder::Capture(EventReason reason, uint64_t triggerIndex)
+    {
+        if (triggerIndex == 0 || m_slots.empty())
+            return; // 尚未有任何 Batch
+
+        // 1. 釘住觸發前的時間窗。設定 pin 後再讀一次寫入位置：
+        //    擷取端可能在設定前已開始寫入 m_writeIndex 對應的 Slot (覆寫 m_writeIndex - N)，起點需在其後
+        uint64_t n = m_ringBatches;
+        uint64_t start = (triggerIndex > m_preBatches) ? triggerIndex - m_preBatches : 0;
+        m_pinIndex.store(start);
+        uint64_t written = m_writeIndex.load();
+        if (written >= n && start < written - n + 1)
+        {
+            start = written - n + 1;
+            m_pinIndex.store(start);
+        }
+        uint64_t end = triggerIndex + m_postBatches;
+
+        const Slot &last = m_slots[(triggerIndex - 1) % n];
+        EventFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, EVENT_MAGIC, sizeof(header.magic));
+        header.endianTag = EVENT_ENDIAN_TAG;
+        header.version = EVENT_VERSION;
+        header.reason = (uint32_t)reason;
+        header.deviceId = last.desc.deviceId;
+        header.triggerSeq = last.desc.seqId;
+        header.triggerTimestampNs = last.desc.timestampNs;
+        header.createdNs = RealtimeNsNow();
+
+        std::string path;
+        int fd = m_options.directory.empty() ? -1 : OpenEventFile(header, path);
+
+        // 2. 依序輸出：已寫入的 Slot 直接寫檔 / 送出後釋放，觸發後的 Batch 邊到邊輸出
+        uint64_t skippedBefore = m_skipped;
+        uint64_t next = start;
+        int64_t lastProgressUs = NowUs();
+        while (next < end)
+        {
+            uint64_t available = std::min(m_writeIndex.load(), end);
+            if (available > next)
+            {
+                uint64_t count = std::min(available - next, EVENT_WRITE_BURST);
+                if (fd >= 0 && !WriteRecords(fd, next, count))
+                {
+                    close(fd);
+                    fd = -1;
+                }
+                if (m_sending)
+                {
+                    for (uint64_t i = next; i < next + count; i++)
+                    {
+                        const Slot &slot = m_slots[i % n];
+                        m_sender.SendBatch(slot.desc, slot.samples.data(), slot.samples.size());
+                    }
+                    m_sender.Poll();
+                }
+                next += count;
+                m_pinIndex.store(next);
+                lastProgressUs = NowUs();
+                continue;
+            }
+            if (!m_running || NowUs() - lastProgressUs > EVENT_STALL_US)
+                break; // 擷取已停止：以現有資料結束
+            PollCommand(1);
+        }
+        m_pinIndex.store(EVENT_NONE);
+        if (m_sending)
+            m_sender.Flush();
+
+        // 3. 補上實際輸出的範圍
+        header.preBatches = (uint32_t)(std::min(next, triggerIndex) - start);
+        header.postBatches = (uint32_t)(next > triggerIndex ? next - triggerIndex : 0);
+        header.recordCount = next - start;
+        header.skipped = m_skipped - skippedBefore;
+        if (fd >= 0)
+        {
+            if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+                std::cerr << "[Event] Cannot finalize " << path << ": " << strerror(errno) << std::endl;
+            fdatasync(fd);
+            close(fd);
+        }
+        m_events++;
+        std::cout << "[Event] Captured " << header.preBatches << " + " << header.postBatches << " batches around seq "
+                  << header.triggerSeq << (path.empty() ? "" : " -> " + path) << ", skipped " << header.skipped
+                  << std::endl;
+    }
+
+    int EventRecorder::OpenEventFile(const EventFileHeader &header, std::string &path)
+    {
+        // 檔名：evt_dev<id>_<觸發時資料時間 UTC>_<序號>.evt
+        uint64_t startNs = header.triggerTimestampNs ? header.triggerTimestampNs : header.createdNs;
+        time_t startSec = (time_t)(startNs / 1000000000ULL);
+        struct tm utc;
+        gmtime_r(&startSec, &utc);
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", &utc);
+        char file[96];
+        snprintf(file, sizeof(file), "evt_dev%u_%s_%04llu.evt", (unsigned)header.deviceId, stamp,
+                 (unsigned long long)m_fileCounter++);
+        path = m_options.directory + "/" + file;
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "[Event] Cannot create " << path << ": " << strerror(errno) << std::endl;
+            path.clear();
+            return -1;
+        }
+        // 先寫入檔頭佔位 (Record 數等結束時再補上)，之後的 Record 循序接在後面
+        if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header))
+        {
+            std::cerr << "[Event] Cannot write " << path << ": " << strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool EventRecorder::WriteRecords(int fd, uint64_t first, uint64_t count)
+    {
+        // 每筆 Record 兩段 iovec：Header (m_recordHeaders) 與 Slot 內的樣本 (Big Endian 主機不需轉換)
+        struct iovec iov[EVENT_WRITE_BURST * 2];
+        size_t total = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        size_t swapCount = 0;
+        for (uint64_t i = 0; i < count; i++)
+            swapCount += m_slots[(first + i) % m_ringBatches].samples.size();
+        if (m_swapBuffer.size() < swapCount)
+            m_swapBuffer.resize(swapCount);
+        size_t swapOffset = 0;
+#endif
+        for (uint64_t i = 0; i < count; i++)
+        {
+            const Slot &slot = m_slots[(first + i) % m_ringBatches];
+            PacketHeader h = slot.desc;
+            h.version = WIRE_VERSION_2;
+            h.type = PacketType::Data;
+            h.encoding = SampleEncoding::Raw;
+            h.flags &= (uint8_t)~(WIRE_FLAG_FRAGMENTED | WIRE_FLAG_RETRANSMIT);
+            h.fragIndex = 0;
+            h.fragCount = 1;
+            h.fragOffset = 0;
+            h.payloadBytes = (uint32_t)(slot.samples.size() * sizeof(uint32_t));
+            uint8_t *out = m_recordHeaders.data() + i * WIRE_V2_HEADER_SIZE;
+            iov[i * 2].iov_base = out;
+            iov[i * 2].iov_len = WriteHeader(h, out);
+
+            const uint32_t *payload = slot.samples.data();
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            uint32_t *swapped = m_swapBuffer.data() + swapOffset;
+            for (size_t k = 0; k < slot.samples.size(); k++)
+                WriteBe32((uint8_t *)(swapped + k), slot.samples[k]);
+            swapOffset += slot.samples.size();
+            payload = swapped;
+#endif
+            iov[i * 2 + 1].iov_base = const_cast<uint32_t *>(payload);
+            iov[i * 2 + 1].iov_len = h.payloadBytes;
+            total += iov[i * 2].iov_len + iov[i * 2 + 1].iov_len;
+        }
+
+        // 事件檔為循序寫入 (fd 位置接在前一次之後)；部分寫入時調整 iovec 繼續
+        struct iovec *cur = iov;
+        int remaining = (int)(count * 2);
+        while (total > 0)
+        {
+            ssize_t n = writev(fd, cur, remaining);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                std::cerr << "[Event] Write failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+            total -= (size_t)n;
+            while (remaining > 0 && (size_t)n >= cur->iov_len)
+            {
+                n -= cur->iov_len;
+                cur++;
+                remaining--;
+            }
+            if (remaining > 0)
+            {
+                cur->iov_base = (uint8_t *)cur->iov_base + n;
+                cur->iov_len -= n;
+            }
+        }
+        return true;
+    }
+
+    int64_t EventRecorder::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    bool EventRecorder::ReadFile(const std::string &path, EventFileHeader &header, std::vector<RecordedBatch> &records)
+    {
+        records.clear();
+        FILE *fp = fopen(path.c_str(), "rb");
+        if (!fp)
+            return false;
+        std::vector<uint8_t> data;
+        uint8_t chunk[65536];
+        size_t got;
+        while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+            data.insert(data.end(), chunk, chunk + got);
+        fclose(fp);
+
+        if (data.size() < sizeof(header))
+            return false;
+        memcpy(&header, data.data(), sizeof(header));
+        if (memcmp(header.magic, EVENT_MAGIC, sizeof(header.magic)) != 0)
+            return false;
+        if (header.endianTag != EVENT_ENDIAN_TAG)
+        {
+            // 另一種 Byte Order 的主機寫出 (PPC 上錄下、PC 上讀取)
+            header.endianTag = __builtin_bswap32(header.endianTag);
+            header.version = __builtin_bswap32(header.version);
+            header.reason = __builtin_bswap32(header.reason);
+            header.deviceId = __builtin_bswap16(header.deviceId);
+            header.triggerSeq = __builtin_bswap64(header.triggerSeq);
+            header.triggerTimestampNs = __builtin_bswap64(header.triggerTimestampNs);
+            header.createdNs = __builtin_bswap64(header.createdNs);
+            header.preBatches = __builtin_bswap32(header.preBatches);
+            header.postBatches = __builtin_bswap32(header.postBatches);
+            header.recordCount = __builtin_bswap64(header.recordCount);
+            header.skipped = __builtin_bswap64(header.skipped);
+        }
+        if (header.endianTag != EVENT_ENDIAN_TAG || header.version != EVENT_VERSION)
+            return false;
+
+        // Record 內皆為 Big Endian，與主機無關
+        size_t pos = sizeof(header);
+        while (records.size() < header.recordCount && data.size() - pos >= WIRE_V2_HEADER_SIZE)
+        {
+            RecordedBatch batch;
+            if (!ParseHeader(data.data() + pos, WIRE_V2_HEADER_SIZE, batch.header) ||
+                batch.header.headerBytes + batch.header.payloadBytes > data.size() - pos)
+                break;
+            const uint8_t *payload = data.data() + pos + batch.header.headerBytes;
+            batch.samples.resize(batch.header.payloadBytes / sizeof(uint32_t));
+            for (size_t k = 0; k < batch.samples.size(); k++)
+                batch.samples[k] = ReadBe32(payload + k * sizeof(uint32_t));
+            pos += batch.header.headerBytes + batch.header.payloadBytes;
+            records.push_back(batch);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,502 @@
+/**
+ * @file Fec.cpp
+ * @brief Datagram 群組 FEC 實作 (XOR / GF(256) Cauchy Reed-Solomon)
+ */
+#include "net/Fec.hpp"
+#include "net/WireProtocol.hpp"
+#include "net/ByteOrder.hpp"
+#include <cstring>
+#include <algorithm>
+#include <time.h>
+
+namespace Net
+{
+    namespace
+    {
+        // GF(2^8)，原始多項式 x^8 + x^4 + x^3 + x^2 + 1 (0x11D)
+        struct GfTables
+        {
+            uint8_t exp[512];
+            uint8_t log[256];
+
+            GfTables()
+            {
+                int x = 1;
+                for (int i = 0; i < 255; i++)
+                {
+                    exp[i] = (uint8_t)x;
+                    log[x] = (uint8_t)i;
+                    x <<= 1;
+                    if (x & 0x100)
+                        x ^= 0x11D;
+                }
+                for (int i = 255; i < 512; i++)
+                    exp[i] = exp[i - 255];
+                log[0] = 0;
+            }
+        };
+
+        const GfTables &Gf()
+        {
+            static const GfTables tables;
+            return tables;
+        }
+
+        inline uint8_t GfMul(uint8_t a, uint8_t b)
+        {
+            if (a == 0 || b == 0)
+                return 0;
+            const GfTables &gf = Gf();
+            return gf.exp[gf.log[a] + gf.log[b]];
+        }
+
+        inline uint8_t GfInv(uint8_t a)
+        {
+            const GfTables &gf = Gf();
+            return gf.exp[255 - gf.log[a]];
+        }
+
+        // 第 j 個 Parity 對第 i 個成員的係數
+        // XOR 全為 1；RS 為 Cauchy 矩陣 1 / (x_j + y_i)，x_j = j, y_i = M + i (任意方陣皆可逆)
+        inline uint8_t Coefficient(FecScheme scheme, int parityCount, int j, int i)
+        {
+            if (scheme == FecScheme::Xor)
+                return 1;
+            return GfInv((uint8_t)(j ^ (parityCount + i)));
+        }
+
+        void BuildMulTable(uint8_t coef, uint8_t *table)
+        {
+            for (int x = 0; x < 256; x++)
+                table[x] = GfMul(coef, (uint8_t)x);
+        }
+
+        // dst ^= src (以 32 bit 為單位處理主體)
+        void XorInto(uint8_t *dst, const uint8_t *src, size_t length)
+        {
+            size_t i = 0;
+            for (; i + 4 <= length; i += 4)
+            {
+                uint32_t a, b;
+                std::memcpy(&a, dst + i, 4);
+                std::memcpy(&b, src + i, 4);
+                a ^= b;
+                std::memcpy(dst + i, &a, 4);
+            }
+            for (; i < length; i++)
+                dst[i] ^= src[i];
+        }
+
+        // dst ^= coef * src (coef 的乘法表已預先建好)
+        void MulAddInto(uint8_t *dst, const uint8_t *src, size_t length, const uint8_t *table)
+        {
+            for (size_t i = 0; i < length; i++)
+                dst[i] ^= table[src[i]];
+        }
+
+        void AccumulateInto(uint8_t *dst, const uint8_t *src, size_t length, uint8_t coef, uint8_t *table)
+        {
+            if (coef == 0)
+                return;
+            if (coef == 1)
+            {
+                XorInto(dst, src, length);
+                return;
+            }
+            BuildMulTable(coef, table);
+            MulAddInto(dst, src, length, table);
+        }
+
+        int64_t NowUs()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        }
+    }
+
+    // ========================================================================
+    // FecEncoder
+    // ========================================================================
+
+    FecEncoder::FecEncoder()
+        : m_scheme(FecScheme::Xor), m_groupSize(0), m_parityCount(0), m_maxDatagram(0),
+          m_deviceId(0), m_groupId(0), m_memberCount(0), m_firstUs(0), m_maxLength(0) {}
+
+    bool FecEncoder::Init(FecScheme scheme, int groupSize, int parityCount, size_t maxDatagram)
+    {
+        if (scheme == FecScheme::Xor)
+            parityCount = 1;
+        if (groupSize < 2 || groupSize > FEC_MAX_GROUP || parityCount < 1 || parityCount > FEC_MAX_PARITY ||
+            maxDatagram == 0 || maxDatagram > 0xFFFF)
+        {
+            m_groupSize = 0;
+            return false;
+        }
+
+        m_scheme = scheme;
+        m_groupSize = groupSize;
+        m_parityCount = parityCount;
+        m_maxDatagram = maxDatagram;
+        m_memberCount = 0;
+        m_maxLength = 0;
+
+        // 預先配置：Header + 完整成員表 + 最大 Payload (之後不再配置)
+        m_parity.assign(parityCount, std::vector<uint8_t>(Overhead(groupSize) + maxDatagram, 0));
+        m_parityLength.assign(parityCount, 0);
+        return true;
+    }
+
+    bool FecEncoder::Add(uint16_t deviceId, uint64_t seqId, uint16_t fragIndex, const struct iovec *iov, int iovCount)
+    {
+        if (!Enabled())
+            return false;
+
+        size_t length = 0;
+        for (int i = 0; i < iovCount; i++)
+            length += iov[i].iov_len;
+        if (length > m_maxDatagram)
+            return false; // 不在保護範圍 (UdpSender 已預留空間，正常不會發生)
+
+        if (m_memberCount == 0)
+        {
+            // 上一組的 Parity 已送出：清除累積區 (只清用過的範圍)
+            size_t used = Overhead(m_groupSize) + m_maxLength;
+            for (int j = 0; j < m_parityCount; j++)
+                std::memset(m_parity[j].data(), 0, used);
+
+            m_deviceId = deviceId;
+            m_firstUs = NowUs();
+            m_maxLength = 0;
+        }
+
+        // 成員表寫入每個 Parity (位置固定在完整成員表之後，Finish 時再往前移)
+        size_t payloadOffset = Overhead(m_groupSize);
+        int index = m_memberCount;
+        for (int j = 0; j < m_parityCount; j++)
+        {
+            uint8_t *member = m_parity[j].data() + FEC_HEADER_SIZE + index * FEC_MEMBER_SIZE;
+            WriteBe64(member, seqId);
+            WriteBe16(member + 8, fragIndex);
+            WriteBe16(member + 10, (uint16_t)length);
+
+            uint8_t coef = Coefficient(m_scheme, m_parityCount, j, index);
+            uint8_t *dst = m_parity[j].data() + payloadOffset;
+            for (int i = 0; i < iovCount; i++)
+            {
+                if (iov[i].iov_len == 0)
+                    continue;
+                AccumulateInto(dst, static_cast<const uint8_t *>(iov[i].iov_base), iov[i].iov_len, coef, m_coefTable);
+                dst += iov[i].iov_len;
+            }
+        }
+
+        if (length > m_maxLength)
+            m_maxLength = length;
+        m_memberCount++;
+        return m_memberCount >= m_groupSize;
+    }
+
+    int FecEncoder::Finish()
+    {
+        if (m_memberCount == 0)
+            return 0;
+
+        size_t headerBytes = Overhead(m_memberCount);
+        size_t payloadOffset = Overhead(m_groupSize);
+        for (int j = 0; j < m_parityCount; j++)
+        {
+            uint8_t *p = m_parity[j].data();
+            WriteBe16(p, WIRE_MAGIC);
+            p[2] = WIRE_VERSION_2;
+            p[3] = (uint8_t)PacketType::Parity;
+            WriteBe16(p + 4, (uint16_t)headerBytes);
+            p[6] = (uint8_t)m_scheme;
+            p[7] = (uint8_t)m_memberCount;
+            WriteBe16(p + 8, m_deviceId);
+            p[10] = (uint8_t)j;
+            p[11] = (uint8_t)m_parityCount;
+            WriteBe32(p + 12, m_groupId);
+            WriteBe16(p + 16, (uint16_t)m_maxLength);
+            std::memset(p + 18, 0, 6);
+
+            // 逾時提早結束的群組：Payload 緊接在實際成員表之後
+            if (headerBytes != payloadOffset)
+                std::memmove(p + headerBytes, p + payloadOffset, m_maxLength);
+            m_parityLength[j] = headerBytes + m_maxLength;
+        }
+
+        int count = m_parityCount;
+        m_groupId++;
+        m_memberCount = 0;
+        return count;
+    }
+
+    // ========================================================================
+    // FecDecoder
+    // ========================================================================
+
+    FecDecoder::FecDecoder(size_t historyDepth, size_t maxGroups)
+        : m_store(historyDepth > 0 ? historyDepth : 1), m_storeNext(0),
+          m_groups(maxGroups > 0 ? maxGroups : 1), m_groupNext(0),
+          m_recovered(0), m_unrecoverable(0)
+    {
+        for (size_t i = 0; i < m_store.size(); i++)
+            m_store[i].used = false;
+        for (size_t i = 0; i < m_groups.size(); i++)
+            m_groups[i].used = false;
+    }
+
+    bool FecDecoder::Push(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>> &recovered)
+    {
+        // 1. Parity Datagram
+        if (length >= FEC_HEADER_SIZE && ReadBe16(data) == WIRE_MAGIC && data[2] == WIRE_VERSION_2 &&
+            data[3] == (uint8_t)PacketType::Parity)
+        {
+            size_t headerBytes = ReadBe16(data + 4);
+            FecScheme scheme = (FecScheme)data[6];
+            int memberCount = data[7];
+            uint16_t deviceId = ReadBe16(data + 8);
+            int parityIndex = data[10];
+            int parityCount = data[11];
+            uint32_t groupId = ReadBe32(data + 12);
+            size_t paritySize = ReadBe16(data + 16);
+
+            if (memberCount < 1 || memberCount > FEC_MAX_GROUP || parityCount < 1 || parityCount > FEC_MAX_PARITY ||
+                parityIndex >= parityCount || (scheme == FecScheme::Xor && parityCount != 1) ||
+                (scheme != FecScheme::Xor && scheme != FecScheme::ReedSolomon) ||
+                headerBytes != FEC_HEADER_SIZE + (size_t)memberCount * FEC_MEMBER_SIZE ||
+                headerBytes + paritySize > length)
+                return true;
+
+            uint64_t firstSeq = ReadBe64(data + FEC_HEADER_SIZE);
+            Group *group = NULL;
+            for (size_t i = 0; i < m_groups.size(); i++)
+            {
+                Group &g = m_groups[i];
+                if (g.used && g.deviceId == deviceId && g.groupId == groupId && g.members[0].seqId == firstSeq)
+                {
+                    group = &g;
+                    break;
+                }
+            }
+
+            if (!group)
+            {
+                // 依序覆寫最舊的群組 (被覆寫時仍缺資料者視為無法補回)
+                group = &m_groups[m_groupNext];
+                m_groupNext = (m_groupNext + 1) % m_groups.size();
+                if (group->used && !group->done)
+                    m_unrecoverable += CountMissing(*group);
+
+                group->used = true;
+                group->done = false;
+                group->deviceId = deviceId;
+                group->groupId = groupId;
+                group->scheme = scheme;
+                group->parityCount = parityCount;
+                group->paritySize = paritySize;
+                group->members.resize(memberCount);
+                const uint8_t *m = data + FEC_HEADER_SIZE;
+                for (int i = 0; i < memberCount; i++, m += FEC_MEMBER_SIZE)
+                {
+                    group->members[i].seqId = ReadBe64(m);
+                    group->members[i].fragIndex = ReadBe16(m + 8);
+                    group->members[i].length = ReadBe16(m + 10);
+                }
+                group->parityIndex.clear();
+                group->parityData.clear();
+            }
+
+            if (group->done || group->paritySize != paritySize)
+                return true;
+            for (size_t i = 0; i < group->parityIndex.size(); i++)
+            {
+                if (group->parityIndex[i] == parityIndex)
+                    return true; // 重複
+            }
+
+            group->parityIndex.push_back(parityIndex);
+            group->parityData.push_back(std::vector<uint8_t>(data + headerBytes, data + headerBytes + paritySize));
+            TryRecover(*group, recovered);
+            return true;
+        }
+
+        // 2. Data Datagram：保留副本，並檢查是否補齊了等待中的群組
+        PacketHeader header;
+        if (!ParseHeader(data, length, header) || header.version != WIRE_VERSION_2 || header.type != PacketType::Data)
+            return false;
+
+        StoreData(header.deviceId, header.seqId, header.fragIndex, data, length);
+        for (size_t i = 0; i < m_groups.size(); i++)
+        {
+            Group &g = m_groups[i];
+            if (!g.used || g.done || g.deviceId != header.deviceId)
+                continue;
+            for (size_t m = 0; m < g.members.size(); m++)
+            {
+                if (g.members[m].seqId == header.seqId && g.members[m].fragIndex == header.fragIndex)
+                {
+                    TryRecover(g, recovered);
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    void FecDecoder::StoreData(uint16_t deviceId, uint64_t seqId, uint16_t fragIndex, const uint8_t *data, size_t length)
+    {
+        if (FindData(deviceId, seqId, fragIndex))
+            return; // 重複 (例如 NACK 重送)
+
+        StoredDatagram &slot = m_store[m_storeNext];
+        m_storeNext = (m_storeNext + 1) % m_store.size();
+        slot.used = true;
+        slot.deviceId = deviceId;
+        slot.seqId = seqId;
+        slot.fragIndex = fragIndex;
+        slot.data.assign(data, data + length);
+
+        // 重送的 Datagram 帶有 RETRANSMIT 旗標，還原成原始內容 Parity 才對得上
+        slot.data[WIRE_V2_FLAGS_OFFSET] &= (uint8_t)~WIRE_FLAG_RETRANSMIT;
+    }
+
+    const FecDecoder::StoredDatagram *FecDecoder::FindData(uint16_t deviceId, uint64_t seqId, uint16_t fragIndex) const
+    {
+        for (size_t i = 0; i < m_store.size(); i++)
+        {
+            const StoredDatagram &s = m_store[i];
+            if (s.used && s.seqId == seqId && s.fragIndex == fragIndex && s.deviceId == deviceId)
+                return &s;
+        }
+        return NULL;
+    }
+
+    int FecDecoder::CountMissing(const Group &group) const
+    {
+        int missing = 0;
+        for (size_t i = 0; i < group.members.size(); i++)
+        {
+            if (!FindData(group.deviceId, group.members[i].seqId, group.members[i].fragIndex))
+                missing++;
+        }
+        return missing;
+    }
+
+    void FecDecoder::TryRecover(Group &group, std::vector<std::vector<uint8_t>> &recovered)
+    {
+        // 1. 找出遺失的成員
+        int missingIndex[FEC_MAX_PARITY];
+        int missingCount = 0;
+        for (size_t i = 0; i < group.members.size(); i++)
+        {
+            if (FindData(group.deviceId, group.members[i].seqId, group.members[i].fragIndex))
+                continue;
+            if (missingCount >= FEC_MAX_PARITY || missingCount >= (int)group.parityIndex.size())
+                return; // Parity 不足 (之後收到更多 Parity 或 Data 時再試)
+            missingIndex[missingCount++] = (int)i;
+        }
+
+        if (missingCount == 0)
+        {
+            group.done = true;
+            return;
+        }
+
+        // 2. 以前 missingCount 個 Parity 建立方程式：S_k = P_k - sum(已知成員) = sum(c_km * D_m)
+        int n = missingCount;
+        size_t size = group.paritySize;
+        uint8_t table[256];
+        std::vector<std::vector<uint8_t>> syndrome(n);
+        for (int k = 0; k < n; k++)
+        {
+            syndrome[k] = group.parityData[k];
+            int row = group.parityIndex[k];
+            for (size_t i = 0; i < group.members.size(); i++)
+            {
+                const StoredDatagram *s = FindData(group.deviceId, group.members[i].seqId, group.members[i].fragIndex);
+                if (!s)
+                    continue;
+                size_t length = (s->data.size() < size) ? s->data.size() : size;
+                uint8_t coef = Coefficient(group.scheme, group.parityCount, row, (int)i);
+                AccumulateInto(syndrome[k].data(), s->data.data(), length, coef, table);
+            }
+        }
+
+        // 3. 係數矩陣 A[k][m] 求反矩陣 (GF(256) Gauss-Jordan)
+        uint8_t a[FEC_MAX_PARITY][FEC_MAX_PARITY];
+        uint8_t inv[FEC_MAX_PARITY][FEC_MAX_PARITY];
+        for (int k = 0; k < n; k++)
+        {
+            for (int m = 0; m < n; m++)
+            {
+                a[k][m] = Coefficient(group.scheme, group.parityCount, group.parityIndex[k], missingIndex[m]);
+                inv[k][m] = (k == m) ? 1 : 0;
+            }
+        }
+
+        for (int col = 0; col < n; col++)
+        {
+            int pivot = col;
+            while (pivot < n && a[pivot][col] == 0)
+                pivot++;
+            if (pivot == n)
+            {
+                m_unrecoverable += n;
+                group.done = true;
+                return;
+            }
+            if (pivot != col)
+            {
+                for (int m = 0; m < n; m++)
+                {
+                    std::swap(a[pivot][m], a[col][m]);
+                    std::swap(inv[pivot][m], inv[col][m]);
+                }
+            }
+
+            uint8_t scale = GfInv(a[col][col]);
+            for (int m = 0; m < n; m++)
+            {
+                a[col][m] = GfMul(a[col][m], scale);
+                inv[col][m] = GfMul(inv[col][m], scale);
+            }
+            for (int r = 0; r < n; r++)
+            {
+                if (r == col || a[r][col] == 0)
+                    continue;
+                uint8_t factor = a[r][col];
+                for (int m = 0; m < n; m++)
+                {
+                    a[r][m] ^= GfMul(factor, a[col][m]);
+                    inv[r][m] ^= GfMul(factor, inv[col][m]);
+                }
+            }
+        }
+
+        // 4. D_m = sum(inv[m][k] * S_k)，截回原始長度
+        for (int m = 0; m < n; m++)
+        {
+            const Member &member = group.members[missingIndex[m]];
+            std::vector<uint8_t> datagram(size, 0);
+            for (int k = 0; k < n; k++)
+                AccumulateInto(datagram.data(), syndrome[k].data(), size, inv[m][k], table);
+            datagram.resize(member.length);
+
+            PacketHeader header;
+            if (!ParseHeader(datagram.data(), datagram.size(), header) || header.deviceId != group.deviceId ||
+                header.seqId != member.seqId || header.fragIndex != member.fragIndex)
+            {
+                m_unrecoverable++;
+                continue;
+            }
+
+            StoreData(group.deviceId, member.seqId, member.fragIndex, datagram.data(), datagram.size());
+            recovered.push_back(std::vector<uint8_t>());
+            recovered.back().swap(datagram);
+            m_recovered++;
+        }
+        group.done = true;
+    }
+}
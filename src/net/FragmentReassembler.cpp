@@ -0,0 +1,136 @@
+/**
+ * @file FragmentReassembler.cpp
+ * @brief 接收端分段重組實作
+ */
+#include "net/FragmentReassembler.hpp"
+#include <cstring>
+#include <time.h>
+
+namespace Net
+{
+
+    FragmentReassembler::FragmentReassembler(size_t maxPending, int64_t timeoutUs, size_t maxPayloadBytes,
+                                             size_t maxDatagram)
+        : m_pending(maxPending > 0 ? maxPending : 1), m_timeoutUs(timeoutUs), m_maxPayloadBytes(maxPayloadBytes),
+          m_maxDatagram(maxDatagram),
+          m_completed(0), m_incompleteDropped(0), m_duplicates(0), m_malformed(0)
+    {
+        for (size_t i = 0; i < m_pending.size(); i++)
+            m_pending[i].used = false;
+    }
+
+    bool FragmentReassembler::Push(const uint8_t *data, size_t length, ReassembledBatch &out)
+    {
+        PacketHeader header;
+        if (!ParseHeader(data, length, header) || header.type != PacketType::Data)
+        {
+            m_malformed++;
+            return false;
+        }
+
+        const uint8_t *body = data + header.headerBytes;
+        size_t bodyLength = length - header.headerBytes;
+
+        // 1. 未分段：直接回傳
+        if (header.fragCount <= 1)
+        {
+            out.header = header;
+            out.payload.assign(body, body + bodyLength);
+            m_completed++;
+            return true;
+        }
+
+        // 2. 分段：payloadBytes 與分段範圍先檢查再配置
+        if (header.payloadBytes > m_maxPayloadBytes ||
+            header.payloadBytes > (uint64_t)header.fragCount * m_maxDatagram ||
+            (uint64_t)header.fragOffset + bodyLength > header.payloadBytes)
+        {
+            m_malformed++;
+            return false;
+        }
+
+        // 找到 (或建立) 對應的未完成 Batch
+        int64_t nowUs = NowUs();
+        Expire();
+
+        Pending *p = FindOrAllocate(header.deviceId, header.seqId);
+        if (!p->used)
+        {
+            p->used = true;
+            p->firstUs = nowUs;
+            p->header = header;
+            p->received = 0;
+            p->payload.resize(header.payloadBytes);
+            p->have.assign(header.fragCount, false);
+        }
+        else if (p->header.fragCount != header.fragCount || p->payload.size() != header.payloadBytes)
+        {
+            m_malformed++;
+            return false;
+        }
+
+        if (p->have[header.fragIndex])
+        {
+            m_duplicates++;
+            return false;
+        }
+
+        std::memcpy(p->payload.data() + header.fragOffset, body, bodyLength);
+        p->have[header.fragIndex] = true;
+        p->received++;
+
+        if (p->received < p->header.fragCount)
+            return false;
+
+        // 3. 全部到齊：交換 Buffer 給呼叫端 (不複製)
+        out.header = p->header;
+        out.payload.swap(p->payload);
+        p->used = false;
+        m_completed++;
+        return true;
+    }
+
+    void FragmentReassembler::Expire()
+    {
+        int64_t nowUs = NowUs();
+        for (size_t i = 0; i < m_pending.size(); i++)
+        {
+            if (m_pending[i].used && nowUs - m_pending[i].firstUs > m_timeoutUs)
+            {
+                m_pending[i].used = false;
+                m_incompleteDropped++;
+            }
+        }
+    }
+
+    FragmentReassembler::Pending *FragmentReassembler::FindOrAllocate(uint16_t deviceId, uint64_t seqId)
+    {
+        Pending *freeSlot = NULL;
+        Pending *oldest = NULL;
+        for (size_t i = 0; i < m_pending.size(); i++)
+        {
+            Pending &p = m_pending[i];
+            if (p.used && p.header.seqId == seqId && p.header.deviceId == deviceId)
+                return &p;
+            if (!p.used && !freeSlot)
+                freeSlot = &p;
+            if (p.used && (!oldest || p.firstUs < oldest->firstUs))
+                oldest = &p;
+        }
+
+        if (freeSlot)
+            return freeSlot;
+
+        // 沒有空位：捨棄最舊的未完成 Batch
+        oldest->used = false;
+        m_incompleteDropped++;
+        return oldest;
+    }
+
+    int64_t FragmentReassembler::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+}
@@ -0,0 +1,607 @@
+/**
+ * @file LocalRecorder.cpp
+ * @brief 本機環狀錄製寫入執行緒與錄製檔讀取實作
+ */
+#include "net/LocalRecorder.hpp"
+#include "net/ByteOrder.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+namespace Net
+{
+    static_assert(sizeof(RecordFileHeader) <= 512, "record header exceeds minimum block size");
+    static_assert(sizeof(RecordIndexEntry) == 32, "record index entry must stay 32 bytes");
+
+    // 沒有 Batch 時的喚醒間隔 (檢查 sync 期限)
+    static const int RECORDER_IDLE_WAIT_MS = 100;
+    static const size_t RECORDER_MIN_BLOCK = 512;
+
+    static uint64_t RealtimeNsNow()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    // 由檔案大小推算 Data Block 數：1 個 Header Block + dataBlocks + Index Block
+    static uint64_t DataBlocksFor(size_t fileBytes, size_t blockBytes)
+    {
+        uint64_t totalBlocks = fileBytes / blockBytes;
+        uint64_t perIndexBlock = blockBytes / sizeof(RecordIndexEntry);
+        if (totalBlocks < 3)
+            return 0;
+        return (totalBlocks - 1) * perIndexBlock / (perIndexBlock + 1);
+    }
+
+    static uint64_t IndexBlocksFor(uint64_t dataBlocks, size_t blockBytes)
+    {
+        uint64_t perIndexBlock = blockBytes / sizeof(RecordIndexEntry);
+        return (dataBlocks + perIndexBlock - 1) / perIndexBlock;
+    }
+
+    LocalRecorder::LocalRecorder()
+        : m_slot(0), m_fileSeq(0), m_blockUsed(0), m_indexFlushed(0), m_lastSyncUs(0), m_head(0), m_count(0),
+          m_running(false), m_recordsWritten(0), m_blocksWritten(0), m_filesCompleted(0), m_writeErrors(0)
+    {
+        memset(&m_header, 0, sizeof(m_header));
+        memset(&m_blockEntry, 0, sizeof(m_blockEntry));
+    }
+
+    LocalRecorder::~LocalRecorder() { Close(); }
+
+    std::string LocalRecorder::FilePath(const std::string &directory, int slot)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "rec_%03d.rec", slot);
+        return directory + "/" + name;
+    }
+
+    bool LocalRecorder::Open(const RecorderOptions &options)
+    {
+        Close();
+        m_options = options;
+
+        size_t bb = m_options.blockBytes;
+        if (bb < RECORDER_MIN_BLOCK || (bb % RECORDER_MIN_BLOCK) != 0 || m_options.fileCount < 2)
+        {
+            std::cerr << "[Recorder] Invalid layout: block " << bb << " bytes, " << m_options.fileCount << " files"
+                      << std::endl;
+            return false;
+        }
+        uint64_t dataBlocks = DataBlocksFor(m_options.fileBytes, bb);
+        if (dataBlocks < 2)
+        {
+            std::cerr << "[Recorder] File size " << m_options.fileBytes << " too small for " << bb << " byte blocks"
+                      << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (stat(m_options.directory.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            std::cerr << "[Recorder] Not a directory: " << m_options.directory << std::endl;
+            return false;
+        }
+
+        // 1. 預先配置所有檔案，並找出最新的一個 (接續在其後，避免重開機後先覆寫最新資料)
+        memset(&m_header, 0, sizeof(m_header));
+        m_header.dataBlocks = dataBlocks;
+        m_fds.assign(m_options.fileCount, -1);
+        uint64_t newestSeq = 0;
+        int newestSlot = -1;
+        for (int slot = 0; slot < m_options.fileCount; slot++)
+        {
+            if (!Prepare(slot))
+            {
+                Close();
+                return false;
+            }
+
+            RecordFileHeader h;
+            if (pread(m_fds[slot], &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+                memcmp(h.magic, RECORD_MAGIC, sizeof(h.magic)) == 0 && h.endianTag == RECORD_ENDIAN_TAG &&
+                h.blockBytes == bb && h.dataBlocks == dataBlocks && h.fileSeq > newestSeq)
+            {
+                newestSeq = h.fileSeq;
+                newestSlot = slot;
+            }
+        }
+        m_slot = (newestSlot + 1) % m_options.fileCount;
+        m_fileSeq = newestSeq + 1;
+
+        // 2. 寫入 Buffer 與佇列 (之後不再配置)
+        m_block.assign(bb, 0);
+        m_headerBlock.assign(bb, 0);
+        uint64_t perIndexBlock = bb / sizeof(RecordIndexEntry);
+        m_index.resize(IndexBlocksFor(dataBlocks, bb) * perIndexBlock);
+        m_jobs.assign(m_options.queueDepth > 0 ? m_options.queueDepth : 1, Job());
+        m_head = 0;
+        m_count = 0;
+
+        if (!BeginFile())
+        {
+            Close();
+            return false;
+        }
+
+        std::cout << "[Recorder] " << m_options.fileCount << " x " << m_options.fileBytes / (1024 * 1024)
+                  << " MB files in " << m_options.directory << " (" << bb << " byte blocks), starting at slot "
+                  << m_slot << std::endl;
+        m_running = true;
+        m_thread = std::thread(&LocalRecorder::Run, this);
+        return true;
+    }
+
+    bool LocalRecorder::Prepare(int slot)
+    {
+        std::string path = FilePath(m_options.directory, slot);
+        int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "[Recorder] Cannot open " << path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        m_fds[slot] = fd;
+
+        size_t bb = m_options.blockBytes;
+        off_t fileBytes = (off_t)((1 + m_header.dataBlocks + IndexBlocksFor(m_header.dataBlocks, bb)) * bb);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size == fileBytes)
+            return true;
+
+        // 大小不符 (新檔或設定改變)：重新配置。JFFS2 / UBIFS 不支援 fallocate，退回一般檔案大小設定
+        if (ftruncate(fd, 0) != 0)
+        {
+            std::cerr << "[Recorder] Cannot truncate " << path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        int err = posix_fallocate(fd, 0, fileBytes);
+        if (err == EOPNOTSUPP || err == EINVAL)
+        {
+            err = (ftruncate(fd, fileBytes) == 0) ? 0 : errno;
+        }
+        if (err != 0)
+        {
+            std::cerr << "[Recorder] Cannot allocate " << fileBytes << " bytes for " << path << ": " << strerror(err)
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void LocalRecorder::Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cond.notify_one();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+            FinishFile(); // 目前的檔案標示為 Complete，下次由下一個檔案開始
+        }
+
+        for (size_t i = 0; i < m_fds.size(); i++)
+        {
+            if (m_fds[i] >= 0)
+                close(m_fds[i]);
+        }
+        m_fds.clear();
+    }
+
+    bool LocalRecorder::Submit(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
+    {
+        bool accepted = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running)
+                return false;
+            if (m_count == m_jobs.size())
+            {
+                // 佇列已滿 (儲存裝置跟不上)：捨棄最舊的一筆
+                m_head = (m_head + 1) % m_jobs.size();
+                m_count--;
+                m_monitor.RecordDrop();
+                accepted = false;
+            }
+
+            // Slot 的 Buffer 重複使用，穩定狀態下只有複製
+            Job &job = m_jobs[(m_head + m_count) % m_jobs.size()];
+            job.desc = desc;
+            job.rawData.assign(rawData, rawData + rawCount);
+            m_count++;
+            m_monitor.RecordDepth(m_count);
+        }
+        m_cond.notify_one();
+        return accepted;
+    }
+
+    void LocalRecorder::Run()
+    {
+        Job current;
+        m_lastSyncUs = NowUs();
+        while (true)
+        {
+            bool haveJob = false;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_count == 0 && m_running)
+                    m_cond.wait_for(lock, std::chrono::milliseconds(RECORDER_IDLE_WAIT_MS));
+
+                if (m_count > 0)
+                {
+                    Job &job = m_jobs[m_head];
+                    current.desc = job.desc;
+                    current.rawData.swap(job.rawData);
+                    m_head = (m_head + 1) % m_jobs.size();
+                    m_count--;
+                    m_monitor.RecordDepth(m_count);
+                    haveJob = true;
+                }
+                else if (!m_running)
+                {
+                    break; // 佇列已清空且要求停止
+                }
+            }
+
+            int64_t startUs = NowUs();
+            if (haveJob)
+                Append(current.desc, current.rawData.data(), current.rawData.size());
+
+            // 定期寫出部分 Block、Index 與 Header，讓異常斷電時最多遺失一個週期
+            if (m_options.syncIntervalMs > 0 && startUs - m_lastSyncUs >= m_options.syncIntervalMs * 1000)
+            {
+                FlushBlocks();
+                FlushIndex();
+                WriteHeader();
+                fdatasync(m_fds[m_slot]);
+                m_lastSyncUs = startUs;
+            }
+            if (haveJob)
+                m_monitor.RecordService(NowUs() - startUs);
+        }
+    }
+
+    bool LocalRecorder::BeginFile()
+    {
+        RecordFileHeader &h = m_header;
+        uint64_t dataBlocks = h.dataBlocks;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, RECORD_MAGIC, sizeof(h.magic));
+        h.endianTag = RECORD_ENDIAN_TAG;
+        h.version = RECORD_VERSION;
+        h.blockBytes = (uint32_t)m_options.blockBytes;
+        h.state = (uint32_t)RecordFileState::Open;
+        h.fileSeq = m_fileSeq;
+        h.createdNs = RealtimeNsNow();
+        h.dataOffset = m_options.blockBytes;
+        h.dataBlocks = dataBlocks;
+        h.indexOffset = (1 + dataBlocks) * m_options.blockBytes;
+
+        std::fill(m_index.begin(), m_index.end(), RecordIndexEntry());
+        m_indexFlushed = 0;
+        m_blockUsed = 0;
+
+        // Header 先落地：舊的 Index 從此因 fileSeq 不符而失效
+        if (!WriteHeader())
+            return false;
+        fdatasync(m_fds[m_slot]);
+        return true;
+    }
+
+    void LocalRecorder::FinishFile()
+    {
+        if (m_fds.empty() || m_fds[m_slot] < 0)
+            return;
+        FlushBlocks();
+        FlushIndex();
+        m_header.state = (uint32_t)RecordFileState::Complete;
+        WriteHeader();
+        fdatasync(m_fds[m_slot]);
+        m_filesCompleted++;
+    }
+
+    bool LocalRecorder::Append(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
+    {
+        size_t bb = m_options.blockBytes;
+        size_t length = WIRE_V2_HEADER_SIZE + rawCount * sizeof(uint32_t);
+
+        // 目前 Block 放不下：補 0 寫出，Record 從新的 Block 開始
+        if (m_blockUsed > 0 && m_blockUsed + length > bb)
+            FlushBlocks();
+
+        uint64_t blocksNeeded = (length + bb - 1) / bb;
+        if (blocksNeeded > m_header.dataBlocks)
+        {
+            m_writeErrors++; // 單一 Batch 比整個檔案還大
+            return false;
+        }
+        if (m_blockUsed == 0 && m_header.blocksWritten + blocksNeeded > m_header.dataBlocks)
+        {
+            // 檔案已滿：換到下一個 (最舊的) 檔案
+            FinishFile();
+            m_slot = (m_slot + 1) % m_options.fileCount;
+            m_fileSeq++;
+            if (!BeginFile())
+            {
+                m_writeErrors++;
+                return false;
+            }
+        }
+        if (m_block.size() < blocksNeeded * bb)
+            m_block.resize(blocksNeeded * bb);
+
+        if (m_blockUsed == 0)
+        {
+            m_blockEntry.timestampNs = desc.timestampNs;
+            m_blockEntry.seqId = desc.seqId;
+            m_blockEntry.firstSampleIndex = desc.firstSampleIndex;
+            m_blockEntry.deviceId = desc.deviceId;
+            m_blockEntry.recordCount = 0;
+            m_blockEntry.fileSeq = (uint32_t)m_fileSeq;
+        }
+
+        // Record = 未分段的 v2 Datagram
+        PacketHeader h = desc;
+        h.version = WIRE_VERSION_2;
+        h.type = PacketType::Data;
+        h.encoding = SampleEncoding::Raw;
+        h.flags &= (uint8_t)~(WIRE_FLAG_FRAGMENTED | WIRE_FLAG_RETRANSMIT);
+        h.fragIndex = 0;
+        h.fragCount = 1;
+        h.fragOffset = 0;
+        h.payloadBytes = (uint32_t)(rawCount * sizeof(uint32_t));
+        uint8_t *out = m_block.data() + m_blockUsed;
+        size_t headerBytes = Net::WriteHeader(h, out);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (size_t i = 0; i < rawCount; i++)
+            WriteBe32(out + headerBytes + i * sizeof(uint32_t), rawData[i]);
+#else
+        memcpy(out + headerBytes, rawData, rawCount * sizeof(uint32_t));
+#endif
+        m_blockUsed += headerBytes + rawCount * sizeof(uint32_t);
+        m_blockEntry.recordCount++;
+
+        if (m_header.recordCount == 0)
+            m_header.firstTimestampNs = desc.timestampNs;
+        m_header.lastTimestampNs = desc.timestampNs;
+        m_header.recordCount++;
+        m_recordsWritten++;
+
+        // 大 Record 或剛好填滿：立即寫出
+        if (m_blockUsed >= bb)
+            return FlushBlocks();
+        return true;
+    }
+
+    bool LocalRecorder::FlushBlocks()
+    {
+        if (m_blockUsed == 0 || m_fds.empty())
+            return true;
+
+        size_t bb = m_options.blockBytes;
+        uint64_t blocks = (m_blockUsed + bb - 1) / bb;
+        memset(m_block.data() + m_blockUsed, 0, blocks * bb - m_blockUsed);
+        bool ok = WriteAt(m_block.data(), blocks * bb, m_header.dataOffset + m_header.blocksWritten * bb);
+
+        // 每個 Block 一筆 Index；大 Record 延續的 Block recordCount = 0
+        for (uint64_t i = 0; i < blocks; i++)
+        {
+            m_index[m_header.blocksWritten + i] = m_blockEntry;
+            if (i > 0)
+                m_index[m_header.blocksWritten + i].recordCount = 0;
+        }
+        m_header.blocksWritten += blocks;
+        m_blocksWritten += blocks;
+        m_blockUsed = 0;
+        if (m_block.size() > bb)
+            m_block.resize(bb);
+        return ok;
+    }
+
+    void LocalRecorder::FlushIndex()
+    {
+        // 從第一個尚未完整寫出的 Index Block 寫到目前為止 (未用部分為 0)
+        size_t bb = m_options.blockBytes;
+        size_t perIndexBlock = bb / sizeof(RecordIndexEntry);
+        size_t first = m_indexFlushed;
+        size_t end = (size_t)m_header.blocksWritten;
+        if (end <= first)
+            return;
+        size_t bytes = ((end - first + perIndexBlock - 1) / perIndexBlock) * bb;
+        WriteAt((const uint8_t *)&m_index[first], bytes, m_header.indexOffset + first * sizeof(RecordIndexEntry));
+        m_indexFlushed = (end / perIndexBlock) * perIndexBlock;
+    }
+
+    bool LocalRecorder::WriteHeader()
+    {
+        memcpy(m_headerBlock.data(), &m_header, sizeof(m_header));
+        return WriteAt(m_headerBlock.data(), m_headerBlock.size(), 0);
+    }
+
+    bool LocalRecorder::WriteAt(const uint8_t *data, size_t length, uint64_t offset)
+    {
+        int fd = m_fds[m_slot];
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t n = pwrite(fd, data + done, length - done, (off_t)(offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                if (m_writeErrors++ == 0)
+                    std::cerr << "[Recorder] Write failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+            done += (size_t)n;
+        }
+        return true;
+    }
+
+    int64_t LocalRecorder::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    //=========================================================================
+    // RecordFileReader
+    //=========================================================================
+
+    static void SwapHeader(RecordFileHeader &h)
+    {
+        h.endianTag = __builtin_bswap32(h.endianTag);
+        h.version = __builtin_bswap32(h.version);
+        h.blockBytes = __builtin_bswap32(h.blockBytes);
+        h.state = __builtin_bswap32(h.state);
+        h.fileSeq = __builtin_bswap64(h.fileSeq);
+        h.createdNs = __builtin_bswap64(h.createdNs);
+        h.dataOffset = __builtin_bswap64(h.dataOffset);
+        h.dataBlocks = __builtin_bswap64(h.dataBlocks);
+        h.indexOffset = __builtin_bswap64(h.indexOffset);
+        h.blocksWritten = __builtin_bswap64(h.blocksWritten);
+        h.recordCount = __builtin_bswap64(h.recordCount);
+        h.firstTimestampNs = __builtin_bswap64(h.firstTimestampNs);
+        h.lastTimestampNs = __builtin_bswap64(h.lastTimestampNs);
+    }
+
+    static void SwapEntry(RecordIndexEntry &e)
+    {
+        e.timestampNs = __builtin_bswap64(e.timestampNs);
+        e.seqId = __builtin_bswap64(e.seqId);
+        e.firstSampleIndex = __builtin_bswap64(e.firstSampleIndex);
+        e.deviceId = __builtin_bswap16(e.deviceId);
+        e.recordCount = __builtin_bswap16(e.recordCount);
+        e.fileSeq = __builtin_bswap32(e.fileSeq);
+    }
+
+    RecordFileReader::RecordFileReader() : m_fd(-1), m_validBlocks(0) { memset(&m_header, 0, sizeof(m_header)); }
+
+    RecordFileReader::~RecordFileReader() { Close(); }
+
+    bool RecordFileReader::Open(const std::string &path)
+    {
+        Close();
+        m_fd = open(path.c_str(), O_RDONLY);
+        if (m_fd < 0)
+            return false;
+
+        RecordFileHeader &h = m_header;
+        if (pread(m_fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || memcmp(h.magic, RECORD_MAGIC, sizeof(h.magic)) != 0)
+        {
+            Close();
+            return false;
+        }
+        bool swapped = (h.endianTag != RECORD_ENDIAN_TAG);
+        if (swapped)
+            SwapHeader(h);
+        struct stat st;
+        if (h.endianTag != RECORD_ENDIAN_TAG || h.version != RECORD_VERSION || h.blockBytes < RECORDER_MIN_BLOCK ||
+            fstat(m_fd, &st) != 0 || h.indexOffset + h.dataBlocks * sizeof(RecordIndexEntry) > (uint64_t)st.st_size)
+        {
+            Close();
+            return false;
+        }
+
+        m_index.resize(h.dataBlocks);
+        size_t indexBytes = h.dataBlocks * sizeof(RecordIndexEntry);
+        if (pread(m_fd, m_index.data(), indexBytes, (off_t)h.indexOffset) != (ssize_t)indexBytes)
+        {
+            Close();
+            return false;
+        }
+
+        // 有效範圍：開頭連續屬於本檔案的 Index (Open 狀態的檔案可能有前一輪的殘留)
+        m_validBlocks = 0;
+        while (m_validBlocks < h.dataBlocks && m_validBlocks < h.blocksWritten)
+        {
+            RecordIndexEntry &e = m_index[m_validBlocks];
+            if (swapped)
+                SwapEntry(e);
+            if (e.fileSeq != (uint32_t)h.fileSeq)
+                break;
+            m_validBlocks++;
+        }
+        return true;
+    }
+
+    void RecordFileReader::Close()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+        m_index.clear();
+        m_validBlocks = 0;
+    }
+
+    uint64_t RecordFileReader::FindBlock(uint64_t timestampNs) const
+    {
+        // 第一個 timestampNs >= 目標的 Block；其前一個 Block 的後段也可能含有目標之後的資料
+        uint64_t lo = 0, hi = m_validBlocks;
+        while (lo < hi)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (m_index[mid].timestampNs < timestampNs)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (m_validBlocks == 0 || (lo == m_validBlocks && m_header.lastTimestampNs < timestampNs))
+            return m_validBlocks;
+        uint64_t block = (lo > 0) ? lo - 1 : 0;
+        while (block > 0 && m_index[block].recordCount == 0)
+            block--;
+        return block;
+    }
+
+    uint64_t RecordFileReader::ReadBlock(uint64_t block, std::vector<RecordedBatch> &records)
+    {
+        records.clear();
+        if (m_fd < 0 || block >= m_validBlocks)
+            return 0;
+        const RecordIndexEntry &entry = m_index[block];
+        if (entry.recordCount == 0)
+            return 1; // 大 Record 的延續
+
+        uint64_t span = 1;
+        while (block + span < m_validBlocks && m_index[block + span].recordCount == 0)
+            span++;
+        size_t bytes = (size_t)(span * m_header.blockBytes);
+        if (m_buffer.size() < bytes)
+            m_buffer.resize(bytes);
+        off_t offset = (off_t)(m_header.dataOffset + block * m_header.blockBytes);
+        if (pread(m_fd, m_buffer.data(), bytes, offset) != (ssize_t)bytes)
+            return 0;
+
+        size_t pos = 0;
+        for (uint16_t i = 0; i < entry.recordCount; i++)
+        {
+            RecordedBatch batch;
+            PacketHeader &h = batch.header;
+            // 只交給 ParseHeader 固定的 Header 長度 (其長度檢查以整個 Datagram 為準)
+            if (bytes - pos < WIRE_V2_HEADER_SIZE || !ParseHeader(m_buffer.data() + pos, WIRE_V2_HEADER_SIZE, h) ||
+                h.version != WIRE_VERSION_2 || h.headerBytes + h.payloadBytes > bytes - pos)
+                break;
+            const uint8_t *payload = m_buffer.data() + pos + h.headerBytes;
+            size_t count = h.payloadBytes / sizeof(uint32_t);
+            records.push_back(batch);
+            std::vector<uint32_t> &samples = records.back().samples;
+            samples.resize(count);
+            for (size_t k = 0; k < count; k++)
+                samples[k] = ReadBe32(payload + k * sizeof(uint32_t));
+            pos += h.headerBytes + h.payloadBytes;
+        }
+        return span;
+    }
+}
@@ -0,0 +1,349 @@
+/**
+ * @file SampleCodec.cpp
+ * @brief Delta/Predictor + Rice / FOR 壓縮實作
+ */
+#include "net/SampleCodec.hpp"
+
+namespace Net
+{
+    namespace
+    {
+        // Rice 商數 (Unary) 上限，超過則該 k 不可用，避免極端值產生超長 Unary
+        const uint32_t RICE_MAX_QUOTIENT = 24;
+
+        const uint8_t MODE_PREDICTOR_2ND = 0x80;
+        const uint8_t MODE_PACK_FOR = 0x40;
+        const uint8_t MODE_PARAM_MASK = 0x3F;
+
+        inline uint32_t ZigZag(uint32_t residual)
+        {
+            return (residual << 1) ^ (uint32_t)((int32_t)residual >> 31);
+        }
+
+        inline uint32_t UnZigZag(uint32_t value)
+        {
+            return (value >> 1) ^ (0u - (value & 1u));
+        }
+
+        inline int BitWidth(uint32_t value)
+        {
+            return value ? 32 - __builtin_clz(value) : 0;
+        }
+
+        // MSB-First Bit Writer (64-bit 累加器，每滿 8 bit 即寫出)
+        class BitWriter
+        {
+        public:
+            BitWriter(uint8_t *out, size_t capacity)
+                : m_out(out), m_capacity(capacity), m_pos(0), m_acc(0), m_bits(0), m_overflow(false) {}
+
+            void Put(uint32_t value, int bits)
+            {
+                if (bits == 0)
+                    return;
+                if (bits < 32)
+                    value &= (1u << bits) - 1u;
+                m_acc = (m_acc << bits) | value;
+                m_bits += bits;
+                while (m_bits >= 8)
+                {
+                    m_bits -= 8;
+                    if (m_pos < m_capacity)
+                        m_out[m_pos++] = (uint8_t)(m_acc >> m_bits);
+                    else
+                        m_overflow = true;
+                }
+            }
+
+            // q 個 1 後接一個 0 (q <= RICE_MAX_QUOTIENT)
+            void PutUnary(uint32_t q)
+            {
+                Put(((1u << q) - 1u) << 1, (int)q + 1);
+            }
+
+            size_t Finish()
+            {
+                if (m_bits > 0)
+                    Put(0, 8 - m_bits);
+                return m_overflow ? 0 : m_pos;
+            }
+
+        private:
+            uint8_t *m_out;
+            size_t m_capacity;
+            size_t m_pos;
+            uint64_t m_acc;
+            int m_bits;
+            bool m_overflow;
+        };
+
+        // MSB-First Bit Reader (累加器左對齊，讀超過尾端時補 0 並記錄錯誤)
+        class BitReader
+        {
+        public:
+            BitReader(const uint8_t *data, size_t length)
+                : m_ptr(data), m_end(data + length), m_acc(0), m_bits(0),
+                  m_available((uint64_t)length * 8), m_consumed(0) {}
+
+            uint32_t Get(int bits)
+            {
+                if (bits == 0)
+                    return 0;
+                Refill();
+                uint32_t value = (uint32_t)(m_acc >> (64 - bits));
+                Consume(bits);
+                return value;
+            }
+
+            // 回傳連續 1 的數量 (並吃掉結尾的 0)，超過上限回傳 > RICE_MAX_QUOTIENT
+            uint32_t GetUnary()
+            {
+                Refill();
+                uint64_t inverted = ~m_acc;
+                uint32_t q = inverted ? (uint32_t)__builtin_clzll(inverted) : 64;
+                if (q > RICE_MAX_QUOTIENT)
+                    return q;
+                Consume((int)q + 1);
+                return q;
+            }
+
+            bool Overrun() const { return m_consumed > m_available; }
+
+        private:
+            void Refill()
+            {
+                while (m_bits <= 56)
+                {
+                    uint64_t byte = (m_ptr < m_end) ? *m_ptr++ : 0;
+                    m_acc |= byte << (56 - m_bits);
+                    m_bits += 8;
+                }
+            }
+
+            void Consume(int bits)
+            {
+                m_acc <<= bits;
+                m_bits -= bits;
+                m_consumed += bits;
+            }
+
+            const uint8_t *m_ptr;
+            const uint8_t *m_end;
+            uint64_t m_acc;
+            int m_bits;
+            uint64_t m_available;
+            uint64_t m_consumed;
+        };
+
+        // 計算 Rice(k) 的總 bit 數，商數超過上限回傳 UINT64_MAX
+        uint64_t RiceCost(const uint32_t *values, int count, int k, uint32_t maxValue)
+        {
+            if ((maxValue >> k) > RICE_MAX_QUOTIENT)
+                return UINT64_MAX;
+            uint64_t cost = (uint64_t)count * (uint64_t)(k + 1);
+            for (int i = 0; i < count; i++)
+                cost += values[i] >> k;
+            return cost;
+        }
+    }
+
+    size_t SampleCodec::MaxEncodedSize(int numSamples, int numChannels)
+    {
+        if (numSamples <= 0 || numChannels <= 0)
+            return 0;
+        // 最差情況：每個 Block 皆為 32 bit FOR，加上 Mode Byte 與第一筆原始值
+        size_t blocks = (size_t)(numSamples + CODEC_BLOCK_SAMPLES - 1) / CODEC_BLOCK_SAMPLES;
+        return (size_t)numChannels * ((size_t)numSamples * 4 + blocks + 4) + 1;
+    }
+
+    size_t SampleCodec::Encode(const uint32_t *rawData,
+                               int numSamples,
+                               int numChannels,
+                               uint8_t *out,
+                               size_t outCapacity)
+    {
+        if (numSamples <= 0 || numChannels <= 0 || outCapacity < MaxEncodedSize(numSamples, numChannels))
+            return 0;
+
+        BitWriter writer(out, outCapacity);
+        uint32_t zz1[CODEC_BLOCK_SAMPLES];
+        uint32_t zz2[CODEC_BLOCK_SAMPLES];
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const uint32_t *src = rawData + ch;
+            uint32_t prev1 = src[0];
+            uint32_t prev2 = src[0];
+            writer.Put(prev1, 32);
+
+            for (int start = 1; start < numSamples; start += CODEC_BLOCK_SAMPLES)
+            {
+                int count = numSamples - start;
+                if (count > CODEC_BLOCK_SAMPLES)
+                    count = CODEC_BLOCK_SAMPLES;
+
+                // 1. 同時計算兩種 Predictor 的殘差，取絕對值總和較小者
+                uint64_t sum1 = 0, sum2 = 0;
+                uint32_t p1 = prev1, p2 = prev2;
+                for (int i = 0; i < count; i++)
+                {
+                    uint32_t x = src[(size_t)(start + i) * numChannels];
+                    zz1[i] = ZigZag(x - p1);
+                    zz2[i] = ZigZag(x - (p1 + (p1 - p2)));
+                    sum1 += zz1[i];
+                    sum2 += zz2[i];
+                    p2 = p1;
+                    p1 = x;
+                }
+                prev2 = p2;
+                prev1 = p1;
+
+                uint8_t mode = 0;
+                const uint32_t *values = zz1;
+                uint64_t sum = sum1;
+                if (sum2 < sum1)
+                {
+                    mode |= MODE_PREDICTOR_2ND;
+                    values = zz2;
+                    sum = sum2;
+                }
+
+                uint32_t maxValue = 0;
+                for (int i = 0; i < count; i++)
+                    maxValue |= values[i];
+
+                // 2. FOR 成本：固定寬度
+                int forWidth = BitWidth(maxValue);
+                uint64_t bestCost = (uint64_t)count * forWidth;
+                int bestParam = forWidth;
+                bool useRice = false;
+
+                // 3. Rice 成本：由平均值估計 k，並比較相鄰 k
+                uint32_t mean = (uint32_t)(sum / (uint64_t)count);
+                int k0 = mean ? BitWidth(mean) - 1 : 0;
+                for (int k = k0 - 1; k <= k0 + 1; k++)
+                {
+                    if (k < 0 || k > 31)
+                        continue;
+                    uint64_t cost = RiceCost(values, count, k, maxValue);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestParam = k;
+                        useRice = true;
+                    }
+                }
+
+                if (!useRice)
+                    mode |= MODE_PACK_FOR;
+                mode |= (uint8_t)bestParam;
+                writer.Put(mode, 8);
+
+                if (useRice)
+                {
+                    for (int i = 0; i < count; i++)
+                    {
+                        writer.PutUnary(values[i] >> bestParam);
+                        writer.Put(values[i], bestParam);
+                    }
+                }
+                else
+                {
+                    for (int i = 0; i < count; i++)
+                        writer.Put(values[i], bestParam);
+                }
+            }
+        }
+
+        return writer.Finish();
+    }
+
+    bool SampleCodec::Decode(const uint8_t *data,
+                             size_t length,
+                             int numSamples,
+                             int numChannels,
+                             uint32_t *rawOut)
+    {
+        if (numSamples <= 0 || numChannels <= 0)
+            return false;
+
+        BitReader reader(data, length);
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            uint32_t *dst = rawOut + ch;
+            uint32_t prev1 = reader.Get(32);
+            uint32_t prev2 = prev1;
+            dst[0] = prev1;
+
+            for (int start = 1; start < numSamples; start += CODEC_BLOCK_SAMPLES)
+            {
+                int count = numSamples - start;
+                if (count > CODEC_BLOCK_SAMPLES)
+                    count = CODEC_BLOCK_SAMPLES;
+
+                uint8_t mode = (uint8_t)reader.Get(8);
+                int param = mode & MODE_PARAM_MASK;
+                bool secondOrder = (mode & MODE_PREDICTOR_2ND) != 0;
+                bool useRice = (mode & MODE_PACK_FOR) == 0;
+                if (param > 32 || (useRice && param > 31))
+                    return false;
+
+                for (int i = 0; i < count; i++)
+                {
+                    uint32_t zz;
+                    if (useRice)
+                    {
+                        uint32_t q = reader.GetUnary();
+                        if (q > RICE_MAX_QUOTIENT)
+                            return false;
+                        zz = (q << param) | reader.Get(param);
+                    }
+                    else
+                    {
+                        zz = reader.Get(param);
+                    }
+
+                    uint32_t predicted = secondOrder ? prev1 + (prev1 - prev2) : prev1;
+                    uint32_t x = predicted + UnZigZag(zz);
+                    dst[(size_t)(start + i) * numChannels] = x;
+                    prev2 = prev1;
+                    prev1 = x;
+                }
+            }
+
+            if (reader.Overrun())
+                return false;
+        }
+
+        return !reader.Overrun();
+    }
+
+    bool SampleCodec::ParseEncoding(const std::string &name, SampleEncoding &encoding)
+    {
+        if (name == "raw")
+        {
+            encoding = SampleEncoding::Raw;
+            return true;
+        }
+        if (name == "delta")
+        {
+            encoding = SampleEncoding::DeltaPack;
+            return true;
+        }
+        return false;
+    }
+
+    const char *SampleCodec::EncodingName(SampleEncoding encoding)
+    {
+        switch (encoding)
+        {
+        case SampleEncoding::Raw:
+            return "raw";
+        case SampleEncoding::DeltaPack:
+            return "delta";
+        default:
+            return "unknown";
+        }
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file SendHistory.cpp
+ * @brief 已發送 Datagram 歷史環實作
+ */
+#include "net/SendHistory.hpp"
+#include <cstring>
+#include <algorithm>
+
+namespace Net
+{
+    const size_t SendHistory::NO_SLOT;
+
+    void SendHistory::Init(size_t depth, size_t maxDatagram)
+    {
+        m_entries.assign(depth, Entry());
+        for (size_t i = 0; i < m_entries.size(); i++)
+        {
+            m_entries[i].used = false;
+            m_entries[i].data.resize(maxDatagram);
+        }
+        size_t buckets = 1;
+        while (depth > 0 && buckets < depth * 4)
+            buckets <<= 1;
+        m_buckets.assign(depth > 0 ? buckets : 0, NO_SLOT);
+        m_next = 0;
+        m_maxDatagram = maxDatagram;
+        m_serial = 0;
+    }
+
+    size_t SendHistory::Bucket(uint16_t deviceId, uint64_t seqId) const
+    {
+        // 同一裝置的連續序號落在不同 Bucket (XOR 常數不改變低位元的相異性)
+        return (size_t)((seqId ^ (deviceId * 0x9E3779B97F4A7C15ULL)) & (m_buckets.size() - 1));
+    }
+
+    bool SendHistory::Matches(size_t slot, uint16_t deviceId, uint64_t seqId) const
+    {
+        const Entry &entry = m_entries[slot];
+        return entry.used && entry.seqId == seqId && entry.deviceId == deviceId;
+    }
+
+    SendHistory::Entry *SendHistory::Record(uint16_t deviceId, uint64_t seqId, const struct iovec *iov, int iovCount)
+    {
+        if (m_entries.empty())
+            return NULL;
+
+        size_t total = 0;
+        for (int i = 0; i < iovCount; i++)
+            total += iov[i].iov_len;
+        if (total > m_maxDatagram)
+            return NULL;
+
+        size_t slot = m_next;
+        Entry &entry = m_entries[slot];
+        m_next = (m_next + 1) % m_entries.size();
+
+        // 同一 Batch 的前一個分段 (被覆蓋的正是這個 Slot 時不串接)
+        size_t &bucket = m_buckets[Bucket(deviceId, seqId)];
+        entry.prev = (bucket != slot && bucket != NO_SLOT && Matches(bucket, deviceId, seqId)) ? bucket : NO_SLOT;
+        bucket = slot;
+
+        size_t pos = 0;
+        for (int i = 0; i < iovCount; i++)
+        {
+            if (iov[i].iov_len == 0)
+                continue;
+            std::memcpy(entry.data.data() + pos, iov[i].iov_base, iov[i].iov_len);
+            pos += iov[i].iov_len;
+        }
+        entry.used = true;
+        entry.deviceId = deviceId;
+        entry.seqId = seqId;
+        entry.length = total;
+        entry.serial = ++m_serial;
+        return &entry;
+    }
+
+    size_t SendHistory::Find(uint16_t deviceId, uint64_t seqId, std::vector<const Entry *> &out) const
+    {
+        out.clear();
+        if (m_buckets.empty())
+            return 0;
+
+        // 由最新的分段往回串接 (serial 必須遞減，避免 prev 已被新資料覆蓋)，再反轉為發送順序
+        size_t slot = m_buckets[Bucket(deviceId, seqId)];
+        uint64_t newer = m_serial + 1;
+        while (slot != NO_SLOT && Matches(slot, deviceId, seqId) && m_entries[slot].serial < newer)
+        {
+            out.push_back(&m_entries[slot]);
+            newer = m_entries[slot].serial;
+            slot = m_entries[slot].prev;
+        }
+        std::reverse(out.begin(), out.end());
+        return out.size();
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * @file SendPipeline.cpp
+ * @brief 網路發送執行緒實作
+ */
+#include "net/SendPipeline.hpp"
+#include <chrono>
+#include <time.h>
+
+namespace Net
+{
+    // 無資料時的喚醒間隔：需小於批次 / FEC 延遲上限，並定期處理 NACK 與 TCP 連線
+    static const int PIPELINE_IDLE_WAIT_US = 1000;
+
+    SendPipeline::SendPipeline(UdpSender &udp, TcpSink *tcp)
+        : m_udp(udp), m_tcp(tcp), m_head(0), m_count(0), m_running(false),
+          m_statusIntervalMs(0), m_startUs(0), m_lastStatusUs(0) {}
+
+    SendPipeline::~SendPipeline() { Stop(); }
+
+    bool SendPipeline::Start(size_t capacity)
+    {
+        if (m_running)
+            return false;
+
+        m_jobs.assign(capacity > 0 ? capacity : 1, Job());
+        m_head = 0;
+        m_count = 0;
+        m_startUs = NowUs();
+        m_lastStatusUs = m_startUs;
+        m_running = true;
+        m_thread = std::thread(&SendPipeline::Run, this);
+        return true;
+    }
+
+    void SendPipeline::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_cond.notify_one();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void SendPipeline::EnableStatus(long intervalMs, StatusCollector collector)
+    {
+        m_statusIntervalMs = intervalMs;
+        m_statusCollector = collector;
+        m_statusReport.devices.reserve(STATUS_MAX_DEVICES);
+    }
+
+    bool SendPipeline::Submit(const PacketHeader &desc, std::vector<uint32_t> &rawData)
+    {
+        bool accepted = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_count == m_jobs.size())
+            {
+                // 佇列已滿：捨棄最舊的一筆 (與裝置佇列相同，保留最新資料)
+                m_head = (m_head + 1) % m_jobs.size();
+                m_count--;
+                m_monitor.RecordDrop();
+                accepted = false;
+            }
+
+            Job &job = m_jobs[(m_head + m_count) % m_jobs.size()];
+            job.desc = desc;
+            job.rawData.swap(rawData);
+            m_count++;
+            m_monitor.RecordDepth(m_count);
+        }
+        m_cond.notify_one();
+        return accepted;
+    }
+
+    void SendPipeline::Run()
+    {
+        Job current;
+        int64_t lastHousekeepingUs = 0;
+        while (true)
+        {
+            bool haveJob = false;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_count == 0 && m_running)
+                    m_cond.wait_for(lock, std::chrono::microseconds(PIPELINE_IDLE_WAIT_US));
+
+                if (m_count > 0)
+                {
+                    // 取出佇首 (交換 Buffer，不複製)
+                    Job &job = m_jobs[m_head];
+                    current.desc = job.desc;
+                    current.rawData.swap(job.rawData);
+                    m_head = (m_head + 1) % m_jobs.size();
+                    m_count--;
+                    m_monitor.RecordDepth(m_count);
+                    haveJob = true;
+                }
+                else if (!m_running)
+                {
+                    break; // 佇列已清空且要求停止
+                }
+            }
+
+            // 週期性工作 (NACK、TCP 連線 / 積壓、批次與 FEC 期限)：閒置時或每 1ms 一次
+            int64_t nowUs = NowUs();
+            if (!haveJob || nowUs - lastHousekeepingUs >= PIPELINE_IDLE_WAIT_US)
+            {
+                m_udp.ServiceNacks();
+                if (m_tcp)
+                    m_tcp->Service();
+                m_udp.Poll();
+                if (m_statusIntervalMs > 0 && nowUs - m_lastStatusUs >= m_statusIntervalMs * 1000)
+                    SendStatus(nowUs);
+                lastHousekeepingUs = nowUs;
+            }
+            if (!haveJob)
+                continue;
+
+            int64_t startUs = NowUs();
+            m_udp.SendBatch(current.desc, current.rawData.data(), current.rawData.size());
+            if (m_tcp)
+                m_tcp->SendBatch(current.desc, current.rawData.data(), current.rawData.size());
+            m_monitor.RecordService(NowUs() - startUs);
+        }
+
+        m_udp.Flush();
+    }
+
+    void SendPipeline::SendStatus(int64_t nowUs)
+    {
+        StatusReport &report = m_statusReport;
+        Utils::StageStats stats = m_monitor.Snapshot();
+        report.uptimeMs = (uint64_t)(nowUs - m_startUs) / 1000;
+        report.statusSeq++;
+        report.sendErrors = (uint32_t)m_udp.GetSendErrors();
+        report.sendQueueDepth = (uint32_t)stats.queueDepth;
+        report.sendQueueHighWater = (uint32_t)stats.queueHighWater;
+        report.sendDropped = (uint32_t)stats.dropped;
+        report.sendAvgServiceUs = (uint32_t)stats.avgServiceUs;
+        report.sendMaxServiceUs = (uint32_t)stats.maxServiceUs;
+        report.devices.clear();
+        if (m_statusCollector)
+            m_statusCollector(report);
+
+        m_udp.SendStatus(report);
+        m_lastStatusUs = nowUs;
+    }
+
+    int64_t SendPipeline::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+}
@@ -0,0 +1,404 @@
+/**
+ * @file ShmRing.cpp
+ * @brief Shared Memory 單寫多讀環狀傳輸實作
+ */
+#include "net/ShmRing.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Net
+{
+    static_assert(sizeof(ShmRingControl) == 64, "ShmRingControl must stay 64 bytes");
+
+    static const size_t SHM_RING_MIN_CAPACITY = 64 * 1024;
+    static const uint16_t SHM_RECORD_DATA = 0;
+    static const uint16_t SHM_RECORD_PAD = 1;
+
+    // 紀錄 Header (同一台機器存取，使用 Host Byte Order)
+    struct ShmRecordHeader
+    {
+        uint32_t size;   // 整筆紀錄大小 (含本 Header，8 Byte 對齊)
+        uint16_t type;   // SHM_RECORD_DATA / SHM_RECORD_PAD
+        uint16_t reserved;
+        uint32_t seq;    // 紀錄序號
+        uint32_t length; // 資料長度 (不含本 Header)
+    };
+    static_assert(sizeof(ShmRecordHeader) == SHM_RING_RECORD_HEADER, "ShmRecordHeader size mismatch");
+
+    //=========================================================================
+    // Writer
+    //=========================================================================
+
+    ShmRingWriter::ShmRingWriter()
+        : m_fd(-1), m_base(NULL), m_mapBytes(0), m_control(NULL), m_data(NULL), m_mask(0),
+          m_published(0), m_rejected(0) {}
+
+    ShmRingWriter::~ShmRingWriter() { Close(); }
+
+    bool ShmRingWriter::Create(const std::string &name, size_t capacityBytes)
+    {
+        Close();
+
+        size_t capacity = SHM_RING_MIN_CAPACITY;
+        while (capacity < capacityBytes && capacity < 0x40000000u)
+            capacity <<= 1;
+
+        m_fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (m_fd < 0)
+        {
+            std::cerr << "[SHM] shm_open " << name << " failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        m_mapBytes = sizeof(ShmRingControl) + capacity;
+        if (ftruncate(m_fd, (off_t)m_mapBytes) < 0)
+        {
+            std::cerr << "[SHM] ftruncate failed: " << strerror(errno) << std::endl;
+            Close();
+            return false;
+        }
+
+        m_base = mmap(NULL, m_mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (m_base == MAP_FAILED)
+        {
+            m_base = NULL;
+            std::cerr << "[SHM] mmap failed: " << strerror(errno) << std::endl;
+            Close();
+            return false;
+        }
+
+        // 先清掉 magic，欄位設定完成後才寫回 (Reader 以 magic 判斷是否可用)
+        m_control = static_cast<ShmRingControl *>(m_base);
+        m_data = static_cast<uint8_t *>(m_base) + sizeof(ShmRingControl);
+        m_mask = (uint32_t)capacity - 1;
+        m_control->magic = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        m_control->version = SHM_RING_VERSION;
+        m_control->capacity = (uint32_t)capacity;
+        m_control->generation = (uint32_t)ts.tv_nsec ^ ((uint32_t)getpid() << 16);
+        m_control->head.store(0, std::memory_order_relaxed);
+        m_control->tail.store(0, std::memory_order_relaxed);
+        m_control->records.store(0, std::memory_order_relaxed);
+        memset(m_control->reserved, 0, sizeof(m_control->reserved));
+        std::atomic_thread_fence(std::memory_order_release);
+        m_control->magic = SHM_RING_MAGIC;
+
+        m_name = name;
+        m_published = 0;
+        m_rejected = 0;
+        std::cout << "[SHM] Ring " << name << " created: " << capacity << " bytes" << std::endl;
+        return true;
+    }
+
+    bool ShmRingWriter::Publish(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
+    {
+        if (!m_control)
+            return false;
+
+        // 本機傳輸不需壓縮：一律 Raw、不分段
+        PacketHeader header = desc;
+        header.version = WIRE_VERSION_2;
+        header.type = PacketType::Data;
+        header.flags = desc.flags & WIRE_FLAG_TIME_CORRECTED;
+        header.encoding = SampleEncoding::Raw;
+        header.fragIndex = 0;
+        header.fragCount = 1;
+        header.fragOffset = 0;
+        size_t payloadSize = rawCount * sizeof(uint32_t);
+        header.payloadBytes = (uint32_t)payloadSize;
+        size_t headerSize = WriteHeader(header, m_headerSlot);
+
+        uint32_t capacity = m_mask + 1;
+        size_t length = headerSize + payloadSize;
+        size_t size = (SHM_RING_RECORD_HEADER + length + 7) & ~(size_t)7;
+        if (size > capacity / 2)
+        {
+            m_rejected++;
+            return false;
+        }
+
+        // 尾端放不下整筆時補 Pad 並繞回開頭 (剩餘不足一個紀錄 Header 時 Reader 自動略過)
+        uint32_t head = m_control->head.load(std::memory_order_relaxed);
+        uint32_t offset = head & m_mask;
+        uint32_t pad = (offset + size > capacity) ? capacity - offset : 0;
+        Reserve(head + pad + (uint32_t)size);
+
+        if (pad >= SHM_RING_RECORD_HEADER)
+        {
+            ShmRecordHeader padRecord = {pad, SHM_RECORD_PAD, 0, 0, 0};
+            memcpy(m_data + offset, &padRecord, sizeof(padRecord));
+        }
+
+        uint32_t seq = m_control->records.load(std::memory_order_relaxed);
+        uint8_t *out = m_data + ((head + pad) & m_mask);
+        ShmRecordHeader record = {(uint32_t)size, SHM_RECORD_DATA, 0, seq, (uint32_t)length};
+        memcpy(out, &record, sizeof(record));
+        memcpy(out + SHM_RING_RECORD_HEADER, m_headerSlot, headerSize);
+        memcpy(out + SHM_RING_RECORD_HEADER + headerSize, rawData, payloadSize);
+
+        // 資料寫完才發布 head
+        m_control->records.store(seq + 1, std::memory_order_relaxed);
+        m_control->head.store(head + pad + (uint32_t)size, std::memory_order_release);
+        m_published++;
+        return true;
+    }
+
+    void ShmRingWriter::Reserve(uint32_t end)
+    {
+        // 推進 tail 直到 [tail, end) 不超過容量 (被覆寫的紀錄先移出有效範圍)
+        uint32_t capacity = m_mask + 1;
+        uint32_t tail = m_control->tail.load(std::memory_order_relaxed);
+        uint32_t original = tail;
+        while ((int32_t)(end - tail) > (int32_t)capacity)
+        {
+            uint32_t offset = tail & m_mask;
+            if (capacity - offset < SHM_RING_RECORD_HEADER)
+            {
+                tail += capacity - offset;
+                continue;
+            }
+            ShmRecordHeader record;
+            memcpy(&record, m_data + offset, sizeof(record));
+            tail += record.size;
+        }
+
+        if (tail != original)
+        {
+            m_control->tail.store(tail, std::memory_order_relaxed);
+            // tail 必須在覆寫資料之前對 Reader 可見
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    void ShmRingWriter::Close()
+    {
+        if (m_base)
+        {
+            munmap(m_base, m_mapBytes);
+            m_base = NULL;
+        }
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+            shm_unlink(m_name.c_str());
+        }
+        m_control = NULL;
+        m_data = NULL;
+    }
+
+    //=========================================================================
+    // Reader
+    //=========================================================================
+
+    ShmRingReader::ShmRingReader()
+        : m_fd(-1), m_base(NULL), m_mapBytes(0), m_control(NULL), m_data(NULL), m_mask(0),
+          m_generation(0), m_cursor(0), m_pendingSize(0), m_expectedSeq(0), m_haveSeq(false),
+          m_read(0), m_overruns(0), m_lost(0) {}
+
+    ShmRingReader::~ShmRingReader() { Detach(); }
+
+    bool ShmRingReader::Attach(const std::string &name, bool fromOldest)
+    {
+        Detach();
+
+        m_fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (m_fd < 0)
+        {
+            std::cerr << "[SHM] Attach " << name << " failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(m_fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmRingControl) + SHM_RING_MIN_CAPACITY)
+        {
+            std::cerr << "[SHM] Ring " << name << " not ready" << std::endl;
+            Detach();
+            return false;
+        }
+
+        m_mapBytes = (size_t)st.st_size;
+        m_base = mmap(NULL, m_mapBytes, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (m_base == MAP_FAILED)
+        {
+            m_base = NULL;
+            std::cerr << "[SHM] mmap failed: " << strerror(errno) << std::endl;
+            Detach();
+            return false;
+        }
+
+        m_control = static_cast<const ShmRingControl *>(m_base);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t capacity = m_control->capacity;
+        if (m_control->magic != SHM_RING_MAGIC || m_control->version != SHM_RING_VERSION ||
+            capacity == 0 || (capacity & (capacity - 1)) != 0 || sizeof(ShmRingControl) + capacity > m_mapBytes)
+        {
+            std::cerr << "[SHM] Ring " << name << " has invalid layout" << std::endl;
+            Detach();
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t *>(m_base) + sizeof(ShmRingControl);
+        m_mask = capacity - 1;
+        m_generation = m_control->generation;
+        m_pendingSize = 0;
+        m_read = 0;
+        m_overruns = 0;
+        m_lost = 0;
+        if (fromOldest)
+        {
+            m_cursor = m_control->tail.load(std::memory_order_acquire);
+            m_haveSeq = false;
+        }
+        else
+        {
+            m_expectedSeq = m_control->records.load(std::memory_order_acquire);
+            m_cursor = m_control->head.load(std::memory_order_acquire);
+            m_haveSeq = true;
+        }
+        return true;
+    }
+
+    ShmReadStatus ShmRingReader::Poll(ShmRecord &record)
+    {
+        if (!m_control)
+            return ShmReadStatus::Empty;
+        if (m_pendingSize > 0)
+            Release();
+
+        // Writer 重建 Ring：從新 Ring 的目前位置重新開始
+        if (WriterRestarted())
+        {
+            m_generation = m_control->generation;
+            m_cursor = m_control->head.load(std::memory_order_acquire);
+            m_haveSeq = false;
+            m_overruns++;
+            return ShmReadStatus::Overrun;
+        }
+
+        uint32_t capacity = m_mask + 1;
+        while (true)
+        {
+            uint32_t head = m_control->head.load(std::memory_order_acquire);
+            if (m_cursor == head)
+                return ShmReadStatus::Empty;
+            if (Overwritten(m_cursor))
+            {
+                Resync();
+                return ShmReadStatus::Overrun;
+            }
+
+            uint32_t offset = m_cursor & m_mask;
+            if (capacity - offset < SHM_RING_RECORD_HEADER)
+            {
+                m_cursor += capacity - offset;
+                continue;
+            }
+
+            ShmRecordHeader header;
+            memcpy(&header, m_data + offset, sizeof(header));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (Overwritten(m_cursor) || header.size < SHM_RING_RECORD_HEADER || header.size > capacity - offset ||
+                (header.size & 7) != 0 || header.length > header.size - SHM_RING_RECORD_HEADER)
+            {
+                Resync();
+                return ShmReadStatus::Overrun;
+            }
+
+            if (header.type == SHM_RECORD_PAD)
+            {
+                m_cursor += header.size;
+                continue;
+            }
+
+            record.seq = header.seq;
+            record.data = m_data + offset + SHM_RING_RECORD_HEADER;
+            record.length = header.length;
+            if (!ParseHeader(record.data, record.length, record.header))
+            {
+                // 解析失敗通常代表讀取途中被覆寫；否則略過這筆
+                if (Overwritten(m_cursor))
+                {
+                    Resync();
+                    return ShmReadStatus::Overrun;
+                }
+                m_cursor += header.size;
+                continue;
+            }
+            record.payload = record.data + record.header.headerBytes;
+            record.payloadBytes = record.length - record.header.headerBytes;
+
+            if (m_haveSeq && header.seq != m_expectedSeq)
+                m_lost += (uint32_t)(header.seq - m_expectedSeq);
+            m_expectedSeq = header.seq + 1;
+            m_haveSeq = true;
+            m_pendingSize = header.size;
+            return ShmReadStatus::Ok;
+        }
+    }
+
+    bool ShmRingReader::Release()
+    {
+        if (m_pendingSize == 0)
+            return false;
+
+        // 處理期間若 tail 已越過本紀錄，代表資料已被覆寫
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool intact = !Overwritten(m_cursor);
+        if (intact)
+        {
+            m_cursor += m_pendingSize;
+            m_read++;
+        }
+        else
+        {
+            Resync();
+        }
+        m_pendingSize = 0;
+        return intact;
+    }
+
+    bool ShmRingReader::WriterRestarted() const
+    {
+        return m_control && m_control->generation != m_generation;
+    }
+
+    bool ShmRingReader::Overwritten(uint32_t position) const
+    {
+        uint32_t tail = m_control->tail.load(std::memory_order_acquire);
+        return (int32_t)(position - tail) < 0;
+    }
+
+    void ShmRingReader::Resync()
+    {
+        // 跳到最舊的完整紀錄；遺失筆數由下一筆的序號差計算
+        m_cursor = m_control->tail.load(std::memory_order_acquire);
+        m_pendingSize = 0;
+        m_overruns++;
+    }
+
+    void ShmRingReader::Detach()
+    {
+        if (m_base)
+        {
+            munmap(m_base, m_mapBytes);
+            m_base = NULL;
+        }
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+        m_control = NULL;
+        m_data = NULL;
+    }
+}
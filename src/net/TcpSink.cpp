@@ -0,0 +1,368 @@
+/**
+ * @file TcpSink.cpp
+ * @brief TCP 串流輸出實作
+ */
+#include "net/TcpSink.hpp"
+#include "net/SampleCodec.hpp"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace Net
+{
+    static const size_t TCP_CHUNK_SIZE = 64 * 1024;
+    static const int TCP_MAX_IOV = 16;
+
+    TcpSink::TcpSink()
+        : m_listenFd(-1), m_maxClients(0), m_maxBacklogBytes(0), m_sendBufferBytes(0),
+          m_bytesSent(0), m_slowDisconnects(0), m_backlogHighWater(0) {}
+
+    TcpSink::~TcpSink() { Close(); }
+
+    bool TcpSink::Init(int port, int maxClients, size_t maxBacklogBytes, int sendBufferBytes)
+    {
+        if (m_listenFd >= 0)
+            Close();
+
+        if ((m_listenFd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        {
+            std::cerr << "[TCP] Socket creation failed" << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(m_listenFd, (const struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(m_listenFd, 4) < 0)
+        {
+            std::cerr << "[TCP] Listen failed on port " << port << ": " << strerror(errno) << std::endl;
+            close(m_listenFd);
+            m_listenFd = -1;
+            return false;
+        }
+        fcntl(m_listenFd, F_SETFL, fcntl(m_listenFd, F_GETFL, 0) | O_NONBLOCK);
+
+        m_maxClients = (maxClients > 0) ? maxClients : 1;
+        m_maxBacklogBytes = maxBacklogBytes;
+        m_sendBufferBytes = sendBufferBytes;
+
+        // 積壓 Buffer 一次配置完成，執行中不再向系統要記憶體
+        size_t chunksPerClient = (maxBacklogBytes + TCP_CHUNK_SIZE - 1) / TCP_CHUNK_SIZE + 1;
+        m_chunks.resize(chunksPerClient * m_maxClients);
+        m_freeChunks.clear();
+        for (size_t i = 0; i < m_chunks.size(); i++)
+        {
+            m_chunks[i].data.resize(TCP_CHUNK_SIZE);
+            m_chunks[i].begin = 0;
+            m_chunks[i].end = 0;
+            m_freeChunks.push_back((int)i);
+        }
+
+        std::cout << "[TCP] Listening on port " << port << " (max " << m_maxClients << " clients, backlog "
+                  << maxBacklogBytes / 1024 << " KB/client)" << std::endl;
+        return true;
+    }
+
+    bool TcpSink::SendBatch(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
+    {
+        if (m_clients.empty())
+            return false;
+
+        PacketHeader header = desc;
+        header.version = WIRE_VERSION_2;
+        header.type = PacketType::Data;
+        header.flags = desc.flags & WIRE_FLAG_TIME_CORRECTED;
+        header.fragIndex = 0;
+        header.fragCount = 1;
+        header.fragOffset = 0;
+
+        const uint8_t *payload = reinterpret_cast<const uint8_t *>(rawData);
+        size_t payloadSize = rawCount * sizeof(uint32_t);
+
+        // 壓縮 Payload (與 UdpSender 相同：沒有變小就送 Raw)
+        header.encoding = SampleEncoding::Raw;
+        if (desc.encoding == SampleEncoding::DeltaPack && rawCount >= (size_t)desc.numSamples * desc.numChannels)
+        {
+            size_t capacity = SampleCodec::MaxEncodedSize(desc.numSamples, desc.numChannels);
+            if (m_encodeBuffer.size() < capacity)
+                m_encodeBuffer.resize(capacity);
+
+            size_t encodedSize = SampleCodec::Encode(rawData, desc.numSamples, desc.numChannels,
+                                                     m_encodeBuffer.data(), m_encodeBuffer.size());
+            if (encodedSize > 0 && encodedSize < payloadSize)
+            {
+                payload = m_encodeBuffer.data();
+                payloadSize = encodedSize;
+                header.encoding = SampleEncoding::DeltaPack;
+            }
+        }
+        header.payloadBytes = (uint32_t)payloadSize;
+
+        struct iovec iov[2];
+        iov[0].iov_base = m_headerSlot;
+        iov[0].iov_len = WriteHeader(header, m_headerSlot);
+        iov[1].iov_base = const_cast<uint8_t *>(payload);
+        iov[1].iov_len = payloadSize;
+        size_t total = iov[0].iov_len + iov[1].iov_len;
+
+        bool anyOk = false;
+        for (size_t i = 0; i < m_clients.size();)
+        {
+            bool slow = false;
+            if (!SendToClient(m_clients[i], iov, 2, total, slow))
+            {
+                Disconnect(i, slow ? "backlog full" : "send failed");
+                if (slow)
+                    m_slowDisconnects++;
+                continue;
+            }
+            anyOk = true;
+            i++;
+        }
+        return anyOk;
+    }
+
+    bool TcpSink::SendToClient(Client &client, const struct iovec *iov, int iovCount, size_t total, bool &slow)
+    {
+        // 已有積壓：必須排在後面以維持 Frame 順序
+        if (!client.backlog.empty())
+        {
+            slow = !Enqueue(client, iov, iovCount, 0);
+            return !slow && FlushBacklog(client);
+        }
+
+        // 直接送出 (sendmsg 等同 writev，另加 MSG_NOSIGNAL 避免對端關閉時收到 SIGPIPE)
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = const_cast<struct iovec *>(iov);
+        msg.msg_iovlen = iovCount;
+        ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            n = 0;
+        }
+        m_bytesSent += n;
+
+        if ((size_t)n == total)
+            return true;
+        slow = !Enqueue(client, iov, iovCount, (size_t)n);
+        return !slow;
+    }
+
+    bool TcpSink::Enqueue(Client &client, const struct iovec *iov, int iovCount, size_t skip)
+    {
+        size_t remaining = 0;
+        for (int i = 0; i < iovCount; i++)
+            remaining += iov[i].iov_len;
+        remaining -= skip;
+        if (client.backlogBytes + remaining > m_maxBacklogBytes)
+            return false;
+
+        for (int i = 0; i < iovCount; i++)
+        {
+            const uint8_t *src = static_cast<const uint8_t *>(iov[i].iov_base);
+            size_t length = iov[i].iov_len;
+            if (skip >= length)
+            {
+                skip -= length;
+                continue;
+            }
+            src += skip;
+            length -= skip;
+            skip = 0;
+
+            while (length > 0)
+            {
+                // 填入最後一個 Chunk 的剩餘空間，滿了再向 Pool 要新的
+                if (client.backlog.empty() || m_chunks[client.backlog.back()].end == TCP_CHUNK_SIZE)
+                {
+                    int index = AllocateChunk();
+                    if (index < 0)
+                        return false;
+                    client.backlog.push_back(index);
+                }
+                Chunk &chunk = m_chunks[client.backlog.back()];
+                size_t copy = TCP_CHUNK_SIZE - chunk.end;
+                if (copy > length)
+                    copy = length;
+                memcpy(chunk.data.data() + chunk.end, src, copy);
+                chunk.end += copy;
+                src += copy;
+                length -= copy;
+                client.backlogBytes += copy;
+            }
+        }
+
+        if (client.backlogBytes > m_backlogHighWater)
+            m_backlogHighWater = client.backlogBytes;
+        return true;
+    }
+
+    bool TcpSink::FlushBacklog(Client &client)
+    {
+        while (!client.backlog.empty())
+        {
+            struct iovec iov[TCP_MAX_IOV];
+            int count = 0;
+            size_t requested = 0;
+            for (size_t i = 0; i < client.backlog.size() && count < TCP_MAX_IOV; i++, count++)
+            {
+                Chunk &chunk = m_chunks[client.backlog[i]];
+                iov[count].iov_base = chunk.data.data() + chunk.begin;
+                iov[count].iov_len = chunk.end - chunk.begin;
+                requested += iov[count].iov_len;
+            }
+
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            ssize_t n = sendmsg(client.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            m_bytesSent += n;
+            client.backlogBytes -= n;
+
+            // 歸還已完整送出的 Chunk
+            size_t sent = (size_t)n;
+            while (sent > 0)
+            {
+                Chunk &chunk = m_chunks[client.backlog.front()];
+                size_t available = chunk.end - chunk.begin;
+                if (sent < available)
+                {
+                    chunk.begin += sent;
+                    break;
+                }
+                sent -= available;
+                ReleaseChunk(client.backlog.front());
+                client.backlog.pop_front();
+            }
+
+            if ((size_t)n < requested)
+                break; // Kernel Buffer 已滿，下次 Service() 再送
+        }
+        return true;
+    }
+
+    void TcpSink::Service()
+    {
+        if (m_listenFd < 0)
+            return;
+
+        AcceptClients();
+
+        for (size_t i = 0; i < m_clients.size();)
+        {
+            Client &client = m_clients[i];
+
+            // Archive Client 不會送資料過來；可讀且 recv 回傳 0 表示對端已關閉
+            char probe[64];
+            ssize_t n = recv(client.fd, probe, sizeof(probe), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                Disconnect(i, "closed by peer");
+                continue;
+            }
+
+            if (!FlushBacklog(client))
+            {
+                Disconnect(i, "send failed");
+                continue;
+            }
+            i++;
+        }
+    }
+
+    void TcpSink::AcceptClients()
+    {
+        while (true)
+        {
+            struct sockaddr_in addr;
+            socklen_t addrLen = sizeof(addr);
+            int fd = accept(m_listenFd, (struct sockaddr *)&addr, &addrLen);
+            if (fd < 0)
+                break;
+
+            if ((int)m_clients.size() >= m_maxClients)
+            {
+                std::cerr << "[TCP] Rejected " << inet_ntoa(addr.sin_addr) << ": too many clients" << std::endl;
+                close(fd);
+                continue;
+            }
+
+            // 小 Frame 不等待合併 (降低延遲)，並放大 Kernel 發送 Buffer
+            int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            if (m_sendBufferBytes > 0)
+                setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &m_sendBufferBytes, sizeof(m_sendBufferBytes));
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+            int effective = 0;
+            socklen_t optLen = sizeof(effective);
+            getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &effective, &optLen);
+
+            Client client;
+            client.fd = fd;
+            client.addr = addr;
+            client.backlogBytes = 0;
+            m_clients.push_back(client);
+            std::cout << "[TCP] Client connected: " << inet_ntoa(addr.sin_addr) << ":" << ntohs(addr.sin_port)
+                      << " (SO_SNDBUF " << effective << ")" << std::endl;
+        }
+    }
+
+    void TcpSink::Disconnect(size_t index, const char *reason)
+    {
+        Client &client = m_clients[index];
+        std::cerr << "[TCP] Client " << inet_ntoa(client.addr.sin_addr) << ":" << ntohs(client.addr.sin_port)
+                  << " disconnected: " << reason << std::endl;
+
+        while (!client.backlog.empty())
+        {
+            ReleaseChunk(client.backlog.front());
+            client.backlog.pop_front();
+        }
+        close(client.fd);
+        m_clients.erase(m_clients.begin() + index);
+    }
+
+    int TcpSink::AllocateChunk()
+    {
+        if (m_freeChunks.empty())
+            return -1;
+        int index = m_freeChunks.back();
+        m_freeChunks.pop_back();
+        m_chunks[index].begin = 0;
+        m_chunks[index].end = 0;
+        return index;
+    }
+
+    void TcpSink::ReleaseChunk(int index)
+    {
+        m_freeChunks.push_back(index);
+    }
+
+    void TcpSink::Close()
+    {
+        while (!m_clients.empty())
+            Disconnect(m_clients.size() - 1, "shutdown");
+        if (m_listenFd >= 0)
+        {
+            close(m_listenFd);
+            m_listenFd = -1;
+        }
+    }
+}
@@ -0,0 +1,434 @@
+/**
+ * @file TimeSync.cpp
+ * @brief 時鐘偏差估計實作 (Controller 端回應 / 接收端估計)
+ */
+#include "net/TimeSync.hpp"
+#include "net/WireProtocol.hpp"
+#include "net/ByteOrder.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace Net
+{
+    // 樣本時間跨度不足時只估計 offset (drift 視為 0)
+    static const int64_t TIME_SYNC_MIN_DRIFT_SPAN_NS = 2000000000LL;
+
+    uint64_t RealtimeNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    static int64_t MonotonicUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    static void WriteTimeSync(uint8_t *out, TimeSyncKind kind, uint64_t a, uint64_t b, uint64_t c)
+    {
+        memset(out, 0, TIME_SYNC_PACKET_SIZE);
+        WriteBe16(out, WIRE_MAGIC);
+        out[2] = WIRE_VERSION_2;
+        out[3] = (uint8_t)PacketType::TimeSync;
+        out[4] = (uint8_t)kind;
+        WriteBe64(out + 8, a);
+        WriteBe64(out + 16, b);
+        WriteBe64(out + 24, c);
+    }
+
+    static bool ParseTimeSync(const uint8_t *data, size_t length, TimeSyncKind &kind, uint64_t &a, uint64_t &b, uint64_t &c)
+    {
+        if (length < TIME_SYNC_PACKET_SIZE || ReadBe16(data) != WIRE_MAGIC ||
+            data[2] != WIRE_VERSION_2 || data[3] != (uint8_t)PacketType::TimeSync)
+            return false;
+        kind = (TimeSyncKind)data[4];
+        a = ReadBe64(data + 8);
+        b = ReadBe64(data + 16);
+        c = ReadBe64(data + 24);
+        return true;
+    }
+
+    // 接收一個 Datagram，並取得 Kernel 收到封包的時間 (不受應用程式排程延遲影響)
+    static ssize_t ReceiveTimestamped(int fd, uint8_t *buffer, size_t capacity, int flags,
+                                      struct sockaddr_in &from, uint64_t &rxNs)
+    {
+        struct iovec iov;
+        iov.iov_base = buffer;
+        iov.iov_len = capacity;
+        char control[64];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(fd, &msg, flags);
+        if (n < 0)
+            return n;
+
+        rxNs = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+            {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                rxNs = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+            }
+        }
+        if (rxNs == 0)
+            rxNs = RealtimeNs(); // Kernel 不支援時退回應用程式時間
+        return n;
+    }
+
+    //=========================================================================
+    // TimeSyncServer (Controller)
+    //=========================================================================
+
+    TimeSyncServer::TimeSyncServer()
+        : m_sockfd(-1), m_running(false), m_haveClientIp(false), m_haveProbe(false), m_haveCorrection(false),
+          m_correctionUs(0), m_skewOffsetNs(0), m_skewDriftPpb(0), m_skewRefNs(0), m_requests(0), m_corrections(0),
+          m_rejectedCorrections(0)
+    {
+        memset(&m_clientIp, 0, sizeof(m_clientIp));
+        memset(&m_lastProbe, 0, sizeof(m_lastProbe));
+    }
+
+    TimeSyncServer::~TimeSyncServer() { Stop(); }
+
+    bool TimeSyncServer::Start(int port, const std::string &clientIp)
+    {
+        if (m_running)
+            return false;
+
+        m_haveClientIp = !clientIp.empty();
+        if (m_haveClientIp && inet_aton(clientIp.c_str(), &m_clientIp) == 0)
+        {
+            std::cerr << "[TimeSync] Invalid client IP: " << clientIp << std::endl;
+            return false;
+        }
+        m_haveProbe = false;
+
+        if ((m_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+        {
+            std::cerr << "[TimeSync] Socket creation failed" << std::endl;
+            return false;
+        }
+
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (bind(m_sockfd, (const struct sockaddr *)&local, sizeof(local)) < 0)
+        {
+            std::cerr << "[TimeSync] Bind port " << port << " failed: " << strerror(errno) << std::endl;
+            close(m_sockfd);
+            m_sockfd = -1;
+            return false;
+        }
+
+        int on = 1;
+        setsockopt(m_sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+        struct timeval timeout = {0, 200000}; // 定期醒來檢查停止旗標
+        setsockopt(m_sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        m_running = true;
+        m_thread = std::thread(&TimeSyncServer::Run, this);
+        std::cout << "[TimeSync] Listening on port " << port << " (corrections from "
+                  << (m_haveClientIp ? clientIp : std::string("last requester")) << ")" << std::endl;
+        return true;
+    }
+
+    void TimeSyncServer::Stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+            m_thread.join();
+        if (m_sockfd >= 0)
+        {
+            close(m_sockfd);
+            m_sockfd = -1;
+        }
+    }
+
+    void TimeSyncServer::Run()
+    {
+        uint8_t buffer[256];
+        uint8_t reply[TIME_SYNC_PACKET_SIZE];
+        while (m_running)
+        {
+            struct sockaddr_in from;
+            uint64_t t2 = 0;
+            ssize_t n = ReceiveTimestamped(m_sockfd, buffer, sizeof(buffer), 0, from, t2);
+            if (n < 0)
+                continue; // 逾時或被中斷
+
+            TimeSyncKind kind;
+            uint64_t a, b, c;
+            if (!ParseTimeSync(buffer, (size_t)n, kind, a, b, c))
+                continue;
+
+            if (kind == TimeSyncKind::Request)
+            {
+                m_requests++;
+                m_lastProbe = from;
+                m_haveProbe = true;
+                t2 = ApplySkew(t2);
+                uint64_t t3 = ApplySkew(RealtimeNs());
+                WriteTimeSync(reply, TimeSyncKind::Response, a, t2, t3);
+                sendto(m_sockfd, reply, sizeof(reply), 0, (const struct sockaddr *)&from, sizeof(from));
+            }
+            else if (kind == TimeSyncKind::Correction)
+            {
+                // 可偏移所有 Batch 時間戳：只接受指定接收端 (或最近一次 Request 的來源)
+                if (!CorrectionAllowed(from))
+                {
+                    m_rejectedCorrections++;
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_correction.refNs = a;
+                m_correction.offsetNs = (int64_t)b;
+                m_correction.driftPpb = (int64_t)c;
+                m_haveCorrection = true;
+                m_correctionUs = MonotonicUs();
+                m_corrections++;
+            }
+        }
+    }
+
+    bool TimeSyncServer::CorrectionAllowed(const struct sockaddr_in &from) const
+    {
+        if (m_haveClientIp)
+            return from.sin_addr.s_addr == m_clientIp.s_addr;
+        return m_haveProbe && from.sin_addr.s_addr == m_lastProbe.sin_addr.s_addr &&
+               from.sin_port == m_lastProbe.sin_port;
+    }
+
+    bool TimeSyncServer::Correct(uint64_t controllerNs, uint64_t &correctedNs, long maxAgeMs) const
+    {
+        correctedNs = controllerNs;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_haveCorrection || MonotonicUs() - m_correctionUs > (int64_t)maxAgeMs * 1000)
+            return false;
+
+        double elapsedNs = (double)(int64_t)(controllerNs - m_correction.refNs);
+        int64_t offsetNs = m_correction.offsetNs + (int64_t)(m_correction.driftPpb * elapsedNs / 1e9);
+        correctedNs = controllerNs - (uint64_t)offsetNs;
+        return true;
+    }
+
+    void TimeSyncServer::SetClockSkew(int64_t offsetNs, int64_t driftPpb)
+    {
+        m_skewOffsetNs = offsetNs;
+        m_skewDriftPpb = driftPpb;
+        m_skewRefNs = RealtimeNs();
+    }
+
+    uint64_t TimeSyncServer::ApplySkew(uint64_t realNs) const
+    {
+        if (m_skewOffsetNs == 0 && m_skewDriftPpb == 0)
+            return realNs;
+        double elapsedNs = (double)(int64_t)(realNs - m_skewRefNs);
+        return realNs + (uint64_t)(m_skewOffsetNs + (int64_t)(m_skewDriftPpb * elapsedNs / 1e9));
+    }
+
+    //=========================================================================
+    // ClockSync (接收端)
+    //=========================================================================
+
+    ClockSync::ClockSync(size_t windowSize)
+        : m_windowSize(windowSize < 4 ? 4 : windowSize), m_next(0), m_sockfd(-1),
+          m_intervalMs(1000), m_sendCorrections(false), m_lastRequestUs(0),
+          m_synced(false), m_lastDelayNs(0), m_minDelayNs(0), m_sampleCount(0)
+    {
+        memset(&m_server, 0, sizeof(m_server));
+        m_samples.reserve(m_windowSize);
+        m_selected.reserve(m_windowSize);
+    }
+
+    ClockSync::~ClockSync() { Close(); }
+
+    bool ClockSync::Init(const std::string &controllerIp, int port, long intervalMs, bool sendCorrections)
+    {
+        Close();
+
+        m_server.sin_family = AF_INET;
+        m_server.sin_port = htons(port);
+        if (inet_aton(controllerIp.c_str(), &m_server.sin_addr) == 0)
+        {
+            std::cerr << "[TimeSync] Invalid IP: " << controllerIp << std::endl;
+            return false;
+        }
+
+        if ((m_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+        {
+            std::cerr << "[TimeSync] Socket creation failed" << std::endl;
+            return false;
+        }
+        int on = 1;
+        setsockopt(m_sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+        m_intervalMs = (intervalMs > 0) ? intervalMs : 1000;
+        m_sendCorrections = sendCorrections;
+        m_lastRequestUs = 0;
+        m_samples.clear();
+        m_next = 0;
+        m_synced = false;
+        m_sampleCount = 0;
+        return true;
+    }
+
+    int ClockSync::Poll()
+    {
+        if (m_sockfd < 0)
+            return 0;
+
+        int64_t nowUs = MonotonicUs();
+        if (m_lastRequestUs == 0 || nowUs - m_lastRequestUs >= m_intervalMs * 1000)
+        {
+            uint8_t request[TIME_SYNC_PACKET_SIZE];
+            WriteTimeSync(request, TimeSyncKind::Request, RealtimeNs(), 0, 0);
+            sendto(m_sockfd, request, sizeof(request), 0, (const struct sockaddr *)&m_server, sizeof(m_server));
+            m_lastRequestUs = nowUs;
+        }
+
+        int added = 0;
+        uint8_t buffer[256];
+        while (true)
+        {
+            struct sockaddr_in from;
+            uint64_t t4 = 0;
+            ssize_t n = ReceiveTimestamped(m_sockfd, buffer, sizeof(buffer), MSG_DONTWAIT, from, t4);
+            if (n < 0)
+                break;
+
+            TimeSyncKind kind;
+            uint64_t t1, t2, t3;
+            if (!ParseTimeSync(buffer, (size_t)n, kind, t1, t2, t3) || kind != TimeSyncKind::Response)
+                continue;
+            if (t4 < t1 || (int64_t)(t3 - t2) < 0)
+                continue; // 時鐘被調整或格式錯誤
+            AddSample(t1, t2, t3, t4);
+            added++;
+        }
+
+        if (added > 0)
+        {
+            Estimate();
+            if (m_sendCorrections)
+                SendCorrection();
+        }
+        return added;
+    }
+
+    void ClockSync::AddSample(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+    {
+        Sample sample;
+        sample.localNs = t1 + (t4 - t1) / 2;
+        sample.offsetNs = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+        sample.delayNs = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+        if (sample.delayNs < 0)
+            sample.delayNs = 0;
+
+        if (m_samples.size() < m_windowSize)
+            m_samples.push_back(sample);
+        else
+            m_samples[m_next] = sample;
+        m_next = (m_next + 1) % m_windowSize;
+
+        m_lastDelayNs = sample.delayNs;
+        m_sampleCount++;
+    }
+
+    void ClockSync::Estimate()
+    {
+        // 只取延遲最小的一半 (排隊延遲造成的不對稱最小)
+        m_selected = m_samples;
+        std::sort(m_selected.begin(), m_selected.end(),
+                  [](const Sample &a, const Sample &b) { return a.delayNs < b.delayNs; });
+        size_t count = (m_selected.size() + 1) / 2;
+        m_selected.resize(count);
+        m_minDelayNs = m_selected[0].delayNs;
+
+        // 以最新樣本為原點 (秒)，避免大數相減的精度問題
+        uint64_t refNs = m_selected[0].localNs;
+        uint64_t earliest = refNs;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (m_selected[i].localNs > refNs)
+                refNs = m_selected[i].localNs;
+            if (m_selected[i].localNs < earliest)
+                earliest = m_selected[i].localNs;
+        }
+
+        double sumX = 0.0, sumY = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            sumX += (double)(int64_t)(m_selected[i].localNs - refNs) / 1e9;
+            sumY += (double)m_selected[i].offsetNs;
+        }
+        double meanX = sumX / count;
+        double meanY = sumY / count;
+
+        double slope = 0.0; // ns / s = ppb
+        if (count >= 4 && (int64_t)(refNs - earliest) >= TIME_SYNC_MIN_DRIFT_SPAN_NS)
+        {
+            double sxx = 0.0, sxy = 0.0;
+            for (size_t i = 0; i < count; i++)
+            {
+                double dx = (double)(int64_t)(m_selected[i].localNs - refNs) / 1e9 - meanX;
+                sxx += dx * dx;
+                sxy += dx * ((double)m_selected[i].offsetNs - meanY);
+            }
+            if (sxx > 0.0)
+                slope = sxy / sxx;
+        }
+
+        // 回歸線在 refNs (x = 0) 的 offset；修正值的參考點換成 Controller 時間
+        int64_t offsetNs = (int64_t)(meanY - slope * meanX);
+        m_estimate.offsetNs = offsetNs;
+        m_estimate.driftPpb = (int64_t)slope;
+        m_estimate.refNs = refNs + (uint64_t)offsetNs;
+        m_synced = true;
+    }
+
+    uint64_t ClockSync::ToLocalNs(uint64_t controllerNs) const
+    {
+        if (!m_synced)
+            return controllerNs;
+        double elapsedNs = (double)(int64_t)(controllerNs - m_estimate.refNs);
+        int64_t offsetNs = m_estimate.offsetNs + (int64_t)(m_estimate.driftPpb * elapsedNs / 1e9);
+        return controllerNs - (uint64_t)offsetNs;
+    }
+
+    void ClockSync::SendCorrection()
+    {
+        uint8_t packet[TIME_SYNC_PACKET_SIZE];
+        WriteTimeSync(packet, TimeSyncKind::Correction, m_estimate.refNs,
+                      (uint64_t)m_estimate.offsetNs, (uint64_t)m_estimate.driftPpb);
+        sendto(m_sockfd, packet, sizeof(packet), 0, (const struct sockaddr *)&m_server, sizeof(m_server));
+    }
+
+    void ClockSync::Close()
+    {
+        if (m_sockfd >= 0)
+        {
+            close(m_sockfd);
+            m_sockfd = -1;
+        }
+    }
+}
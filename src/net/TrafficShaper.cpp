@@ -0,0 +1,177 @@
+/**
+ * @file TrafficShaper.cpp
+ * @brief Token Bucket 流量整形實作
+ */
+#include "net/TrafficShaper.hpp"
+#include "net/WireProtocol.hpp"
+#include <time.h>
+#include <cerrno>
+
+namespace Net
+{
+
+    TrafficShaper::TrafficShaper()
+        : m_enabled(false), m_burstBytes(0.0), m_maxDelayUs(0), m_targetBytesPerUs(0.0),
+          m_shapedDatagrams(0), m_shapedDelayUs(0), m_maxShapedDelayUs(0), m_overruns(0)
+    {
+        m_global.bytesPerUs = 0.0;
+        m_global.tokens = 0.0;
+        m_global.lastUs = 0;
+    }
+
+    void TrafficShaper::Configure(double globalBitsPerSec, double targetBitsPerSec, size_t burstBytes, int64_t maxDelayUs)
+    {
+        m_burstBytes = (double)burstBytes;
+        m_maxDelayUs = (maxDelayUs > 0) ? maxDelayUs : 0;
+        m_targetBytesPerUs = (targetBitsPerSec > 0) ? targetBitsPerSec / 8e6 : 0.0;
+        m_enabled = (globalBitsPerSec > 0 || targetBitsPerSec > 0) && burstBytes > 0;
+
+        int64_t nowUs = NowUs();
+        m_global.bytesPerUs = (globalBitsPerSec > 0) ? globalBitsPerSec / 8e6 : 0.0;
+        m_global.tokens = m_burstBytes;
+        m_global.lastUs = nowUs;
+        for (size_t i = 0; i < m_targets.size(); i++)
+        {
+            m_targets[i].bytesPerUs = m_targetBytesPerUs;
+            m_targets[i].tokens = m_burstBytes;
+            m_targets[i].lastUs = nowUs;
+        }
+    }
+
+    void TrafficShaper::SetTargetCount(size_t count)
+    {
+        Bucket bucket;
+        bucket.bytesPerUs = m_targetBytesPerUs;
+        bucket.tokens = m_burstBytes;
+        bucket.lastUs = NowUs();
+        m_targets.resize(count, bucket);
+    }
+
+    bool TrafficShaper::Admit(int target, size_t bytes, int64_t readyUs, bool mayWait)
+    {
+        if (!m_enabled)
+            return true;
+        if (mayWait)
+        {
+            Pace(target, bytes, readyUs);
+            return true;
+        }
+        if (Delay(target, bytes) > 0)
+            return false;
+        Consume(target, bytes);
+        return true;
+    }
+
+    int64_t TrafficShaper::Delay(int target, size_t bytes)
+    {
+        int64_t nowUs = NowUs();
+        size_t wireBytes = bytes + UDP_IP_OVERHEAD;
+        int64_t delay = BucketDelay(m_global, wireBytes, nowUs);
+        if (target >= 0 && (size_t)target < m_targets.size())
+        {
+            int64_t targetDelay = BucketDelay(m_targets[target], wireBytes, nowUs);
+            if (targetDelay > delay)
+                delay = targetDelay;
+        }
+        return delay;
+    }
+
+    int64_t TrafficShaper::Pace(int target, size_t bytes, int64_t readyUs)
+    {
+        int64_t delay = Delay(target, bytes);
+        if (delay > 0)
+        {
+            // 等待後仍在延遲上限內才等，否則直接送出 (延遲上限優先)
+            if (NowUs() + delay - readyUs <= m_maxDelayUs)
+            {
+                struct timespec ts;
+                ts.tv_sec = delay / 1000000;
+                ts.tv_nsec = (delay % 1000000) * 1000;
+                while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+                    ;
+                m_shapedDatagrams++;
+                m_shapedDelayUs += delay;
+                if (delay > m_maxShapedDelayUs)
+                    m_maxShapedDelayUs = delay;
+            }
+            else
+            {
+                m_overruns++;
+                delay = 0;
+            }
+        }
+
+        Consume(target, bytes);
+        return delay;
+    }
+
+    void TrafficShaper::Consume(int target, size_t bytes)
+    {
+        int64_t nowUs = NowUs();
+        size_t wireBytes = bytes + UDP_IP_OVERHEAD;
+        Refill(m_global, nowUs);
+        BucketConsume(m_global, wireBytes);
+        if (target >= 0 && (size_t)target < m_targets.size())
+        {
+            Refill(m_targets[target], nowUs);
+            BucketConsume(m_targets[target], wireBytes);
+        }
+    }
+
+    void TrafficShaper::Refund(int target, size_t bytes)
+    {
+        if (!m_enabled)
+            return;
+        size_t wireBytes = bytes + UDP_IP_OVERHEAD;
+        BucketRefund(m_global, wireBytes);
+        if (target >= 0 && (size_t)target < m_targets.size())
+            BucketRefund(m_targets[target], wireBytes);
+    }
+
+    void TrafficShaper::Refill(Bucket &bucket, int64_t nowUs) const
+    {
+        if (bucket.bytesPerUs <= 0.0)
+            return;
+        bucket.tokens += (nowUs - bucket.lastUs) * bucket.bytesPerUs;
+        if (bucket.tokens > m_burstBytes)
+            bucket.tokens = m_burstBytes;
+        bucket.lastUs = nowUs;
+    }
+
+    int64_t TrafficShaper::BucketDelay(Bucket &bucket, size_t bytes, int64_t nowUs) const
+    {
+        if (bucket.bytesPerUs <= 0.0)
+            return 0;
+        Refill(bucket, nowUs);
+        // 超過 Bucket 容量的 Datagram 只需等到 Bucket 滿
+        double need = ((double)bytes < m_burstBytes) ? (double)bytes : m_burstBytes;
+        if (bucket.tokens >= need)
+            return 0;
+        return (int64_t)((need - bucket.tokens) / bucket.bytesPerUs) + 1;
+    }
+
+    void TrafficShaper::BucketConsume(Bucket &bucket, size_t bytes) const
+    {
+        if (bucket.bytesPerUs <= 0.0)
+            return;
+        bucket.tokens -= (double)bytes;
+        if (bucket.tokens < -m_burstBytes)
+            bucket.tokens = -m_burstBytes; // 欠額上限
+    }
+
+    void TrafficShaper::BucketRefund(Bucket &bucket, size_t bytes) const
+    {
+        if (bucket.bytesPerUs <= 0.0)
+            return;
+        bucket.tokens += (double)bytes;
+        if (bucket.tokens > m_burstBytes)
+            bucket.tokens = m_burstBytes;
+    }
+
+    int64_t TrafficShaper::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+}
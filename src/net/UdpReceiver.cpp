@@ -0,0 +1,426 @@
+/**
+ * @file UdpReceiver.cpp
+ * @brief 接收端函式庫實作
+ */
+#include "net/UdpReceiver.hpp"
+#include "net/ByteOrder.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+namespace Net
+{
+    // 序號往回跳超過此距離視為裝置重新啟動 (v1 的 32 bit 序號回繞亦同)
+    static const uint64_t STREAM_RESTART_DISTANCE = 65536;
+    // 序號追蹤視窗 (Bitmap 寬度)
+    static const uint64_t STREAM_WINDOW = 64;
+    // 每個 Slot 的 Control Buffer (SCM_TIMESTAMPNS)
+    static const size_t RX_CONTROL_SIZE = 64;
+
+    static uint64_t RealtimeNsNow()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    UdpReceiver::UdpReceiver()
+        : m_sockfd(-1), m_head(0), m_count(0), m_ringMode(false), m_running(false),
+          m_datagrams(0), m_bytes(0), m_recvCalls(0), m_malformed(0),
+          m_fecRecovered(0), m_incompleteDropped(0), m_ringDropped(0) {}
+
+    UdpReceiver::~UdpReceiver() { Close(); }
+
+    bool UdpReceiver::Init(int port, const ReceiverOptions &options)
+    {
+        Close();
+        m_options = options;
+        if (m_options.batchSize == 0)
+            m_options.batchSize = 1;
+        if (m_options.maxDatagram < WIRE_V2_HEADER_SIZE)
+            m_options.maxDatagram = WIRE_V2_HEADER_SIZE;
+
+        m_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_sockfd < 0)
+        {
+            std::cerr << "[RX] Error creating socket" << std::endl;
+            return false;
+        }
+
+        int on = 1;
+        setsockopt(m_sockfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(m_sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+        if (m_options.recvBufferBytes > 0)
+        {
+            setsockopt(m_sockfd, SOL_SOCKET, SO_RCVBUF, &m_options.recvBufferBytes, sizeof(m_options.recvBufferBytes));
+            int actual = 0;
+            socklen_t len = sizeof(actual);
+            getsockopt(m_sockfd, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+            // Linux 回報值為設定值的兩倍 (含簿記空間)；不足時多半是 net.core.rmem_max 限制
+            if (actual < m_options.recvBufferBytes)
+                std::cerr << "[RX] SO_RCVBUF limited to " << actual << " bytes (check net.core.rmem_max)" << std::endl;
+        }
+
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (!m_options.bindIp.empty() && inet_aton(m_options.bindIp.c_str(), &local.sin_addr) == 0)
+        {
+            std::cerr << "[RX] Invalid bind IP: " << m_options.bindIp << std::endl;
+            Close();
+            return false;
+        }
+        if (bind(m_sockfd, (const struct sockaddr *)&local, sizeof(local)) < 0)
+        {
+            std::cerr << "[RX] Bind failed on port " << port << ": " << strerror(errno) << std::endl;
+            Close();
+            return false;
+        }
+
+        // recvmmsg Slot：每個 mmsghdr 指向固定的 Buffer 與 Control 區
+        size_t slots = m_options.batchSize;
+        m_buffers.assign(slots * m_options.maxDatagram, 0);
+        m_controls.assign(slots * RX_CONTROL_SIZE, 0);
+        m_iovs.resize(slots);
+        m_msgs.resize(slots);
+        for (size_t i = 0; i < slots; i++)
+        {
+            m_iovs[i].iov_base = m_buffers.data() + i * m_options.maxDatagram;
+            m_iovs[i].iov_len = m_options.maxDatagram;
+            memset(&m_msgs[i], 0, sizeof(m_msgs[i]));
+            m_msgs[i].msg_hdr.msg_iov = &m_iovs[i];
+            m_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        m_reassembler = FragmentReassembler(m_options.maxPending, m_options.reassemblyTimeoutUs, m_options.maxBatchBytes,
+                                            m_options.maxDatagram);
+        m_status.devices.reserve(STATUS_MAX_DEVICES);
+
+        std::cout << "[RX] Listening on " << (m_options.bindIp.empty() ? "0.0.0.0" : m_options.bindIp) << ":" << port
+                  << " (recvmmsg x" << slots << ")" << std::endl;
+        return true;
+    }
+
+    int UdpReceiver::Poll(int timeoutMs)
+    {
+        if (m_sockfd < 0)
+            return -1;
+
+        struct pollfd pfd = {m_sockfd, POLLIN, 0};
+        int ready = poll(&pfd, 1, timeoutMs);
+        if (ready < 0)
+            return (errno == EINTR) ? 0 : -1;
+
+        int delivered = 0;
+        while (ready > 0)
+        {
+            // 每次呼叫前重設 Control 長度 (Kernel 會改寫)
+            for (size_t i = 0; i < m_msgs.size(); i++)
+            {
+                m_msgs[i].msg_hdr.msg_control = m_controls.data() + i * RX_CONTROL_SIZE;
+                m_msgs[i].msg_hdr.msg_controllen = RX_CONTROL_SIZE;
+                m_msgs[i].msg_hdr.msg_flags = 0;
+            }
+
+            int n = recvmmsg(m_sockfd, m_msgs.data(), (unsigned int)m_msgs.size(), MSG_DONTWAIT, NULL);
+            if (n <= 0)
+            {
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    return -1;
+                break;
+            }
+            m_recvCalls++;
+
+            for (int i = 0; i < n; i++)
+            {
+                struct msghdr &hdr = m_msgs[i].msg_hdr;
+                uint64_t arrivalNs = 0;
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+                    {
+                        struct timespec ts;
+                        memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                        arrivalNs = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+                    }
+                }
+                if (arrivalNs == 0)
+                    arrivalNs = RealtimeNsNow();
+
+                if (hdr.msg_flags & MSG_TRUNC)
+                {
+                    m_malformed++; // 超過 Slot 大小
+                    continue;
+                }
+                HandleDatagram((const uint8_t *)m_iovs[i].iov_base, m_msgs[i].msg_len, arrivalNs, delivered);
+            }
+
+            if ((size_t)n < m_msgs.size())
+                break; // Socket 已讀空
+        }
+
+        m_reassembler.Expire();
+        m_incompleteDropped = m_reassembler.GetIncompleteDropped();
+        return delivered;
+    }
+
+    void UdpReceiver::HandleDatagram(const uint8_t *data, size_t length, uint64_t arrivalNs, int &delivered)
+    {
+        m_datagrams++;
+        m_bytes += length;
+
+        PacketHeader header;
+        bool isV2 = length >= 4 && ReadBe16(data) == WIRE_MAGIC && data[2] == WIRE_VERSION_2;
+        if (isV2 && (PacketType)data[3] == PacketType::Status)
+        {
+            if (!ParseStatus(data, length, m_status))
+                m_malformed++;
+            else if (m_statusCallback)
+                m_statusCallback(m_status);
+            return;
+        }
+        if (isV2 && (PacketType)data[3] == PacketType::Parity)
+        {
+            if (m_options.fec)
+                PushFec(data, length, arrivalNs, delivered);
+            return;
+        }
+        if (!ParseHeader(data, length, header) || header.type != PacketType::Data)
+        {
+            m_malformed++; // NACK / TimeSync 不應出現在資料 Port
+            return;
+        }
+
+        HandleData(data, length, arrivalNs, delivered);
+
+        // Data Datagram 也需交給 FecDecoder 保存，之後的 Parity 才能補回同組的遺失成員
+        // (Parity 先到時，補齊所需的最後一個成員也可能在此觸發補回)
+        if (m_options.fec && header.version == WIRE_VERSION_2)
+            PushFec(data, length, arrivalNs, delivered);
+    }
+
+    void UdpReceiver::PushFec(const uint8_t *data, size_t length, uint64_t arrivalNs, int &delivered)
+    {
+        m_fec.Push(data, length, m_recoveredDatagrams);
+        for (size_t i = 0; i < m_recoveredDatagrams.size(); i++)
+        {
+            m_fecRecovered++;
+            HandleData(m_recoveredDatagrams[i].data(), m_recoveredDatagrams[i].size(), arrivalNs, delivered);
+        }
+        m_recoveredDatagrams.clear();
+    }
+
+    void UdpReceiver::HandleData(const uint8_t *data, size_t length, uint64_t arrivalNs, int &delivered)
+    {
+        if (!m_reassembler.Push(data, length, m_batch))
+            return;
+
+        bool decoded = Decode(m_batch, m_decoded.samples);
+        if (!TrackSequence(m_batch.header, arrivalNs, decoded) || !decoded)
+            return;
+
+        m_decoded.header = m_batch.header;
+        m_decoded.arrivalNs = arrivalNs;
+        Deliver();
+        delivered++;
+    }
+
+    bool UdpReceiver::TrackSequence(const PacketHeader &header, uint64_t arrivalNs, bool decoded)
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        StreamState &s = m_streams[header.deviceId];
+        StreamStats &st = s.stats;
+        st.deviceId = header.deviceId;
+        uint64_t seq = header.seqId;
+
+        if (s.started && seq < st.lastSeq && st.lastSeq - seq > STREAM_RESTART_DISTANCE)
+        {
+            st.restarts++;
+            s.started = false; // 重新開始追蹤 (累計值保留)
+        }
+
+        if (!s.started)
+        {
+            s.started = true;
+            s.seen = 1;
+            st.lastSeq = seq;
+        }
+        else if (seq > st.lastSeq)
+        {
+            uint64_t distance = seq - st.lastSeq;
+            st.missing += distance - 1;
+            s.seen = (distance >= STREAM_WINDOW) ? 1 : ((s.seen << distance) | 1);
+            st.lastSeq = seq;
+        }
+        else
+        {
+            uint64_t distance = st.lastSeq - seq;
+            if (distance >= STREAM_WINDOW)
+            {
+                st.tooLate++;
+            }
+            else if (s.seen & (1ULL << distance))
+            {
+                st.duplicates++;
+                return false;
+            }
+            else
+            {
+                s.seen |= (1ULL << distance);
+                if (header.flags & WIRE_FLAG_RETRANSMIT)
+                    st.recovered++;
+                else
+                    st.reordered++;
+            }
+            if (st.missing > 0)
+                st.missing--;
+        }
+
+        if (decoded)
+        {
+            st.batches++;
+            st.samples += header.numSamples;
+        }
+        else
+        {
+            st.decodeErrors++;
+        }
+        st.lastArrivalNs = arrivalNs;
+        return true;
+    }
+
+    bool UdpReceiver::Decode(const ReassembledBatch &batch, std::vector<uint32_t> &samples)
+    {
+        const PacketHeader &h = batch.header;
+        if (h.numChannels == 0)
+            return false;
+
+        // numSamples / numChannels 直接來自封包：先確認長度再配置 (uint64 避免 32 位元溢位)
+        uint64_t count = (uint64_t)h.numSamples * h.numChannels;
+        if (count > m_options.maxBatchBytes / sizeof(uint32_t))
+            return false;
+
+        if (h.encoding == SampleEncoding::Raw)
+        {
+            if (count > batch.payload.size() / sizeof(uint32_t))
+                return false;
+            samples.resize(count);
+            const uint8_t *p = batch.payload.data();
+            for (size_t i = 0; i < count; i++)
+                samples[i] = ReadBe32(p + i * sizeof(uint32_t));
+            return true;
+        }
+        if (h.encoding == SampleEncoding::DeltaPack)
+        {
+            samples.resize(count);
+            return SampleCodec::Decode(batch.payload.data(), batch.payload.size(),
+                                       (int)h.numSamples, (int)h.numChannels, samples.data());
+        }
+        return false;
+    }
+
+    void UdpReceiver::Deliver()
+    {
+        if (!m_ringMode)
+        {
+            if (m_batchCallback)
+                m_batchCallback(m_decoded);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_ringMutex);
+            if (m_count == m_ring.size())
+            {
+                // Ring 已滿：捨棄最舊的一筆 (與發送端佇列相同，保留最新資料)
+                m_head = (m_head + 1) % m_ring.size();
+                m_count--;
+                m_ringDropped++;
+            }
+            DecodedBatch &slot = m_ring[(m_head + m_count) % m_ring.size()];
+            slot.header = m_decoded.header;
+            slot.arrivalNs = m_decoded.arrivalNs;
+            slot.samples.swap(m_decoded.samples);
+            m_count++;
+        }
+        m_ringCond.notify_one();
+    }
+
+    bool UdpReceiver::Start(size_t capacity)
+    {
+        if (m_running || m_sockfd < 0)
+            return false;
+
+        m_ring.assign(capacity > 0 ? capacity : 1, DecodedBatch());
+        m_head = 0;
+        m_count = 0;
+        m_ringMode = true;
+        m_running = true;
+        m_thread = std::thread(&UdpReceiver::Run, this);
+        return true;
+    }
+
+    void UdpReceiver::Stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+            m_thread.join();
+        m_ringCond.notify_all();
+    }
+
+    void UdpReceiver::Run()
+    {
+        while (m_running)
+        {
+            if (Poll(100) < 0)
+            {
+                std::cerr << "[RX] Receive error: " << strerror(errno) << std::endl;
+                break;
+            }
+        }
+    }
+
+    bool UdpReceiver::Pop(DecodedBatch &out, int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(m_ringMutex);
+        if (m_count == 0)
+            m_ringCond.wait_for(lock, std::chrono::milliseconds(timeoutMs));
+        if (m_count == 0)
+            return false;
+
+        DecodedBatch &slot = m_ring[m_head];
+        out.header = slot.header;
+        out.arrivalNs = slot.arrivalNs;
+        out.samples.swap(slot.samples);
+        m_head = (m_head + 1) % m_ring.size();
+        m_count--;
+        return true;
+    }
+
+    std::vector<StreamStats> UdpReceiver::GetStreamStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        std::vector<StreamStats> result;
+        result.reserve(m_streams.size());
+        for (std::map<uint16_t, StreamState>::const_iterator it = m_streams.begin(); it != m_streams.end(); ++it)
+            result.push_back(it->second.stats);
+        return result;
+    }
+
+    void UdpReceiver::Close()
+    {
+        Stop();
+        if (m_sockfd >= 0)
+        {
+            close(m_sockfd);
+            m_sockfd = -1;
+        }
+    }
+}
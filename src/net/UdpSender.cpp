@@ -3,20 +3,35 @@
  * @brief UDP 發送實作
  */
 #include "net/UdpSender.hpp"
+#include "net/ByteOrder.hpp"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <vector>
+#include <sys/socket.h>
+#include <cerrno>
+#include <time.h>
+#include <fcntl.h>
+#include <net/if.h>
 
 namespace Net
 {
 
-    UdpSender::UdpSender() : m_sockfd(-1), m_initialized(false) {}
+    UdpSender::UdpSender()
+        : m_batchMax(1), m_batchDelayUs(0), m_batchCount(0), m_batchFirstUs(0),
+          m_useSendmmsg(true), m_sendErrors(0), m_sentDatagrams(0),
+          m_historyDepth(0), m_nackSockfd(-1), m_retxMaxPerSec(0), m_retxTokens(0.0), m_retxLastUs(0),
+          m_nacksReceived(0), m_retransmitted(0), m_retransmitMisses(0), m_retransmitThrottled(0),
+          m_paritySent(0), m_pacer(NULL), m_readyUs(0),
+          m_maxDatagram(1500 - UDP_IP_OVERHEAD),
+          m_protocolVersion(WIRE_VERSION_2), m_rawByteSwap(false),
+          m_sockfd(-1), m_initialized(false) {}
 
     UdpSender::~UdpSender() { Close(); }
 
-    bool UdpSender::Init(const std::string &targetIp, int port)
+    bool UdpSender::Init(const std::string &targetIp, int port, const SocketOptions &options)
     {
         if (m_initialized)
             Close();
@@ -26,58 +41,779 @@ namespace Net
             std::cerr << "[UDP] Socket creation failed" << std::endl;
             return false;
         }
+        ApplySocketOptions(options);
 
-        memset(&m_servaddr, 0, sizeof(m_servaddr));
-        m_servaddr.sin_family = AF_INET;
-        m_servaddr.sin_port = htons(port);
+        m_targets.clear();
+        m_initialized = true;
+        if (!AddTarget(targetIp, port))
+        {
+            Close();
+            return false;
+        }
+
+        // 預先填好 sendmsg 結構，發送時只需更新 Header 與 Payload 指標
+        memset(m_headerSlot, 0, sizeof(m_headerSlot));
+        memset(&m_msg, 0, sizeof(m_msg));
+        m_iov[0].iov_base = m_headerSlot;
+        m_iov[0].iov_len = 0;
+        m_iov[1].iov_base = NULL;
+        m_iov[1].iov_len = 0;
+        m_msg.msg_namelen = sizeof(struct sockaddr_in);
+        m_msg.msg_iov = m_iov;
+        m_msg.msg_iovlen = 2;
+
+        std::cout << "[UDP] Initialized Target: " << targetIp << ":" << port << std::endl;
+        return true;
+    }
+
+    void UdpSender::ApplySocketOptions(const SocketOptions &options)
+    {
+        if (options.sendBufferBytes > 0 &&
+            setsockopt(m_sockfd, SOL_SOCKET, SO_SNDBUF, &options.sendBufferBytes, sizeof(options.sendBufferBytes)) < 0)
+            std::cerr << "[UDP] SO_SNDBUF failed: " << strerror(errno) << std::endl;
+
+        if (options.dscp >= 0)
+        {
+            int tos = (options.dscp & 0x3F) << 2; // DSCP 佔 TOS 的高 6 bit，低 2 bit 為 ECN
+            if (setsockopt(m_sockfd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0)
+                std::cerr << "[UDP] IP_TOS failed: " << strerror(errno) << std::endl;
+        }
+
+        if (options.priority >= 0 &&
+            setsockopt(m_sockfd, SOL_SOCKET, SO_PRIORITY, &options.priority, sizeof(options.priority)) < 0)
+            std::cerr << "[UDP] SO_PRIORITY failed: " << strerror(errno) << std::endl;
+
+        if (!options.bindDevice.empty() &&
+            setsockopt(m_sockfd, SOL_SOCKET, SO_BINDTODEVICE, options.bindDevice.c_str(), options.bindDevice.size() + 1) < 0)
+            std::cerr << "[UDP] SO_BINDTODEVICE " << options.bindDevice << " failed: " << strerror(errno) << std::endl;
+
+        if (!options.sourceIp.empty())
+        {
+            struct sockaddr_in local;
+            memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            local.sin_port = 0; // 來源 Port 由系統指定
+            if (inet_aton(options.sourceIp.c_str(), &local.sin_addr) == 0 ||
+                bind(m_sockfd, (struct sockaddr *)&local, sizeof(local)) < 0)
+                std::cerr << "[UDP] Bind source IP " << options.sourceIp << " failed: " << strerror(errno) << std::endl;
+        }
+
+        if (options.nonBlocking)
+            fcntl(m_sockfd, F_SETFL, fcntl(m_sockfd, F_GETFL, 0) | O_NONBLOCK);
+
+        // 讀回實際生效值
+        m_socketOptions = SocketOptions();
+        int value = 0;
+        socklen_t optLen = sizeof(value);
+        if (getsockopt(m_sockfd, SOL_SOCKET, SO_SNDBUF, &value, &optLen) == 0)
+            m_socketOptions.sendBufferBytes = value;
+        optLen = sizeof(value);
+        if (getsockopt(m_sockfd, IPPROTO_IP, IP_TOS, &value, &optLen) == 0)
+            m_socketOptions.dscp = (value >> 2) & 0x3F;
+        optLen = sizeof(value);
+        if (getsockopt(m_sockfd, SOL_SOCKET, SO_PRIORITY, &value, &optLen) == 0)
+            m_socketOptions.priority = value;
+
+        char device[IFNAMSIZ + 1];
+        memset(device, 0, sizeof(device));
+        optLen = IFNAMSIZ;
+        if (!options.bindDevice.empty())
+        {
+            // 舊 Kernel 不支援讀回 SO_BINDTODEVICE，此時沿用要求值
+            m_socketOptions.bindDevice = (getsockopt(m_sockfd, SOL_SOCKET, SO_BINDTODEVICE, device, &optLen) == 0)
+                                             ? std::string(device)
+                                             : options.bindDevice;
+        }
+
+        struct sockaddr_in local;
+        socklen_t localLen = sizeof(local);
+        if (getsockname(m_sockfd, (struct sockaddr *)&local, &localLen) == 0 && local.sin_addr.s_addr != INADDR_ANY)
+            m_socketOptions.sourceIp = inet_ntoa(local.sin_addr);
+        m_socketOptions.nonBlocking = (fcntl(m_sockfd, F_GETFL, 0) & O_NONBLOCK) != 0;
+
+        std::cout << "[UDP] Socket: SO_SNDBUF " << m_socketOptions.sendBufferBytes
+                  << ", DSCP " << m_socketOptions.dscp
+                  << ", SO_PRIORITY " << m_socketOptions.priority
+                  << ", Device " << (m_socketOptions.bindDevice.empty() ? "any" : m_socketOptions.bindDevice)
+                  << ", Source " << (m_socketOptions.sourceIp.empty() ? "any" : m_socketOptions.sourceIp)
+                  << (m_socketOptions.nonBlocking ? ", non-blocking" : ", blocking") << std::endl;
+    }
 
-        if (inet_aton(targetIp.c_str(), &m_servaddr.sin_addr) == 0)
+    bool UdpSender::AddTarget(const std::string &targetIp, int port)
+    {
+        if (!m_initialized)
+            return false;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+
+        if (inet_aton(targetIp.c_str(), &addr.sin_addr) == 0)
         {
             std::cerr << "[UDP] Invalid IP: " << targetIp << std::endl;
             return false;
         }
 
-        m_initialized = true;
-        std::cout << "[UDP] Initialized Target: " << targetIp << ":" << port << std::endl;
+        // 目標變更前先送出累積中的封包 (mmsghdr 會重新指向新的目標陣列)
+        Flush();
+        m_targets.push_back(addr);
+        if (m_pacer)
+            m_pacer->SetTargetCount(m_targets.size());
+        RebuildBatchMsgs();
+
+        if (m_targets.size() > 1)
+        {
+            std::cout << "[UDP] Added " << (IN_MULTICAST(ntohl(addr.sin_addr.s_addr)) ? "Multicast" : "Unicast")
+                      << " Target: " << targetIp << ":" << port << std::endl;
+        }
+        return true;
+    }
+
+    bool UdpSender::SetMulticast(int ttl, const std::string &interfaceIp, bool loopback)
+    {
+        if (!m_initialized)
+            return false;
+
+        unsigned char ttlValue = (unsigned char)((ttl < 1) ? 1 : (ttl > 255 ? 255 : ttl));
+        if (setsockopt(m_sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttlValue, sizeof(ttlValue)) < 0)
+        {
+            std::cerr << "[UDP] IP_MULTICAST_TTL failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        unsigned char loopValue = loopback ? 1 : 0;
+        if (setsockopt(m_sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loopValue, sizeof(loopValue)) < 0)
+        {
+            std::cerr << "[UDP] IP_MULTICAST_LOOP failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // 指定送出的網卡 (空字串表示依路由表)
+        if (!interfaceIp.empty())
+        {
+            struct in_addr ifAddr;
+            if (inet_aton(interfaceIp.c_str(), &ifAddr) == 0 ||
+                setsockopt(m_sockfd, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr)) < 0)
+            {
+                std::cerr << "[UDP] IP_MULTICAST_IF failed: " << interfaceIp << std::endl;
+                return false;
+            }
+        }
+
+        std::cout << "[UDP] Multicast TTL: " << (int)ttlValue
+                  << ", Interface: " << (interfaceIp.empty() ? "default" : interfaceIp) << std::endl;
         return true;
     }
 
     void UdpSender::SendRawBatch(uint32_t seqId,
                                  double timestamp,
                                  const std::vector<uint32_t> &rawData,
-                                 uint16_t numSamples,
-                                 uint16_t numChannels)
+                                 uint32_t numSamples,
+                                 uint16_t numChannels,
+                                 SampleEncoding encoding)
+    {
+        SendRawBatch(seqId, timestamp, rawData.data(), rawData.size(), numSamples, numChannels, encoding);
+    }
+
+    bool UdpSender::SendRawBatch(uint32_t seqId,
+                                 double timestamp,
+                                 const uint32_t *rawData,
+                                 size_t rawCount,
+                                 uint32_t numSamples,
+                                 uint16_t numChannels,
+                                 SampleEncoding encoding)
+    {
+        PacketHeader desc;
+        desc.seqId = seqId;
+        desc.timestampNs = (uint64_t)(timestamp * 1e9);
+        desc.numSamples = numSamples;
+        desc.numChannels = numChannels;
+        desc.channelMask = (numChannels >= 32) ? 0xFFFFFFFFu : ((1u << numChannels) - 1u);
+        desc.encoding = encoding;
+        return SendBatch(desc, rawData, rawCount);
+    }
+
+    bool UdpSender::SendBatch(const PacketHeader &desc, const uint32_t *rawData, size_t rawCount)
     {
         if (!m_initialized)
+            return false;
+
+        m_readyUs = NowUs();
+        m_txHeader = desc;
+        m_txHeader.version = m_protocolVersion;
+        m_txHeader.type = PacketType::Data;
+
+        const uint8_t *payload = reinterpret_cast<const uint8_t *>(rawData);
+        size_t payloadSize = rawCount * sizeof(uint32_t);
+        uint32_t numSamples = desc.numSamples;
+        uint16_t numChannels = desc.numChannels;
+
+        // 壓縮 Payload (若壓縮後沒有變小，退回 Raw 以免浪費接收端解碼)
+        m_txHeader.encoding = SampleEncoding::Raw;
+        if (desc.encoding == SampleEncoding::DeltaPack &&
+            rawCount >= (size_t)numSamples * numChannels)
+        {
+            size_t capacity = SampleCodec::MaxEncodedSize(numSamples, numChannels);
+            if (m_encodeBuffer.size() < capacity)
+                m_encodeBuffer.resize(capacity);
+
+            size_t encodedSize = SampleCodec::Encode(rawData, numSamples, numChannels,
+                                                     m_encodeBuffer.data(), m_encodeBuffer.size());
+            if (encodedSize > 0 && encodedSize < payloadSize)
+            {
+                payload = m_encodeBuffer.data();
+                payloadSize = encodedSize;
+                m_txHeader.encoding = SampleEncoding::DeltaPack;
+            }
+        }
+
+        // Raw Payload 在線路上為 Big Endian：只有 Little Endian 主機上的工具會啟用轉換
+        if (m_rawByteSwap && m_txHeader.encoding == SampleEncoding::Raw)
+        {
+            if (m_encodeBuffer.size() < payloadSize)
+                m_encodeBuffer.resize(payloadSize);
+            for (size_t i = 0; i < rawCount; i++)
+                WriteBe32(m_encodeBuffer.data() + i * sizeof(uint32_t), rawData[i]);
+            payload = m_encodeBuffer.data();
+        }
+
+        if (payloadSize > 0xFFFFFFFFu)
+        {
+            std::cerr << "[UDP] Batch too large: " << payloadSize << " bytes" << std::endl;
+            m_sendErrors++;
+            return false;
+        }
+        m_txHeader.payloadBytes = (uint32_t)payloadSize;
+
+        // 啟用 FEC 的串流需預留 Parity Header 空間
+        size_t maxDatagram = m_maxDatagram;
+        FecStream *fec = FindFec(m_txHeader.deviceId);
+        if (fec)
+            maxDatagram -= FecEncoder::Overhead(fec->groupSize);
+
+        // 1. 一個 Datagram 放得下：v1 時與舊版格式完全相同
+        size_t baseHeader = (m_protocolVersion == WIRE_VERSION_1) ? sizeof(UdpHeader) : WIRE_V2_HEADER_SIZE;
+        bool fitsV1 = (m_protocolVersion != WIRE_VERSION_1) || numSamples <= 0xFFFF;
+        if (baseHeader + payloadSize <= maxDatagram && fitsV1)
+        {
+            m_txHeader.fragIndex = 0;
+            m_txHeader.fragCount = 1;
+            m_txHeader.fragOffset = 0;
+            m_iov[0].iov_len = WriteHeader(m_txHeader, m_headerSlot);
+
+            // Payload 直接指向呼叫端 Buffer (sendmsg 只讀取，不修改)
+            m_iov[1].iov_base = const_cast<uint8_t *>(payload);
+            m_iov[1].iov_len = payloadSize;
+            return SendDatagram(m_txHeader.seqId);
+        }
+
+        // 2. 超過 MTU：切成多段，每段皆帶完整 Header (v1 另加分段 Header)
+        size_t fragHeader = (m_protocolVersion == WIRE_VERSION_1) ? sizeof(UdpHeader) + sizeof(UdpFragmentHeader)
+                                                                  : WIRE_V2_HEADER_SIZE;
+        size_t chunk = (maxDatagram - fragHeader) & ~(size_t)3;
+        size_t fragCount = (payloadSize + chunk - 1) / chunk;
+        if (fragCount < 2)
+            fragCount = 2; // 僅因 v1 樣本數超過 16 bit 而分段時，仍以分段格式送出
+        if (fragCount > 0xFFFF)
+        {
+            std::cerr << "[UDP] Batch too large to fragment: " << payloadSize << " bytes" << std::endl;
+            m_sendErrors++;
+            return false;
+        }
+
+        m_txHeader.fragCount = (uint16_t)fragCount;
+
+        bool ok = true;
+        for (size_t i = 0; i < fragCount; i++)
+        {
+            size_t offset = i * chunk;
+            if (offset > payloadSize)
+                offset = payloadSize;
+            size_t length = (payloadSize - offset < chunk) ? payloadSize - offset : chunk;
+
+            m_txHeader.fragIndex = (uint16_t)i;
+            m_txHeader.fragOffset = (uint32_t)offset;
+            m_iov[0].iov_len = WriteHeader(m_txHeader, m_headerSlot);
+
+            m_iov[1].iov_base = const_cast<uint8_t *>(payload + offset);
+            m_iov[1].iov_len = length;
+            ok = SendDatagram(m_txHeader.seqId) && ok;
+        }
+        return ok;
+    }
+
+    void UdpSender::SetMtu(int mtu)
+    {
+        // 至少要能放下兩個 Header 與少量 Payload
+        size_t minDatagram = WIRE_V2_HEADER_SIZE + 64;
+        size_t maxDatagram = (mtu > UDP_IP_OVERHEAD) ? (size_t)(mtu - UDP_IP_OVERHEAD) : 0;
+        if (maxDatagram < minDatagram)
+            maxDatagram = minDatagram;
+        if (maxDatagram > 65507)
+            maxDatagram = 65507; // IPv4 UDP Payload 上限
+        m_maxDatagram = maxDatagram;
+
+        // 歷史環 Slot 大小跟著 MTU 調整
+        if (m_history.Enabled())
+            m_history.Init(m_historyDepth, m_maxDatagram);
+
+        // FEC 群組重新開始 (MTU 太小放不下 Parity Header 的串流停用)
+        for (size_t i = 0; i < m_fecStreams.size();)
+        {
+            FecStream &stream = m_fecStreams[i];
+            size_t overhead = FecEncoder::Overhead(stream.groupSize);
+            if (overhead + WIRE_V2_HEADER_SIZE + 64 > m_maxDatagram ||
+                !stream.encoder.Init(stream.scheme, stream.groupSize, stream.parityCount, m_maxDatagram - overhead))
+            {
+                std::cerr << "[UDP] FEC disabled for device " << stream.deviceId << ": MTU too small" << std::endl;
+                m_fecStreams.erase(m_fecStreams.begin() + i);
+                continue;
+            }
+            i++;
+        }
+    }
+
+    void UdpSender::SetProtocolVersion(int version)
+    {
+        m_protocolVersion = (version == WIRE_VERSION_1) ? WIRE_VERSION_1 : WIRE_VERSION_2;
+        std::cout << "[UDP] Wire Protocol: v" << (int)m_protocolVersion << std::endl;
+    }
+
+    bool UdpSender::SendDatagram(uint64_t seqId)
+    {
+        // 記錄到歷史環 (v2 預先標上重送旗標，重送時可直接送出)
+        SendHistory::Entry *entry = m_history.Record(m_txHeader.deviceId, seqId, m_iov, 2);
+        if (entry && m_protocolVersion == WIRE_VERSION_2)
+            entry->data[WIRE_V2_FLAGS_OFFSET] |= WIRE_FLAG_RETRANSMIT;
+
+        bool ok = TransmitDatagram(seqId);
+
+        // FEC：累積進本組 Parity，滿 K 個即送出
+        FecStream *fec = FindFec(m_txHeader.deviceId);
+        if (fec && fec->encoder.Add(m_txHeader.deviceId, seqId, m_txHeader.fragIndex, m_iov, 2))
+            ok = SendParity(*fec) && ok;
+        return ok;
+    }
+
+    bool UdpSender::TransmitDatagram(uint64_t seqId)
+    {
+        // 非批次模式：直接發送 (Kernel 一次收集 Header + Payload)
+        // 多個目標共用同一份編碼結果，只替換目的地位址
+        if (m_batchMax <= 1)
+        {
+            bool ok = true;
+            for (size_t t = 0; t < m_targets.size(); t++)
+            {
+                size_t bytes = m_iov[0].iov_len + m_iov[1].iov_len;
+                Admit((int)t, bytes, m_readyUs, true);
+                m_msg.msg_name = &m_targets[t];
+                if (sendmsg(m_sockfd, &m_msg, 0) < 0)
+                {
+                    Refund((int)t, bytes);
+                    m_sendErrors++;
+                    ok = false;
+                }
+                else
+                {
+                    m_sentDatagrams++;
+                }
+            }
+            return ok;
+        }
+
+        // 批次模式：複製到 Slot，等待 sendmmsg
+        BatchSlot &slot = m_batchSlots[m_batchCount];
+        size_t total = 0;
+        for (size_t i = 0; i < m_msg.msg_iovlen; i++)
+            total += m_iov[i].iov_len;
+        if (slot.data.size() < total)
+            slot.data.resize(total);
+        size_t pos = 0;
+        for (size_t i = 0; i < m_msg.msg_iovlen; i++)
+        {
+            if (m_iov[i].iov_len == 0)
+                continue;
+            std::memcpy(slot.data.data() + pos, m_iov[i].iov_base, m_iov[i].iov_len);
+            pos += m_iov[i].iov_len;
+        }
+        slot.seqId = seqId;
+        slot.iov.iov_base = slot.data.data();
+        slot.iov.iov_len = total;
+
+        if (m_batchCount == 0)
+            m_batchFirstUs = NowUs();
+        m_batchCount++;
+
+        // 只檢查批次期限 (不走 Poll，避免在 Datagram 發送途中觸發 FEC Parity)
+        if (m_batchCount >= m_batchMax || NowUs() - m_batchFirstUs >= m_batchDelayUs)
+            Flush();
+        return true;
+    }
+
+    void UdpSender::SetBatching(int maxMessages, long maxDelayUs)
+    {
+        Flush();
+        m_batchMax = (maxMessages > 1) ? maxMessages : 1;
+        m_batchDelayUs = (maxDelayUs > 0) ? maxDelayUs : 0;
+        m_batchCount = 0;
+
+        m_batchSlots.assign(m_batchMax, BatchSlot());
+        RebuildBatchMsgs();
+
+        if (m_batchMax > 1)
+            std::cout << "[UDP] Batching: " << m_batchMax << " msgs / " << m_batchDelayUs << " us" << std::endl;
+    }
+
+    void UdpSender::RebuildBatchMsgs()
+    {
+        // 排列方式：Slot 為主、目標為次 (msg[slot * 目標數 + target])
+        // 每個 Slot 的資料只存一份，各目標的 mmsghdr 指向同一個 iovec
+        size_t numTargets = m_targets.size();
+        m_batchMsgs.assign(m_batchSlots.size() * numTargets, mmsghdr());
+        m_flushResults.reserve(m_batchMsgs.size());
+        for (size_t slot = 0; slot < m_batchSlots.size(); slot++)
+        {
+            for (size_t t = 0; t < numTargets; t++)
+            {
+                mmsghdr &msg = m_batchMsgs[slot * numTargets + t];
+                memset(&msg, 0, sizeof(mmsghdr));
+                msg.msg_hdr.msg_name = &m_targets[t];
+                msg.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+                msg.msg_hdr.msg_iov = &m_batchSlots[slot].iov;
+                msg.msg_hdr.msg_iovlen = 1;
+            }
+        }
+    }
+
+    bool UdpSender::EnableFec(uint16_t deviceId, FecScheme scheme, int groupSize, int parityCount, long maxDelayUs)
+    {
+        if (!m_initialized || m_protocolVersion != WIRE_VERSION_2)
+        {
+            std::cerr << "[UDP] FEC requires wire protocol v2" << std::endl;
+            return false;
+        }
+
+        size_t overhead = FecEncoder::Overhead(groupSize);
+        if (overhead + WIRE_V2_HEADER_SIZE + 64 > m_maxDatagram)
+        {
+            std::cerr << "[UDP] FEC group size " << groupSize << " too large for MTU" << std::endl;
+            return false;
+        }
+
+        FecStream stream;
+        stream.deviceId = deviceId;
+        stream.scheme = scheme;
+        stream.groupSize = groupSize;
+        stream.parityCount = (scheme == FecScheme::Xor) ? 1 : parityCount;
+        stream.maxDelayUs = (maxDelayUs > 0) ? maxDelayUs : 0;
+        if (!stream.encoder.Init(scheme, groupSize, stream.parityCount, m_maxDatagram - overhead))
+        {
+            std::cerr << "[UDP] Invalid FEC parameters: K=" << groupSize << ", M=" << parityCount << std::endl;
+            return false;
+        }
+
+        FecStream *existing = FindFec(deviceId);
+        if (existing)
+            *existing = stream;
+        else
+            m_fecStreams.push_back(stream);
+
+        std::cout << "[UDP] FEC device " << deviceId << ": " << (scheme == FecScheme::Xor ? "XOR" : "RS")
+                  << " K=" << groupSize << " M=" << stream.parityCount
+                  << " (+" << (100 * stream.parityCount / groupSize) << "% datagrams)" << std::endl;
+        return true;
+    }
+
+    UdpSender::FecStream *UdpSender::FindFec(uint16_t deviceId)
+    {
+        for (size_t i = 0; i < m_fecStreams.size(); i++)
+        {
+            if (m_fecStreams[i].deviceId == deviceId)
+                return &m_fecStreams[i];
+        }
+        return NULL;
+    }
+
+    bool UdpSender::SendParity(FecStream &stream)
+    {
+        int count = stream.encoder.Finish();
+        bool ok = true;
+        for (int i = 0; i < count; i++)
+        {
+            m_iov[0].iov_base = const_cast<uint8_t *>(stream.encoder.ParityData(i));
+            m_iov[0].iov_len = stream.encoder.ParityLength(i);
+            m_iov[1].iov_len = 0;
+            ok = TransmitDatagram(0) && ok;
+            m_paritySent++;
+        }
+
+        // 還原 Header Slot 指標 (SendBatch 直接序列化到 m_headerSlot)
+        m_iov[0].iov_base = m_headerSlot;
+        return ok;
+    }
+
+    bool UdpSender::EnableRetransmit(size_t historyDepth, int nackPort, int maxPerSec)
+    {
+        if (!m_initialized || historyDepth == 0)
+            return false;
+
+        if ((m_nackSockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+        {
+            std::cerr << "[UDP] NACK socket creation failed" << std::endl;
+            return false;
+        }
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(nackPort);
+        if (bind(m_nackSockfd, (const struct sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            std::cerr << "[UDP] NACK bind failed on port " << nackPort << ": " << strerror(errno) << std::endl;
+            close(m_nackSockfd);
+            m_nackSockfd = -1;
+            return false;
+        }
+        fcntl(m_nackSockfd, F_SETFL, fcntl(m_nackSockfd, F_GETFL, 0) | O_NONBLOCK);
+
+        m_historyDepth = historyDepth;
+        m_history.Init(historyDepth, m_maxDatagram);
+        m_retxFound.reserve(64);
+        m_retxMaxPerSec = (maxPerSec > 0) ? maxPerSec : 1;
+        m_retxTokens = m_retxMaxPerSec;
+        m_retxLastUs = NowUs();
+
+        std::cout << "[UDP] Retransmit: history " << historyDepth << " datagrams, NACK port " << nackPort
+                  << ", max " << m_retxMaxPerSec << "/s" << std::endl;
+        return true;
+    }
+
+    int UdpSender::ServiceNacks()
+    {
+        if (m_nackSockfd < 0)
+            return 0;
+
+        // Token Bucket 補充 (最多累積 1 秒的額度)
+        int64_t nowUs = NowUs();
+        m_retxTokens += (nowUs - m_retxLastUs) * m_retxMaxPerSec / 1e6;
+        if (m_retxTokens > m_retxMaxPerSec)
+            m_retxTokens = m_retxMaxPerSec;
+        m_retxLastUs = nowUs;
+
+        uint64_t before = m_retransmitted;
+        uint8_t buffer[NACK_HEADER_SIZE + NACK_MAX_RANGES * NACK_RANGE_SIZE];
+        NackRange ranges[NACK_MAX_RANGES];
+
+        while (true)
+        {
+            struct sockaddr_in requester;
+            socklen_t addrLen = sizeof(requester);
+            ssize_t n = recvfrom(m_nackSockfd, buffer, sizeof(buffer), 0, (struct sockaddr *)&requester, &addrLen);
+            if (n <= 0)
+                break;
+
+            uint16_t deviceId = 0;
+            size_t rangeCount = ParseNack(buffer, (size_t)n, deviceId, ranges);
+            if (rangeCount == 0)
+                continue;
+            m_nacksReceived++;
+
+            // 一個 NACK 最多處理歷史深度個序號 (更舊的必定已不在歷史環中)，額度用完即停止
+            uint64_t budget = m_historyDepth;
+            for (size_t r = 0; r < rangeCount && budget > 0; r++)
+            {
+                uint64_t count = (ranges[r].count < budget) ? ranges[r].count : budget;
+                uint64_t i = 0;
+                for (; i < count && m_retxTokens >= 1.0; i++)
+                    Retransmit(deviceId, ranges[r].firstSeq + i, requester);
+                budget -= count;
+                if (i < count)
+                {
+                    m_retransmitThrottled += count - i;
+                    break;
+                }
+            }
+        }
+        return (int)(m_retransmitted - before);
+    }
+
+    void UdpSender::Retransmit(uint16_t deviceId, uint64_t seqId, const struct sockaddr_in &requester)
+    {
+        if (m_retxTokens < 1.0)
+        {
+            m_retransmitThrottled++;
             return;
+        }
+        if (m_history.Find(deviceId, seqId, m_retxFound) == 0)
+        {
+            m_retransmitMisses++;
+            return;
+        }
 
-        // 準備 Buffer: Header + Data
-        std::vector<uint8_t> buffer;
-        size_t payloadSize = rawData.size() * sizeof(uint32_t);
-        buffer.resize(sizeof(UdpHeader) + payloadSize);
+        for (size_t i = 0; i < m_retxFound.size(); i++)
+        {
+            if (m_retxTokens < 1.0)
+            {
+                m_retransmitThrottled++;
+                continue;
+            }
+            m_retxTokens -= 1.0;
 
-        // 填寫 Header
-        UdpHeader *header = reinterpret_cast<UdpHeader *>(buffer.data());
-        header->seqId = seqId;
-        header->timestamp = timestamp;
-        header->numSamples = numSamples;
-        header->numChannels = numChannels;
+            const SendHistory::Entry *entry = m_retxFound[i];
+            Admit(-1, entry->length, NowUs(), true);
+            if (sendto(m_sockfd, entry->data.data(), entry->length, 0,
+                       (const struct sockaddr *)&requester, sizeof(requester)) < 0)
+            {
+                Refund(-1, entry->length);
+                m_sendErrors++;
+                continue;
+            }
+            m_retransmitted++;
+            m_sentDatagrams++;
+        }
+    }
 
-        // 填寫 Data (直接記憶體複製)
-        std::memcpy(buffer.data() + sizeof(UdpHeader), rawData.data(), payloadSize);
+    bool UdpSender::SendStatus(const StatusReport &report)
+    {
+        // v1 接收端無法辨識 Status，避免被誤當成資料封包
+        if (!m_initialized || m_protocolVersion != WIRE_VERSION_2)
+            return false;
+
+        m_statusBuffer.resize(STATUS_HEADER_SIZE + STATUS_MAX_DEVICES * STATUS_DEVICE_SIZE);
+        size_t length = WriteStatus(report, m_statusBuffer.data(), m_statusBuffer.size());
 
-        // 發送
-        sendto(m_sockfd, buffer.data(), buffer.size(), 0,
-               (const struct sockaddr *)&m_servaddr, sizeof(m_servaddr));
+        bool ok = true;
+        for (size_t t = 0; t < m_targets.size(); t++)
+        {
+            if (sendto(m_sockfd, m_statusBuffer.data(), length, 0,
+                       (const struct sockaddr *)&m_targets[t], sizeof(m_targets[t])) < 0)
+            {
+                m_sendErrors++;
+                ok = false;
+            }
+            else
+            {
+                m_sentDatagrams++;
+            }
+        }
+        return ok;
+    }
+
+    void UdpSender::Poll()
+    {
+        m_readyUs = NowUs();
+        // FEC 群組未滿但已超過等待上限：以現有成員送出 Parity
+        for (size_t i = 0; i < m_fecStreams.size(); i++)
+        {
+            FecStream &stream = m_fecStreams[i];
+            if (stream.encoder.HasPending() && NowUs() - stream.encoder.PendingSinceUs() >= stream.maxDelayUs)
+                SendParity(stream);
+        }
+
+        if (m_batchCount > 0 && NowUs() - m_batchFirstUs >= m_batchDelayUs)
+            Flush();
+    }
+
+    int UdpSender::Flush()
+    {
+        m_flushResults.clear();
+        if (m_batchCount == 0 || !m_initialized)
+        {
+            m_batchCount = 0;
+            return 0;
+        }
+
+        int numTargets = (int)m_targets.size();
+        int totalMsgs = m_batchCount * numTargets;
+        int sentCount = 0;
+        int offset = 0;
+        int64_t readyUs = NowUs();
+        int admitted = 0; // 自 offset 起已由 Pacer 計入、尚未送出的筆數 (部分送出 / 改用 sendmsg 後沿用，不重複計入)
+        while (offset < totalMsgs)
+        {
+            // 整形：只送出 Pacer 允許的連續幾筆，下一筆需要等待時切開 (第一筆必要時等待，確保每次至少送出一筆)
+            // 逐筆 sendmsg 時一次只計入一筆
+            int limit = m_useSendmmsg ? totalMsgs - offset : 1;
+            while (admitted < limit &&
+                   Admit((offset + admitted) % numTargets, m_batchSlots[(offset + admitted) / numTargets].iov.iov_len,
+                         readyUs, admitted == 0))
+                admitted++;
+            int chunk = std::min(admitted, limit);
+
+            int ret;
+            if (m_useSendmmsg)
+            {
+                ret = sendmmsg(m_sockfd, &m_batchMsgs[offset], chunk, 0);
+                if (ret < 0 && errno == ENOSYS)
+                {
+                    // 舊 Kernel 不支援 sendmmsg，改為逐筆 sendmsg
+                    m_useSendmmsg = false;
+                    continue;
+                }
+            }
+            else
+            {
+                ret = (sendmsg(m_sockfd, &m_batchMsgs[offset].msg_hdr, 0) < 0) ? -1 : 1;
+            }
+
+            if (ret < 0)
+            {
+                // sendmmsg 在第一筆即失敗：記錄該筆錯誤後跳過 (歸還其用量)，繼續送後面的
+                SendResult result = {m_batchSlots[offset / numTargets].seqId, offset % numTargets, errno};
+                m_flushResults.push_back(result);
+                m_sendErrors++;
+                Refund(offset % numTargets, m_batchSlots[offset / numTargets].iov.iov_len);
+                offset++;
+                admitted--;
+                continue;
+            }
+
+            for (int i = 0; i < ret; i++)
+            {
+                int index = offset + i;
+                SendResult result = {m_batchSlots[index / numTargets].seqId, index % numTargets, 0};
+                m_flushResults.push_back(result);
+            }
+            sentCount += ret;
+            m_sentDatagrams += ret;
+            offset += ret;
+            admitted -= ret;
+        }
+
+        m_batchCount = 0;
+        return sentCount;
+    }
+
+    void UdpSender::SetPacer(DatagramPacer *pacer)
+    {
+        Flush();
+        m_pacer = pacer;
+        if (m_pacer)
+            m_pacer->SetTargetCount(m_targets.size());
+    }
+
+    int64_t UdpSender::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
     }
 
     void UdpSender::Close()
     {
+        Flush();
         if (m_sockfd >= 0)
         {
             close(m_sockfd);
             m_sockfd = -1;
         }
+        if (m_nackSockfd >= 0)
+        {
+            close(m_nackSockfd);
+            m_nackSockfd = -1;
+        }
         m_initialized = false;
     }
 }
\ No newline at end of file
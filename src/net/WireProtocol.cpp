@@ -0,0 +1,289 @@
+/**
+ * @file WireProtocol.cpp
+ * @brief 封包 Header 序列化 / 解析
+ */
+#include "net/WireProtocol.hpp"
+#include "net/ByteOrder.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace Net
+{
+
+    size_t WriteHeader(const PacketHeader &header, uint8_t *out)
+    {
+        bool fragmented = header.fragCount > 1;
+
+        if (header.version == WIRE_VERSION_1)
+        {
+            // v1：序號截為 32 bit，時間戳轉回秒
+            uint16_t chField = (header.numChannels & UDP_CHANNEL_COUNT_MASK) |
+                               (uint16_t)((uint16_t)header.encoding << UDP_ENCODING_SHIFT);
+            if (fragmented)
+                chField |= UDP_FLAG_FRAGMENTED;
+
+            WriteBe32(out, (uint32_t)header.seqId);
+            WriteBeDouble(out + 4, header.timestampNs / 1e9);
+            WriteBe16(out + 12, (header.numSamples > 0xFFFF) ? 0xFFFF : (uint16_t)header.numSamples);
+            WriteBe16(out + 14, chField);
+            if (!fragmented)
+                return sizeof(UdpHeader);
+
+            uint8_t *frag = out + sizeof(UdpHeader);
+            WriteBe16(frag, header.fragIndex);
+            WriteBe16(frag + 2, header.fragCount);
+            WriteBe32(frag + 4, header.fragOffset);
+            WriteBe32(frag + 8, header.payloadBytes);
+            WriteBe32(frag + 12, header.numSamples);
+            return sizeof(UdpHeader) + sizeof(UdpFragmentHeader);
+        }
+
+        WriteBe16(out, WIRE_MAGIC);
+        out[2] = WIRE_VERSION_2;
+        out[3] = (uint8_t)header.type;
+        WriteBe16(out + 4, (uint16_t)WIRE_V2_HEADER_SIZE);
+        out[6] = (uint8_t)header.encoding;
+        out[WIRE_V2_FLAGS_OFFSET] = (uint8_t)(header.flags | (fragmented ? WIRE_FLAG_FRAGMENTED : 0));
+        WriteBe16(out + 8, header.deviceId);
+        WriteBe16(out + 10, header.numChannels);
+        WriteBe32(out + 12, header.channelMask);
+        WriteBe64(out + 16, header.seqId);
+        WriteBe64(out + 24, header.firstSampleIndex);
+        WriteBe64(out + 32, header.timestampNs);
+        WriteBeDouble(out + 40, header.sampleRate);
+        WriteBe32(out + 48, header.numSamples);
+        WriteBe16(out + 52, header.fragIndex);
+        WriteBe16(out + 54, header.fragCount);
+        WriteBe32(out + 56, header.fragOffset);
+        WriteBe32(out + 60, header.payloadBytes);
+        return WIRE_V2_HEADER_SIZE;
+    }
+
+    bool ParseHeader(const uint8_t *data, size_t length, PacketHeader &header)
+    {
+        if (length >= WIRE_V2_HEADER_SIZE && ReadBe16(data) == WIRE_MAGIC && data[2] == WIRE_VERSION_2)
+        {
+            size_t headerBytes = ReadBe16(data + 4);
+            if (headerBytes < WIRE_V2_HEADER_SIZE || headerBytes > length)
+                return false;
+
+            header.version = WIRE_VERSION_2;
+            header.type = (PacketType)data[3];
+            header.encoding = (SampleEncoding)data[6];
+            header.flags = data[WIRE_V2_FLAGS_OFFSET];
+            header.deviceId = ReadBe16(data + 8);
+            header.numChannels = ReadBe16(data + 10);
+            header.channelMask = ReadBe32(data + 12);
+            header.seqId = ReadBe64(data + 16);
+            header.firstSampleIndex = ReadBe64(data + 24);
+            header.timestampNs = ReadBe64(data + 32);
+            header.sampleRate = ReadBeDouble(data + 40);
+            header.numSamples = ReadBe32(data + 48);
+            header.fragIndex = ReadBe16(data + 52);
+            header.fragCount = ReadBe16(data + 54);
+            header.fragOffset = ReadBe32(data + 56);
+            header.payloadBytes = ReadBe32(data + 60);
+            header.headerBytes = headerBytes;
+        }
+        else
+        {
+            if (length < sizeof(UdpHeader))
+                return false;
+
+            uint16_t chField = ReadBe16(data + 14);
+            header.version = WIRE_VERSION_1;
+            header.type = PacketType::Data;
+            header.encoding = (SampleEncoding)((chField & UDP_ENCODING_MASK) >> UDP_ENCODING_SHIFT);
+            header.flags = 0;
+            header.deviceId = 0;
+            header.numChannels = chField & UDP_CHANNEL_COUNT_MASK;
+            header.channelMask = 0;
+            header.seqId = ReadBe32(data);
+            header.firstSampleIndex = 0;
+            header.timestampNs = (uint64_t)(ReadBeDouble(data + 4) * 1e9);
+            header.sampleRate = 0.0;
+            header.numSamples = ReadBe16(data + 12);
+            header.fragIndex = 0;
+            header.fragCount = 1;
+            header.fragOffset = 0;
+            header.headerBytes = sizeof(UdpHeader);
+
+            if (chField & UDP_FLAG_FRAGMENTED)
+            {
+                if (length < sizeof(UdpHeader) + sizeof(UdpFragmentHeader))
+                    return false;
+                const uint8_t *frag = data + sizeof(UdpHeader);
+                header.flags = WIRE_FLAG_FRAGMENTED;
+                header.fragIndex = ReadBe16(frag);
+                header.fragCount = ReadBe16(frag + 2);
+                header.fragOffset = ReadBe32(frag + 4);
+                header.payloadBytes = ReadBe32(frag + 8);
+                header.numSamples = ReadBe32(frag + 12);
+                header.headerBytes += sizeof(UdpFragmentHeader);
+            }
+            else
+            {
+                header.payloadBytes = (uint32_t)(length - sizeof(UdpHeader));
+            }
+        }
+
+        if (header.fragCount == 0 || header.fragIndex >= header.fragCount)
+            return false;
+        if ((uint64_t)header.fragOffset + (length - header.headerBytes) > header.payloadBytes)
+            return false;
+        return true;
+    }
+
+    size_t WriteNack(uint16_t deviceId, const NackRange *ranges, size_t rangeCount, uint8_t *out, size_t capacity)
+    {
+        if (rangeCount > NACK_MAX_RANGES)
+            rangeCount = NACK_MAX_RANGES;
+        if (capacity < NACK_HEADER_SIZE)
+            return 0;
+        if (capacity < NACK_HEADER_SIZE + rangeCount * NACK_RANGE_SIZE)
+            rangeCount = (capacity - NACK_HEADER_SIZE) / NACK_RANGE_SIZE;
+
+        WriteBe16(out, WIRE_MAGIC);
+        out[2] = WIRE_VERSION_2;
+        out[3] = (uint8_t)PacketType::Nack;
+        WriteBe16(out + 4, deviceId);
+        WriteBe16(out + 6, (uint16_t)rangeCount);
+
+        uint8_t *p = out + NACK_HEADER_SIZE;
+        for (size_t i = 0; i < rangeCount; i++, p += NACK_RANGE_SIZE)
+        {
+            WriteBe64(p, ranges[i].firstSeq);
+            WriteBe16(p + 8, ranges[i].count);
+        }
+        return NACK_HEADER_SIZE + rangeCount * NACK_RANGE_SIZE;
+    }
+
+    size_t ParseNack(const uint8_t *data, size_t length, uint16_t &deviceId, NackRange *ranges)
+    {
+        if (length < NACK_HEADER_SIZE || ReadBe16(data) != WIRE_MAGIC ||
+            data[2] != WIRE_VERSION_2 || data[3] != (uint8_t)PacketType::Nack)
+            return 0;
+
+        size_t rangeCount = ReadBe16(data + 6);
+        if (rangeCount > NACK_MAX_RANGES || length < NACK_HEADER_SIZE + rangeCount * NACK_RANGE_SIZE)
+            return 0;
+
+        deviceId = ReadBe16(data + 4);
+        const uint8_t *p = data + NACK_HEADER_SIZE;
+        for (size_t i = 0; i < rangeCount; i++, p += NACK_RANGE_SIZE)
+        {
+            ranges[i].firstSeq = ReadBe64(p);
+            ranges[i].count = ReadBe16(p + 8);
+        }
+        return rangeCount;
+    }
+
+    // 超過欄位寬度時以最大值表示
+    static uint16_t Saturate16(uint64_t value) { return (value > 0xFFFFu) ? 0xFFFFu : (uint16_t)value; }
+
+    size_t WriteStatus(const StatusReport &report, uint8_t *out, size_t capacity)
+    {
+        if (capacity < STATUS_HEADER_SIZE)
+            return 0;
+        size_t deviceCount = report.devices.size();
+        if (deviceCount > STATUS_MAX_DEVICES)
+            deviceCount = STATUS_MAX_DEVICES;
+        if (capacity < STATUS_HEADER_SIZE + deviceCount * STATUS_DEVICE_SIZE)
+            deviceCount = (capacity - STATUS_HEADER_SIZE) / STATUS_DEVICE_SIZE;
+
+        memset(out, 0, STATUS_HEADER_SIZE);
+        WriteBe16(out, WIRE_MAGIC);
+        out[2] = WIRE_VERSION_2;
+        out[3] = (uint8_t)PacketType::Status;
+        WriteBe16(out + 4, (uint16_t)STATUS_HEADER_SIZE);
+        out[6] = (uint8_t)deviceCount;
+        WriteBe64(out + 8, report.uptimeMs);
+        WriteBe32(out + 16, report.statusSeq);
+        WriteBe32(out + 20, report.sendErrors);
+        WriteBe32(out + 24, report.sendQueueDepth);
+        WriteBe32(out + 28, report.sendQueueHighWater);
+        WriteBe32(out + 32, report.sendDropped);
+        WriteBe32(out + 36, report.sendAvgServiceUs);
+        WriteBe32(out + 40, report.sendMaxServiceUs);
+
+        uint8_t *p = out + STATUS_HEADER_SIZE;
+        for (size_t i = 0; i < deviceCount; i++, p += STATUS_DEVICE_SIZE)
+        {
+            const DeviceStatus &dev = report.devices[i];
+            WriteBe16(p, dev.deviceId);
+            WriteBe16(p + 2, Saturate16(dev.queueDepth));
+            WriteBe16(p + 4, Saturate16(dev.queueHighWater));
+            WriteBe16(p + 6, 0);
+            WriteBe64(p + 8, dev.samples);
+            WriteBe32(p + 16, dev.readErrors);
+            WriteBe32(p + 20, dev.queueDropped);
+            WriteBe32(p + 24, dev.jitterAvgUs);
+            WriteBe32(p + 28, dev.jitterMaxUs);
+            WriteBe32(p + 32, dev.loopAvgUs);
+            WriteBe32(p + 36, dev.loopMaxUs);
+        }
+        return STATUS_HEADER_SIZE + deviceCount * STATUS_DEVICE_SIZE;
+    }
+
+    bool ParseStatus(const uint8_t *data, size_t length, StatusReport &report)
+    {
+        if (length < STATUS_HEADER_SIZE || ReadBe16(data) != WIRE_MAGIC ||
+            data[2] != WIRE_VERSION_2 || data[3] != (uint8_t)PacketType::Status)
+            return false;
+
+        size_t headerBytes = ReadBe16(data + 4);
+        size_t deviceCount = data[6];
+        if (headerBytes < STATUS_HEADER_SIZE || length < headerBytes + deviceCount * STATUS_DEVICE_SIZE)
+            return false;
+
+        report.uptimeMs = ReadBe64(data + 8);
+        report.statusSeq = ReadBe32(data + 16);
+        report.sendErrors = ReadBe32(data + 20);
+        report.sendQueueDepth = ReadBe32(data + 24);
+        report.sendQueueHighWater = ReadBe32(data + 28);
+        report.sendDropped = ReadBe32(data + 32);
+        report.sendAvgServiceUs = ReadBe32(data + 36);
+        report.sendMaxServiceUs = ReadBe32(data + 40);
+
+        report.devices.resize(deviceCount);
+        const uint8_t *p = data + headerBytes;
+        for (size_t i = 0; i < deviceCount; i++, p += STATUS_DEVICE_SIZE)
+        {
+            DeviceStatus &dev = report.devices[i];
+            dev.deviceId = ReadBe16(p);
+            dev.queueDepth = ReadBe16(p + 2);
+            dev.queueHighWater = ReadBe16(p + 4);
+            dev.samples = ReadBe64(p + 8);
+            dev.readErrors = ReadBe32(p + 16);
+            dev.queueDropped = ReadBe32(p + 20);
+            dev.jitterAvgUs = ReadBe32(p + 24);
+            dev.jitterMaxUs = ReadBe32(p + 28);
+            dev.loopAvgUs = ReadBe32(p + 32);
+            dev.loopMaxUs = ReadBe32(p + 36);
+        }
+        return true;
+    }
+
+    uint32_t ChannelMaskFromRange(const std::string &range)
+    {
+        // 格式: "ai<first>" 或 "ai<first>:<last>"
+        size_t pos = 0;
+        while (pos < range.size() && (range[pos] < '0' || range[pos] > '9'))
+            pos++;
+        if (pos >= range.size())
+            return 0;
+
+        char *end = NULL;
+        long first = strtol(range.c_str() + pos, &end, 10);
+        long last = first;
+        if (*end == ':')
+            last = strtol(end + 1, NULL, 10);
+        if (first < 0 || last < first || last > 31)
+            return 0;
+
+        uint32_t mask = 0;
+        for (long ch = first; ch <= last; ch++)
+            mask |= 1u << ch;
+        return mask;
+    }
+}
@@ -4,47 +4,632 @@
 #include "utils/ConfigLoader.hpp"
 #include "nlohmann/json.hpp" // 請確保此檔案已存在
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
 #include <iostream>
+#include <type_traits>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 // 為了方便使用 JSON 物件
 using json = nlohmann::json;
 
 namespace Utils
 {
+    // ============================================================
+    // 二進位快取 (<設定檔>.cache)
+    //   ConfigCacheHeader + SystemConfig 序列化內容 (Host Order，只供同一台機器 / 同一版程式使用)
+    //   JSON 內容的 Hash 與長度相符、且程式的 SystemConfig 結構未改變時直接載入，不經 JSON 解析
+    // ============================================================
+    static const char CONFIG_CACHE_MAGIC[8] = {'U', 'E', 'I', 'C', 'F', 'G', '0', '1'};
+    static const uint32_t CONFIG_CACHE_ENDIAN_TAG = 0x01020304;
+    // SystemConfig 或下方 Visit() 的欄位變更時遞增 (結構大小改變時也會自動失效)
+    static const uint32_t CONFIG_CACHE_VERSION = 5;
 
-    SystemConfig ConfigLoader::load(const std::string &filePath)
+    struct ConfigCacheHeader
     {
-        std::ifstream file(filePath);
-        if (!file.is_open())
+        char magic[8];
+        uint32_t endianTag;
+        uint32_t version;
+        uint32_t layoutTag; // 編譯時的結構大小，程式更新後舊快取自動失效
+        uint32_t reserved;
+        uint64_t jsonBytes;
+        uint64_t jsonHash;
+        uint64_t payloadBytes;
+        uint64_t payloadHash; // 快取本身的完整性 (寫到一半斷電等)
+    };
+
+    static uint32_t LayoutTag()
+    {
+        return (uint32_t)(sizeof(SystemConfig) * 31 * 31 + sizeof(TaskConfig) * 31 + sizeof(ChannelConfig)) ^
+               (uint32_t)(sizeof(long) << 24);
+    }
+
+    // FNV-1a 64 bit
+    static uint64_t HashBytes(const char *data, size_t length)
+    {
+        uint64_t hash = 1469598103934665603ULL;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= (uint8_t)data[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    class CacheWriter
+    {
+    public:
+        template <typename T>
+        typename std::enable_if<std::is_arithmetic<T>::value>::type Field(const T &v)
+        {
+            m_out.append((const char *)&v, sizeof(v));
+        }
+        void Field(const std::string &v)
+        {
+            Field((uint32_t)v.size());
+            m_out.append(v);
+        }
+        bool Count(uint32_t &n)
+        {
+            Field(n);
+            return true;
+        }
+        const std::string &Data() const { return m_out; }
+
+    private:
+        std::string m_out;
+    };
+
+    class CacheReader
+    {
+    public:
+        CacheReader(const char *data, size_t length) : m_p(data), m_end(data + length), m_ok(true) {}
+
+        template <typename T>
+        typename std::enable_if<std::is_arithmetic<T>::value>::type Field(T &v)
+        {
+            if (!Take(sizeof(v)))
+                return;
+            memcpy(&v, m_p - sizeof(v), sizeof(v));
+        }
+        void Field(std::string &v)
         {
-            // 嘗試從上層目錄尋找 (相容 build 資料夾執行情況)
-            file.open("../" + filePath);
-            if (!file.is_open())
+            uint32_t n = 0;
+            Field(n);
+            if (Take(n))
+                v.assign(m_p - n, n);
+        }
+        // 陣列長度 (超過剩餘資料即視為損壞)
+        bool Count(uint32_t &n)
+        {
+            Field(n);
+            if (n > (size_t)(m_end - m_p))
+                m_ok = false;
+            return m_ok;
+        }
+        bool Ok() const { return m_ok && m_p == m_end; }
+
+    private:
+        bool Take(size_t n)
+        {
+            if (!m_ok || n > (size_t)(m_end - m_p))
             {
-                throw std::runtime_error("[Config] Cannot open config file: " + filePath);
+                m_ok = false;
+                return false;
             }
+            m_p += n;
+            return true;
+        }
+
+        const char *m_p;
+        const char *m_end;
+        bool m_ok;
+    };
+
+    // 同一份欄位清單供寫入與讀取使用 (CacheWriter / CacheReader)
+    template <typename Archive, typename T>
+    static void VisitVector(Archive &ar, std::vector<T> &items)
+    {
+        uint32_t n = (uint32_t)items.size();
+        if (!ar.Count(n))
+            return;
+        items.resize(n);
+        for (auto &item : items)
+            Visit(ar, item);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, HardwareConfig &c)
+    {
+        ar.Field(c.excitationA);
+        ar.Field(c.excitationB);
+        ar.Field(c.coupling);
+        ar.Field(c.iepeCurrent);
+        ar.Field(c.gain);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, ChannelConfig &c)
+    {
+        ar.Field(c.deviceName);
+        ar.Field(c.channelRange);
+        ar.Field(c.modelInfo);
+        ar.Field(c.active);
+        Visit(ar, c.hwConfig);
+        ar.Field(c.avgConfig.active);
+        ar.Field(c.avgConfig.windowSize);
+        ar.Field(c.fftConfig.active);
+        ar.Field(c.fftConfig.windowType);
+        ar.Field(c.fftConfig.points);
+        ar.Field(c.fftConfig.overlapPercent);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, TaskConfig &c)
+    {
+        ar.Field(c.taskName);
+        ar.Field(c.deviceId);
+        ar.Field(c.active);
+        ar.Field(c.sampleRate);
+        ar.Field(c.encoding);
+        ar.Field(c.fec.active);
+        ar.Field(c.fec.scheme);
+        ar.Field(c.fec.groupSize);
+        ar.Field(c.fec.parityCount);
+        ar.Field(c.fec.maxDelayUs);
+        VisitVector(ar, c.channels);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, UdpTargetConfig &c)
+    {
+        ar.Field(c.ip);
+        ar.Field(c.port);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, MulticastConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.group);
+        ar.Field(c.port);
+        ar.Field(c.ttl);
+        ar.Field(c.interfaceIp);
+        ar.Field(c.loopback);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, RetransmitConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.historyDepth);
+        ar.Field(c.nackPort);
+        ar.Field(c.maxPerSec);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, TcpSinkConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.port);
+        ar.Field(c.maxClients);
+        ar.Field(c.maxBacklogBytes);
+        ar.Field(c.sendBufferBytes);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, ShapingConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.globalMbps);
+        ar.Field(c.targetMbps);
+        ar.Field(c.burstBytes);
+        ar.Field(c.maxDelayUs);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, UdpSocketConfig &c)
+    {
+        ar.Field(c.sendBufferBytes);
+        ar.Field(c.dscp);
+        ar.Field(c.priority);
+        ar.Field(c.bindDevice);
+        ar.Field(c.sourceIp);
+        ar.Field(c.nonBlocking);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, ShmRingConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.name);
+        ar.Field(c.capacityBytes);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, LocalRecorderConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.directory);
+        ar.Field(c.fileCount);
+        ar.Field(c.fileBytes);
+        ar.Field(c.blockBytes);
+        ar.Field(c.syncIntervalMs);
+        ar.Field(c.queueDepth);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, EventRecorderConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.preMs);
+        ar.Field(c.postMs);
+        ar.Field(c.directory);
+        ar.Field(c.targetIp);
+        ar.Field(c.targetPort);
+        ar.Field(c.commandPort);
+        ar.Field(c.triggerChannel);
+        ar.Field(c.triggerLevel);
+        ar.Field(c.triggerEdge);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, StatusConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.intervalMs);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, TimeSyncConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.port);
+        ar.Field(c.applyCorrections);
+        ar.Field(c.maxCorrectionAgeMs);
+        ar.Field(c.clientIp);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, HotReloadConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.settleMs);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, ResourceBudgetConfig &c)
+    {
+        ar.Field(c.active);
+        ar.Field(c.enforce);
+        ar.Field(c.linkMbps);
+        ar.Field(c.maxCpuPercent);
+        ar.Field(c.maxMemoryMb);
+        ar.Field(c.readUsPerFrame);
+        ar.Field(c.encodeMbPerSec);
+        ar.Field(c.compressionRatio);
+        ar.Field(c.fecXorMbPerSec);
+        ar.Field(c.fecRsMbPerSec);
+        ar.Field(c.sendUsPerDatagram);
+        ar.Field(c.avgNsPerSample);
+        ar.Field(c.fftNsPerButterfly);
+    }
+
+    template <typename Archive>
+    static void Visit(Archive &ar, SystemConfig &c)
+    {
+        ar.Field(c.systemName);
+        ar.Field(c.udpIp);
+        ar.Field(c.udpPort);
+        VisitVector(ar, c.udpExtraTargets);
+        Visit(ar, c.multicast);
+        Visit(ar, c.retransmit);
+        Visit(ar, c.tcpSink);
+        Visit(ar, c.shaping);
+        Visit(ar, c.udpSocket);
+        Visit(ar, c.shmRing);
+        Visit(ar, c.localRecorder);
+        Visit(ar, c.eventRecorder);
+        Visit(ar, c.status);
+        Visit(ar, c.timeSync);
+        Visit(ar, c.hotReload);
+        Visit(ar, c.resourceBudget);
+        ar.Field(c.protocolVersion);
+        ar.Field(c.udpMtu);
+        ar.Field(c.udpBatchMaxMessages);
+        ar.Field(c.udpBatchMaxDelayUs);
+        ar.Field(c.sendQueueDepth);
+        VisitVector(ar, c.taskConfigs);
+    }
+
+    // 以序列化內容比較兩份設定的某個部分 (欄位清單與快取相同，不必另外維護比較函式)
+    template <typename T>
+    static bool SameFields(const T &a, const T &b)
+    {
+        T copyA = a, copyB = b;
+        CacheWriter wa, wb;
+        Visit(wa, copyA);
+        Visit(wb, copyB);
+        return wa.Data() == wb.Data();
+    }
+
+    // 一次 read() 讀入快取並驗證；任何不符皆回傳 false (改為解析 JSON)
+    static bool LoadCache(const std::string &cachePath, const std::string &jsonText, SystemConfig &config)
+    {
+        int fd = open(cachePath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        std::string data;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ConfigCacheHeader))
+        {
+            data.resize((size_t)st.st_size);
+            if (read(fd, &data[0], data.size()) != (ssize_t)data.size())
+                data.clear();
+        }
+        close(fd);
+        if (data.size() < sizeof(ConfigCacheHeader))
+            return false;
+
+        ConfigCacheHeader h;
+        memcpy(&h, data.data(), sizeof(h));
+        const char *payload = data.data() + sizeof(h);
+        if (memcmp(h.magic, CONFIG_CACHE_MAGIC, sizeof(h.magic)) != 0 || h.endianTag != CONFIG_CACHE_ENDIAN_TAG ||
+            h.version != CONFIG_CACHE_VERSION || h.layoutTag != LayoutTag() || h.jsonBytes != jsonText.size() ||
+            h.jsonHash != HashBytes(jsonText.data(), jsonText.size()) || h.payloadBytes != data.size() - sizeof(h) ||
+            h.payloadHash != HashBytes(payload, (size_t)h.payloadBytes))
+            return false;
+
+        CacheReader reader(payload, (size_t)h.payloadBytes);
+        SystemConfig loaded;
+        Visit(reader, loaded);
+        if (!reader.Ok())
+            return false;
+        config = std::move(loaded);
+        return true;
+    }
+
+    // 寫入暫存檔後 rename，避免斷電留下半個快取；唯讀檔案系統上失敗只提示
+    static void SaveCache(const std::string &cachePath, const std::string &jsonText, SystemConfig &config)
+    {
+        CacheWriter writer;
+        Visit(writer, config);
+        const std::string &payload = writer.Data();
+
+        ConfigCacheHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, CONFIG_CACHE_MAGIC, sizeof(h.magic));
+        h.endianTag = CONFIG_CACHE_ENDIAN_TAG;
+        h.version = CONFIG_CACHE_VERSION;
+        h.layoutTag = LayoutTag();
+        h.jsonBytes = jsonText.size();
+        h.jsonHash = HashBytes(jsonText.data(), jsonText.size());
+        h.payloadBytes = payload.size();
+        h.payloadHash = HashBytes(payload.data(), payload.size());
+
+        std::string data((const char *)&h, sizeof(h));
+        data += payload;
+        std::string tmpPath = cachePath + ".tmp";
+        int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok = (fd >= 0 && write(fd, data.data(), data.size()) == (ssize_t)data.size() && fsync(fd) == 0);
+        if (fd >= 0)
+            close(fd);
+        if (ok)
+            ok = (rename(tmpPath.c_str(), cachePath.c_str()) == 0);
+        else
+            unlink(tmpPath.c_str());
+        if (!ok)
+            std::cerr << "[Config] Cannot write cache " << cachePath << ": " << strerror(errno) << std::endl;
+    }
+
+    std::string ConfigLoader::resolve(const std::string &filePath)
+    {
+        struct stat st;
+        if (stat(filePath.c_str(), &st) != 0 && stat(("../" + filePath).c_str(), &st) == 0)
+            return "../" + filePath; // 嘗試從上層目錄尋找 (相容 build 資料夾執行情況)
+        return filePath;
+    }
+
+    SystemConfig ConfigLoader::load(const std::string &filePath)
+    {
+        const std::string path = resolve(filePath);
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("[Config] Cannot open config file: " + filePath);
         }
+        std::stringstream text;
+        text << file.rdbuf();
+        const std::string jsonText = text.str();
 
+        SystemConfig sysConfig;
+        const std::string cachePath = path + ".cache";
+        bool cached = LoadCache(cachePath, jsonText, sysConfig);
+        if (!cached)
+        {
+            sysConfig = parse(jsonText);
+            SaveCache(cachePath, jsonText, sysConfig);
+        }
+
+        std::cout << "[Config] Successfully loaded: " << sysConfig.systemName << " ("
+                  << sysConfig.taskConfigs.size() << " active tasks" << (cached ? ", from cache" : "") << ")"
+                  << std::endl;
+        return sysConfig;
+    }
+
+    SystemConfig ConfigLoader::parse(const std::string &jsonText)
+    {
         try
         {
-            json j;
-            file >> j;
+            const json j = json::parse(jsonText);
 
             SystemConfig sysConfig;
             sysConfig.systemName = j.value("system_name", "DefaultSystem");
             sysConfig.udpIp = j.value("udp_target_ip", "127.0.0.1");
             sysConfig.udpPort = j.value("udp_target_port", 5005);
+            if (j.contains("udp_extra_targets"))
+            {
+                for (const auto &targetJson : j["udp_extra_targets"])
+                {
+                    UdpTargetConfig target;
+                    target.ip = targetJson.value("ip", "");
+                    target.port = targetJson.value("port", sysConfig.udpPort);
+                    sysConfig.udpExtraTargets.push_back(target);
+                }
+            }
+            if (j.contains("udp_multicast"))
+            {
+                const auto &mcJson = j["udp_multicast"];
+                sysConfig.multicast.active = mcJson.value("active", false);
+                sysConfig.multicast.group = mcJson.value("group", "239.192.0.10");
+                sysConfig.multicast.port = mcJson.value("port", sysConfig.udpPort);
+                sysConfig.multicast.ttl = mcJson.value("ttl", 1);
+                sysConfig.multicast.interfaceIp = mcJson.value("interface", "");
+                sysConfig.multicast.loopback = mcJson.value("loopback", false);
+            }
+            if (j.contains("retransmit"))
+            {
+                const auto &rtJson = j["retransmit"];
+                sysConfig.retransmit.active = rtJson.value("active", false);
+                sysConfig.retransmit.historyDepth = rtJson.value("history_depth", 2048);
+                sysConfig.retransmit.nackPort = rtJson.value("nack_port", 5006);
+                sysConfig.retransmit.maxPerSec = rtJson.value("max_per_sec", 500);
+            }
+            if (j.contains("tcp_sink"))
+            {
+                const auto &tcpJson = j["tcp_sink"];
+                sysConfig.tcpSink.active = tcpJson.value("active", false);
+                sysConfig.tcpSink.port = tcpJson.value("port", 5007);
+                sysConfig.tcpSink.maxClients = tcpJson.value("max_clients", 4);
+                sysConfig.tcpSink.maxBacklogBytes = tcpJson.value("max_backlog_bytes", 4L * 1024 * 1024);
+                sysConfig.tcpSink.sendBufferBytes = tcpJson.value("send_buffer_bytes", 1024 * 1024);
+            }
+            if (j.contains("udp_socket"))
+            {
+                const auto &sockJson = j["udp_socket"];
+                sysConfig.udpSocket.sendBufferBytes = sockJson.value("send_buffer_bytes", 0);
+                sysConfig.udpSocket.dscp = sockJson.value("dscp", -1);
+                sysConfig.udpSocket.priority = sockJson.value("priority", -1);
+                sysConfig.udpSocket.bindDevice = sockJson.value("bind_device", "");
+                sysConfig.udpSocket.sourceIp = sockJson.value("source_ip", "");
+                sysConfig.udpSocket.nonBlocking = sockJson.value("non_blocking", false);
+            }
+            if (j.contains("status"))
+            {
+                const auto &statusJson = j["status"];
+                sysConfig.status.active = statusJson.value("active", false);
+                sysConfig.status.intervalMs = statusJson.value("interval_ms", 1000L);
+            }
+            if (j.contains("time_sync"))
+            {
+                const auto &tsJson = j["time_sync"];
+                sysConfig.timeSync.active = tsJson.value("active", false);
+                sysConfig.timeSync.port = tsJson.value("port", 5008);
+                sysConfig.timeSync.applyCorrections = tsJson.value("apply_corrections", true);
+                sysConfig.timeSync.maxCorrectionAgeMs = tsJson.value("max_correction_age_ms", 30000L);
+                sysConfig.timeSync.clientIp = tsJson.value("client_ip", "");
+            }
+            if (j.contains("shm_ring"))
+            {
+                const auto &shmJson = j["shm_ring"];
+                sysConfig.shmRing.active = shmJson.value("active", false);
+                sysConfig.shmRing.name = shmJson.value("name", "/uei_daq");
+                sysConfig.shmRing.capacityBytes = shmJson.value("capacity_bytes", 4L * 1024 * 1024);
+            }
+            if (j.contains("local_recorder"))
+            {
+                const auto &recJson = j["local_recorder"];
+                sysConfig.localRecorder.active = recJson.value("active", false);
+                sysConfig.localRecorder.directory = recJson.value("directory", "/mnt/rec");
+                sysConfig.localRecorder.fileCount = recJson.value("file_count", 8);
+                sysConfig.localRecorder.fileBytes = recJson.value("file_bytes", 8L * 1024 * 1024);
+                sysConfig.localRecorder.blockBytes = recJson.value("block_bytes", 4096);
+                sysConfig.localRecorder.syncIntervalMs = recJson.value("sync_interval_ms", 1000L);
+                sysConfig.localRecorder.queueDepth = recJson.value("queue_depth", 1024);
+            }
+            if (j.contains("event_recorder"))
+            {
+                const auto &evJson = j["event_recorder"];
+                sysConfig.eventRecorder.active = evJson.value("active", false);
+                sysConfig.eventRecorder.preMs = evJson.value("pre_ms", 5000L);
+                sysConfig.eventRecorder.postMs = evJson.value("post_ms", 2000L);
+                sysConfig.eventRecorder.directory = evJson.value("directory", "/mnt/rec/events");
+                sysConfig.eventRecorder.targetIp = evJson.value("target_ip", "");
+                sysConfig.eventRecorder.targetPort = evJson.value("target_port", 5009);
+                sysConfig.eventRecorder.commandPort = evJson.value("command_port", 5010);
+                if (evJson.contains("level_trigger"))
+                {
+                    const auto &trigJson = evJson["level_trigger"];
+                    sysConfig.eventRecorder.triggerChannel = trigJson.value("channel", -1);
+                    sysConfig.eventRecorder.triggerLevel = trigJson.value("level", 8388608L);
+                    sysConfig.eventRecorder.triggerEdge = trigJson.value("edge", "rising");
+                }
+            }
+            if (j.contains("traffic_shaping"))
+            {
+                const auto &shJson = j["traffic_shaping"];
+                sysConfig.shaping.active = shJson.value("active", false);
+                sysConfig.shaping.globalMbps = shJson.value("global_mbps", 80.0);
+                sysConfig.shaping.targetMbps = shJson.value("target_mbps", 0.0);
+                sysConfig.shaping.burstBytes = shJson.value("burst_bytes", 16384);
+                sysConfig.shaping.maxDelayUs = shJson.value("max_delay_us", 5000L);
+            }
+            if (j.contains("hot_reload"))
+            {
+                const auto &hrJson = j["hot_reload"];
+                sysConfig.hotReload.active = hrJson.value("active", false);
+                sysConfig.hotReload.settleMs = hrJson.value("settle_ms", 200L);
+            }
+            if (j.contains("resource_budget"))
+            {
+                const auto &rbJson = j["resource_budget"];
+                ResourceBudgetConfig &rb = sysConfig.resourceBudget;
+                rb.active = rbJson.value("active", true);
+                rb.enforce = rbJson.value("enforce", false);
+                rb.linkMbps = rbJson.value("link_mbps", 100.0);
+                rb.maxCpuPercent = rbJson.value("max_cpu_percent", 80.0);
+                rb.maxMemoryMb = rbJson.value("max_memory_mb", 64.0);
+                rb.readUsPerFrame = rbJson.value("read_us_per_frame", 20.0);
+                rb.encodeMbPerSec = rbJson.value("encode_mb_per_s", 20.0);
+                rb.compressionRatio = rbJson.value("compression_ratio", 0.6);
+                rb.fecXorMbPerSec = rbJson.value("fec_xor_mb_per_s", 60.0);
+                rb.fecRsMbPerSec = rbJson.value("fec_rs_mb_per_s", 8.0);
+                rb.sendUsPerDatagram = rbJson.value("send_us_per_datagram", 15.0);
+                rb.avgNsPerSample = rbJson.value("avg_ns_per_sample", 50.0);
+                rb.fftNsPerButterfly = rbJson.value("fft_ns_per_butterfly", 40.0);
+            }
+            sysConfig.protocolVersion = j.value("protocol_version", 2);
+            sysConfig.udpMtu = j.value("udp_mtu", 1500);
+            sysConfig.udpBatchMaxMessages = j.value("udp_batch_max_messages", 1);
+            sysConfig.udpBatchMaxDelayUs = j.value("udp_batch_max_delay_us", 2000L);
+            sysConfig.sendQueueDepth = j.value("send_queue_depth", 256);
 
             // 解析 Tasks
             if (j.contains("tasks"))
             {
+                int taskIndex = 0;
                 for (const auto &taskJson : j["tasks"])
                 {
                     TaskConfig task;
                     task.taskName = taskJson.value("task_name", "UnnamedTask");
+                    task.deviceId = taskJson.value("device_id", taskIndex++);
                     task.active = taskJson.value("active", false);
                     task.sampleRate = taskJson.value("sample_rate", 1000.0);
+                    task.encoding = taskJson.value("encoding", "raw");
+                    if (taskJson.contains("fec"))
+                    {
+                        const auto &fecJson = taskJson["fec"];
+                        task.fec.active = fecJson.value("active", false);
+                        task.fec.scheme = fecJson.value("scheme", "xor");
+                        task.fec.groupSize = fecJson.value("group_size", 8);
+                        task.fec.parityCount = fecJson.value("parity_count", 1);
+                        task.fec.maxDelayUs = fecJson.value("max_delay_us", 20000L);
+                    }
 
                     if (!task.active)
                         continue; // 跳過未啟用任務
@@ -82,7 +667,7 @@ namespace Utils
                             // 3. Hardware Config (關鍵新增部分)
                             if (chJson.contains("hardware_config"))
                             {
-                                auto hw = chJson["hardware_config"];
+                                const auto &hw = chJson["hardware_config"];
                                 // AI-208
                                 ch.hwConfig.excitationA = hw.value("ai208_excitation_a", 0.0);
                                 ch.hwConfig.excitationB = hw.value("ai208_excitation_b", 0.0);
@@ -111,9 +696,6 @@ namespace Utils
                 }
             }
 
-            std::cout << "[Config] Successfully loaded: " << sysConfig.systemName
-                      << " (" << sysConfig.taskConfigs.size() << " active tasks)" << std::endl;
-
             return sysConfig;
         }
         catch (const json::exception &e)
@@ -122,4 +704,108 @@ namespace Utils
         }
     }
 
+    ConfigDiff ConfigLoader::diff(const SystemConfig &running, const SystemConfig &next)
+    {
+        ConfigDiff result;
+
+        // 系統層級設定 (Socket / 輸出 / 錄製等，需重新啟動)
+        if (running.udpIp != next.udpIp || running.udpPort != next.udpPort)
+            result.restartSections.push_back("udp_target");
+        bool targetsChanged = (running.udpExtraTargets.size() != next.udpExtraTargets.size());
+        for (size_t i = 0; !targetsChanged && i < running.udpExtraTargets.size(); i++)
+            targetsChanged = !SameFields(running.udpExtraTargets[i], next.udpExtraTargets[i]);
+        if (targetsChanged)
+            result.restartSections.push_back("udp_extra_targets");
+        if (!SameFields(running.multicast, next.multicast))
+            result.restartSections.push_back("udp_multicast");
+        if (!SameFields(running.retransmit, next.retransmit))
+            result.restartSections.push_back("retransmit");
+        if (!SameFields(running.tcpSink, next.tcpSink))
+            result.restartSections.push_back("tcp_sink");
+        if (!SameFields(running.shaping, next.shaping))
+            result.restartSections.push_back("traffic_shaping");
+        if (!SameFields(running.udpSocket, next.udpSocket))
+            result.restartSections.push_back("udp_socket");
+        if (!SameFields(running.shmRing, next.shmRing))
+            result.restartSections.push_back("shm_ring");
+        if (!SameFields(running.localRecorder, next.localRecorder))
+            result.restartSections.push_back("local_recorder");
+        if (!SameFields(running.eventRecorder, next.eventRecorder))
+            result.restartSections.push_back("event_recorder");
+        if (!SameFields(running.status, next.status))
+            result.restartSections.push_back("status");
+        if (!SameFields(running.timeSync, next.timeSync))
+            result.restartSections.push_back("time_sync");
+        if (!SameFields(running.hotReload, next.hotReload))
+            result.restartSections.push_back("hot_reload");
+        if (running.protocolVersion != next.protocolVersion || running.udpMtu != next.udpMtu ||
+            running.udpBatchMaxMessages != next.udpBatchMaxMessages ||
+            running.udpBatchMaxDelayUs != next.udpBatchMaxDelayUs || running.sendQueueDepth != next.sendQueueDepth)
+            result.restartSections.push_back("udp_protocol");
+
+        // Task 依 deviceId 對應
+        for (const auto &task : running.taskConfigs)
+        {
+            TaskDiff change;
+            change.deviceId = task.deviceId;
+            change.taskName = task.taskName;
+
+            const TaskConfig *other = NULL;
+            for (const auto &candidate : next.taskConfigs)
+                if (candidate.deviceId == task.deviceId)
+                    other = &candidate;
+            if (!other)
+            {
+                change.removed = true;
+                result.tasks.push_back(change);
+                continue;
+            }
+
+            change.taskName = other->taskName;
+            change.sampleRate = (task.sampleRate != other->sampleRate);
+            change.encoding = (task.encoding != other->encoding);
+            change.fec = (task.fec.active != other->fec.active) ||
+                         (other->fec.active && (task.fec.scheme != other->fec.scheme ||
+                                                task.fec.groupSize != other->fec.groupSize ||
+                                                task.fec.parityCount != other->fec.parityCount ||
+                                                task.fec.maxDelayUs != other->fec.maxDelayUs));
+            if (task.channels.size() != other->channels.size())
+                change.channels = true;
+            else
+            {
+                for (size_t c = 0; c < task.channels.size(); c++)
+                {
+                    const ChannelConfig &a = task.channels[c];
+                    const ChannelConfig &b = other->channels[c];
+                    if (a.channelRange != b.channelRange || a.deviceName != b.deviceName || a.active != b.active)
+                        change.channels = true;
+                    if (!SameFields(a.hwConfig, b.hwConfig))
+                        change.hardware = true;
+                    if (a.avgConfig.active != b.avgConfig.active || a.avgConfig.windowSize != b.avgConfig.windowSize ||
+                        a.fftConfig.active != b.fftConfig.active || a.fftConfig.windowType != b.fftConfig.windowType ||
+                        a.fftConfig.points != b.fftConfig.points ||
+                        a.fftConfig.overlapPercent != b.fftConfig.overlapPercent || a.modelInfo != b.modelInfo)
+                        change.processing = true;
+                }
+            }
+            if (change.Any())
+                result.tasks.push_back(change);
+        }
+        for (const auto &task : next.taskConfigs)
+        {
+            bool known = false;
+            for (const auto &candidate : running.taskConfigs)
+                known = known || (candidate.deviceId == task.deviceId);
+            if (!known)
+            {
+                TaskDiff change;
+                change.deviceId = task.deviceId;
+                change.taskName = task.taskName;
+                change.added = true;
+                result.tasks.push_back(change);
+            }
+        }
+        return result;
+    }
+
 } // namespace Utils
\ No newline at end of file
@@ -0,0 +1,132 @@
+//=============================================================================
+// NAME:    src/utils/ConfigWatcher.cpp
+//=============================================================================
+#include "utils/ConfigWatcher.hpp"
+#include "utils/ConfigLoader.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+
+namespace Utils
+{
+    // 沒有事件時的喚醒間隔 (檢查 Stop 與 settle 期限)
+    static const int WATCH_POLL_MS = 50;
+
+    ConfigWatcher::ConfigWatcher()
+        : m_settleMs(200), m_fd(-1), m_running(false), m_reloads(0), m_errors(0)
+    {
+    }
+
+    ConfigWatcher::~ConfigWatcher()
+    {
+        Stop();
+    }
+
+    bool ConfigWatcher::Start(const std::string &filePath, long settleMs, ReloadCallback callback)
+    {
+        Stop();
+        m_path = ConfigLoader::resolve(filePath);
+        m_settleMs = settleMs;
+        m_callback = callback;
+
+        std::string directory = ".";
+        m_name = m_path;
+        size_t slash = m_path.rfind('/');
+        if (slash != std::string::npos)
+        {
+            directory = (slash == 0) ? "/" : m_path.substr(0, slash);
+            m_name = m_path.substr(slash + 1);
+        }
+
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0)
+        {
+            std::cerr << "[Config] inotify_init1 failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            std::cerr << "[Config] Cannot watch " << directory << ": " << strerror(errno) << std::endl;
+            close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+
+        m_running = true;
+        m_thread = std::thread(&ConfigWatcher::Run, this);
+        std::cout << "[Config] Watching " << m_path << " for changes" << std::endl;
+        return true;
+    }
+
+    void ConfigWatcher::Stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+            m_thread.join();
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+    }
+
+    void ConfigWatcher::Run()
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        int64_t lastChangeUs = 0;
+        bool pending = false;
+
+        while (m_running)
+        {
+            struct pollfd pfd;
+            pfd.fd = m_fd;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, WATCH_POLL_MS) > 0)
+            {
+                ssize_t n;
+                while ((n = read(m_fd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (ssize_t pos = 0; pos < n;)
+                    {
+                        const struct inotify_event *ev = (const struct inotify_event *)(buffer + pos);
+                        // 只看設定檔本身 (快取檔 / 編輯器暫存檔也在同一目錄)
+                        if (ev->len > 0 && m_name == ev->name)
+                        {
+                            pending = true;
+                            lastChangeUs = NowUs();
+                        }
+                        pos += sizeof(struct inotify_event) + ev->len;
+                    }
+                }
+            }
+
+            if (!pending || NowUs() - lastChangeUs < m_settleMs * 1000)
+                continue;
+            pending = false;
+
+            try
+            {
+                SystemConfig config = ConfigLoader::load(m_path);
+                m_reloads++;
+                m_callback(config);
+            }
+            catch (const std::exception &e)
+            {
+                // 編輯中途或格式錯誤：保留執行中的設定，等下一次變動
+                m_errors++;
+                std::cerr << "[Config] Reload failed, keeping running config: " << e.what() << std::endl;
+            }
+        }
+    }
+
+    int64_t ConfigWatcher::NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+} // namespace Utils
@@ -0,0 +1,119 @@
+//=============================================================================
+// NAME:    tests/ConfigLoaderTest.cpp
+// DESC:    同一份 JSON 載入兩次 (解析 / 快取) 後 diff() 必須沒有差異
+//          用法: config_loader_test [DAQ_Settings.json]
+//=============================================================================
+#include "utils/ConfigLoader.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                        \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(cond))                                                                       \
+        {                                                                                  \
+            std::cerr << "[Test] FAIL " << __FILE__ << ":" << __LINE__ << ": " #cond << std::endl; \
+            g_failures++;                                                                  \
+        }                                                                                  \
+    } while (0)
+
+// 第一個通道沒有 moving_avg / fft 區塊：這些欄位只來自結構的預設值
+static const char *MINIMAL_JSON = R"({
+    "system_name": "DiffTest",
+    "tasks": [
+        {
+            "task_name": "Task_A",
+            "active": true,
+            "channels": [
+                { "device_name": "Dev_A", "channel_range": "ai0:3" },
+                { "device_name": "Dev_A", "channel_range": "ai4:7",
+                  "moving_avg": { "active": true } }
+            ]
+        }
+    ]
+})";
+
+static void ExpectNoDiff(const Utils::SystemConfig &a, const Utils::SystemConfig &b, const char *what)
+{
+    Utils::ConfigDiff diff = Utils::ConfigLoader::diff(a, b);
+    if (!diff.Empty())
+    {
+        std::cerr << "[Test] " << what << ": " << diff.tasks.size() << " task(s) changed";
+        for (const auto &section : diff.restartSections)
+            std::cerr << ", " << section;
+        std::cerr << std::endl;
+    }
+    CHECK(diff.Empty());
+}
+
+static std::string ReadFile(const std::string &path)
+{
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// 寫到暫存目錄後 load() 兩次：第一次解析並寫出快取，第二次由快取載入
+static void TestLoadTwice(const std::string &jsonText, const char *what)
+{
+    char dir[] = "/tmp/config_test_XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        std::cerr << "[Test] mkdtemp failed" << std::endl;
+        g_failures++;
+        return;
+    }
+    const std::string path = std::string(dir) + "/DAQ_Settings.json";
+    {
+        std::ofstream file(path);
+        file << jsonText;
+    }
+
+    Utils::SystemConfig parsed = Utils::ConfigLoader::load(path);
+    Utils::SystemConfig cached = Utils::ConfigLoader::load(path);
+    ExpectNoDiff(parsed, cached, what);
+    ExpectNoDiff(Utils::ConfigLoader::parse(jsonText), cached, what);
+
+    std::remove((path + ".cache").c_str());
+    std::remove(path.c_str());
+    rmdir(dir);
+}
+
+int main(int argc, char **argv)
+{
+    // 預設值
+    Utils::SystemConfig minimal = Utils::ConfigLoader::parse(MINIMAL_JSON);
+    CHECK(minimal.taskConfigs.size() == 1);
+    if (minimal.taskConfigs.size() == 1 && minimal.taskConfigs[0].channels.size() == 2)
+    {
+        const Utils::ChannelConfig &ch = minimal.taskConfigs[0].channels[0];
+        CHECK(!ch.avgConfig.active && ch.avgConfig.windowSize == 0);
+        CHECK(!ch.fftConfig.active && ch.fftConfig.points == 0 && ch.fftConfig.overlapPercent == 0.0);
+    }
+    ExpectNoDiff(minimal, Utils::ConfigLoader::parse(MINIMAL_JSON), "minimal parse");
+    TestLoadTwice(MINIMAL_JSON, "minimal load");
+
+    if (argc > 1)
+    {
+        const std::string jsonText = ReadFile(argv[1]);
+        CHECK(!jsonText.empty());
+        ExpectNoDiff(Utils::ConfigLoader::parse(jsonText), Utils::ConfigLoader::parse(jsonText), argv[1]);
+        TestLoadTwice(jsonText, argv[1]);
+    }
+
+    if (g_failures)
+    {
+        std::cerr << "[Test] " << g_failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "[Test] ConfigLoader OK" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+//=============================================================================
+// NAME:    tests/ResourceBudgetTest.cpp
+// DESC:    EstimateBudget() 對已知設定的估算值 (成本參數使用 resource_budget 預設值)
+//=============================================================================
+#include "daq/ResourceBudget.hpp"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+
+static int g_failures = 0;
+
+#define CHECK_NEAR(actual, expected)                                                                 \
+    do                                                                                               \
+    {                                                                                                \
+        double a_ = (actual), e_ = (expected);                                                       \
+        if (std::fabs(a_ - e_) > 1e-6 * std::max(1.0, std::fabs(e_)))                                \
+        {                                                                                            \
+            std::cerr << "[Test] FAIL " << __FILE__ << ":" << __LINE__ << ": " #actual " = " << a_   \
+                      << ", expected " << e_ << std::endl;                                           \
+            g_failures++;                                                                            \
+        }                                                                                            \
+    } while (0)
+
+#define CHECK(cond)                                                                        \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(cond))                                                                       \
+        {                                                                                  \
+            std::cerr << "[Test] FAIL " << __FILE__ << ":" << __LINE__ << ": " #cond << std::endl; \
+            g_failures++;                                                                  \
+        }                                                                                  \
+    } while (0)
+
+// 單一 Task：ai0:7 @ 1000 Hz，v2 Header，MTU 1500，沒有額外目標 / Ring / 錄製
+static Utils::SystemConfig MakeConfig(const std::string &encoding, bool fec)
+{
+    Utils::SystemConfig config;
+    config.protocolVersion = 2;
+    config.udpMtu = 1500;
+    config.sendQueueDepth = 256;
+
+    Utils::ChannelConfig ch;
+    ch.channelRange = "ai0:7";
+
+    Utils::TaskConfig task;
+    task.taskName = "Task_A";
+    task.active = true;
+    task.sampleRate = 1000.0;
+    task.encoding = encoding;
+    task.fec.active = fec;
+    task.channels.push_back(ch);
+    config.taskConfigs.push_back(task);
+    return config;
+}
+
+int main()
+{
+    // Raw：Batch = 10 Frame x 8 ch x 4 bytes = 320 bytes，100 Batch/s，每個 Batch 一個 Datagram
+    {
+        Utils::SystemConfig config = MakeConfig("raw", false);
+        Daq::BudgetReport report = Daq::EstimateBudget(config);
+        CHECK(report.tasks.size() == 1);
+        CHECK(!report.Exceeded());
+        if (report.tasks.size() == 1)
+        {
+            const Daq::TaskBudget &task = report.tasks[0];
+            CHECK(task.numChannels == 8);
+            CHECK_NEAR(task.samplesPerSec, 8000.0);
+            CHECK_NEAR(task.payloadBytesPerSec, 32000.0);
+            CHECK_NEAR(task.datagramsPerSec, 100.0);
+            CHECK_NEAR(task.wireBitsPerSec, (64 + 320 + 28) * 100 * 8.0); // v2 Header + Payload + UDP/IP
+            CHECK_NEAR(task.memoryBytes, 100 * 320.0);                   // MAX_QUEUE_BATCHES 個 Batch
+            CHECK_NEAR(task.cpuPercent, (1000 * 20.0 + 100 * 15.0) / 1e4);
+        }
+        CHECK_NEAR(report.linkBitsPerSec, 329600.0);
+        CHECK_NEAR(report.linkLimitBitsPerSec, 100e6);
+        CHECK_NEAR(report.memoryBytes, 100 * 320.0 + 256 * 320.0);
+
+        // max_memory_mb 以 10^6 bytes 計：113920 bytes 超過 0.11 MB
+        config.resourceBudget.maxMemoryMb = 0.11;
+        CHECK(Daq::EstimateBudget(config).Exceeded());
+        config.resourceBudget.maxMemoryMb = 0.12;
+        CHECK(!Daq::EstimateBudget(config).Exceeded());
+    }
+
+    // Delta + XOR FEC：Payload 192 bytes；編碼 32000 B/s @ 20 MB/s，FEC 28400 B/s @ 60 MB/s
+    {
+        Daq::BudgetReport report = Daq::EstimateBudget(MakeConfig("delta", true));
+        CHECK(report.tasks.size() == 1);
+        if (report.tasks.size() == 1)
+        {
+            const Daq::TaskBudget &task = report.tasks[0];
+            CHECK_NEAR(task.payloadBytesPerSec, 19200.0);
+            CHECK_NEAR(task.datagramsPerSec, 112.5); // 每 8 個 Data 加 1 個 Parity
+            double loopUs = 1000 * 20.0;
+            double encodeUs = 32000.0 / 20e6 * 1e6;
+            double fecUs = (64 + 192 + 28) * 100 / 60e6 * 1e6;
+            double sendUs = 112.5 * 15.0;
+            CHECK_NEAR(task.cpuPercent, (loopUs + encodeUs + fecUs + sendUs) / 1e4);
+        }
+    }
+
+    if (g_failures)
+    {
+        std::cerr << "[Test] " << g_failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "[Test] ResourceBudget OK" << std::endl;
+    return EXIT_SUCCESS;
+}
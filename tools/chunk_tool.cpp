@@ -0,0 +1,566 @@
+/**
+ * @file chunk_tool.cpp
+ * @brief 分塊錄製檔 (.uchk)：接收寫入、由 Controller 錄製檔轉換，以及依時間範圍查詢
+ *
+ * 用法:
+ *   chunk_tool record [-c config] [-n chunk_samples] [-m chunk_ms] [-s file_sec] [-r window] <port> <directory>
+ *     接收 (UdpReceiver Ring 模式) 並為每個裝置寫入 dev<id>_<UTC>.uchk，每 file_sec 秒換檔 (預設 3600)；
+ *     每個裝置保留 window 個 Batch 依樣本序號重新排序後才寫入 (預設 16)，亂序到達的 Batch 不會被當成晚到略過
+ *   chunk_tool convert [-c config] [-n chunk_samples] [-m chunk_ms] <directory> <file.rec|file.evt> [...]
+ *     將 Controller 本機錄製檔 / 事件檔轉為 .uchk (依時間排序，重疊的部分略過)
+ *   chunk_tool info <file.uchk>
+ *   chunk_tool query <file.uchk> <channel> <from> <to>
+ *     輸出 "timestamp_ns,code" CSV；只讀取涵蓋範圍的 Chunk 欄位
+ *   chunk_tool range <file.uchk> <channel> <from> <to>
+ *     範圍內的最小 / 最大 Code (完整涵蓋的 Chunk 只用 Index)
+ *
+ *   -c 設定檔 (DAQ_Settings.json)：依 device_id 將 TaskConfig 寫入檔頭
+ *   channel：欄位編號或名稱 (例如 3 或 ai3)
+ *   時間：HH:MM:SS[.fff] (檔案第一筆資料當天，UTC)、YYYY-MM-DDTHH:MM:SS[.fff] (UTC)、
+ *         +秒數 (相對於檔案第一筆資料) 或 Unix 秒數
+ */
+#include "net/ChunkFile.hpp"
+#include "net/UdpReceiver.hpp"
+#include "net/LocalRecorder.hpp"
+#include "net/EventRecorder.hpp"
+#include "utils/ConfigLoader.hpp"
+#include "utils/ArgParse.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
+
+namespace
+{
+    volatile sig_atomic_t g_stop = 0;
+    void signal_handler(int) { g_stop = 1; }
+
+    int64_t NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    std::string FormatUtc(uint64_t ns)
+    {
+        time_t sec = (time_t)(ns / 1000000000ULL);
+        struct tm tm;
+        gmtime_r(&sec, &tm);
+        char text[48];
+        size_t len = strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tm);
+        snprintf(text + len, sizeof(text) - len, ".%06uZ", (unsigned)(ns % 1000000000ULL / 1000));
+        return text;
+    }
+
+    // "SS[.fff]" 的小數部分轉為 ns
+    uint64_t FractionNs(const char *p)
+    {
+        if (*p != '.')
+            return 0;
+        uint64_t ns = 0, scale = 100000000ULL;
+        for (p++; *p >= '0' && *p <= '9' && scale > 0; p++, scale /= 10)
+            ns += (uint64_t)(*p - '0') * scale;
+        return ns;
+    }
+
+    /**
+     * @brief 解析查詢時間 (見檔頭說明)
+     * @param baseNs 檔案第一筆資料的時間 (HH:MM:SS 的日期與 +秒數的起點)
+     */
+    bool ParseTime(const std::string &text, uint64_t baseNs, uint64_t &ns)
+    {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char *s = text.c_str();
+        const char *rest = NULL;
+
+        if (s[0] == '+')
+        {
+            double sec = 0.0;
+            if (!Utils::ParseDouble(s + 1, 0.0, 1e9, sec))
+                return false;
+            ns = baseNs + (uint64_t)(sec * 1e9);
+            return true;
+        }
+        if ((rest = strptime(s, "%Y-%m-%dT%H:%M:%S", &tm)) != NULL)
+        {
+            ns = (uint64_t)timegm(&tm) * 1000000000ULL + FractionNs(rest);
+            return true;
+        }
+        if ((rest = strptime(s, "%H:%M:%S", &tm)) != NULL)
+        {
+            uint64_t dayStart = baseNs / 1000000000ULL / 86400 * 86400;
+            ns = (dayStart + tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec) * 1000000000ULL + FractionNs(rest);
+            return true;
+        }
+
+        char *end = NULL;
+        unsigned long long sec = strtoull(s, &end, 10);
+        if (end == s)
+            return false;
+        ns = sec * 1000000000ULL + FractionNs(end);
+        return true;
+    }
+
+    int ParseChannel(const Net::ChunkLayout &layout, const std::string &text)
+    {
+        for (size_t c = 0; c < layout.channelNames.size(); c++)
+            if (layout.channelNames[c] == text)
+                return (int)c;
+        char *end = NULL;
+        long c = strtol(text.c_str(), &end, 10);
+        if (end == text.c_str() || *end != '\0' || c < 0 || c >= layout.numChannels)
+            return -1;
+        return (int)c;
+    }
+
+    /**
+     * @brief 每個裝置一個 ChunkFileWriter；依時間 / 通道配置改變換檔
+     */
+    class ChunkFiles
+    {
+    public:
+        ChunkFiles(const std::string &directory, const Net::ChunkOptions &options, long fileSec,
+                   const Utils::SystemConfig *config)
+            : m_directory(directory), m_options(options), m_fileSec(fileSec), m_config(config), m_filesCompleted(0),
+              m_retiredSamples(0), m_retiredChunks(0), m_retiredBytes(0), m_retiredLate(0)
+        {
+        }
+
+        bool Append(const Net::PacketHeader &h, const uint32_t *samples, size_t count)
+        {
+            std::unique_ptr<Net::ChunkFileWriter> &writer = m_files[h.deviceId];
+            if (!writer)
+                writer.reset(new Net::ChunkFileWriter());
+            if (writer->IsOpen() && m_fileSec > 0 && writer->GetSamplesWritten() > 0 &&
+                h.timestampNs >= writer->GetFirstTimestampNs() + (uint64_t)m_fileSec * 1000000000ULL)
+                Retire(*writer);
+            if (!writer->IsOpen() && !OpenFor(*writer, h))
+                return false;
+            if (writer->Append(h, samples, count))
+                return true;
+
+            // 通道數 / 取樣率改變 (或寫入失敗)：換新檔再試一次
+            Retire(*writer);
+            return OpenFor(*writer, h) && writer->Append(h, samples, count);
+        }
+
+        void Close()
+        {
+            for (auto &it : m_files)
+                Retire(*it.second);
+        }
+
+        // 已結束與寫入中檔案的合計
+        uint64_t GetSamples() const { return m_retiredSamples + OpenTotal(&Net::ChunkFileWriter::GetSamplesWritten); }
+        uint64_t GetChunks() const { return m_retiredChunks + OpenTotal(&Net::ChunkFileWriter::GetChunksWritten); }
+        uint64_t GetBytes() const { return m_retiredBytes + OpenTotal(&Net::ChunkFileWriter::GetBytesWritten); }
+        uint64_t GetLateDropped() const { return m_retiredLate + OpenTotal(&Net::ChunkFileWriter::GetLateDropped); }
+        uint64_t GetFilesCompleted() const { return m_filesCompleted; }
+
+    private:
+        // 結束檔案並累計其統計 (Open() 會清除 Writer 的計數)
+        void Retire(Net::ChunkFileWriter &writer)
+        {
+            if (!writer.IsOpen())
+                return;
+            writer.Close();
+            m_filesCompleted++;
+            m_retiredSamples += writer.GetSamplesWritten();
+            m_retiredChunks += writer.GetChunksWritten();
+            m_retiredBytes += writer.GetBytesWritten();
+            m_retiredLate += writer.GetLateDropped();
+        }
+
+        uint64_t OpenTotal(uint64_t (Net::ChunkFileWriter::*getter)() const) const
+        {
+            uint64_t total = 0;
+            for (const auto &it : m_files)
+                if (it.second->IsOpen())
+                    total += ((*it.second).*getter)();
+            return total;
+        }
+
+        bool OpenFor(Net::ChunkFileWriter &writer, const Net::PacketHeader &h)
+        {
+            const Utils::TaskConfig *task = NULL;
+            if (m_config)
+                for (const auto &t : m_config->taskConfigs)
+                    if (t.deviceId == h.deviceId)
+                        task = &t;
+
+            time_t sec = (time_t)(h.timestampNs / 1000000000ULL);
+            struct tm tm;
+            gmtime_r(&sec, &tm);
+            char stamp[32];
+            strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", &tm);
+
+            // 同一秒內換檔時加上序號
+            std::string base = m_directory + "/dev" + std::to_string(h.deviceId) + "_" + stamp;
+            std::string path = base + ".uchk";
+            struct stat st;
+            for (int n = 1; stat(path.c_str(), &st) == 0 || stat((path + ".part").c_str(), &st) == 0; n++)
+                path = base + "_" + std::to_string(n) + ".uchk";
+
+            if (!writer.Open(path, Net::MakeChunkLayout(h, task), m_options))
+                return false;
+            std::cout << "[Chunk] Device " << h.deviceId << " -> " << path << std::endl;
+            return true;
+        }
+
+        std::string m_directory;
+        Net::ChunkOptions m_options;
+        long m_fileSec;
+        const Utils::SystemConfig *m_config;
+        std::map<uint16_t, std::unique_ptr<Net::ChunkFileWriter>> m_files;
+        uint64_t m_filesCompleted;
+        uint64_t m_retiredSamples;
+        uint64_t m_retiredChunks;
+        uint64_t m_retiredBytes;
+        uint64_t m_retiredLate;
+    };
+
+    void PrintTotals(const ChunkFiles &files)
+    {
+        std::cout << "[Chunk] samples " << files.GetSamples() << ", chunks " << files.GetChunks() << ", files "
+                  << files.GetFilesCompleted() << ", late dropped " << files.GetLateDropped() << std::endl;
+    }
+
+    int Record(int port, const std::string &directory, const Net::ChunkOptions &options, long fileSec,
+               size_t reorderWindow, const Utils::SystemConfig *config)
+    {
+        signal(SIGINT, signal_handler);
+
+        Net::UdpReceiver receiver;
+        if (!receiver.Init(port))
+            return 1;
+        ChunkFiles files(directory, options, fileSec, config);
+        receiver.Start(4096);
+
+        // 每個裝置依 firstSampleIndex 排序的待寫入 Batch
+        std::map<uint16_t, std::map<uint64_t, Net::DecodedBatch>> pending;
+        bool ok = true;
+        Net::DecodedBatch batch;
+        int64_t lastReportUs = NowUs();
+        uint64_t lastBytes = 0;
+        while (!g_stop && ok)
+        {
+            if (receiver.Pop(batch, 100))
+            {
+                std::map<uint64_t, Net::DecodedBatch> &window = pending[batch.header.deviceId];
+                std::swap(window[batch.header.firstSampleIndex], batch);
+                while (ok && window.size() > reorderWindow)
+                {
+                    const Net::DecodedBatch &oldest = window.begin()->second;
+                    ok = files.Append(oldest.header, oldest.samples.data(), oldest.samples.size());
+                    window.erase(window.begin()); // 無法建立檔案 (磁碟空間不足等) 時結束
+                }
+            }
+
+            int64_t nowUs = NowUs();
+            if (nowUs - lastReportUs >= 1000000)
+            {
+                double sec = (nowUs - lastReportUs) / 1e6;
+                uint64_t bytes = files.GetBytes();
+                std::cout << "[Chunk] " << (bytes - lastBytes) / sec / 1e6 << " MB/s, ring dropped "
+                          << receiver.GetRingDropped() << std::endl;
+                PrintTotals(files);
+                lastReportUs = nowUs;
+                lastBytes = bytes;
+            }
+        }
+
+        receiver.Stop();
+        while (receiver.Pop(batch, 0))
+            std::swap(pending[batch.header.deviceId][batch.header.firstSampleIndex], batch);
+        for (auto &device : pending)
+            for (auto &it : device.second)
+                files.Append(it.second.header, it.second.samples.data(), it.second.samples.size());
+        files.Close();
+        receiver.Close();
+        PrintTotals(files);
+        return 0;
+    }
+
+    int Convert(const std::string &directory, const std::vector<std::string> &inputs, const Net::ChunkOptions &options,
+                const Utils::SystemConfig *config)
+    {
+        // 依各檔案第一筆資料的時間排序後依序寫入
+        struct Input
+        {
+            std::string path;
+            uint64_t sortNs;
+        };
+        std::vector<Input> sorted;
+        for (const auto &path : inputs)
+        {
+            Input input;
+            input.path = path;
+            if (path.size() > 4 && path.compare(path.size() - 4, 4, ".evt") == 0)
+            {
+                Net::EventFileHeader header;
+                std::vector<Net::RecordedBatch> records;
+                if (!Net::EventRecorder::ReadFile(path, header, records) || records.empty())
+                {
+                    std::cerr << "[Chunk] Cannot read " << path << std::endl;
+                    return 1;
+                }
+                input.sortNs = records.front().header.timestampNs;
+            }
+            else
+            {
+                Net::RecordFileReader reader;
+                if (!reader.Open(path))
+                {
+                    std::cerr << "[Chunk] Cannot read " << path << std::endl;
+                    return 1;
+                }
+                input.sortNs = reader.Header().firstTimestampNs;
+            }
+            sorted.push_back(input);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const Input &a, const Input &b) { return a.sortNs < b.sortNs; });
+
+        ChunkFiles files(directory, options, 0, config);
+        std::vector<Net::RecordedBatch> records;
+        for (const auto &input : sorted)
+        {
+            if (input.path.size() > 4 && input.path.compare(input.path.size() - 4, 4, ".evt") == 0)
+            {
+                Net::EventFileHeader header;
+                Net::EventRecorder::ReadFile(input.path, header, records);
+                for (const auto &r : records)
+                    if (!files.Append(r.header, r.samples.data(), r.samples.size()))
+                        return 1;
+                continue;
+            }
+
+            Net::RecordFileReader reader;
+            reader.Open(input.path);
+            for (uint64_t block = 0; block < reader.ValidBlocks();)
+            {
+                uint64_t span = reader.ReadBlock(block, records);
+                if (span == 0)
+                    break;
+                for (const auto &r : records)
+                    if (!files.Append(r.header, r.samples.data(), r.samples.size()))
+                        return 1;
+                block += span;
+            }
+        }
+        files.Close();
+        PrintTotals(files);
+        return 0;
+    }
+
+    int Info(const std::string &path)
+    {
+        Net::ChunkFileReader reader;
+        if (!reader.Open(path))
+        {
+            std::cerr << "[Chunk] Cannot open " << path << std::endl;
+            return 1;
+        }
+
+        const Net::ChunkFileHeader &h = reader.Header();
+        const Net::ChunkLayout &layout = reader.Layout();
+        std::cout << path << ": device " << h.deviceId << (layout.taskName.empty() ? "" : " (" + layout.taskName + ")")
+                  << ", " << h.numChannels << " ch @ " << h.sampleRate << " Hz"
+                  << (reader.HasFooter() ? "" : ", no footer (index rebuilt by scan)") << std::endl;
+        std::cout << "  columns:";
+        for (const auto &name : layout.channelNames)
+            std::cout << " " << name;
+        std::cout << std::endl;
+
+        size_t count = reader.ChunkCount();
+        if (count == 0)
+        {
+            std::cout << "  no chunks" << std::endl;
+            return 0;
+        }
+
+        uint64_t samples = 0, gaps = 0, missingSamples = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const Net::ChunkHeader &c = reader.Chunk(i);
+            samples += c.numSamples;
+            if (i > 0)
+            {
+                uint64_t expected = reader.Chunk(i - 1).firstSampleIndex + reader.Chunk(i - 1).numSamples;
+                if (c.firstSampleIndex > expected)
+                {
+                    gaps++;
+                    missingSamples += c.firstSampleIndex - expected;
+                }
+            }
+        }
+        std::cout << "  " << count << " chunks, " << samples << " samples, " << FormatUtc(reader.Chunk(0).firstTimestampNs)
+                  << " - " << FormatUtc(reader.Chunk(count - 1).endTimestampNs) << std::endl
+                  << "  gaps " << gaps << " (" << missingSamples << " samples)" << std::endl;
+
+        for (int c = 0; c < h.numChannels; c++)
+        {
+            uint32_t lo = UINT32_MAX, hi = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                lo = std::min(lo, reader.ChunkMin(i, c));
+                hi = std::max(hi, reader.ChunkMax(i, c));
+            }
+            std::cout << "  " << layout.channelNames[c] << ": min 0x" << std::hex << lo << ", max 0x" << hi << std::dec
+                      << std::endl;
+        }
+        return 0;
+    }
+
+    int Query(bool extentOnly, const std::string &path, const std::string &channelText, const std::string &fromText,
+              const std::string &toText)
+    {
+        Net::ChunkFileReader reader;
+        if (!reader.Open(path))
+        {
+            std::cerr << "[Chunk] Cannot open " << path << std::endl;
+            return 1;
+        }
+        int channel = ParseChannel(reader.Layout(), channelText);
+        if (channel < 0)
+        {
+            std::cerr << "[Chunk] Unknown channel " << channelText << std::endl;
+            return 1;
+        }
+        uint64_t baseNs = reader.ChunkCount() > 0 ? reader.Chunk(0).firstTimestampNs : 0;
+        uint64_t fromNs, toNs;
+        if (!ParseTime(fromText, baseNs, fromNs) || !ParseTime(toText, baseNs, toNs) || toNs <= fromNs)
+        {
+            std::cerr << "[Chunk] Invalid time range " << fromText << " - " << toText << std::endl;
+            return 1;
+        }
+
+        size_t samples = 0;
+        if (extentOnly)
+        {
+            uint32_t lo, hi;
+            if (reader.ChannelExtent(channel, fromNs, toNs, lo, hi))
+                std::cout << reader.Layout().channelNames[channel] << ": min 0x" << std::hex << lo << ", max 0x" << hi
+                          << std::dec << std::endl;
+            else
+                std::cout << "no data in range" << std::endl;
+        }
+        else
+        {
+            std::vector<uint32_t> codes;
+            std::vector<uint64_t> times;
+            if (!reader.ReadChannel(channel, fromNs, toNs, codes, &times))
+            {
+                std::cerr << "[Chunk] Read failed" << std::endl;
+                return 1;
+            }
+            std::cout << "timestamp_ns,code\n";
+            for (size_t i = 0; i < codes.size(); i++)
+                std::cout << times[i] << "," << codes[i] << "\n";
+            samples = codes.size();
+        }
+
+        std::cerr << "[Chunk] " << FormatUtc(fromNs) << " - " << FormatUtc(toNs) << ": " << samples << " samples, read "
+                  << reader.GetChunksRead() << " of " << reader.ChunkCount() << " chunks (" << reader.GetBytesRead()
+                  << " bytes)" << std::endl;
+        return 0;
+    }
+
+    void Usage()
+    {
+        std::cerr << "Usage: chunk_tool record [-c config] [-n chunk_samples] [-m chunk_ms] [-s file_sec] [-r window] <port> <directory>\n"
+                  << "       chunk_tool convert [-c config] [-n chunk_samples] [-m chunk_ms] <directory> <file.rec|file.evt> [...]\n"
+                  << "       chunk_tool info <file.uchk>\n"
+                  << "       chunk_tool query|range <file.uchk> <channel> <from> <to>" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        Usage();
+        return 1;
+    }
+    std::string mode = argv[1];
+    if (mode == "info" && argc == 3)
+        return Info(argv[2]);
+    if ((mode == "query" || mode == "range") && argc == 6)
+        return Query(mode == "range", argv[2], argv[3], argv[4], argv[5]);
+    if (mode != "record" && mode != "convert")
+    {
+        Usage();
+        return 1;
+    }
+
+    Net::ChunkOptions options;
+    long fileSec = 3600;
+    size_t reorderWindow = 16;
+    std::string configPath;
+    int opt;
+    bool ok = true;
+    optind = 2;
+    while (ok && (opt = getopt(argc, argv, "c:n:m:s:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            configPath = optarg;
+            break;
+        case 'n':
+            ok = Utils::ParseInt(optarg, 1, 16 * 1024 * 1024, options.chunkSamples);
+            break;
+        case 'm':
+            ok = Utils::ParseInt(optarg, 1, 86400000, options.maxChunkMs);
+            break;
+        case 's':
+            ok = Utils::ParseInt(optarg, 0, 100000000, fileSec);
+            break;
+        case 'r':
+            ok = Utils::ParseInt(optarg, 0, 65536, reorderWindow);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+    }
+    if (!ok)
+    {
+        Usage();
+        return 1;
+    }
+
+    Utils::SystemConfig config;
+    if (!configPath.empty())
+    {
+        try
+        {
+            config = Utils::ConfigLoader::load(configPath);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[Chunk] " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    const Utils::SystemConfig *configPtr = configPath.empty() ? NULL : &config;
+
+    int port = 0;
+    if (mode == "record" && argc - optind == 2 && Utils::ParsePort(argv[optind], port))
+        return Record(port, argv[optind + 1], options, fileSec, reorderWindow, configPtr);
+    if (mode == "convert" && argc - optind >= 2)
+        return Convert(argv[optind], std::vector<std::string>(argv + optind + 1, argv + argc), options, configPtr);
+    Usage();
+    return 1;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file clock_sync.cpp
+ * @brief 時鐘偏差估計工具：接收端模式每秒列出 offset / drift / delay；serve 模式模擬 Controller
+ *
+ * 用法:
+ *   clock_sync [controller_ip] [port] [interval_ms] [correct]
+ *     預設 127.0.0.1, 5008, 1000, 0；correct = 1 時回送修正值給 Controller
+ *   clock_sync serve [port] [skew_offset_us] [skew_drift_ppm]
+ *     以指定的偏差回應 Request，並列出收到的修正值換算結果 (Loopback 測試用)
+ */
+#include "net/TimeSync.hpp"
+#include "utils/ArgParse.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <signal.h>
+
+namespace
+{
+    volatile sig_atomic_t g_stop = 0;
+    void signal_handler(int) { g_stop = 1; }
+
+    int Serve(int port, int64_t skewOffsetNs, int64_t skewDriftPpb)
+    {
+        Net::TimeSyncServer server;
+        server.SetClockSkew(skewOffsetNs, skewDriftPpb);
+        if (!server.Start(port))
+            return 1;
+        std::cout << "[ClockSync] Serving with skew " << skewOffsetNs / 1000 << " us, "
+                  << skewDriftPpb / 1000.0 << " ppm" << std::endl;
+
+        while (!g_stop)
+        {
+            sleep(1);
+            // 模擬 Batch 時間戳：以偏差後的時鐘取值，再用接收端回送的修正值換回
+            uint64_t realNs = Net::RealtimeNs();
+            uint64_t controllerNs = server.ApplySkew(realNs);
+            uint64_t correctedNs = 0;
+            bool corrected = server.Correct(controllerNs, correctedNs, 30000);
+            std::cout << "[ClockSync] requests " << server.GetRequests() << ", corrections " << server.GetCorrections()
+                      << " (rejected " << server.GetRejectedCorrections() << ")";
+            if (corrected)
+                std::cout << ", residual " << ((int64_t)(correctedNs - realNs)) / 1000.0 << " us";
+            std::cout << std::endl;
+        }
+        server.Stop();
+        return 0;
+    }
+
+    void Usage()
+    {
+        std::cerr << "Usage: clock_sync [controller_ip] [port] [interval_ms] [correct 0|1]\n"
+                  << "       clock_sync serve [port] [skew_offset_us] [skew_drift_ppm]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    signal(SIGINT, signal_handler);
+
+    if (argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")))
+    {
+        Usage();
+        return 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "serve") == 0)
+    {
+        int port = 5008;
+        int64_t skewOffsetUs = 0;
+        double skewDriftPpm = 0.0;
+        if (argc > 5 || (argc > 2 && !Utils::ParsePort(argv[2], port)) ||
+            (argc > 3 && !Utils::ParseInt(argv[3], -1000000000000LL, 1000000000000LL, skewOffsetUs)) ||
+            (argc > 4 && !Utils::ParseDouble(argv[4], -1000000.0, 1000000.0, skewDriftPpm)))
+        {
+            Usage();
+            return 1;
+        }
+        return Serve(port, skewOffsetUs * 1000, (int64_t)(skewDriftPpm * 1000));
+    }
+
+    const char *controllerIp = (argc > 1) ? argv[1] : "127.0.0.1";
+    int port = 5008;
+    long intervalMs = 1000;
+    int correct = 0;
+    if (argc > 5 || (argc > 2 && !Utils::ParsePort(argv[2], port)) ||
+        (argc > 3 && !Utils::ParseInt(argv[3], 1, 3600000, intervalMs)) ||
+        (argc > 4 && !Utils::ParseInt(argv[4], 0, 1, correct)))
+    {
+        Usage();
+        return 1;
+    }
+    bool sendCorrections = (correct != 0);
+
+    Net::ClockSync sync;
+    if (!sync.Init(controllerIp, port, intervalMs, sendCorrections))
+        return 1;
+
+    uint64_t lastReported = 0;
+    while (!g_stop)
+    {
+        sync.Poll();
+        if (sync.Synced() && sync.GetSamples() != lastReported && sync.GetSamples() % 10 == 0)
+        {
+            const Net::ClockCorrection &c = sync.GetCorrection();
+            std::cout << "[ClockSync] samples " << sync.GetSamples()
+                      << ", offset " << c.offsetNs / 1000.0 << " us"
+                      << ", drift " << c.driftPpb / 1000.0 << " ppm"
+                      << ", delay " << sync.GetLastDelayNs() / 1000.0 << " us (min "
+                      << sync.GetMinDelayNs() / 1000.0 << " us)" << std::endl;
+            lastReported = sync.GetSamples();
+        }
+        usleep(1000);
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file codec_bench.cpp
+ * @brief SampleCodec 壓縮率與編解碼速度量測 (使用與 ueipac_sim_sender.py 相同的模擬訊號)
+ *
+ * 用法: codec_bench [sample_rate] [batch_size] [seconds]
+ *   預設 1000 Hz, 每 Batch 100 Samples, 模擬 10 秒, 8 通道
+ */
+#include "net/SampleCodec.hpp"
+#include "utils/ArgParse.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+
+namespace
+{
+    const int NUM_CHANNELS = 8;
+
+    // 與模擬器相同：-10V..+10V 對應 24-bit Offset Binary
+    uint32_t VoltToCode(double voltage)
+    {
+        if (voltage > 10.0)
+            voltage = 10.0;
+        if (voltage < -10.0)
+            voltage = -10.0;
+        long code = (long)((voltage + 10.0) / 20.0 * 16777216.0);
+        if (code > 0xFFFFFF)
+            code = 0xFFFFFF;
+        if (code < 0)
+            code = 0;
+        return (uint32_t)code;
+    }
+
+    double NowSec()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    double sampleRate = 1000.0;
+    int batchSize = 100;
+    double seconds = 10.0;
+    if (argc > 4 || (argc > 1 && !Utils::ParseDouble(argv[1], 1e-3, 1e7, sampleRate)) ||
+        (argc > 2 && !Utils::ParseInt(argv[2], 1, 1000000, batchSize)) ||
+        (argc > 3 && !Utils::ParseDouble(argv[3], 1e-3, 86400.0, seconds)))
+    {
+        std::cerr << "Usage: codec_bench [sample_rate] [batch_size] [seconds]" << std::endl;
+        return 1;
+    }
+
+    // 1. 產生模擬訊號 (Ch0: 2Hz Sine, Ch1: 0.5Hz Sine, Ch2: DC, Ch3: Noise, 其他: 0V)
+    int numBatches = (int)(sampleRate * seconds / batchSize);
+    if (numBatches < 1)
+        numBatches = 1;
+    size_t batchWords = (size_t)batchSize * NUM_CHANNELS;
+    std::vector<uint32_t> raw(batchWords * numBatches);
+
+    srand(1);
+    double dt = 1.0 / sampleRate;
+    for (size_t s = 0; s < (size_t)batchSize * numBatches; s++)
+    {
+        double t = s * dt;
+        for (int ch = 0; ch < NUM_CHANNELS; ch++)
+        {
+            double v = 0.0;
+            if (ch == 0)
+                v = 5.0 * sin(2 * M_PI * 2.0 * t);
+            else if (ch == 1)
+                v = 8.0 * sin(2 * M_PI * 0.5 * t);
+            else if (ch == 2)
+                v = 2.5;
+            else if (ch == 3)
+                v = (rand() / (double)RAND_MAX) * 2.0 - 1.0;
+            raw[s * NUM_CHANNELS + ch] = VoltToCode(v);
+        }
+    }
+
+    // 2. 編碼
+    size_t capacity = Net::SampleCodec::MaxEncodedSize(batchSize, NUM_CHANNELS);
+    std::vector<uint8_t> encoded(capacity * numBatches);
+    std::vector<size_t> encodedSize(numBatches);
+
+    double t0 = NowSec();
+    size_t totalEncoded = 0;
+    for (int b = 0; b < numBatches; b++)
+    {
+        encodedSize[b] = Net::SampleCodec::Encode(&raw[b * batchWords], batchSize, NUM_CHANNELS,
+                                                  &encoded[b * capacity], capacity);
+        totalEncoded += encodedSize[b];
+    }
+    double encodeSec = NowSec() - t0;
+
+    // 3. 解碼並比對
+    std::vector<uint32_t> decoded(batchWords);
+    bool ok = true;
+    double decodeSec = 0.0;
+    for (int b = 0; b < numBatches && ok; b++)
+    {
+        double d0 = NowSec();
+        ok = Net::SampleCodec::Decode(&encoded[b * capacity], encodedSize[b], batchSize, NUM_CHANNELS,
+                                      decoded.data());
+        decodeSec += NowSec() - d0;
+        for (size_t i = 0; i < batchWords && ok; i++)
+            ok = (decoded[i] == raw[b * batchWords + i]);
+    }
+
+    double rawMB = raw.size() * sizeof(uint32_t) / 1e6;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "[Bench] Rate: " << sampleRate << " Hz, Batch: " << batchSize
+              << ", Channels: " << NUM_CHANNELS << ", Batches: " << numBatches << std::endl;
+    std::cout << "[Bench] Raw: " << rawMB << " MB, Encoded: " << totalEncoded / 1e6 << " MB, Ratio: "
+              << (totalEncoded ? rawMB * 1e6 / totalEncoded : 0.0) << " : 1" << std::endl;
+    std::cout << "[Bench] Encode: " << rawMB / encodeSec << " MB/s, Decode: " << rawMB / decodeSec
+              << " MB/s" << std::endl;
+    std::cout << "[Bench] Round-trip: " << (ok ? "OK" : "MISMATCH") << std::endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,744 @@
+/**
+ * @file load_gen.cpp
+ * @brief 多裝置合成負載產生器：依 DAQ_Settings.json 模擬一或多台 Controller，送出完全相同的線路格式
+ *
+ * 用法: load_gen [-c config] [-t ip:port] [-n controllers] [-a] [-b batch_samples] [-w shape]
+ *                [-d seconds] [-L loss%] [-B burst] [-R reorder%] [-D depth] [-U dup%]
+ *   -c  設定檔 (預設 DAQ_Settings.json)：取用 tasks 的取樣率 / 通道 / 編碼 / FEC，
+ *       以及 protocol_version / udp_mtu / udp_batch_* / udp_socket / status
+ *   -t  目標 (預設為設定檔的 udp_target_ip:udp_target_port)
+ *   -n  模擬的 Controller 數 (預設 1)，每台獨立執行緒與 Socket，deviceId 依序加上 100 * 索引
+ *   -a  連同 active = false 的 Task 一併產生 (模擬滿載機箱)
+ *   -b  每個 Batch 的樣本數 (預設 10，與 DaqAI217 相同)
+ *   -w  波形 sine | square | ramp | noise | mixed (預設 mixed：依通道輪流)
+ *   -d  執行秒數 (預設 0 = 直到 Ctrl+C)
+ *   -L / -B  Datagram 遺失率 (%) 與每次遺失的連續長度 (預設 1)
+ *   -R / -D  亂序率 (%) 與延後的 Datagram 數 (預設 3)
+ *   -U  重複率 (%)
+ * 設定任一損傷時，Controller 改送往本機中繼執行緒，由其依比例丟棄 / 延後 / 重複後轉送目標
+ * (以 Datagram 為單位，分段與 FEC Parity 也會受影響)。
+ *
+ * 每秒列出各裝置的目標 / 實際樣本率與 Datagram 率；發送落後排程時立即補送並記錄最大落後時間。
+ */
+#include "utils/ConfigLoader.hpp"
+#include "utils/ArgParse.hpp"
+#include "net/UdpSender.hpp"
+#include "net/ByteOrder.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace
+{
+    volatile sig_atomic_t g_stop = 0;
+    void signal_handler(int) { g_stop = 1; }
+
+    // 每台 Controller 的 deviceId 間隔
+    const int DEVICE_ID_STRIDE = 100;
+    // 中繼執行緒每次 recvmmsg / sendmmsg 的筆數
+    const int RELAY_BURST = 64;
+    const size_t RELAY_MAX_DATAGRAM = 65536;
+
+    // AI-217 的 24 bit Code：0x800000 = 0 V
+    const double CODE_MID = 8388608.0;
+    const double CODE_AMPLITUDE = 4000000.0;
+
+    enum class Shape
+    {
+        Sine,
+        Square,
+        Ramp,
+        Noise,
+        Mixed
+    };
+
+    int64_t MonotonicNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    uint64_t RealtimeNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    void SleepUntilNs(int64_t deadlineNs)
+    {
+        struct timespec ts;
+        ts.tv_sec = deadlineNs / 1000000000LL;
+        ts.tv_nsec = deadlineNs % 1000000000LL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    // xorshift64*：各執行緒獨立，不需同步
+    struct Random
+    {
+        uint64_t state;
+        explicit Random(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+        uint64_t Next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+        double Uniform() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+        bool Percent(double p) { return p > 0 && Uniform() * 100.0 < p; }
+    };
+
+    int CountBits(uint32_t v)
+    {
+        int n = 0;
+        for (; v; v &= v - 1)
+            n++;
+        return n;
+    }
+
+    // 一個虛擬裝置 (對應一個 Task)
+    struct VirtualDevice
+    {
+        Net::PacketHeader desc;
+        std::string name;
+        Utils::FecConfig fec;
+        uint32_t batchSamples = 10;
+        uint64_t batchIndex = 0;
+        int64_t nextDueNs = 0;
+        std::vector<uint32_t> samples;
+
+        std::atomic<uint64_t> batches{0};
+        std::atomic<uint64_t> sentSamples{0};
+    };
+
+    //=========================================================================
+    // 損傷中繼：丟棄 / 延後 / 重複 Datagram 後轉送 (以 recvmmsg / sendmmsg 批次處理)
+    //=========================================================================
+    class ImpairmentRelay
+    {
+    public:
+        ImpairmentRelay() : m_sockfd(-1), m_running(false), m_lossPercent(0), m_burst(1), m_reorderPercent(0),
+                            m_depth(3), m_dupPercent(0), m_forwarded(0), m_dropped(0), m_reordered(0), m_duplicated(0) {}
+        ~ImpairmentRelay() { Stop(); }
+
+        bool Start(const struct sockaddr_in &target, double lossPercent, int burst, double reorderPercent, int depth,
+                   double dupPercent)
+        {
+            m_target = target;
+            m_lossPercent = lossPercent;
+            m_burst = burst > 0 ? burst : 1;
+            m_reorderPercent = reorderPercent;
+            m_depth = depth > 0 ? depth : 1;
+            m_dupPercent = dupPercent;
+
+            m_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+            struct sockaddr_in local;
+            memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            local.sin_port = 0;
+            socklen_t len = sizeof(m_local);
+            int buf = 8 * 1024 * 1024;
+            if (m_sockfd < 0 || bind(m_sockfd, (const struct sockaddr *)&local, sizeof(local)) < 0 ||
+                getsockname(m_sockfd, (struct sockaddr *)&m_local, &len) < 0)
+            {
+                std::cerr << "[LoadGen] Relay bind failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+            setsockopt(m_sockfd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+            setsockopt(m_sockfd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+
+            m_running = true;
+            m_thread = std::thread(&ImpairmentRelay::Run, this);
+            return true;
+        }
+
+        void Stop()
+        {
+            m_running = false;
+            if (m_thread.joinable())
+                m_thread.join();
+            if (m_sockfd >= 0)
+                close(m_sockfd);
+            m_sockfd = -1;
+        }
+
+        int GetPort() const { return ntohs(m_local.sin_port); }
+        uint64_t GetForwarded() const { return m_forwarded; }
+        uint64_t GetDropped() const { return m_dropped; }
+        uint64_t GetReordered() const { return m_reordered; }
+        uint64_t GetDuplicated() const { return m_duplicated; }
+
+    private:
+        struct Held
+        {
+            std::vector<uint8_t> data;
+            size_t length = 0;
+            int remaining = 0; // 之後再轉送幾個 Datagram 才送出
+            bool used = false;
+        };
+
+        void Run()
+        {
+            std::vector<uint8_t> buffers(RELAY_BURST * RELAY_MAX_DATAGRAM);
+            struct mmsghdr in[RELAY_BURST];
+            struct iovec inIov[RELAY_BURST];
+            for (int i = 0; i < RELAY_BURST; i++)
+            {
+                inIov[i].iov_base = buffers.data() + (size_t)i * RELAY_MAX_DATAGRAM;
+                inIov[i].iov_len = RELAY_MAX_DATAGRAM;
+                memset(&in[i], 0, sizeof(in[i]));
+                in[i].msg_hdr.msg_iov = &inIov[i];
+                in[i].msg_hdr.msg_iovlen = 1;
+            }
+            // 轉送清單：每個輸入最多產生 1 + 重複 1 + 釋放延後的若干筆
+            std::vector<struct mmsghdr> out;
+            std::vector<struct iovec> outIov;
+            m_held.resize(RELAY_BURST);
+            for (size_t i = 0; i < m_held.size(); i++)
+                m_held[i].data.resize(RELAY_MAX_DATAGRAM);
+            Random rng((uint64_t)MonotonicNs());
+            int burstLeft = 0;
+
+            while (m_running)
+            {
+                struct pollfd pfd = {m_sockfd, POLLIN, 0};
+                if (poll(&pfd, 1, 100) <= 0)
+                    continue;
+                int n = recvmmsg(m_sockfd, in, RELAY_BURST, MSG_DONTWAIT, NULL);
+                if (n <= 0)
+                    continue;
+
+                outIov.clear();
+                for (int i = 0; i < n; i++)
+                {
+                    uint8_t *data = (uint8_t *)inIov[i].iov_base;
+                    size_t length = in[i].msg_len;
+
+                    if (burstLeft > 0 || rng.Percent(m_lossPercent))
+                    {
+                        burstLeft = (burstLeft > 0) ? burstLeft - 1 : m_burst - 1;
+                        m_dropped++;
+                        continue;
+                    }
+                    if (rng.Percent(m_reorderPercent) && Hold(data, length))
+                    {
+                        m_reordered++;
+                        continue;
+                    }
+
+                    Append(outIov, data, length);
+                    if (rng.Percent(m_dupPercent))
+                    {
+                        Append(outIov, data, length);
+                        m_duplicated++;
+                    }
+                    Release(outIov);
+                }
+                if (outIov.empty())
+                    continue;
+
+                out.resize(outIov.size());
+                for (size_t i = 0; i < out.size(); i++)
+                {
+                    memset(&out[i], 0, sizeof(out[i]));
+                    out[i].msg_hdr.msg_name = &m_target;
+                    out[i].msg_hdr.msg_namelen = sizeof(m_target);
+                    out[i].msg_hdr.msg_iov = &outIov[i];
+                    out[i].msg_hdr.msg_iovlen = 1;
+                }
+                size_t offset = 0;
+                while (offset < out.size())
+                {
+                    int sent = sendmmsg(m_sockfd, &out[offset], (unsigned int)(out.size() - offset), 0);
+                    if (sent <= 0)
+                    {
+                        offset++;
+                        continue;
+                    }
+                    m_forwarded += sent;
+                    offset += sent;
+                }
+                // 已送出的延後 Datagram 才釋放 Slot
+                for (size_t i = 0; i < m_held.size(); i++)
+                {
+                    if (m_held[i].used && m_held[i].remaining < 0)
+                        m_held[i].used = false;
+                }
+            }
+        }
+
+        static void Append(std::vector<struct iovec> &list, const uint8_t *data, size_t length)
+        {
+            struct iovec iov;
+            iov.iov_base = const_cast<uint8_t *>(data);
+            iov.iov_len = length;
+            list.push_back(iov);
+        }
+
+        bool Hold(const uint8_t *data, size_t length)
+        {
+            for (size_t i = 0; i < m_held.size(); i++)
+            {
+                Held &h = m_held[i];
+                if (h.used)
+                    continue;
+                memcpy(h.data.data(), data, length);
+                h.length = length;
+                h.remaining = m_depth;
+                h.used = true;
+                return true;
+            }
+            return false; // 延後中的 Datagram 已滿：照常轉送
+        }
+
+        // 每轉送一筆，延後中的 Datagram 倒數一次；到期者附加在後面送出 (remaining = -1 表示送出後釋放)
+        void Release(std::vector<struct iovec> &list)
+        {
+            for (size_t i = 0; i < m_held.size(); i++)
+            {
+                Held &h = m_held[i];
+                if (!h.used || h.remaining < 0)
+                    continue;
+                if (--h.remaining == 0)
+                {
+                    Append(list, h.data.data(), h.length);
+                    h.remaining = -1;
+                }
+            }
+        }
+
+        int m_sockfd;
+        struct sockaddr_in m_local;
+        struct sockaddr_in m_target;
+        std::thread m_thread;
+        std::atomic<bool> m_running;
+        std::vector<Held> m_held;
+
+        double m_lossPercent;
+        int m_burst;
+        double m_reorderPercent;
+        int m_depth;
+        double m_dupPercent;
+
+        std::atomic<uint64_t> m_forwarded;
+        std::atomic<uint64_t> m_dropped;
+        std::atomic<uint64_t> m_reordered;
+        std::atomic<uint64_t> m_duplicated;
+    };
+
+    //=========================================================================
+    // 虛擬 Controller：一個執行緒、一個 UdpSender，依排程輪流產生各裝置的 Batch
+    //=========================================================================
+    class VirtualController
+    {
+    public:
+        VirtualController(int index, Shape shape) : m_shape(shape), m_rng(0x1234 + (uint64_t)index), m_sentDatagrams(0), m_maxLagNs(0) {}
+
+        std::vector<std::unique_ptr<VirtualDevice>> &Devices() { return m_devices; }
+        uint64_t GetSentDatagrams() const { return m_sentDatagrams; }
+        int64_t GetMaxLagNs() const { return m_maxLagNs; }
+
+        bool Init(const Utils::SystemConfig &config, const std::string &ip, int port)
+        {
+            Net::SocketOptions options;
+            options.sendBufferBytes = config.udpSocket.sendBufferBytes;
+            options.dscp = config.udpSocket.dscp;
+            options.priority = config.udpSocket.priority;
+            options.nonBlocking = config.udpSocket.nonBlocking;
+            if (!m_sender.Init(ip, port, options))
+                return false;
+            m_sender.SetProtocolVersion(config.protocolVersion);
+            m_sender.SetMtu(config.udpMtu);
+            m_sender.SetBatching(config.udpBatchMaxMessages, config.udpBatchMaxDelayUs);
+            m_sender.SetRawByteSwap(!Net::HostIsBigEndian());
+            m_statusIntervalMs = config.status.active ? config.status.intervalMs : 0;
+
+            for (size_t d = 0; d < m_devices.size(); d++)
+            {
+                const VirtualDevice &dev = *m_devices[d];
+                if (!dev.fec.active)
+                    continue;
+                Net::FecScheme scheme = (dev.fec.scheme == "rs") ? Net::FecScheme::ReedSolomon : Net::FecScheme::Xor;
+                m_sender.EnableFec(dev.desc.deviceId, scheme, dev.fec.groupSize, dev.fec.parityCount, dev.fec.maxDelayUs);
+            }
+            return true;
+        }
+
+        void Start() { m_thread = std::thread(&VirtualController::Run, this); }
+        void Join()
+        {
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+    private:
+        void Fill(VirtualDevice &dev)
+        {
+            const Net::PacketHeader &h = dev.desc;
+            size_t nc = h.numChannels;
+            dev.samples.resize((size_t)dev.batchSamples * nc);
+            for (uint32_t s = 0; s < dev.batchSamples; s++)
+            {
+                double t = (double)(h.firstSampleIndex + s) / h.sampleRate;
+                for (size_t c = 0; c < nc; c++)
+                {
+                    // 各通道頻率不同 (1, 2, 3 ... Hz)，Mixed 時依通道輪流四種波形
+                    double f = 1.0 + (double)c;
+                    Shape shape = (m_shape == Shape::Mixed) ? (Shape)(c % 4) : m_shape;
+                    double v;
+                    switch (shape)
+                    {
+                    case Shape::Square:
+                        v = (std::fmod(t * f, 1.0) < 0.5) ? 1.0 : -1.0;
+                        break;
+                    case Shape::Ramp:
+                        v = 2.0 * std::fmod(t * f, 1.0) - 1.0;
+                        break;
+                    case Shape::Noise:
+                        v = m_rng.Uniform() * 2.0 - 1.0;
+                        break;
+                    default:
+                        v = std::sin(2.0 * M_PI * f * t);
+                        break;
+                    }
+                    dev.samples[s * nc + c] = (uint32_t)(CODE_MID + v * CODE_AMPLITUDE);
+                }
+            }
+        }
+
+        void SendStatus(int64_t nowNs)
+        {
+            Net::StatusReport report;
+            report.uptimeMs = (uint64_t)((nowNs - m_startNs) / 1000000);
+            report.statusSeq = m_statusSeq++;
+            report.sendErrors = (uint32_t)m_sender.GetSendErrors();
+            for (size_t d = 0; d < m_devices.size() && d < Net::STATUS_MAX_DEVICES; d++)
+            {
+                Net::DeviceStatus status;
+                status.deviceId = m_devices[d]->desc.deviceId;
+                status.samples = m_devices[d]->sentSamples;
+                report.devices.push_back(status);
+            }
+            m_sender.SendStatus(report);
+        }
+
+        void Run()
+        {
+            m_startNs = MonotonicNs();
+            uint64_t startRealNs = RealtimeNs();
+            int64_t lastStatusNs = m_startNs;
+            for (size_t d = 0; d < m_devices.size(); d++)
+                m_devices[d]->nextDueNs = m_startNs;
+
+            while (!g_stop && !m_devices.empty())
+            {
+                // 下一個到期的裝置
+                VirtualDevice *next = m_devices[0].get();
+                for (size_t d = 1; d < m_devices.size(); d++)
+                {
+                    if (m_devices[d]->nextDueNs < next->nextDueNs)
+                        next = m_devices[d].get();
+                }
+
+                int64_t nowNs = MonotonicNs();
+                if (next->nextDueNs > nowNs)
+                {
+                    // 等待期間仍需處理批次 / FEC 期限 (最多睡 1 ms)
+                    int64_t wakeNs = next->nextDueNs;
+                    if (wakeNs - nowNs > 1000000)
+                        wakeNs = nowNs + 1000000;
+                    SleepUntilNs(wakeNs);
+                    m_sender.Poll();
+                    m_sentDatagrams = m_sender.GetSentDatagrams();
+                    continue;
+                }
+                if (nowNs - next->nextDueNs > m_maxLagNs)
+                    m_maxLagNs = nowNs - next->nextDueNs;
+
+                Net::PacketHeader &h = next->desc;
+                h.seqId = next->batchIndex + 1;
+                h.firstSampleIndex = next->batchIndex * next->batchSamples;
+                h.timestampNs = startRealNs + (uint64_t)(h.firstSampleIndex * 1e9 / h.sampleRate);
+                h.numSamples = next->batchSamples;
+                Fill(*next);
+                m_sender.SendBatch(h, next->samples.data(), next->samples.size());
+                next->batches++;
+                next->sentSamples += next->batchSamples;
+
+                next->batchIndex++;
+                next->nextDueNs = m_startNs + (int64_t)((next->batchIndex * next->batchSamples) * 1e9 / h.sampleRate);
+
+                m_sender.Poll();
+                if (m_statusIntervalMs > 0 && nowNs - lastStatusNs >= m_statusIntervalMs * 1000000LL)
+                {
+                    SendStatus(nowNs);
+                    lastStatusNs = nowNs;
+                }
+                m_sentDatagrams = m_sender.GetSentDatagrams();
+            }
+            m_sender.Flush();
+            m_sentDatagrams = m_sender.GetSentDatagrams();
+            m_sender.Close();
+        }
+
+        Shape m_shape;
+        Random m_rng;
+        Net::UdpSender m_sender;
+        std::vector<std::unique_ptr<VirtualDevice>> m_devices;
+        std::thread m_thread;
+        long m_statusIntervalMs = 0;
+        uint32_t m_statusSeq = 0;
+        int64_t m_startNs = 0;
+
+        std::atomic<uint64_t> m_sentDatagrams;
+        std::atomic<int64_t> m_maxLagNs;
+    };
+
+    void Usage()
+    {
+        std::cerr << "Usage: load_gen [-c config] [-t ip:port] [-n controllers] [-a] [-b batch_samples] [-w shape]"
+                  << " [-d seconds] [-L loss%] [-B burst] [-R reorder%] [-D depth] [-U dup%]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string configPath = "DAQ_Settings.json";
+    std::string targetIp;
+    int targetPort = 0;
+    int controllers = 1;
+    bool includeInactive = false;
+    int batchSamples = 10;
+    Shape shape = Shape::Mixed;
+    long duration = 0;
+    double lossPercent = 0, reorderPercent = 0, dupPercent = 0;
+    int burst = 1, depth = 3;
+
+    int opt;
+    bool ok = true;
+    while (ok && (opt = getopt(argc, argv, "c:t:n:ab:w:d:L:B:R:D:U:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            configPath = optarg;
+            break;
+        case 't':
+            ok = Utils::ParseEndpoint(optarg, targetIp, targetPort);
+            break;
+        case 'n':
+            ok = Utils::ParseInt(optarg, 1, 1000, controllers);
+            break;
+        case 'a':
+            includeInactive = true;
+            break;
+        case 'b':
+            ok = Utils::ParseInt(optarg, 1, 1000000, batchSamples);
+            break;
+        case 'w':
+            if (strcmp(optarg, "sine") == 0)
+                shape = Shape::Sine;
+            else if (strcmp(optarg, "square") == 0)
+                shape = Shape::Square;
+            else if (strcmp(optarg, "ramp") == 0)
+                shape = Shape::Ramp;
+            else if (strcmp(optarg, "noise") == 0)
+                shape = Shape::Noise;
+            else if (strcmp(optarg, "mixed") == 0)
+                shape = Shape::Mixed;
+            else
+                ok = false;
+            break;
+        case 'd':
+            ok = Utils::ParseInt(optarg, 0, 100000000, duration);
+            break;
+        case 'L':
+            ok = Utils::ParseDouble(optarg, 0.0, 100.0, lossPercent);
+            break;
+        case 'B':
+            ok = Utils::ParseInt(optarg, 1, 100000, burst);
+            break;
+        case 'R':
+            ok = Utils::ParseDouble(optarg, 0.0, 100.0, reorderPercent);
+            break;
+        case 'D':
+            ok = Utils::ParseInt(optarg, 1, 100000, depth);
+            break;
+        case 'U':
+            ok = Utils::ParseDouble(optarg, 0.0, 100.0, dupPercent);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+    }
+    if (!ok)
+    {
+        Usage();
+        return 1;
+    }
+
+    Utils::SystemConfig config;
+    try
+    {
+        config = Utils::ConfigLoader::load(configPath);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (targetIp.empty())
+        targetIp = config.udpIp;
+    if (targetPort == 0)
+        targetPort = config.udpPort;
+
+    signal(SIGINT, signal_handler);
+
+    // 1. 損傷中繼 (需要時)
+    struct sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(targetPort);
+    if (inet_aton(targetIp.c_str(), &target.sin_addr) == 0)
+    {
+        std::cerr << "[LoadGen] Invalid target IP: " << targetIp << std::endl;
+        return 1;
+    }
+    ImpairmentRelay relay;
+    bool impaired = lossPercent > 0 || reorderPercent > 0 || dupPercent > 0;
+    std::string sendIp = targetIp;
+    int sendPort = targetPort;
+    if (impaired)
+    {
+        if (!relay.Start(target, lossPercent, burst, reorderPercent, depth, dupPercent))
+            return 1;
+        sendIp = "127.0.0.1";
+        sendPort = relay.GetPort();
+        std::cout << "[LoadGen] Impairment: loss " << lossPercent << "% (burst " << burst << "), reorder "
+                  << reorderPercent << "% (depth " << depth << "), duplicate " << dupPercent << "%" << std::endl;
+    }
+
+    // 2. 建立虛擬 Controller 與裝置
+    std::vector<std::unique_ptr<VirtualController>> ctrls;
+    double targetSampleRate = 0;
+    for (int c = 0; c < controllers; c++)
+    {
+        std::unique_ptr<VirtualController> ctrl(new VirtualController(c, shape));
+        for (const auto &task : config.taskConfigs)
+        {
+            if ((!task.active && !includeInactive) || task.sampleRate <= 0)
+                continue;
+
+            std::unique_ptr<VirtualDevice> dev(new VirtualDevice());
+            dev->name = task.taskName;
+            dev->fec = task.fec;
+            dev->batchSamples = (uint32_t)batchSamples;
+            Net::PacketHeader &h = dev->desc;
+            h.deviceId = (uint16_t)(task.deviceId + c * DEVICE_ID_STRIDE);
+            for (const auto &ch : task.channels)
+            {
+                if (ch.active)
+                    h.channelMask |= Net::ChannelMaskFromRange(ch.channelRange);
+            }
+            h.numChannels = (uint16_t)CountBits(h.channelMask);
+            if (h.numChannels == 0)
+                continue;
+            h.sampleRate = task.sampleRate;
+            if (!Net::SampleCodec::ParseEncoding(task.encoding, h.encoding))
+                h.encoding = Net::SampleEncoding::Raw;
+            if (c == 0)
+                targetSampleRate += task.sampleRate;
+            ctrl->Devices().push_back(std::move(dev));
+        }
+        if (!ctrl->Init(config, sendIp, sendPort))
+            return 1;
+        ctrls.push_back(std::move(ctrl));
+    }
+    if (ctrls[0]->Devices().empty())
+    {
+        std::cerr << "[LoadGen] No active tasks in " << configPath << " (use -a to include inactive tasks)" << std::endl;
+        return 1;
+    }
+
+    std::cout << "[LoadGen] " << controllers << " controller(s) x " << ctrls[0]->Devices().size() << " device(s) -> "
+              << targetIp << ":" << targetPort << ", batch " << batchSamples << " samples, target "
+              << targetSampleRate << " samples/s per controller" << std::endl;
+    for (size_t d = 0; d < ctrls[0]->Devices().size(); d++)
+    {
+        const VirtualDevice &dev = *ctrls[0]->Devices()[d];
+        std::cout << "  dev " << dev.desc.deviceId << " " << dev.name << ": " << dev.desc.numChannels << " ch @ "
+                  << dev.desc.sampleRate << " Hz, " << Net::SampleCodec::EncodingName(dev.desc.encoding)
+                  << ", " << dev.desc.sampleRate / batchSamples << " batches/s" << std::endl;
+    }
+
+    for (size_t c = 0; c < ctrls.size(); c++)
+        ctrls[c]->Start();
+
+    // 3. 每秒統計
+    int64_t startNs = MonotonicNs();
+    int64_t lastNs = startNs;
+    uint64_t lastSamples = 0, lastDatagrams = 0, lastBatches = 0;
+    while (!g_stop)
+    {
+        usleep(100000);
+        int64_t nowNs = MonotonicNs();
+        if (duration > 0 && nowNs - startNs >= duration * 1000000000LL)
+            g_stop = 1;
+        if (nowNs - lastNs < 1000000000LL && !g_stop)
+            continue;
+
+        double sec = (nowNs - lastNs) / 1e9;
+        uint64_t samples = 0, datagrams = 0, batches = 0, channelSamples = 0;
+        int64_t maxLagNs = 0;
+        for (size_t c = 0; c < ctrls.size(); c++)
+        {
+            datagrams += ctrls[c]->GetSentDatagrams();
+            if (ctrls[c]->GetMaxLagNs() > maxLagNs)
+                maxLagNs = ctrls[c]->GetMaxLagNs();
+            for (size_t d = 0; d < ctrls[c]->Devices().size(); d++)
+            {
+                const VirtualDevice &dev = *ctrls[c]->Devices()[d];
+                samples += dev.sentSamples;
+                batches += dev.batches;
+                channelSamples += dev.sentSamples * dev.desc.numChannels;
+            }
+        }
+        std::cout << "[LoadGen] " << (uint64_t)((samples - lastSamples) / sec) << " samples/s (target "
+                  << (uint64_t)(targetSampleRate * controllers) << "), " << (uint64_t)((batches - lastBatches) / sec)
+                  << " batches/s, " << (uint64_t)((datagrams - lastDatagrams) / sec) << " dgram/s, "
+                  << channelSamples << " channel-samples total, max lag " << maxLagNs / 1000 << " us";
+        if (impaired)
+            std::cout << " | relay fwd " << relay.GetForwarded() << ", dropped " << relay.GetDropped() << ", reordered "
+                      << relay.GetReordered() << ", dup " << relay.GetDuplicated();
+        std::cout << std::endl;
+        lastNs = nowNs;
+        lastSamples = samples;
+        lastDatagrams = datagrams;
+        lastBatches = batches;
+    }
+
+    for (size_t c = 0; c < ctrls.size(); c++)
+        ctrls[c]->Join();
+    usleep(200000); // 讓中繼送完延後中的 Datagram
+    relay.Stop();
+    return 0;
+}
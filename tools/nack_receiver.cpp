@@ -0,0 +1,217 @@
+/**
+ * @file nack_receiver.cpp
+ * @brief NACK 重送測試用接收端：偵測序號缺口並向 Controller 要求重送
+ *
+ * 用法: nack_receiver [listen_port] [controller_ip] [nack_port] [drop_percent]
+ *   預設 5005, 127.0.0.1, 5006, 0
+ *   drop_percent > 0 時會故意丟棄部分原始封包 (重送封包不丟)，用來驗證補送流程。
+ */
+#include "net/FragmentReassembler.hpp"
+#include "utils/ArgParse.hpp"
+#include <iostream>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace
+{
+    volatile sig_atomic_t g_stop = 0;
+    void signal_handler(int) { g_stop = 1; }
+
+    const int64_t RENACK_INTERVAL_US = 200000; // 尚未補到的序號多久後再要求一次
+    const int64_t GIVE_UP_US = 5000000;        // 超過此時間仍未補到視為永久遺失
+
+    struct DeviceState
+    {
+        bool started = false;
+        uint64_t expectedSeq = 0;
+        std::map<uint64_t, int64_t> missing; // seq -> 第一次 NACK 時間
+        std::map<uint64_t, int64_t> lastNack; // seq -> 最後一次 NACK 時間
+    };
+
+    int64_t NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    void Usage()
+    {
+        std::cerr << "Usage: nack_receiver [listen_port] [controller_ip] [nack_port] [drop_percent 0-100]" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int listenPort = 5005;
+    const char *controllerIp = (argc > 2) ? argv[2] : "127.0.0.1";
+    int nackPort = 5006;
+    int dropPercent = 0;
+    if (argc > 5 || (argc > 1 && !Utils::ParsePort(argv[1], listenPort)) ||
+        (argc > 3 && !Utils::ParsePort(argv[3], nackPort)) ||
+        (argc > 4 && !Utils::ParseInt(argv[4], 0, 100, dropPercent)))
+    {
+        Usage();
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(listenPort);
+    if (sockfd < 0 || bind(sockfd, (const struct sockaddr *)&local, sizeof(local)) < 0)
+    {
+        std::cerr << "[NACK-RX] Bind failed on port " << listenPort << std::endl;
+        return 1;
+    }
+
+    struct sockaddr_in controller;
+    memset(&controller, 0, sizeof(controller));
+    controller.sin_family = AF_INET;
+    controller.sin_port = htons(nackPort);
+    if (inet_aton(controllerIp, &controller.sin_addr) == 0)
+    {
+        std::cerr << "[NACK-RX] Invalid controller IP: " << controllerIp << std::endl;
+        return 1;
+    }
+
+    std::cout << "[NACK-RX] Listening on " << listenPort << ", NACK -> " << controllerIp << ":" << nackPort
+              << ", simulated drop " << dropPercent << "%" << std::endl;
+
+    Net::FragmentReassembler reassembler;
+    Net::ReassembledBatch batch;
+    std::map<uint16_t, DeviceState> devices;
+    uint8_t buffer[65536];
+    uint8_t nackBuffer[Net::NACK_HEADER_SIZE + Net::NACK_MAX_RANGES * Net::NACK_RANGE_SIZE];
+    Net::NackRange ranges[Net::NACK_MAX_RANGES];
+
+    uint64_t received = 0, dropped = 0, gaps = 0, recovered = 0, lost = 0, nacksSent = 0;
+    int64_t lastReportUs = NowUs();
+    srand((unsigned)time(NULL));
+
+    while (!g_stop)
+    {
+        struct pollfd pfd = {sockfd, POLLIN, 0};
+        if (poll(&pfd, 1, 50) > 0)
+        {
+            ssize_t n = recv(sockfd, buffer, sizeof(buffer), 0);
+            if (n > 0)
+            {
+                Net::PacketHeader header;
+                bool isRetransmit = Net::ParseHeader(buffer, (size_t)n, header) &&
+                                    (header.flags & Net::WIRE_FLAG_RETRANSMIT);
+
+                // 模擬丟包 (只丟原始封包)
+                if (!isRetransmit && dropPercent > 0 && rand() % 100 < dropPercent)
+                {
+                    dropped++;
+                }
+                else
+                {
+                    received++;
+                    if (reassembler.Push(buffer, (size_t)n, batch))
+                    {
+                        DeviceState &dev = devices[batch.header.deviceId];
+                        uint64_t seq = batch.header.seqId;
+                        int64_t nowUs = NowUs();
+
+                        if (!dev.started)
+                        {
+                            dev.started = true;
+                            dev.expectedSeq = seq + 1;
+                        }
+                        else if (seq >= dev.expectedSeq)
+                        {
+                            // 新缺口：立即 NACK
+                            size_t rangeCount = 0;
+                            if (seq > dev.expectedSeq)
+                            {
+                                uint64_t gap = seq - dev.expectedSeq;
+                                gaps += gap;
+                                for (uint64_t s = dev.expectedSeq; s < seq; s++)
+                                {
+                                    dev.missing[s] = nowUs;
+                                    dev.lastNack[s] = nowUs;
+                                }
+                                ranges[rangeCount].firstSeq = dev.expectedSeq;
+                                ranges[rangeCount].count = (uint16_t)(gap > 0xFFFF ? 0xFFFF : gap);
+                                rangeCount++;
+                            }
+                            dev.expectedSeq = seq + 1;
+
+                            if (rangeCount > 0)
+                            {
+                                size_t len = Net::WriteNack(batch.header.deviceId, ranges, rangeCount,
+                                                            nackBuffer, sizeof(nackBuffer));
+                                sendto(sockfd, nackBuffer, len, 0, (const struct sockaddr *)&controller, sizeof(controller));
+                                nacksSent++;
+                            }
+                        }
+                        else if (dev.missing.erase(seq))
+                        {
+                            dev.lastNack.erase(seq);
+                            recovered++;
+                        }
+                    }
+                }
+            }
+        }
+
+        // 週期性重新要求尚未補到的序號，並放棄過舊的
+        int64_t nowUs = NowUs();
+        for (std::map<uint16_t, DeviceState>::iterator it = devices.begin(); it != devices.end(); ++it)
+        {
+            DeviceState &dev = it->second;
+            size_t rangeCount = 0;
+            for (std::map<uint64_t, int64_t>::iterator m = dev.missing.begin(); m != dev.missing.end();)
+            {
+                if (nowUs - m->second > GIVE_UP_US)
+                {
+                    dev.lastNack.erase(m->first);
+                    dev.missing.erase(m++);
+                    lost++;
+                    continue;
+                }
+                if (nowUs - dev.lastNack[m->first] > RENACK_INTERVAL_US && rangeCount < Net::NACK_MAX_RANGES)
+                {
+                    ranges[rangeCount].firstSeq = m->first;
+                    ranges[rangeCount].count = 1;
+                    rangeCount++;
+                    dev.lastNack[m->first] = nowUs;
+                }
+                ++m;
+            }
+            if (rangeCount > 0)
+            {
+                size_t len = Net::WriteNack(it->first, ranges, rangeCount, nackBuffer, sizeof(nackBuffer));
+                sendto(sockfd, nackBuffer, len, 0, (const struct sockaddr *)&controller, sizeof(controller));
+                nacksSent++;
+            }
+        }
+
+        if (nowUs - lastReportUs >= 1000000)
+        {
+            size_t outstanding = 0;
+            for (std::map<uint16_t, DeviceState>::iterator it = devices.begin(); it != devices.end(); ++it)
+                outstanding += it->second.missing.size();
+            std::cout << "[NACK-RX] Datagrams: " << received << ", Dropped(sim): " << dropped
+                      << ", Gaps: " << gaps << ", Recovered: " << recovered << ", Outstanding: " << outstanding
+                      << ", Lost: " << lost << ", NACKs: " << nacksSent << std::endl;
+            lastReportUs = nowUs;
+        }
+    }
+
+    close(sockfd);
+    return 0;
+}
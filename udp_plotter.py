@@ -26,6 +26,7 @@ class SystemMapper:
         self.device_map = {} 
         self.slot_rates = {}
         self.slot_modes = {}
+        self.device_slots = {}  # v2 Header 的 device_id -> slot
         self.load_config(config_path)
 
     def load_config(self, path):
@@ -33,8 +34,9 @@ class SystemMapper:
             with open(path, 'r', encoding='utf-8') as f:
                 config = json.load(f)
             print(f"[System] Loading Config: {config.get('system_name')}")
-            for task in config.get('tasks', []):
+            for task_idx, task in enumerate(config.get('tasks', [])):
                 if not task.get('active', False): continue
+                device_id = int(task.get('device_id', task_idx))
                 task_rate = float(task.get('sample_rate', 1000.0))
                 for ch in task.get('channels', []):
                     if not ch.get('active', True): continue
@@ -48,6 +50,8 @@ class SystemMapper:
                         self.device_map[dev_name] = idx
                         self.slot_rates[idx] = eff_rate
                         self.slot_modes[idx] = "FFT" if is_fft else "TIME"
+                    if device_id not in self.device_slots:
+                        self.device_slots[device_id] = self.device_map[dev_name]
         except Exception:
             self.device_map = {"Dev1": 0}
             self.slot_titles = ["Slot 1: Dev1 (Mock)"]
@@ -117,16 +121,52 @@ class RealTimePlotter:
             except: break
         sock.close()
 
+    def print_status(self, raw_data):
+        # Status 封包 (格式見 WireProtocol.hpp)：固定區 64 Byte + 每裝置 40 Byte
+        (_, _, _, header_len, dev_count, _, uptime_ms, status_seq, send_errors,
+         q_depth, q_high, q_dropped, send_avg, send_max) = struct.unpack('>HBBHBBQIIIIIII', raw_data[:44])
+        print(f"[Status #{status_seq}] uptime {uptime_ms / 1000.0:.0f}s, send queue {q_depth}/{q_high} "
+              f"dropped {q_dropped}, send errors {send_errors}, send avg {send_avg}us max {send_max}us")
+        for i in range(dev_count):
+            offset = header_len + i * 40
+            if len(raw_data) < offset + 40: break
+            (dev_id, dq_depth, dq_high, _, samples, read_errors, dq_dropped,
+             jitter_avg, jitter_max, loop_avg, loop_max) = struct.unpack('>HHHHQIIIIII', raw_data[offset:offset + 40])
+            print(f"    dev {dev_id}: samples {samples}, read errors {read_errors}, queue {dq_depth}/{dq_high} "
+                  f"dropped {dq_dropped}, jitter avg {jitter_avg}us max {jitter_max}us, loop avg {loop_avg}us max {loop_max}us")
+
     def process_packet(self, raw_data):
         HEADER_SIZE = 16
+        V2_HEADER_SIZE = 64
         if len(raw_data) < HEADER_SIZE: return
 
         try:
-            # 1. Header 解析
-            seq_id, timestamp, num_samples, num_ch = struct.unpack('>IdHH', raw_data[:HEADER_SIZE])
-            
+            # 1. Header 解析 (v2: 'UE' + version 2，否則視為 v1)
+            if raw_data[0:2] == b'UE' and raw_data[2] == 2:
+                if len(raw_data) >= V2_HEADER_SIZE and raw_data[3] == 3:
+                    self.print_status(raw_data)
+                    return
+                # NACK / FEC Parity 等非資料封包可能短於 64 Byte
+                if len(raw_data) < V2_HEADER_SIZE or raw_data[3] != 0: return
+                (_, _, packet_type, header_len, encoding, flags, device_id, num_ch, ch_mask,
+                 seq_id, first_index, ts_ns, sample_rate, num_samples,
+                 frag_index, frag_count, frag_offset, payload_bytes) = struct.unpack('>HBBHBBHHIQQQdIHHII', raw_data[:V2_HEADER_SIZE])
+                # 只處理未分段的 Raw 資料封包，其他請使用 C++ 接收端
+                if packet_type != 0 or encoding != 0 or frag_count > 1: return
+                target_slot = self.mapper.device_slots.get(device_id, 0)
+            else:
+                seq_id, timestamp, num_samples, num_ch = struct.unpack('>IdHH', raw_data[:HEADER_SIZE])
+
+                # numChannels 高 8 bit 為 Payload 編碼 (0 = Raw) 與分段旗標 (0x80)
+                # 壓縮或分段封包需以 C++ SampleCodec / FragmentReassembler 處理，此處略過
+                encoding = num_ch >> 8
+                num_ch = num_ch & 0xFF
+                if encoding != 0: return
+                header_len = HEADER_SIZE
+                target_slot = 0
+
             # 2. [修正] 使用 '>u4' (Unsigned Big Endian) 讀取 Raw Data
-            raw_array = np.frombuffer(raw_data, dtype='>u4', offset=HEADER_SIZE)
+            raw_array = np.frombuffer(raw_data, dtype='>u4', offset=header_len)
             
             if len(raw_array) != num_samples * num_ch: return
 
@@ -148,7 +188,7 @@ class RealTimePlotter:
             volt_matrix = ((codes - 8388608.0) / 8388608.0) * 10.0
 
             # 4. 存入 Buffer (維持原樣)
-            target_slot = 0 
+            if target_slot >= len(self.buffers): return
             maxlen = self.slot_max_lens.get(target_slot, 20000)
 
             for ch in range(num_ch):